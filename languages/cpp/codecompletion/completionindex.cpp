@@ -0,0 +1,205 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "completionindex.h"
+
+#include <QSet>
+#include <QtAlgorithms>
+
+#include <kglobal.h>
+
+#include <language/duchain/topducontext.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchain.h>
+
+using namespace KDevelop;
+
+namespace Cpp {
+
+K_GLOBAL_STATIC(CompletionIndex, completionIndex)
+
+///The cached lookahead members are dropped when there are more entries than this
+const int maxLookaheadEntries = 20000;
+
+CompletionIndex* CompletionIndex::self()
+{
+  return completionIndex;
+}
+
+QString CompletionIndex::humps(const QString& identifier)
+{
+  QString ret;
+  for (int a = 0; a < identifier.size(); ++a) {
+    const QChar c = identifier[a];
+    if (!c.isLetterOrNumber())
+      continue;
+    const bool start = a == 0 || !identifier[a-1].isLetterOrNumber()
+                       || (c.isUpper() && !identifier[a-1].isUpper())
+                       //The last upper-case letter of an acronym starts the next hump, like the 'R' in "XMLReader"
+                       || (c.isUpper() && a+1 < identifier.size() && identifier[a+1].isLower());
+    if (start)
+      ret += c.toLower();
+  }
+  return ret;
+}
+
+CompletionIndex::FileIndex CompletionIndex::fileIndex(TopDUContext* top)
+{
+  const uint index = top->ownIndex();
+  {
+    QMutexLocker lock(&m_mutex);
+    QHash<uint, FileIndex>::const_iterator it = m_files.constFind(index);
+    if (it != m_files.constEnd() && (*it).url == top->url())
+      return *it;
+  }
+
+  FileIndex file;
+  file.url = top->url();
+  addEntries(top, file);
+  qSort(file.names);
+  qSort(file.humps);
+
+  QMutexLocker lock(&m_mutex);
+  m_files.insert(index, file);
+  return file;
+}
+
+void CompletionIndex::addEntries(DUContext* context, FileIndex& file)
+{
+  foreach (Declaration* decl, context->localDeclarations()) {
+    const QString identifier = decl->identifier().identifier().str();
+    if (identifier.isEmpty())
+      continue;
+    const IndexedDeclaration indexed(decl);
+    file.names << Entry(identifier.toLower(), indexed);
+    //A single hump is the first letter of the name, so it is matched as prefix already
+    const QString humps = CompletionIndex::humps(identifier);
+    if (humps.size() > 1)
+      file.humps << Entry(humps, indexed);
+  }
+
+  //The enumerators of unscoped enums and the members of anonymous unions are visible in the global scope too
+  foreach (DUContext* child, context->childContexts())
+    if (child->isPropagateDeclarations())
+      addEntries(child, file);
+}
+
+DUContext* CompletionIndex::visibleScope(Declaration* decl)
+{
+  DUContext* context = decl->context();
+  while (context && context->isPropagateDeclarations())
+    context = context->parentContext();
+  return context;
+}
+
+void CompletionIndex::findMatches(const QVector<Entry>& entries, const QString& prefix, QVector<IndexedDeclaration>& matches)
+{
+  QVector<Entry>::const_iterator it = qLowerBound(entries.constBegin(), entries.constEnd(), Entry(prefix, IndexedDeclaration()));
+  for (; it != entries.constEnd() && (*it).key.startsWith(prefix); ++it)
+    matches << (*it).declaration;
+}
+
+QList<Declaration*> CompletionIndex::globalDeclarations(TopDUContext* top, const QString& prefix,
+                                                        const CursorInRevision& position, MatchModes modes)
+{
+  ENSURE_CHAIN_READ_LOCKED
+
+  const QString key = prefix.toLower();
+  QList<Declaration*> ret;
+  QSet<Declaration*> hadDeclarations;
+  QSet<TopDUContext*> hadContexts;
+  QVector<IndexedDeclaration> matches;
+
+  QList<TopDUContext*> pending;
+  pending << top;
+  while (!pending.isEmpty()) {
+    TopDUContext* current = pending.takeLast();
+    if (hadContexts.contains(current))
+      continue;
+    hadContexts.insert(current);
+
+    foreach (const DUContext::Import& import, current->importedParentContexts()) {
+      TopDUContext* imported = dynamic_cast<TopDUContext*>(import.context(top));
+      if (imported)
+        pending << imported;
+    }
+
+    const FileIndex file = fileIndex(current);
+    matches.clear();
+    if (modes & MatchPrefix)
+      findMatches(file.names, key, matches);
+    if ((modes & MatchCamelCase) && !key.isEmpty())
+      findMatches(file.humps, key, matches);
+
+    foreach (const IndexedDeclaration& match, matches) {
+      Declaration* decl = match.declaration();
+      //Skip what was removed from the context after its array was built
+      if (!decl || visibleScope(decl) != current)
+        continue;
+      if (current == top && position.isValid() && decl->range().start > position)
+        continue;
+      if (hadDeclarations.contains(decl))
+        continue;
+      hadDeclarations.insert(decl);
+      ret << decl;
+    }
+  }
+
+  return ret;
+}
+
+bool CompletionIndex::lookaheadMembers(Declaration* container, bool isPointer, LookaheadMembers& members) const
+{
+  QMutexLocker lock(&m_mutex);
+  QHash<LookaheadKey, LookaheadMembers>::const_iterator it = m_lookahead.constFind(LookaheadKey(container, isPointer));
+  if (it == m_lookahead.constEnd())
+    return false;
+  members = *it;
+  return true;
+}
+
+void CompletionIndex::setLookaheadMembers(Declaration* container, bool isPointer, const LookaheadMembers& members,
+                                          const QList<uint>& topContexts)
+{
+  QMutexLocker lock(&m_mutex);
+  if (m_lookahead.size() >= maxLookaheadEntries) {
+    m_lookahead.clear();
+    m_lookaheadDependencies.clear();
+  }
+
+  const LookaheadKey key(container, isPointer);
+  m_lookahead.insert(key, members);
+  foreach (uint topContext, topContexts)
+    m_lookaheadDependencies.insert(topContext, key);
+}
+
+void CompletionIndex::invalidate(uint topContextIndex)
+{
+  QMutexLocker lock(&m_mutex);
+  m_files.remove(topContextIndex);
+
+  foreach (const LookaheadKey& key, m_lookaheadDependencies.values(topContextIndex))
+    m_lookahead.remove(key);
+  m_lookaheadDependencies.remove(topContextIndex);
+}
+
+int CompletionIndex::size() const
+{
+  QMutexLocker lock(&m_mutex);
+  return m_files.size();
+}
+
+}
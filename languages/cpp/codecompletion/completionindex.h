@@ -0,0 +1,160 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_COMPLETIONINDEX_H
+#define CPP_COMPLETIONINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <language/duchain/declaration.h>
+#include <language/duchain/indexedstring.h>
+#include <language/duchain/types/indexedtype.h>
+
+namespace KDevelop {
+  class DUContext;
+  class TopDUContext;
+  class CursorInRevision;
+}
+
+namespace Cpp {
+
+/**
+ * Prefix index over the global-scope declarations of top-contexts, used by the global code-completion.
+ * This includes the enumerators of unscoped enums and the members of anonymous unions.
+ *
+ * Walking all visible declarations through DUContext::allDeclarations() touches every declaration
+ * of every included file, which easily are 100k declarations. This index instead keeps one sorted
+ * identifier array per top-context, so a lookup only costs a binary search per file of the import-set,
+ * and then is proportional to the count of matches.
+ *
+ * Since the arrays are kept per file, changing the imports of a context does not rebuild anything,
+ * and a reparsed file only rebuilds its own array. Contexts must be invalidated after they were updated.
+ *
+ * The index also caches the members of classes grouped by type, so lookahead-completion only needs to
+ * check the conversion of each distinct member type instead of each member.
+ *
+ * All functions need at least the du-chain read-lock.
+ */
+class CompletionIndex
+{
+public:
+  static CompletionIndex* self();
+
+  enum MatchMode {
+    ///Case-insensitive prefix of the identifier, "qstr" matches "QString"
+    MatchPrefix = 1,
+    ///Case-insensitive prefix of the camel-case humps, "qsl" matches "QStringList" and "q_string_list"
+    MatchCamelCase = 2,
+    MatchAll = MatchPrefix | MatchCamelCase
+  };
+  Q_DECLARE_FLAGS(MatchModes, MatchMode)
+
+  /**
+   * Returns the global-scope declarations of @p top and all its recursive imports that match @p prefix.
+   *
+   * Declarations of @p top itself are only returned when they start in front of @p position.
+   * Each declaration is returned only once, even when it matches in multiple modes.
+   */
+  QList<KDevelop::Declaration*> globalDeclarations(KDevelop::TopDUContext* top, const QString& prefix,
+                                                   const KDevelop::CursorInRevision& position, MatchModes modes = MatchAll);
+
+  struct LookaheadMember {
+    LookaheadMember() : isPointer(false) {
+    }
+    LookaheadMember(KDevelop::Declaration* decl, bool _isPointer) : declaration(decl), isPointer(_isPointer) {
+    }
+    KDevelop::IndexedDeclaration declaration;
+    ///Whether the member is accessed through "->"
+    bool isPointer;
+  };
+  ///All members of one effective type
+  struct LookaheadGroup {
+    KDevelop::IndexedType type;
+    QVector<LookaheadMember> members;
+  };
+  typedef QVector<LookaheadGroup> LookaheadMembers;
+
+  ///Returns false if the members of @p container are not cached
+  bool lookaheadMembers(KDevelop::Declaration* container, bool isPointer, LookaheadMembers& members) const;
+  ///@param topContexts The contexts the members were collected from, the entry is dropped when one of them is invalidated
+  void setLookaheadMembers(KDevelop::Declaration* container, bool isPointer, const LookaheadMembers& members,
+                           const QList<uint>& topContexts);
+
+  ///Drops everything that was taken from the given top-context, it is rebuilt on the next lookup that reaches it
+  void invalidate(uint topContextIndex);
+
+  ///Count of top-contexts that have an array
+  int size() const;
+
+  ///The camel-case humps of @p identifier, lower-case. Public for testing.
+  static QString humps(const QString& identifier);
+
+private:
+  struct Entry {
+    Entry() {
+    }
+    Entry(const QString& _key, const KDevelop::IndexedDeclaration& _declaration) : key(_key), declaration(_declaration) {
+    }
+    bool operator<(const Entry& rhs) const {
+      return key < rhs.key;
+    }
+    QString key;
+    KDevelop::IndexedDeclaration declaration;
+  };
+
+  struct FileIndex {
+    KDevelop::IndexedString url;
+    QVector<Entry> names;
+    QVector<Entry> humps;
+  };
+
+  FileIndex fileIndex(KDevelop::TopDUContext* top);
+  ///Adds the declarations of @p context and of the child-contexts that propagate their declarations into it
+  static void addEntries(KDevelop::DUContext* context, FileIndex& file);
+  ///The context @p decl is visible in, skipping the contexts that propagate their declarations
+  static KDevelop::DUContext* visibleScope(KDevelop::Declaration* decl);
+  static void findMatches(const QVector<Entry>& entries, const QString& prefix, QVector<KDevelop::IndexedDeclaration>& matches);
+
+  struct LookaheadKey {
+    LookaheadKey() : isPointer(false) {
+    }
+    LookaheadKey(KDevelop::Declaration* _container, bool _isPointer) : container(_container), isPointer(_isPointer) {
+    }
+    bool operator==(const LookaheadKey& rhs) const {
+      return container == rhs.container && isPointer == rhs.isPointer;
+    }
+    KDevelop::IndexedDeclaration container;
+    bool isPointer;
+  };
+  friend uint qHash(const LookaheadKey& key) {
+    return key.container.hash() * 3 + key.isPointer;
+  }
+
+  mutable QMutex m_mutex;
+  QHash<uint, FileIndex> m_files;
+  QHash<LookaheadKey, LookaheadMembers> m_lookahead;
+  ///Maps a top-context index to the lookahead entries that contain its declarations
+  QMultiHash<uint, LookaheadKey> m_lookaheadDependencies;
+};
+
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(Cpp::CompletionIndex::MatchModes)
+
+#endif // CPP_COMPLETIONINDEX_H
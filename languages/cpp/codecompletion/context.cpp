@@ -61,6 +61,7 @@
 #include <language/duchain/classdeclaration.h>
 #include "model.h"
 #include "helpers.h"
+#include "completionindex.h"
 
 // #define ifDebug(x) x
 
@@ -439,7 +440,8 @@ CodeCompletionContext( KDevelop::DUContextPointer context, const QString& text,
     m_pointerConversionsBeforeMatching( 0 ),
     m_onlyShow( ShowAll ),
     m_expressionIsTypePrefix( false ),
-    m_doAccessFiltering( DO_ACCESS_FILTERING )
+    m_doAccessFiltering( DO_ACCESS_FILTERING ),
+    m_itemStream( 0 )
 {
   if ( doIncludeCompletion() )
     return;
@@ -1316,6 +1318,20 @@ QList< KSharedPtr< KDevelop::CompletionTreeElement > > CodeCompletionContext::un
   return m_storedUngroupedItems;
 }
 
+void CodeCompletionContext::setItemStream(ItemStream* stream) {
+  m_itemStream = stream;
+}
+
+void CodeCompletionContext::streamItems(const QList<CompletionTreeItemPointer>& items) {
+  if (m_itemStream && !items.isEmpty())
+    m_itemStream->itemsFound(items, this);
+}
+
+void CodeCompletionContext::pollItemStream() {
+  if (m_itemStream)
+    m_itemStream->poll();
+}
+
 QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionItems( const bool& shouldAbort )
 {
   QList<CompletionTreeItemPointer> items;
@@ -1351,6 +1367,10 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionIt
 
     foreach( const DeclarationDepthPair& decl, Cpp::hideOverloadedDeclarations(decls, typeIsConst ) )
     {
+      if (shouldAbort)
+        return items;
+      pollItemStream();
+
       //If we have StaticMemberChoose, which means A::Bla, show only static members, except if we're within a class that derives from the container
       ClassMemberDeclaration* classMember = dynamic_cast<ClassMemberDeclaration*>(decl.first);
 
@@ -1386,6 +1406,9 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::memberAccessCompletionIt
       if(!decl.first->identifier().isEmpty())
         items << CompletionTreeItemPointer( new NormalDeclarationCompletionItem( DeclarationPointer(decl.first), KDevelop::CodeCompletionContext::Ptr(this), decl.second ) );
     }
+
+    //Show the members of each container while the next ones are collected
+    streamItems(items);
   }
 
   return items;
@@ -1723,13 +1746,23 @@ QList<IndexedType> CodeCompletionContext::matchTypes()
   return m_cachedMatchTypes;
 }
 
-QList<DeclAccessPair> CodeCompletionContext::containedDeclarationsForLookahead(Declaration* container, TopDUContext* top,
-                                                                               bool isPointer) const
+///For a given @param container, find members which may potentially be used for lookahead matching, grouped by their type.
+///@param isPointer specifies whether the container should be accessed with operator->
+///Note that a non-pointer container may declare an operator-> (ie, smart pointer)
+///@param topContexts Receives the contexts the members were taken from
+///@param persistent Is set to false if a container is a template instantiation, whose members must not be cached
+static void containedDeclarationsForLookahead(Declaration* container, TopDUContext* top, bool isPointer,
+                                              CompletionIndex::LookaheadMembers& members, QHash<uint, int>& groups,
+                                              QList<uint>& topContexts, bool& persistent)
 {
   static const IndexedIdentifier arrowOpIdentifier(Identifier("operator->"));
-  QList<DeclAccessPair> ret;
   if (!container || !container->internalContext())
-    return ret;
+    return;
+
+  topContexts << container->topContext()->ownIndex();
+  TemplateDeclaration* templateDecl = dynamic_cast<TemplateDeclaration*>(container);
+  if (templateDecl && templateDecl->instantiatedFrom())
+    persistent = false;
 
   Declaration *arrowOperator = 0;
   QVector<Declaration*> declarations = container->internalContext()->localDeclarations(top);
@@ -1741,20 +1774,23 @@ QList<DeclAccessPair> CodeCompletionContext::containedDeclarationsForLookahead(D
     if (!isPointer && decl->indexedIdentifier() == arrowOpIdentifier)
       arrowOperator = decl;
 
-    if (!filterDeclaration(dynamic_cast<ClassMemberDeclaration*>(decl))) {
+    AbstractType::Ptr type = Cpp::effectiveType(decl);
+    if (!type)
       continue;
+    const IndexedType indexedType = type->indexed();
+    QHash<uint, int>::const_iterator group = groups.constFind(indexedType.index());
+    if (group == groups.constEnd()) {
+      group = groups.insert(indexedType.index(), members.size());
+      members.append(CompletionIndex::LookaheadGroup());
+      members.last().type = indexedType;
     }
-
-    if (Cpp::effectiveType(decl)) {
-      ret << DeclAccessPair(decl, isPointer);
-    }
+    members[*group].members << CompletionIndex::LookaheadMember(decl, isPointer);
   }
   //If we found an "->", try to treat it as a smart pointer
   if (arrowOperator) {
-    ret += containedDeclarationsForLookahead( containerDeclForType(Cpp::effectiveType(arrowOperator), top, isPointer),
-                                              top, true );
+    containedDeclarationsForLookahead( containerDeclForType(Cpp::effectiveType(arrowOperator), top, isPointer),
+                                       top, true, members, groups, topContexts, persistent );
   }
-  return ret;
 }
 
 QList<DeclAccessPair> CodeCompletionContext::getLookaheadMatches(Declaration* forDecl, const QList<IndexedType>& matchTypes) const
@@ -1774,31 +1810,43 @@ QList<DeclAccessPair> CodeCompletionContext::getLookaheadMatches(Declaration* fo
     return cacheIt.value();
   }
 
-  /// FIXME: use QVector + std::remove_if
-  ret = containedDeclarationsForLookahead(container, top, typeIsPointer);
+  //The members are grouped by type and kept across completions, so each distinct type is checked only once
+  CompletionIndex::LookaheadMembers members;
+  if (!CompletionIndex::self()->lookaheadMembers(container, typeIsPointer, members)) {
+    QHash<uint, int> groups;
+    QList<uint> topContexts;
+    bool persistent = true;
+    containedDeclarationsForLookahead(container, top, typeIsPointer, members, groups, topContexts, persistent);
+    if (persistent)
+      CompletionIndex::self()->setLookaheadMembers(container, typeIsPointer, members, topContexts);
+  }
 
-  QList<DeclAccessPair>::iterator it = ret.begin();
   Cpp::TypeConversion conv(top);
-  while (it != ret.end()) {
+  foreach (const CompletionIndex::LookaheadGroup& group, members) {
     bool match = false;
-    const IndexedType& declEffectiveType = Cpp::effectiveType(it->first)->indexed();
-    Q_ASSERT(declEffectiveType);
 
     foreach (const IndexedType& matchType, matchTypes) {
       //Don't lookahead if the current type is a (precise) match
       //Cheaper than checking if it converts, and probably good enough
       if (matchType == forDecl->indexedType())
         continue;
-      if (conv.implicitConversion(declEffectiveType, matchType)) {
+      const QPair<uint, uint> conversion(group.type.index(), matchType.index());
+      QHash<QPair<uint, uint>, bool>::const_iterator converts = m_lookaheadConversions.constFind(conversion);
+      if (converts == m_lookaheadConversions.constEnd())
+        converts = m_lookaheadConversions.insert(conversion, conv.implicitConversion(group.type, matchType));
+      if (*converts) {
         match = true;
         break;
       }
     }
 
-    if (!match) {
-      it = ret.erase(it);
-    } else {
-      ++it;
+    if (!match)
+      continue;
+
+    foreach (const CompletionIndex::LookaheadMember& member, group.members) {
+      Declaration* decl = member.declaration.declaration();
+      if (decl && filterDeclaration(dynamic_cast<ClassMemberDeclaration*>(decl)))
+        ret << DeclAccessPair(decl, member.isPointer);
     }
   }
 
@@ -1870,8 +1918,59 @@ QList<DeclarationDepthPair> CodeCompletionContext::namespaceItems(DUContext* duC
   return decls;
 }
 
-QList< CompletionTreeItemPointer > CodeCompletionContext::standardAccessCompletionItems() {
+QList<DeclarationDepthPair> CodeCompletionContext::visibleDeclarations(const CursorInRevision& position, const QString& prefix) const
+{
+  TopDUContext* top = m_duContext->topContext();
+  QList<DeclarationDepthPair> decls;
+  CursorInRevision currentPosition = position;
+  int depth = 0;
+  //Same walk as DUContext::allDeclarations, but the global scope with all its imports is looked up in the index
+  for (DUContext* ctx = m_duContext.data(); ctx && ctx != top; ctx = ctx->parentContext(), ++depth) {
+    foreach(const DeclarationDepthPair& decl, ctx->allDeclarations(currentPosition, top, false))
+      decls << qMakePair(decl.first, decl.second + depth);
+    if (ctx->parentContext() && ctx->parentContext()->type() == DUContext::Class)
+      currentPosition = ctx->parentContext()->range().end;
+  }
+
+  foreach(Declaration* decl, CompletionIndex::self()->globalDeclarations(top, prefix, currentPosition))
+    decls << qMakePair(decl, depth);
+
+  return decls;
+}
+
+QList< CompletionTreeItemPointer > CodeCompletionContext::localScopeCompletionItems() {
+  QList<CompletionTreeItemPointer> items;
+  LOCKDUCHAIN; if (!m_duContext) return items;
+
+  QList<DeclarationDepthPair> decls;
+  int depth = 0;
+  for (DUContext* ctx = m_duContext.data(); ctx && ctx->type() != DUContext::Namespace && ctx->type() != DUContext::Global;
+       ctx = ctx->parentContext(), ++depth)
+  {
+    foreach(Declaration* decl, ctx->localDeclarations()) {
+      //Within code, only the declarations in front of the cursor are visible
+      if (ctx->type() != DUContext::Class && ctx->type() != DUContext::Function && decl->range().start > m_position)
+        continue;
+      if (dynamic_cast<FunctionDefinition*>(decl) && static_cast<FunctionDefinition*>(decl)->hasDeclaration())
+        continue;
+      if (filterDeclaration(decl, 0, true))
+        decls << qMakePair(decl, depth);
+    }
+  }
+
+  //Local declarations hide the global ones, so these items are also part of the complete list
+  foreach( const DeclarationDepthPair& decl, Cpp::hideOverloadedDeclarations(decls, false) )
+    items << CompletionTreeItemPointer( new NormalDeclarationCompletionItem( DeclarationPointer(decl.first), KDevelop::CodeCompletionContext::Ptr(this), decl.second ) );
+
+  return items;
+}
+
+QList< CompletionTreeItemPointer > CodeCompletionContext::standardAccessCompletionItems(const bool& shouldAbort) {
   QList<CompletionTreeItemPointer> items;
+  //Collecting all visible declarations may take long, so show the local ones first
+  if (m_itemStream && m_onlyShow == ShowAll)
+    streamItems(localScopeCompletionItems());
+
   LOCKDUCHAIN; if (!m_duContext) return items;
   //Normal case: Show all visible declarations
   QSet<QualifiedIdentifier> hadNamespaceDeclarations;
@@ -1881,14 +1980,26 @@ QList< CompletionTreeItemPointer > CodeCompletionContext::standardAccessCompleti
     if (func->abstractType() && (func->abstractType()->modifiers() & AbstractType::ConstModifier))
       typeIsConst = true;
   }
-  QList<DeclarationDepthPair> decls = m_duContext->allDeclarations(m_duContext->type() == DUContext::Class ? m_duContext->range().end : m_position, m_duContext->topContext());
+  const CursorInRevision position = m_duContext->type() == DUContext::Class ? m_duContext->range().end : m_position;
+  //The shown list is only filtered while the user continues typing, so the global declarations can be restricted to the
+  //first typed character. Restricting them to the complete typed text would lose items as soon as backspace is pressed.
+  QList<DeclarationDepthPair> decls;
+  if (!m_followingText.isEmpty() && (m_followingText[0].isLetter() || m_followingText[0] == '_'))
+    decls = visibleDeclarations(position, m_followingText.left(1));
+  else
+    decls = m_duContext->allDeclarations(position, m_duContext->topContext());
+  if (shouldAbort)
+    return items;
   decls += namespaceItems(m_duContext.data(), m_position, true);
 
   QList<DeclarationDepthPair> oldDecls = decls;
   decls.clear();
   
   //Remove pure function-definitions before doing overload-resolution, so they don't hide their own declarations.
-  foreach( const DeclarationDepthPair& decl, oldDecls )
+  foreach( const DeclarationDepthPair& decl, oldDecls ) {
+    if (shouldAbort)
+      return items;
+    pollItemStream();
     if(!dynamic_cast<FunctionDefinition*>(decl.first) || !static_cast<FunctionDefinition*>(decl.first)->hasDeclaration()) {
       if(decl.first->kind() == Declaration::Namespace) {
         QualifiedIdentifier id = decl.first->qualifiedIdentifier();
@@ -1902,10 +2013,13 @@ QList< CompletionTreeItemPointer > CodeCompletionContext::standardAccessCompleti
         decls << decl;
       }
     }
+  }
     
   decls = Cpp::hideOverloadedDeclarations(decls, typeIsConst);
 
   foreach( const DeclarationDepthPair& decl, decls ) {
+    if (shouldAbort)
+      return items;
     NormalDeclarationCompletionItem* item = new NormalDeclarationCompletionItem(DeclarationPointer(decl.first), KDevelop::CodeCompletionContext::Ptr(this), decl.second );
 
     if( m_onlyShow == ShowIntegralConstants && !isIntegralConstant(decl.first, false) )
@@ -2033,7 +2147,7 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
       default:
         if(depth() == 0 && (m_onlyShow == ShowAll || m_onlyShow == ShowTypes || m_onlyShow == ShowIntegralConstants))
         {
-          items += standardAccessCompletionItems();
+          items += standardAccessCompletionItems(shouldAbort);
 #ifndef TEST_COMPLETION
           eventuallyAddGroup(i18n("Not Included"), 700, missingIncludeCompletionItems(m_followingText + ':', {}, {}, m_duContext));
 #endif
@@ -2042,12 +2156,18 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
         break;
     }
 
+    if (shouldAbort)
+      return items;
+
+    //The lookahead matches and helpers follow, show what we have until then
+    streamItems(items);
+
     LOCKDUCHAIN; if (!m_duContext) return items;
     if (m_accessType == MemberAccess ||
         m_accessType == ArrowMemberAccess ||
         m_accessType == MemberChoose ||
         m_accessType == NoMemberAccess)
-      addLookaheadMatches(items);
+      addLookaheadMatches(items, shouldAbort);
 
     if (parentContext()) {
       foreach(const IndexedType &matchType, parentContext()->matchTypes()) {
@@ -2066,7 +2186,7 @@ QList<CompletionTreeItemPointer> CodeCompletionContext::completionItems(bool& sh
     return items;
 }
 
-void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPointer> items)
+void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPointer> items, const bool& shouldAbort)
 {
   QList<IndexedType> matchTypes;
   if (m_parentContext)
@@ -2077,6 +2197,9 @@ void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPo
 
   QList<CompletionTreeItemPointer> lookaheadMatches;
   foreach( const CompletionTreeItemPointer &item, items ) {
+    if (shouldAbort)
+      break;
+    pollItemStream();
     Declaration* decl = item->declaration().data();
     if (!decl)
       continue;
@@ -2094,6 +2217,7 @@ void CodeCompletionContext::addLookaheadMatches(const QList<CompletionTreeItemPo
     }
   }
   m_lookaheadMatchesCache.clear();
+  m_lookaheadConversions.clear();
 
   eventuallyAddGroup(i18n("Lookahead Matches"), 800, lookaheadMatches);
 }
@@ -64,6 +64,23 @@ namespace Cpp {
       
       virtual QList< KSharedPtr< KDevelop::CompletionTreeElement > > ungroupedElements();
 
+      /**
+       * Receives the items computed so far while completionItems() is still running, so that the
+       * local and class-scope items can be shown before the global and lookahead matches are found.
+       * Called from the completion thread, the du-chain may be read-locked.
+       */
+      class ItemStream
+      {
+        public:
+          virtual ~ItemStream() {}
+          virtual void itemsFound(const QList<CompletionTreeItemPointer>& items, CodeCompletionContext* context) = 0;
+          ///Called regularly while the items are computed, so that throttled items can be shown once it is time
+          virtual void poll() {}
+      };
+
+      ///Items are only streamed when a stream is set
+      void setItemStream(ItemStream* stream);
+
       typedef KSharedPtr<CodeCompletionContext> Ptr;
 
       typedef OverloadResolutionFunction Function;
@@ -248,19 +265,16 @@ namespace Cpp {
       QList<CompletionTreeItemPointer> includeListAccessCompletionItems(const bool& shouldAbort);
       QList<CompletionTreeItemPointer> signalSlotAccessCompletionItems();
       ///Computes the completion-items for the case that no special kind of access is used(just a list of all suitable items is needed)
-      QList<CompletionTreeItemPointer> standardAccessCompletionItems();
+      QList<CompletionTreeItemPointer> standardAccessCompletionItems(const bool& shouldAbort);
+      ///The items declared in the function and class scopes around the cursor, a subset of standardAccessCompletionItems()
+      QList<CompletionTreeItemPointer> localScopeCompletionItems();
       QList<CompletionTreeItemPointer> getImplementationHelpers();
       QList<CompletionTreeItemPointer> getImplementationHelpersInternal(const QualifiedIdentifier& minimumScope, DUContext* context);
 
       ///If @param forDecl is an instance of a class, find declarations in that class which match @param matchTypes
       ///@returns the list of matching declarations and whether or not you need the arrow operator (->) to access them
       QList<DeclAccessPair> getLookaheadMatches(Declaration* forDecl, const QList<IndexedType>& matchTypes) const;
-      void addLookaheadMatches(const QList<CompletionTreeItemPointer> items);
-      ///For a given @param container, find members which may potentially be used for lookahead matching
-      ///@param isPointer specifies whether the container should be accessed with operator->
-      ///@returns a list of declarations paired with whether or not they use "operator->"
-      ///Note that a non-pointer container may declare an operator-> (ie, smart pointer)
-      QList<DeclAccessPair> containedDeclarationsForLookahead(Declaration* decl, TopDUContext* top, bool isPointer) const;
+      void addLookaheadMatches(const QList<CompletionTreeItemPointer> items, const bool& shouldAbort);
 
       ///*DUChain must be locked*
       bool  filterDeclaration(Declaration* decl, DUContext* declarationContext = 0, bool dynamic = true) const;
@@ -271,6 +285,11 @@ namespace Cpp {
       /// The actual replacement is delayed into the foreground thread.
       void replaceCurrentAccess(const QString& oldAccess, const QString& newAccess);
 
+      ///Passes the items to the item-stream, if there is one
+      void streamItems(const QList<CompletionTreeItemPointer>& items);
+      ///Gives the item-stream, if there is one, the chance to show the items it holds back
+      void pollItemStream();
+
       ///Creates the group and adds it to m_storedUngroupedItems if items is not empty
       void eventuallyAddGroup(QString name, int priority, QList< KSharedPtr< KDevelop::CompletionTreeItem > > items);
       
@@ -312,6 +331,9 @@ namespace Cpp {
 
       QList<DeclarationDepthPair> namespaceItems(KDevelop::DUContext* duContext, const KDevelop::CursorInRevision& position, bool global,
                                                  const QSet<KDevelop::DUContext*>& skipContexts = QSet<KDevelop::DUContext*>()) const;
+      ///The same declarations as m_duContext->allDeclarations(position, ..), except that the global-scope ones
+      ///are only those starting with @param prefix, taken from the CompletionIndex
+      QList<DeclarationDepthPair> visibleDeclarations(const KDevelop::CursorInRevision& position, const QString& prefix) const;
 
       AccessType m_accessType;
       QString m_expression;
@@ -353,6 +375,10 @@ namespace Cpp {
       /// This is useful, as otherwise we'd repeat the same stuff for every variable
       /// with the same type accessible from the current scope
       mutable QHash<Declaration*, QList<DeclAccessPair> > m_lookaheadMatchesCache;
+      /// Whether the member type (first) converts to the match type (second), by type index
+      mutable QHash<QPair<uint, uint>, bool> m_lookaheadConversions;
+
+      ItemStream* m_itemStream;
 
       friend class ImplementationHelperItem;
   };
@@ -38,6 +38,7 @@
 #include "../cppduchain/expressionevaluationresult.h"
 
 #include "../cpputils.h"
+#include "../includedirectorycache.h"
 
 #include "model.h"
 #include "helpers.h"
@@ -217,27 +218,24 @@ QStringList candidateIncludeFiles(Declaration* decl) {
  * Try to find include candidates based solely on the string of the unknown id @p id
  *
  * Example: We have 'QState' in our source file, it is unknown
- * This method then looks through the include paths used by @p source and returns all
- * files matching the file name 'QState'
+ * This method then filters @p namedFiles, the files named 'QState' in the include paths
  *
  * @note DUChain must be locked
  */
-QStringList candidateIncludeFilesFromNameMatcher(const QList<IncludeItem>& includeItems, const QualifiedIdentifier& id)
+QStringList candidateIncludeFilesFromNameMatcher(const QStringList& namedFiles, const QualifiedIdentifier& id)
 {
   QStringList result;
-  for (const IncludeItem& item : includeItems) {
-    // we never want to have directories in the result set
-    if (item.isDirectory)
+  for (const QString& file : namedFiles) {
+    const KUrl url(file);
+    if (isBlacklistedInclude(url))
       continue;
 
-    if (item.name == id.toString() && !isBlacklistedInclude(item.url())) {
-      TopDUContext* top = DUChainUtils::standardContextForUrl(item.url());
-      // if this file was already parsed, and we don't find a declaration for id => discard
-      if (top && top->findDeclarations(id).isEmpty()) {
-        continue;
-      }
-      result << item.url().toLocalFile();
+    TopDUContext* top = DUChainUtils::standardContextForUrl(url);
+    // if this file was already parsed, and we don't find a declaration for id => discard
+    if (top && top->findDeclarations(id).isEmpty()) {
+      continue;
     }
+    result << file;
   }
   return result;
 }
@@ -397,15 +395,20 @@ QList<KDevelop::CompletionTreeItemPointer> missingIncludeCompletionItems(const Q
     }
   }
 
+  //The directory of the document comes first, as it does for quoted includes
+  QStringList includeDirectories;
+  foreach(const Path& path, includePaths)
+    includeDirectories << path.toLocalFile();
+
   lock.unlock();
-  // NOTE: this will acquire the foreground lock and thus we must not hold the duchain lock here
-  const QList<IncludeItem> includeItems = CppUtils::allFilesInIncludePath(currentUrl.toLocalFile(), false, QString());
+  // NOTE: a directory that is not cached yet is read from disk, so we must not hold the duchain lock here
+  const QStringList namedFiles = IncludeDirectoryCache::self()->filesNamed(identifier.toString(), includeDirectories);
   lock.lock();
 
   if (!context)
     return ret;
 
-  auto candidateFiles = candidateIncludeFilesFromNameMatcher(includeItems, identifier);
+  auto candidateFiles = candidateIncludeFilesFromNameMatcher(namedFiles, identifier);
   kDebug() << "candidates from name matching:" << candidateFiles;
   for (const QString& file : candidateFiles) {
     ret += itemsForFile(displayTextPrefix, file, includePaths, currentPath, IndexedDeclaration(), argumentHintDepth, directives);
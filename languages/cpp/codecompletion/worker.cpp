@@ -33,15 +33,85 @@
 
 using namespace KDevelop;
 
+namespace {
+///Items are only streamed when the completion takes longer than this, and at most this often
+const int streamIntervalMilliseconds = 100;
+}
+
 namespace Cpp {
 
+class CodeCompletionWorker::ItemStreamer : public CodeCompletionContext::ItemStream
+{
+  public:
+    ItemStreamer(CodeCompletionWorker* worker) : m_worker(worker) {
+    }
+    virtual void itemsFound(const QList<CompletionTreeItemPointer>& items, CodeCompletionContext* context) {
+      m_worker->itemsFound(items, context);
+    }
+    virtual void poll() {
+      m_worker->flushPendingItems();
+    }
+  private:
+    CodeCompletionWorker* m_worker;
+};
+
 CodeCompletionWorker::CodeCompletionWorker(CodeCompletionModel* model)
   : KDevelop::CodeCompletionWorker(model)
+  , m_itemStreamer(new ItemStreamer(this))
+  , m_streamInterval(streamIntervalMilliseconds)
 {
+  m_streamTimer.start();
 }
+
+CodeCompletionWorker::~CodeCompletionWorker()
+{
+  delete m_itemStreamer;
+}
+
 KDevelop::CodeCompletionContext* CodeCompletionWorker::createCompletionContext(KDevelop::DUContextPointer context, const QString &contextText, const QString &followingText, const KDevelop::CursorInRevision& position) const
 {
-  return new Cpp::CodeCompletionContext( context, contextText, followingText, position );
+  Cpp::CodeCompletionContext* ret = new Cpp::CodeCompletionContext( context, contextText, followingText, position );
+  ret->setItemStream(m_itemStreamer);
+  return ret;
+}
+
+void CodeCompletionWorker::setStreamInterval(int milliseconds)
+{
+  m_streamInterval = milliseconds;
+}
+
+void CodeCompletionWorker::resetItemStream()
+{
+  m_pendingItems.clear();
+  m_pendingContext = 0;
+  m_streamTimer.restart();
+}
+
+void CodeCompletionWorker::itemsFound(const QList<CompletionTreeItemPointer>& items, CodeCompletionContext* context)
+{
+  //A later batch contains the items of the earlier ones, so only the latest one needs to be kept
+  m_pendingItems = items;
+  m_pendingContext = KDevelop::CodeCompletionContext::Ptr(context);
+  flushPendingItems();
+}
+
+void CodeCompletionWorker::flushPendingItems()
+{
+  if(!m_pendingContext || aborting() || m_streamTimer.elapsed() < m_streamInterval)
+    return;
+
+  const QList<CompletionTreeItemPointer> items = m_pendingItems;
+  const KDevelop::CodeCompletionContext::Ptr context = m_pendingContext;
+  m_pendingItems.clear();
+  m_pendingContext = 0;
+
+  //The complete list replaces these items once it is computed
+  QList<CompletionTreeElementPointer> tree = computeGroups( items, context );
+  tree += context->ungroupedElements();
+  if(aborting())
+    return;
+  emit foundDeclarations( tree, context );
+  m_streamTimer.restart();
 }
 
 void CodeCompletionWorker::updateContextRange(KTextEditor::Range& contextRange, KTextEditor::View*, DUContextPointer context) const
@@ -61,6 +131,7 @@ void CodeCompletionWorker::computeCompletions(KDevelop::DUContextPointer context
   QString contextText(_contextText);
   
   TopDUContextPointer topContext;
+  uint topContextIndex = 0;
   {
     DUChainReadLocker lock(DUChain::lock());
     if(context)
@@ -71,11 +142,18 @@ void CodeCompletionWorker::computeCompletions(KDevelop::DUContextPointer context
       kDebug() << "top-context has wrong language:";
       return;
     }
+    topContextIndex = topContext->ownIndex();
   }
   
-  Cpp::TypeConversionCacheEnabler enableConversionCache;
+  //Conversion results are kept across completions in the same document until the du-chain is updated
+  Cpp::TypeConversionCacheEnabler enableConversionCache(topContextIndex);
+
+  resetItemStream();
 
   KDevelop::CodeCompletionWorker::computeCompletions(context, position, followingText, contextRange, contextText);
+
+  //The complete list has been shown, it contains everything that was still pending
+  resetItemStream();
 }
 
 }
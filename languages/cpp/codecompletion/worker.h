@@ -25,7 +25,10 @@
 
 #include <language/codecompletion/codecompletionworker.h>
 
+#include <QElapsedTimer>
+
 #include "model.h"
+#include "context.h"
 
 namespace Cpp {
 
@@ -35,6 +38,7 @@ class CodeCompletionWorker : public KDevelop::CodeCompletionWorker
 
   public:
     CodeCompletionWorker(CodeCompletionModel* model);
+    virtual ~CodeCompletionWorker();
     
     CodeCompletionModel* model() const;
 
@@ -42,6 +46,26 @@ class CodeCompletionWorker : public KDevelop::CodeCompletionWorker
     virtual void computeCompletions(KDevelop::DUContextPointer context, const KTextEditor::Cursor& position, QString followingText, const KTextEditor::Range& _contextRange, const QString& _contextText);
     virtual KDevelop::CodeCompletionContext* createCompletionContext(KDevelop::DUContextPointer context, const QString &contextText, const QString &followingText, const KDevelop::CursorInRevision &position) const;
     virtual void updateContextRange(KTextEditor::Range& contextRange, KTextEditor::View* view, KDevelop::DUContextPointer context) const;
+
+    ///Streamed items are shown at most once per @p milliseconds, and only when the completion takes at least that long
+    void setStreamInterval(int milliseconds);
+    ///Restarts the stream interval and drops the pending items, done when a new completion starts
+    void resetItemStream();
+    ///Shows the pending items if the stream interval has expired
+    void flushPendingItems();
+
+  private:
+    class ItemStreamer;
+    friend class ItemStreamer;
+    ///Queues the items found so far, and shows them if the completion already takes long
+    void itemsFound(const QList<KDevelop::CompletionTreeItemPointer>& items, CodeCompletionContext* context);
+
+    ItemStreamer* m_itemStreamer;
+    QElapsedTimer m_streamTimer;
+    int m_streamInterval;
+    ///The latest streamed items that were not shown yet. Each batch contains the items of the previous ones.
+    QList<KDevelop::CompletionTreeItemPointer> m_pendingItems;
+    KDevelop::CodeCompletionContext::Ptr m_pendingContext;
 };
 
 }
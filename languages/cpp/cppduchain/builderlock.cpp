@@ -0,0 +1,216 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "builderlock.h"
+
+#include <QMutex>
+#include <QAtomicInt>
+
+#include <kglobal.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+
+using namespace KDevelop;
+
+namespace {
+
+const quint64 contentionThresholdMicroseconds = 1000;
+
+QAtomicInt collecting(0);
+
+struct StatisticsStore
+{
+  QMutex mutex;
+  Cpp::BuilderLock::Statistics statistics;
+};
+
+K_GLOBAL_STATIC(StatisticsStore, statisticsStore)
+
+void recordWait(Cpp::BuilderLock::Statistics::Counters& counters, quint64 waitMicroseconds)
+{
+  ++counters.acquisitions;
+  if (waitMicroseconds > contentionThresholdMicroseconds)
+    ++counters.contended;
+  counters.waitMicroseconds += waitMicroseconds;
+  counters.maxWaitMicroseconds = qMax(counters.maxWaitMicroseconds, waitMicroseconds);
+}
+
+void recordHold(Cpp::BuilderLock::Statistics::Counters& counters, quint64 holdMicroseconds)
+{
+  counters.holdMicroseconds += holdMicroseconds;
+  counters.maxHoldMicroseconds = qMax(counters.maxHoldMicroseconds, holdMicroseconds);
+}
+
+}
+
+namespace Cpp {
+
+namespace BuilderLock {
+
+Statistics::Counters::Counters()
+  : acquisitions(0)
+  , contended(0)
+  , waitMicroseconds(0)
+  , holdMicroseconds(0)
+  , maxWaitMicroseconds(0)
+  , maxHoldMicroseconds(0)
+{
+}
+
+void setCollectStatistics(bool collect)
+{
+  collecting = collect ? 1 : 0;
+}
+
+bool collectStatistics()
+{
+  return collecting;
+}
+
+Statistics statistics()
+{
+  QMutexLocker lock(&statisticsStore->mutex);
+  return statisticsStore->statistics;
+}
+
+void resetStatistics()
+{
+  QMutexLocker lock(&statisticsStore->mutex);
+  statisticsStore->statistics = Statistics();
+}
+
+}
+
+BuilderWriteLocker::BuilderWriteLocker(DUChainLock* duChainLock)
+  : m_lock(duChainLock ? duChainLock : DUChain::lock())
+  , m_locked(false)
+  , m_measured(false)
+{
+  lock();
+}
+
+BuilderWriteLocker::~BuilderWriteLocker()
+{
+  unlock();
+}
+
+bool BuilderWriteLocker::lock()
+{
+  if (m_locked)
+    return true;
+
+  if (!collecting) {
+    m_locked = m_lock->lockForWrite();
+    return m_locked;
+  }
+
+  m_measured = !m_lock->currentThreadHasWriteLock();
+  QElapsedTimer waitTimer;
+  waitTimer.start();
+  m_locked = m_lock->lockForWrite();
+  if (m_locked && m_measured) {
+    const quint64 wait = waitTimer.nsecsElapsed() / 1000;
+    QMutexLocker lock(&statisticsStore->mutex);
+    recordWait(statisticsStore->statistics.write, wait);
+    m_holdTimer.start();
+  } else {
+    m_measured = false;
+  }
+  return m_locked;
+}
+
+void BuilderWriteLocker::unlock()
+{
+  if (!m_locked)
+    return;
+
+  m_lock->releaseWriteLock();
+  m_locked = false;
+
+  if (m_measured) {
+    m_measured = false;
+    const quint64 hold = m_holdTimer.nsecsElapsed() / 1000;
+    QMutexLocker lock(&statisticsStore->mutex);
+    recordHold(statisticsStore->statistics.write, hold);
+  }
+}
+
+bool BuilderWriteLocker::locked() const
+{
+  return m_locked;
+}
+
+BuilderReadLocker::BuilderReadLocker(DUChainLock* duChainLock)
+  : m_lock(duChainLock ? duChainLock : DUChain::lock())
+  , m_locked(false)
+  , m_measured(false)
+{
+  lock();
+}
+
+BuilderReadLocker::~BuilderReadLocker()
+{
+  unlock();
+}
+
+bool BuilderReadLocker::lock()
+{
+  if (m_locked)
+    return true;
+
+  if (!collecting) {
+    m_locked = m_lock->lockForRead();
+    return m_locked;
+  }
+
+  m_measured = !m_lock->currentThreadHasReadLock() && !m_lock->currentThreadHasWriteLock();
+  QElapsedTimer waitTimer;
+  waitTimer.start();
+  m_locked = m_lock->lockForRead();
+  if (m_locked && m_measured) {
+    const quint64 wait = waitTimer.nsecsElapsed() / 1000;
+    QMutexLocker lock(&statisticsStore->mutex);
+    recordWait(statisticsStore->statistics.read, wait);
+    m_holdTimer.start();
+  } else {
+    m_measured = false;
+  }
+  return m_locked;
+}
+
+void BuilderReadLocker::unlock()
+{
+  if (!m_locked)
+    return;
+
+  m_lock->releaseReadLock();
+  m_locked = false;
+
+  if (m_measured) {
+    m_measured = false;
+    const quint64 hold = m_holdTimer.nsecsElapsed() / 1000;
+    QMutexLocker lock(&statisticsStore->mutex);
+    recordHold(statisticsStore->statistics.read, hold);
+  }
+}
+
+bool BuilderReadLocker::locked() const
+{
+  return m_locked;
+}
+
+}
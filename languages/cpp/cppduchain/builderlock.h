@@ -0,0 +1,106 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_BUILDERLOCK_H
+#define CPP_BUILDERLOCK_H
+
+#include <QElapsedTimer>
+
+#include "cppduchainexport.h"
+
+namespace KDevelop {
+class DUChainLock;
+}
+
+namespace Cpp {
+
+/**
+ * Lockers for the du-chain as used by the C++ builders.
+ *
+ * They behave like DUChainReadLocker and DUChainWriteLocker, but when collecting is enabled
+ * through setCollectStatistics(), they measure how long the builders wait for the chain lock
+ * and how long they hold it. Only the outermost locker of a thread is measured, as the
+ * chain lock is recursive.
+ */
+namespace BuilderLock {
+
+struct Statistics
+{
+  struct Counters
+  {
+    Counters();
+    ///Count of outermost lock acquisitions
+    uint acquisitions;
+    ///Acquisitions that had to wait for longer than a millisecond
+    uint contended;
+    quint64 waitMicroseconds;
+    quint64 holdMicroseconds;
+    quint64 maxWaitMicroseconds;
+    quint64 maxHoldMicroseconds;
+  };
+
+  Counters read;
+  Counters write;
+};
+
+///Disabled by default, the lockers then only forward to the chain lock
+KDEVCPPDUCHAIN_EXPORT void setCollectStatistics(bool collect);
+KDEVCPPDUCHAIN_EXPORT bool collectStatistics();
+KDEVCPPDUCHAIN_EXPORT Statistics statistics();
+KDEVCPPDUCHAIN_EXPORT void resetStatistics();
+
+}
+
+class KDEVCPPDUCHAIN_EXPORT BuilderWriteLocker
+{
+public:
+  explicit BuilderWriteLocker(KDevelop::DUChainLock* duChainLock = 0);
+  ~BuilderWriteLocker();
+
+  bool lock();
+  void unlock();
+  bool locked() const;
+
+private:
+  Q_DISABLE_COPY(BuilderWriteLocker)
+  KDevelop::DUChainLock* m_lock;
+  bool m_locked;
+  ///Whether this locker acquired the lock first within its thread, and thus is measured
+  bool m_measured;
+  QElapsedTimer m_holdTimer;
+};
+
+class KDEVCPPDUCHAIN_EXPORT BuilderReadLocker
+{
+public:
+  explicit BuilderReadLocker(KDevelop::DUChainLock* duChainLock = 0);
+  ~BuilderReadLocker();
+
+  bool lock();
+  void unlock();
+  bool locked() const;
+
+private:
+  Q_DISABLE_COPY(BuilderReadLocker)
+  KDevelop::DUChainLock* m_lock;
+  bool m_locked;
+  bool m_measured;
+  QElapsedTimer m_holdTimer;
+};
+
+}
+
+#endif // CPP_BUILDERLOCK_H
@@ -31,6 +31,7 @@
 
 #include "parsesession.h"
 #include "name_compiler.h"
+#include "builderlock.h"
 #include <language/duchain/dumpchain.h>
 #include "environmentmanager.h"
 #include "expressionvisitor.h"
@@ -123,7 +124,7 @@ void ContextBuilder::setComputeEmpty(bool empty)
 
 
 void ContextBuilder::createUserProblem(AST* node, QString text) {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     KDevelop::ProblemPointer problem(new KDevelop::Problem);
     problem->setDescription(text);
     problem->setSource(KDevelop::ProblemData::DUChainBuilder);
@@ -132,7 +133,7 @@ void ContextBuilder::createUserProblem(AST* node, QString text) {
 }
 
 void ContextBuilder::addBaseType( KDevelop::BaseClassInstance base, BaseSpecifierAST *node ) {
-  DUChainWriteLocker lock(DUChain::lock());
+  BuilderWriteLocker lock(DUChain::lock());
 
   addImportedContexts(); //Make sure the template-contexts are imported first, before any parent-class contexts.
 
@@ -220,7 +221,7 @@ QPair<DUContext*, QualifiedIdentifier> ContextBuilder::findPrefixContext(const Q
   DUContext* import = 0;
 
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
 
     QualifiedIdentifier currentScopeId = currentContext()->scopeIdentifier(true);
 
@@ -257,7 +258,7 @@ void ContextBuilder::openPrefixContext(AST* ast, const QualifiedIdentifier& id,
   DUContext* import = prefix.first;
   
   if(import) {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     addImportedParentContextSafely(currentContext(), import);
   }
 }
@@ -302,7 +303,7 @@ KDevelop::TopDUContext* ContextBuilder::buildProxyContextFromContent(Cpp::Enviro
 
   TopDUContext* topLevelContext = 0;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     topLevelContext = updateContext.data();
 
     CppDUContext<TopDUContext>* cppContext = 0;
@@ -346,7 +347,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   setCompilingContexts(true);
 
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     if(updateContext && (updateContext->parsingEnvironmentFile() && updateContext->parsingEnvironmentFile()->isProxyContext())) {
       kDebug(9007) << "updating a context " << file->url().str() << " from a proxy-context to a content-context";
       updateContext->parsingEnvironmentFile()->setIsProxyContext(false);
@@ -355,7 +356,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   
   ReferencedTopDUContext topLevelContext;
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     topLevelContext = updateContext;
 
     RangeInRevision topRange = RangeInRevision(CursorInRevision(0,0), CursorInRevision(INT_MAX, INT_MAX));
@@ -405,7 +406,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   }
 
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     //If we're debugging the current file, dump its preprocessed contents and the AST
     ifDebugFile( IndexedString(file->identity().url().str()), { kDebug() << stringFromContents(editor()->parseSession()->contentsVector()); Cpp::DumpChain dump; dump.dump(node, editor()->parseSession()); } );
   }
@@ -413,7 +414,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   if(m_computeEmpty)
   {
     //Empty the top-context, in case we're updating
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     topLevelContext->cleanIfNotEncountered(QSet<DUChainBase*>());
   }else{
     Q_ASSERT(node);
@@ -422,7 +423,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   }
 
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
 
     kDebug(9007) << "built top-level context with" << topLevelContext->localDeclarations().size() << "declarations and" << topLevelContext->importedParentContexts().size() << "included files";
     //If we're debugging the current file, dump the du-chain and the smart ranges
@@ -437,7 +438,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   setCompilingContexts(false);
 
   if (!m_importedParentContexts.isEmpty()) {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     kWarning() << file->url().str() << "Previous parameter declaration context didn't get used??" ;
 //    KDevelop::DumpChain dump;
 //    dump.dump(topLevelContext);
@@ -445,7 +446,7 @@ ReferencedTopDUContext ContextBuilder::buildContexts(Cpp::EnvironmentFilePointer
   }
 
 
-  DUChainWriteLocker lock(DUChain::lock());
+  BuilderWriteLocker lock(DUChain::lock());
   topLevelContext->squeeze();
   return topLevelContext;
 }
@@ -454,7 +455,7 @@ void ContextBuilder::visitNamespace (NamespaceAST *node)
 {
   QualifiedIdentifier identifier;
   if (compilingContexts()) {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
 
     if (node->namespace_name)
       identifier.push(QualifiedIdentifier(editor()->tokenToString(node->namespace_name)));
@@ -484,7 +485,7 @@ void ContextBuilder::visitEnumSpecifier(EnumSpecifierAST* node)
   openContext(node, DUContext::Enum, node->isClass ? node->name : 0 );
 
   if (!node->isClass) {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     currentContext()->setPropagateDeclarations(true);
   }
 
@@ -519,7 +520,7 @@ void ContextBuilder::visitClassSpecifier (ClassSpecifierAST *node)
 
     if ((kind == Token_union || id.isEmpty())) {
       //It's an unnamed union context, or an unnamed struct, propagate the declarations to the parent
-      DUChainWriteLocker lock(DUChain::lock());
+      BuilderWriteLocker lock(DUChain::lock());
         
       if(kind == Token_enum || kind == Token_union || m_typeSpecifierWithoutInitDeclarators == node->start_token) {
         ///@todo Mark unions in the duchain in some way, instead of just representing them as a class
@@ -555,7 +556,7 @@ void ContextBuilder::visitFunctionDefinition (FunctionDefinitionAST *node)
     if (functionName.count() >= 2) {
       
       // This is a class function definition
-      DUChainReadLocker lock(DUChain::lock());
+      BuilderReadLocker lock(DUChain::lock());
       QualifiedIdentifier currentScope = currentContext()->scopeIdentifier(true);
       QualifiedIdentifier className = currentScope + functionName;
       className.pop();
@@ -630,7 +631,7 @@ DUContext* ContextBuilder::openContextInternal(const KDevelop::RangeInRevision&
   DUContext* ret = ContextBuilderBase::openContextInternal(range, type, identifier);
 
   {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
     static_cast<CppDUContext<DUContext>*>(ret)->deleteAllInstantiations();
   }
   
@@ -778,7 +779,7 @@ void ContextBuilder::visitExpressionOrDeclarationStatement(ExpressionOrDeclarati
   
   DUContext::ContextType type;
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     type = currentContext()->type();
   }
 
@@ -794,7 +795,7 @@ void ContextBuilder::visitExpressionOrDeclarationStatement(ExpressionOrDeclarati
     case DUContext::Function:
     case DUContext::Other:
       if (compilingContexts()) {
-        DUChainReadLocker lock(DUChain::lock());
+        BuilderReadLocker lock(DUChain::lock());
 /*        VerifyExpressionVisitor iv(editor()->parseSession());
 
         node->expression->ducontext = currentContext();
@@ -960,7 +961,7 @@ void ContextBuilder::visitDeclarator(DeclaratorAST *node) {
 void ContextBuilder::addImportedContexts()
 {
   if (compilingContexts() && !m_importedParentContexts.isEmpty()) {
-    DUChainWriteLocker lock(DUChain::lock());
+    BuilderWriteLocker lock(DUChain::lock());
 
     foreach (const DUContext::Import& imported, m_importedParentContexts)
       if(DUContext* imp = imported.context(topContext()))
@@ -1097,7 +1098,7 @@ void ContextBuilder::visitCatchStatement(CatchStatementAST *node)
     DUContext* secondParentContext = openContext(node->condition, DUContext::Other);
     
     {
-      DUChainReadLocker lock(DUChain::lock());
+      BuilderReadLocker lock(DUChain::lock());
       contextsToImport.append(DUContext::Import(secondParentContext, 0));
     }
 
@@ -1145,7 +1146,7 @@ bool ContextBuilder::createContextIfNeeded(AST* node, DUContext* importedParentC
 {
   QVector<DUContext::Import> imports;
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     imports << DUContext::Import(importedParentContext, 0);
   }
   
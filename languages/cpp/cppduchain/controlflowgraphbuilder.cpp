@@ -25,6 +25,9 @@
 #include <lexer.h>
 #include <tokens.h>
 #include <util/pushvalue.h>
+#include "independentparts.h"
+
+#include <QtConcurrentMap>
 
 using namespace KDevelop;
 QString nodeToString(const ParseSession* s, AST* node);
@@ -38,6 +41,8 @@ ControlFlowGraphBuilder::ControlFlowGraphBuilder(const KDevelop::ReferencedTopDU
   , m_continueNode(0)
   , m_defaultNode(0)
   , m_top(top)
+  , m_locationTable(*session->locationTable())
+  , m_part(0)
 {}
 
 ControlFlowGraphBuilder::~ControlFlowGraphBuilder()
@@ -47,11 +52,54 @@ void ControlFlowGraphBuilder::run(AST* node)
 {
   Q_ASSERT(!m_currentNode);
   visit(node);
+  addPendingEntries();
+}
+
+void ControlFlowGraphBuilder::runParallel(const ReferencedTopDUContext& top, const ParseSession* session, AST* node, ControlFlowGraph* graph)
+{
+  QList<AST*> parts = Cpp::independentParts(node);
+  if(parts.size() < 2) {
+    ControlFlowGraphBuilder builder(top, session, graph);
+    builder.run(node);
+    return;
+  }
+  
+  QList<ControlFlowGraphBuilder*> builders;
+  foreach(AST* part, parts) {
+    ControlFlowGraphBuilder* builder = new ControlFlowGraphBuilder(top, session, graph);
+    builder->m_part = part;
+    builders << builder;
+  }
+  
+  QtConcurrent::blockingMap(builders, &ControlFlowGraphBuilder::buildPart);
+  
+  foreach(ControlFlowGraphBuilder* builder, builders)
+    builder->addPendingEntries();
+  qDeleteAll(builders);
+}
+
+void ControlFlowGraphBuilder::buildPart(ControlFlowGraphBuilder*& builder)
+{
+  Q_ASSERT(!builder->m_currentNode);
+  builder->visit(builder->m_part);
+}
+
+void ControlFlowGraphBuilder::addPendingEntries()
+{
+  foreach(const PendingEntry& entry, m_pendingEntries) {
+    if(entry.dead)
+      m_graph->addDeadNode(entry.node);
+    else if(entry.declaration)
+      m_graph->addEntry(entry.declaration, entry.node);
+    else
+      m_graph->addEntry(entry.node);
+  }
+  m_pendingEntries.clear();
 }
 
 CursorInRevision ControlFlowGraphBuilder::cursorForToken(uint token)
 {
-  return m_session->positionAt(m_session->token_stream->position(token));
+  return m_session->positionAt(m_session->token_stream->position(token), m_locationTable);
 }
 
 RangeInRevision ControlFlowGraphBuilder::nodeRange(AST* node)
@@ -108,17 +156,17 @@ void ControlFlowGraphBuilder::visitFunctionDefinition(FunctionDefinitionAST* nod
 //     qDebug() << "lalala" << nodeToString(m_session, node) << node->function_body->ducontext->owner() << node->function_body;
   }
   
-  if(d)
-    m_graph->addEntry(d, createCompoundStatement(node->function_body, m_returnNode));
-  else
-    m_graph->addEntry(createCompoundStatement(node->function_body, m_returnNode));
+  PendingEntry entry = { d, createCompoundStatement(node->function_body, m_returnNode), false };
+  m_pendingEntries << entry;
 }
 
 void ControlFlowGraphBuilder::visitEnumerator(EnumeratorAST* node)
 {
     bool create=!m_currentNode;
-    if(create && node->expression)
-      m_graph->addEntry(createCompoundStatement(node->expression, 0));
+    if(create && node->expression) {
+      PendingEntry entry = { 0, createCompoundStatement(node->expression, 0), false };
+      m_pendingEntries << entry;
+    }
     else
       DefaultVisitor::visitEnumerator(node);
 }
@@ -261,7 +309,8 @@ void ControlFlowGraphBuilder::visitJumpStatement(JumpStatementAST* node)
   deadNode->setStartCursor(m_currentNode->nodeRange().end);
 //   deadNode->setEndCursor(cursorForToken(node->end_token));
   m_currentNode=deadNode;
-  m_graph->addDeadNode(deadNode);
+  PendingEntry entry = { 0, deadNode, true };
+  m_pendingEntries << entry;
 }
 
 void ControlFlowGraphBuilder::visitSwitchStatement(SwitchStatementAST* node)
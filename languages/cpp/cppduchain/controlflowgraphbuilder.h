@@ -22,10 +22,12 @@
 #include <cppduchainexport.h>
 #include <parser/default_visitor.h>
 #include <language/duchain/topducontext.h>
+#include <rpp/pp-location.h>
 
 namespace KDevelop
 {
 class ControlFlowGraph;
+class Declaration;
 class ControlFlowNode;
 class CursorInRevision;
 class IndexedString;
@@ -39,6 +41,13 @@ class KDEVCPPDUCHAIN_EXPORT ControlFlowGraphBuilder : public DefaultVisitor
     
     void run(AST* node);
     
+    /**
+     * Same as run(), but the independent parts of @p node are processed in parallel on the global thread-pool,
+     * @see Cpp::independentParts(). The entries are added to @p graph in source order.
+     * The du-chain must not be write-locked, because the parts are read-locked from other threads.
+     */
+    static void runParallel(const KDevelop::ReferencedTopDUContext& top, const ParseSession* session, AST* node, KDevelop::ControlFlowGraph* graph);
+    
   protected:
     virtual void visitFunctionDefinition(FunctionDefinitionAST* node);
     virtual void visitEnumerator(EnumeratorAST* node);
@@ -55,6 +64,10 @@ class KDEVCPPDUCHAIN_EXPORT ControlFlowGraphBuilder : public DefaultVisitor
     virtual void visitLabeledStatement(LabeledStatementAST* node);
     
   private:
+    ///Visits the part without adding anything to the graph yet, used from the thread-pool
+    static void buildPart(ControlFlowGraphBuilder*& builder);
+    void addPendingEntries();
+    
     KDevelop::ControlFlowNode* createCompoundStatement(AST* node, KDevelop::ControlFlowNode* next);
     void createCompoundStatementFrom(KDevelop::ControlFlowNode* curr, AST* node, KDevelop::ControlFlowNode* next);
     KDevelop::CursorInRevision cursorForToken(uint token);
@@ -74,6 +87,18 @@ class KDEVCPPDUCHAIN_EXPORT ControlFlowGraphBuilder : public DefaultVisitor
     QMap<KDevelop::IndexedString, QList<KDevelop::ControlFlowNode*> > m_pendingGotoNodes;
     
     KDevelop::ReferencedTopDUContext m_top;
+    
+    ///Own copy, because the table in the session may not be used from multiple threads
+    rpp::LocationTable m_locationTable;
+    
+    ///Entries are collected while visiting, and added to the graph afterwards
+    struct PendingEntry {
+      KDevelop::Declaration* declaration;
+      KDevelop::ControlFlowNode* node;
+      bool dead;
+    };
+    QList<PendingEntry> m_pendingEntries;
+    AST* m_part;
 };
 
 #endif // CONTROLFLOWGRAPHBUILDER_H
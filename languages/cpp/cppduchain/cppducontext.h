@@ -70,7 +70,6 @@ While construction:
 using namespace KDevelop;
 
 namespace Cpp {
-extern QMutex cppDuContextInstantiationsMutex;
 
     ///This class breaks up the logic of searching a declaration in C++, so QualifiedIdentifiers as well as AST-based lookup mechanisms can be used for searching
     class FindDeclaration {
@@ -454,16 +453,15 @@ class CppDUContext : public BaseContext {
     }
     
     virtual void visit(DUChainVisitor& visitor) {
-      QMutexLocker l(&cppDuContextInstantiationsMutex);
-      foreach(CppDUContext<BaseContext>* ctx, m_instatiations)
+      //The nested contexts lock their own instantiations, so don't keep this one locked while visiting them
+      foreach(CppDUContext<BaseContext>* ctx, instantiations())
         ctx->visit(visitor);
       
       BaseContext::visit(visitor);
     }
     
     virtual void deleteUses() {
-      QMutexLocker l(&cppDuContextInstantiationsMutex);
-      foreach(CppDUContext<BaseContext>* ctx, m_instatiations)
+      foreach(CppDUContext<BaseContext>* ctx, instantiations())
         ctx->deleteUses();
       BaseContext::deleteUses();
     }
@@ -492,9 +490,8 @@ class CppDUContext : public BaseContext {
         setInstantiatedFrom(context->m_instantiatedFrom, templateArguments);
         return;
       }
-      QMutexLocker l(&cppDuContextInstantiationsMutex);
-      
       if( m_instantiatedFrom ) {
+        InstantiationLocker l(m_instantiatedFrom);
         Q_ASSERT(m_instantiatedFrom->m_instatiations[m_instantiatedWith] == this);
         m_instantiatedFrom->m_instatiations.remove( m_instantiatedWith );
       }
@@ -529,6 +526,7 @@ class CppDUContext : public BaseContext {
       m_instantiatedFrom = context;
       Q_ASSERT(m_instantiatedFrom != this);
       if(m_instantiatedFrom) {
+        InstantiationLocker l(m_instantiatedFrom);
         if(!m_instantiatedFrom->m_instatiations.contains(m_instantiatedWith)) {
           m_instantiatedFrom->m_instatiations.insert( m_instantiatedWith, this );
         }else{
@@ -571,6 +569,12 @@ class CppDUContext : public BaseContext {
       return m_instantiatedFrom;
     }
 
+    ///Returns a snapshot of the current instantiations of this context
+    QHash<IndexedInstantiationInformation, CppDUContext<BaseContext>* > instantiations() const {
+      InstantiationLocker l(this);
+      return m_instatiations;
+    }
+
     virtual bool inDUChain() const {
       ///There must be no changes from the moment m_instantiatedFrom is set, because then it can be found as an instantiation by other threads
       return m_instantiatedFrom || BaseContext::inDUChain();
@@ -612,6 +616,7 @@ class CppDUContext : public BaseContext {
         return m_instantiatedFrom->instantiate(info, source);
       
       {
+        InstantiationLocker l(this);
         typename QHash<IndexedInstantiationInformation, CppDUContext<BaseContext>* >::const_iterator it = m_instatiations.constFind(info.indexed());
         if(it != m_instatiations.constEnd())
           return *it;
@@ -652,7 +657,7 @@ class CppDUContext : public BaseContext {
     void deleteAllInstantiations() {
       //Specializations will be destroyed the same time this is destroyed
       CppDUContext<BaseContext>* oldFirst = 0;
-      QMutexLocker l(&cppDuContextInstantiationsMutex);
+      InstantiationLocker l(this);
       while(!m_instatiations.isEmpty()) {
         CppDUContext<BaseContext>* first = 0;
         first = *m_instatiations.begin();
@@ -742,7 +747,7 @@ class CppDUContext : public BaseContext {
 
     CppDUContext<BaseContext>* m_instantiatedFrom;
 
-    ///Every access to m_instatiations must be serialized through instatiationsMutex, because they may be written without a write-lock
+    ///Every access to m_instatiations must be serialized through an InstantiationLocker on this, because they may be written without a write-lock
     QHash<IndexedInstantiationInformation, CppDUContext<BaseContext>* > m_instatiations;
     IndexedInstantiationInformation m_instantiatedWith;
 };
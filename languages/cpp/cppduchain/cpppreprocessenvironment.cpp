@@ -27,6 +27,7 @@ CppPreprocessEnvironment::CppPreprocessEnvironment( const KSharedPtr<Cpp::Enviro
   , m_identityOffsetRestrictionEnabled(false)
   , m_finished(false)
   , m_environmentFile(environmentFile)
+  , m_identifierCount(0)
 {
     //If this is included from another preprocessed file, take the current macro-set from there.
     ///NOTE: m_environmentFile may be zero, this must be treated
@@ -42,9 +43,46 @@ void CppPreprocessEnvironment::finishEnvironment(bool leaveEnvironmentFile) {
             m_environmentFile->addStrings(m_strings);
         m_finished = true;
         m_strings.clear();
+        clearIdentifierStatus();
     }
 }
 
+void CppPreprocessEnvironment::clearIdentifierStatus() {
+    m_identifierTable.clear();
+    m_identifierCount = 0;
+}
+
+CppPreprocessEnvironment::IdentifierEntry& CppPreprocessEnvironment::identifierEntry(uint index) const {
+    if( (m_identifierCount + 1) * 2 > (uint)m_identifierTable.size() ) {
+        //Keep the load below one half, so probe sequences stay short
+        QVector<IdentifierEntry> old;
+        old.swap(m_identifierTable);
+        const IdentifierEntry empty = { 0, 0, 0 };
+        m_identifierTable.fill(empty, qMax(1024, old.size() * 2));
+        const uint mask = m_identifierTable.size() - 1;
+        foreach( const IdentifierEntry& entry, old ) {
+            if( !entry.index )
+                continue;
+            uint slot = (entry.index * 2654435761u) & mask;
+            while( m_identifierTable[slot].index )
+                slot = (slot + 1) & mask;
+            m_identifierTable[slot] = entry;
+        }
+    }
+
+    const uint mask = m_identifierTable.size() - 1;
+    uint slot = (index * 2654435761u) & mask;
+    while( m_identifierTable[slot].index && m_identifierTable[slot].index != index )
+        slot = (slot + 1) & mask;
+
+    IdentifierEntry& entry(m_identifierTable[slot]);
+    if( !entry.index ) {
+        entry.index = index;
+        ++m_identifierCount;
+    }
+    return entry;
+}
+
 void CppPreprocessEnvironment::removeMacro(const KDevelop::IndexedString& macroName) {
   m_macroNameSet.remove(macroName);
   rpp::pp_macro* m = new rpp::pp_macro;
@@ -55,6 +93,8 @@ void CppPreprocessEnvironment::removeMacro(const KDevelop::IndexedString& macroN
 
 void CppPreprocessEnvironment::removeString(const KDevelop::IndexedString& str) {
   m_strings.erase(str.index());
+  if( str.index() )
+    identifierEntry(str.index()).status &= ~RecordedString;
 }
 
 rpp::pp_macro* CppPreprocessEnvironment::retrieveMacro(const KDevelop::IndexedString& name, bool isImportant) const {
@@ -66,11 +106,41 @@ rpp::pp_macro* CppPreprocessEnvironment::retrieveMacro(const KDevelop::IndexedSt
 
     rpp::pp_macro* ret = rpp::Environment::retrieveMacro(name, isImportant);
 
-    if( !ret || (!m_environmentFile->definedMacroNames().contains(name) && !m_environmentFile->unDefinedMacroNames().contains(name)) )
+    if( !name.index() ) {
+      //The empty string, not worth caching
+      if( !ret || (!m_environmentFile->definedMacroNames().contains(name) && !m_environmentFile->unDefinedMacroNames().contains(name)) )
+          m_strings.insert(name.index());
+      if( ret )
+          m_environmentFile->usingMacro(*ret);
+      return ret;
+    }
+
+    //Most identifiers are no macros, and have been seen before. Those only cost a probe into m_identifierTable.
+    //A name that once is in the defined or undefined macro-names of m_environmentFile never leaves both sets.
+    IdentifierEntry& entry(identifierEntry(name.index()));
+
+    if( !ret ) {
+      if( !(entry.status & RecordedString) ) {
         m_strings.insert(name.index());
+        entry.status |= RecordedString;
+      }
+      return ret;
+    }
 
-    if( ret )
-        m_environmentFile->usingMacro(*ret);
+    if( !(entry.status & (RecordedString | KnownMacroName)) ) {
+      if( !m_environmentFile->definedMacroNames().contains(name) && !m_environmentFile->unDefinedMacroNames().contains(name) ) {
+        m_strings.insert(name.index());
+        entry.status |= RecordedString;
+      }else{
+        entry.status |= KnownMacroName;
+      }
+    }
+
+    //usingMacro(..) does nothing for names that are defined or undefined within this file
+    if( !(entry.status & KnownMacroName) && entry.usedMacro != ret ) {
+      m_environmentFile->usingMacro(*ret);
+      entry.usedMacro = ret;
+    }
 
     return ret;
 }
@@ -82,6 +152,7 @@ KSharedPtr<Cpp::EnvironmentFile> CppPreprocessEnvironment::environmentFile() con
 void CppPreprocessEnvironment::setEnvironmentFile( const KSharedPtr<Cpp::EnvironmentFile>& environmentFile ) {
     m_environmentFile = environmentFile;
     m_finished = false;
+    clearIdentifierStatus();
 }
 
 void CppPreprocessEnvironment::swapMacros( rpp::Environment* parentEnvironment ) {
@@ -14,6 +14,8 @@
 #ifndef CPPPREPROCESSENVIRONMENT_H
 #define CPPPREPROCESSENVIRONMENT_H
 
+#include <QVector>
+
 #include <language/duchain/parsingenvironment.h>
 #include "parser/rpp/pp-environment.h"
 #include "environmentmanager.h"
@@ -83,12 +85,35 @@ public:
   static void setRecordOnlyImportantString(bool);
   
 private:
+    enum IdentifierStatus {
+      ///The identifier was inserted into m_strings
+      RecordedString = 1,
+      ///The identifier is in the defined or undefined macro names of m_environmentFile
+      KnownMacroName = 2
+    };
+
+    ///What retrieveMacro(..) found out about an identifier during this run
+    struct IdentifierEntry {
+      uint index;
+      uint status;
+      ///The macro that m_environmentFile->usingMacro(..) was last called for
+      const rpp::pp_macro* usedMacro;
+    };
+
+    ///Returns the entry for the given IndexedString index from the open-addressing table, inserting it if needed
+    IdentifierEntry& identifierEntry(uint index) const;
+    void clearIdentifierStatus();
+
     uint m_identityOffsetRestriction;
     bool m_identityOffsetRestrictionEnabled;
     bool m_finished;
     QSet<KDevelop::IndexedString> m_macroNameSet;
     mutable std::set<Utils::BasicSetRepository::Index> m_strings;
     mutable KSharedPtr<Cpp::EnvironmentFile> m_environmentFile;
+    ///Caches the status of each identifier, so repeated lookups don't need to query the repository-backed
+    ///string-sets of m_environmentFile. Is cleared whenever m_strings or m_environmentFile are reset.
+    mutable QVector<IdentifierEntry> m_identifierTable;
+    mutable uint m_identifierCount;
 };
 
 #endif
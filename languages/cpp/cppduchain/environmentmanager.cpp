@@ -227,6 +227,12 @@ bool EnvironmentFile::matchEnvironment(const ParsingEnvironment* _environment) c
       return true;
     }
 
+  return matchMacros(cppEnvironment);
+}
+
+bool EnvironmentFile::matchMacros(const CppPreprocessEnvironment* cppEnvironment) const {
+  ENSURE_READ_LOCKED
+
   const auto& environmentMacroNames = cppEnvironment->macroNameSet();
 
   const ReferenceCountedStringSet& conflicts = strings() - d_func()->m_usedMacroNames;
@@ -285,6 +285,10 @@ class KDEVCPPDUCHAIN_EXPORT EnvironmentFile : public KDevelop::ParsingEnvironmen
     uint identityOffset() const;
     
     virtual bool matchEnvironment(const KDevelop::ParsingEnvironment* environment) const;
+
+    ///Returns whether the macros in @p environment are compatible to the ones this file was preprocessed with.
+    ///This is the check done by matchEnvironment(..) in full matching-mode, but it does not depend on the matching-level.
+    bool matchMacros(const CppPreprocessEnvironment* environment) const;
     
     virtual bool needsUpdate(const KDevelop::ParsingEnvironment* environment = 0) const;
     
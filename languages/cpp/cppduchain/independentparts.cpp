@@ -0,0 +1,80 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "independentparts.h"
+
+#include <ast.h>
+
+namespace {
+
+void collectParts(const ListNode<DeclarationAST*>* declarations, QList<AST*>& parts);
+
+void collectPart(DeclarationAST* declaration, QList<AST*>& parts)
+{
+  if (!declaration)
+    return;
+
+  switch (declaration->kind) {
+    case AST::Kind_Namespace: {
+      LinkageBodyAST* body = static_cast<NamespaceAST*>(declaration)->linkage_body;
+      if (body)
+        collectParts(body->declarations, parts);
+      break;
+    }
+    case AST::Kind_LinkageSpecification: {
+      LinkageSpecificationAST* linkage = static_cast<LinkageSpecificationAST*>(declaration);
+      if (linkage->linkage_body)
+        collectParts(linkage->linkage_body->declarations, parts);
+      collectPart(linkage->declaration, parts);
+      break;
+    }
+    default:
+      parts << declaration;
+  }
+}
+
+void collectParts(const ListNode<DeclarationAST*>* declarations, QList<AST*>& parts)
+{
+  if (!declarations)
+    return;
+
+  const ListNode<DeclarationAST*>* it = declarations->toFront();
+  const ListNode<DeclarationAST*>* end = it;
+  do {
+    collectPart(it->element, parts);
+    it = it->next;
+  } while (it != end);
+}
+
+}
+
+namespace Cpp {
+
+QList<AST*> independentParts(AST* node)
+{
+  QList<AST*> parts;
+  if (!node)
+    return parts;
+
+  if (node->kind == AST::Kind_TranslationUnit)
+    collectParts(static_cast<TranslationUnitAST*>(node)->declarations, parts);
+  else
+    parts << node;
+
+  return parts;
+}
+
+}
@@ -0,0 +1,40 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_INDEPENDENTPARTS_H
+#define CPP_INDEPENDENTPARTS_H
+
+#include <QList>
+
+#include "cppduchainexport.h"
+
+class AST;
+
+namespace Cpp {
+
+/**
+ * Splits @p node into parts that the per-function analyses can process independently of each other,
+ * for example on different threads.
+ *
+ * A translation-unit is split into its declarations, namespaces and linkage-specifications are split
+ * further into the declarations they contain. Any other node is returned as the only part.
+ * The parts are returned in source order, and visiting them one after the other is equivalent to visiting @p node.
+ */
+KDEVCPPDUCHAIN_EXPORT QList<AST*> independentParts(AST* node);
+
+}
+
+#endif // CPP_INDEPENDENTPARTS_H
@@ -0,0 +1,131 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "instantiationstore.h"
+
+#include <QPair>
+#include <QtAlgorithms>
+
+#include <kglobal.h>
+#include <kdebug.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+
+#include "templatedeclaration.h"
+
+using namespace KDevelop;
+
+namespace Cpp {
+
+K_GLOBAL_STATIC(InstantiationStore, instantiationStore)
+
+InstantiationStore* InstantiationStore::self()
+{
+  return instantiationStore;
+}
+
+InstantiationStore::InstantiationStore()
+  : m_budget(0)
+{
+}
+
+InstantiationStore::Statistics InstantiationStore::statistics() const
+{
+  Statistics ret;
+  ret.live = m_live;
+  ret.evicted = m_evicted;
+  ret.recreated = m_recreated;
+  return ret;
+}
+
+void InstantiationStore::setBudget(uint maxInstantiations)
+{
+  m_budget = maxInstantiations;
+}
+
+uint InstantiationStore::budget() const
+{
+  return m_budget;
+}
+
+void InstantiationStore::added(TemplateDeclaration* owner)
+{
+  m_live.fetchAndAddRelaxed(1);
+
+  QMutexLocker lock(&m_mutex);
+  m_owners.insert(owner);
+}
+
+void InstantiationStore::removed(uint count)
+{
+  m_live.fetchAndAddRelaxed(-int(count));
+}
+
+void InstantiationStore::evicted(uint count)
+{
+  m_live.fetchAndAddRelaxed(-int(count));
+  m_evicted.fetchAndAddRelaxed(count);
+}
+
+void InstantiationStore::recreated()
+{
+  m_recreated.fetchAndAddRelaxed(1);
+}
+
+void InstantiationStore::ownerDestroyed(TemplateDeclaration* owner)
+{
+  QMutexLocker lock(&m_mutex);
+  m_owners.remove(owner);
+}
+
+uint InstantiationStore::evictIfOverBudget()
+{
+  ENSURE_CHAIN_WRITE_LOCKED
+
+  const uint budget = m_budget;
+  if (!budget || uint(int(m_live)) <= budget)
+    return 0;
+
+  const uint target = budget - budget / 4;
+
+  QList<QPair<uint, TemplateDeclaration*> > owners;
+  {
+    QMutexLocker lock(&m_mutex);
+    owners.reserve(m_owners.size());
+    foreach (TemplateDeclaration* owner, m_owners)
+      owners << qMakePair(owner->lastInstantiationUse(), owner);
+  }
+  // oldest use first
+  qSort(owners);
+
+  uint count = 0;
+  for (int a = 0; a < owners.size() && uint(int(m_live)) > target; ++a) {
+    TemplateDeclaration* owner = owners[a].second;
+    {
+      // the owner may have been deleted together with an instantiation evicted before
+      QMutexLocker lock(&m_mutex);
+      if (!m_owners.contains(owner))
+        continue;
+    }
+    count += owner->evictInstantiations();
+  }
+
+  kDebug() << "evicted" << count << "instantiations, live:" << int(m_live) << "budget:" << budget;
+  return count;
+}
+
+}
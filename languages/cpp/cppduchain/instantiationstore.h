@@ -0,0 +1,108 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_INSTANTIATIONSTORE_H
+#define CPP_INSTANTIATIONSTORE_H
+
+#include <QMutex>
+#include <QSet>
+#include <QAtomicInt>
+
+#include "cppduchainexport.h"
+
+namespace Cpp {
+
+class TemplateDeclaration;
+
+/**
+ * Keeps the count of template instantiations within a budget.
+ *
+ * Instantiations are temporary declarations that are never stored to disk, so they only
+ * grow while a session runs. When a budget is set and exceeded, the instantiations of the
+ * least recently used template-declarations are deleted. Whenever one of them is needed
+ * again, it is simply created anew by TemplateDeclaration::instantiate().
+ *
+ * Explicit specializations are real declarations of a persistent top-context, they are never evicted.
+ * Neither are instantiations whose internal context is imported, for example by a class that
+ * inherits from them, or that have uses.
+ */
+class KDEVCPPDUCHAIN_EXPORT InstantiationStore
+{
+public:
+  static InstantiationStore* self();
+
+  InstantiationStore();
+
+  struct Statistics
+  {
+    ///Instantiations that currently exist
+    uint live;
+    ///Instantiations that were deleted to stay within the budget
+    uint evicted;
+    ///Evicted instantiations that were created again
+    uint recreated;
+  };
+  Statistics statistics() const;
+
+  /**
+   * Maximum count of instantiations that are kept, zero disables the eviction.
+   *
+   * The budget is counted in instantiations rather than bytes, because the size of an
+   * instantiation mostly depends on the contexts it drags along.
+   */
+  void setBudget(uint maxInstantiations);
+  uint budget() const;
+
+  /**
+   * When the budget is exceeded, evict the instantiations of the least recently used
+   * template-declarations until a quarter of the budget is free again.
+   *
+   * The du-chain must be write-locked, and no parse-job may exist: Parse-jobs keep pointers to
+   * instantiations and their contexts while they release the lock between building steps.
+   * CppLanguageSupport calls this when the background-parser has finished all its jobs.
+   *
+   * @return The count of evicted instantiations.
+   */
+  uint evictIfOverBudget();
+
+  ///Advances the clock that orders the uses of template-declarations, and returns the new value
+  uint tick()
+  {
+    return m_clock.fetchAndAddRelaxed(1) + 1;
+  }
+
+  ///The following are called by TemplateDeclaration
+  void added(TemplateDeclaration* owner);
+  void removed(uint count = 1);
+  void evicted(uint count);
+  void recreated();
+  void ownerDestroyed(TemplateDeclaration* owner);
+
+private:
+  mutable QMutex m_mutex;
+  ///Template-declarations that have had instantiations
+  QSet<TemplateDeclaration*> m_owners;
+  uint m_budget;
+
+  QAtomicInt m_clock;
+  QAtomicInt m_live;
+  QAtomicInt m_evicted;
+  QAtomicInt m_recreated;
+};
+
+}
+
+#endif // CPP_INSTANTIATIONSTORE_H
@@ -21,6 +21,8 @@
 #include "templatedeclaration.h"
 
 #include <QThreadStorage>
+#include <QElapsedTimer>
+#include <QAtomicInt>
 #include <kglobal.h>
 
 #include <language/duchain/declaration.h>
@@ -36,6 +38,7 @@
 #include "cppducontext.h"
 #include "expressionparser.h"
 #include "templateresolver.h"
+#include "instantiationstore.h"
 #include <language/duchain/classdeclaration.h>
 #include <language/duchain/duchainregister.h>
 #include <util/pushvalue.h>
@@ -58,7 +61,86 @@ REGISTER_TEMPLATE_DECLARATION(FunctionDefinition)
 REGISTER_TEMPLATE_DECLARATION(AliasDeclaration)
 REGISTER_TEMPLATE_DECLARATION(ForwardDeclaration)
 
-QMutex TemplateDeclaration::instantiationsMutex(QMutex::Recursive);
+namespace {
+///Power of two, so the shard can be chosen by masking
+const uint instantiationLockCount = 64;
+
+struct InstantiationLocks {
+  InstantiationLocks() : sharded(true) {
+    for(uint a = 0; a < instantiationLockCount; ++a)
+      locks[a] = new QMutex(QMutex::Recursive);
+  }
+  ~InstantiationLocks() {
+    for(uint a = 0; a < instantiationLockCount; ++a)
+      delete locks[a];
+  }
+
+  QMutex* lockFor(const void* owner) const {
+    if(!sharded)
+      return locks[0];
+    //The low bits of the addresses are equal because of the alignment, so mix in the higher ones
+    quintptr address = reinterpret_cast<quintptr>(owner);
+    return locks[((address >> 4) ^ (address >> 10)) & (instantiationLockCount - 1)];
+  }
+
+  QMutex* locks[instantiationLockCount];
+  bool sharded;
+  QAtomicInt contended;
+  QAtomicInt waitMicroseconds;
+};
+}
+
+K_GLOBAL_STATIC(InstantiationLocks, instantiationLocks)
+
+InstantiationLocker::InstantiationLocker(const void* owner)
+  : m_mutex(instantiationLocks->lockFor(owner))
+  , m_locked(false)
+{
+  lock();
+}
+
+InstantiationLocker::~InstantiationLocker() {
+  if(m_locked)
+    m_mutex->unlock();
+}
+
+void InstantiationLocker::lock() {
+  if(!m_mutex->tryLock()) {
+    QElapsedTimer timer;
+    timer.start();
+    m_mutex->lock();
+    instantiationLocks->contended.fetchAndAddRelaxed(1);
+    instantiationLocks->waitMicroseconds.fetchAndAddRelaxed(timer.nsecsElapsed() / 1000);
+  }
+  m_locked = true;
+}
+
+void InstantiationLocker::unlock() {
+  Q_ASSERT(m_locked);
+  m_mutex->unlock();
+  m_locked = false;
+}
+
+void InstantiationLocker::relock() {
+  Q_ASSERT(!m_locked);
+  lock();
+}
+
+InstantiationLocker::Statistics InstantiationLocker::statistics() {
+  Statistics ret;
+  ret.contended = instantiationLocks->contended;
+  ret.waitMicroseconds = instantiationLocks->waitMicroseconds;
+  return ret;
+}
+
+void InstantiationLocker::resetStatistics() {
+  instantiationLocks->contended = 0;
+  instantiationLocks->waitMicroseconds = 0;
+}
+
+void InstantiationLocker::setSharded(bool sharded) {
+  instantiationLocks->sharded = sharded;
+}
 
 typedef CppDUContext<KDevelop::DUContext> StandardCppDUContext;
 
@@ -310,12 +392,16 @@ namespace Cpp {
 
 TemplateDeclaration::TemplateDeclaration(const TemplateDeclaration& /*rhs*/)
 : m_instantiatedFrom(0)
+, m_instantiationOwner(false)
+, m_lastInstantiationUse(0)
 , m_instantiationDepth(0)
 {
 }
 
 TemplateDeclaration::TemplateDeclaration()
 : m_instantiatedFrom(0)
+, m_instantiationOwner(false)
+, m_lastInstantiationUse(0)
 , m_instantiationDepth(0)
 {
 }
@@ -367,10 +453,12 @@ TemplateDeclaration::~TemplateDeclaration()
   {
     ///Unregister at the declaration this one is instantiated from
     if( m_instantiatedFrom ) {
+      InstantiationLocker l(m_instantiatedFrom);
       InstantiationsHash::iterator it = m_instantiatedFrom->m_instantiations.find(m_instantiatedWith);
       if( it != m_instantiatedFrom->m_instantiations.end() ) {
         Q_ASSERT(*it == this);
         m_instantiatedFrom->m_instantiations.erase(it);
+        InstantiationStore::self()->removed();
       }
 
       m_instantiatedFrom = 0;
@@ -378,6 +466,9 @@ TemplateDeclaration::~TemplateDeclaration()
   }
 
   deleteAllInstantiations();
+
+  if(m_instantiationOwner)
+    InstantiationStore::self()->ownerDestroyed(this);
 }
 
 TemplateDeclaration* TemplateDeclaration::instantiatedFrom() const {
@@ -411,7 +502,7 @@ void TemplateDeclaration::setSpecializedFrom(TemplateDeclaration* other) {
 }
 
 void TemplateDeclaration::reserveInstantiation(const IndexedInstantiationInformation& info) {
-  QMutexLocker l(&instantiationsMutex);
+  InstantiationLocker l(this);
 
   Q_ASSERT(m_instantiations.find(info) == m_instantiations.end());
   m_instantiations.insert(info, 0);
@@ -457,11 +548,13 @@ void TemplateDeclaration::setInstantiatedFrom(TemplateDeclaration* from, const I
   Q_ASSERT(from != this);
   //Change the identifier so it contains the template-parameters
 
-  QMutexLocker l(&instantiationsMutex);
   if( m_instantiatedFrom ) {
+    InstantiationLocker l(m_instantiatedFrom);
     InstantiationsHash::iterator it = m_instantiatedFrom->m_instantiations.find(m_instantiatedWith);
-    if( it != m_instantiatedFrom->m_instantiations.end() && *it == this )
+    if( it != m_instantiatedFrom->m_instantiations.end() && *it == this ) {
       m_instantiatedFrom->m_instantiations.erase(it);
+      InstantiationStore::self()->removed();
+    }
 
     m_instantiatedFrom = 0;
   }
@@ -469,15 +562,22 @@ void TemplateDeclaration::setInstantiatedFrom(TemplateDeclaration* from, const I
   m_instantiatedWith = instantiatedWith.indexed();
   //Only one instantiation is allowed
   if(from) {
+    InstantiationLocker l(from);
     //Either it must be reserved, or not exist yet
     Q_ASSERT(from->m_instantiations.find(instantiatedWith.indexed()) == from->m_instantiations.end() || (*from->m_instantiations.find(instantiatedWith.indexed())) == 0);
     from->m_instantiations.insert(m_instantiatedWith, this);
     Q_ASSERT(from->m_instantiations.contains(m_instantiatedWith));
+
+    from->m_instantiationOwner = true;
+    from->m_lastInstantiationUse = InstantiationStore::self()->tick();
+    InstantiationStore::self()->added(from);
+    if(from->m_evictedInstantiations.remove(m_instantiatedWith))
+      InstantiationStore::self()->recreated();
   }
 }
 
 bool TemplateDeclaration::isInstantiatedFrom(const TemplateDeclaration* other) const {
-    QMutexLocker l(&instantiationsMutex);
+    InstantiationLocker l(other);
 
     InstantiationsHash::const_iterator it = other->m_instantiations.find(m_instantiatedWith);
     if( it != other->m_instantiations.end() && (*it) == this )
@@ -746,11 +846,13 @@ void TemplateDeclaration::deleteAllInstantiations()
 
   InstantiationsHash instantiations;
   {
-    QMutexLocker l(&instantiationsMutex);
+    InstantiationLocker l(this);
     instantiations = m_instantiations;
     m_defaultParameterInstantiations.clear();
     m_instantiations.clear();
+    m_evictedInstantiations.clear();
   }
+  InstantiationStore::self()->removed(instantiations.size());
   
   foreach( TemplateDeclaration* decl, instantiations ) {
     Q_ASSERT(decl);
@@ -766,6 +868,60 @@ void TemplateDeclaration::deleteAllInstantiations()
   }
 }
 
+namespace {
+///Whether persistent parts of the du-chain point to the instantiation, for example a class
+///that has it as base-class imports its internal context, so it must not be deleted
+bool isReferenced(TemplateDeclaration* instantiation)
+{
+  Declaration* decl = dynamic_cast<Declaration*>(instantiation);
+  if(!decl)
+    return true;
+  DUContext* context = decl->internalContext();
+  if(context && !context->importers().isEmpty())
+    return true;
+  return !decl->uses().isEmpty();
+}
+}
+
+uint TemplateDeclaration::evictInstantiations()
+{
+  QList<TemplateDeclaration*> evicted;
+  {
+    InstantiationLocker l(this);
+    InstantiationsHash::iterator it = m_instantiations.begin();
+    while(it != m_instantiations.end()) {
+      //Zero entries are being instantiated right now, and specializations are real declarations
+      if(*it && !(*it)->specializedFrom().isValid() && !isReferenced(*it)) {
+        evicted << *it;
+        m_evictedInstantiations.insert(it.key());
+        it = m_instantiations.erase(it);
+      }else{
+        ++it;
+      }
+    }
+  }
+
+  foreach( TemplateDeclaration* decl, evicted ) {
+    decl->m_instantiatedFrom = 0;
+    Declaration* realDecl = dynamic_cast<Declaration*>(decl);
+    //The instantiated context is deleted too. Otherwise its instantiated members would be found again when
+    //the declaration is re-instantiated, while they still live in the old context.
+    DUContext* context = realDecl->internalContext();
+    CppDUContext<DUContext>* cppContext = dynamic_cast<CppDUContext<DUContext>*>(context);
+    const bool instantiatedContext = cppContext && cppContext->instantiatedFrom();
+    delete realDecl;
+    if(instantiatedContext)
+      delete context;
+  }
+
+  InstantiationStore::self()->evicted(evicted.size());
+  return evicted.size();
+}
+
+uint TemplateDeclaration::lastInstantiationUse() const {
+  return m_lastInstantiationUse;
+}
+
 //TODO: QHash?
 typedef QMap<IndexedString, AbstractType::Ptr> TemplateParams;
 
@@ -958,7 +1114,7 @@ Declaration* TemplateDeclaration::instantiate( const InstantiationInformation& _
     return dynamic_cast<TemplateDeclaration*>(specializedFrom().declaration())->instantiate(templateArguments, source);
 
   {
-    QMutexLocker l(&instantiationsMutex);
+    InstantiationLocker l(this);
     {
       DefaultParameterInstantiationHash::const_iterator it = m_defaultParameterInstantiations.constFind(templateArguments.indexed());
       if(it != m_defaultParameterInstantiations.constEnd())
@@ -969,6 +1125,7 @@ Declaration* TemplateDeclaration::instantiate( const InstantiationInformation& _
     it = m_instantiations.constFind( templateArguments.indexed() );
     if( it != m_instantiations.constEnd() ) {
       if(*it) {
+        m_lastInstantiationUse = InstantiationStore::self()->tick();
         return dynamic_cast<Declaration*>(*it);
       }else{
         ///@todo What if the same thing is instantiated twice in parralel? Then this may trigger as well, altough one side should wait
@@ -1055,7 +1212,7 @@ Declaration* TemplateDeclaration::instantiate( const InstantiationInformation& _
     }
     
     if(!(templateArguments == _templateArguments)) {
-      QMutexLocker l(&instantiationsMutex);
+      InstantiationLocker l(this);
       m_defaultParameterInstantiations[_templateArguments.indexed()] = templateArguments.indexed();
     }
   }
@@ -1064,7 +1221,8 @@ Declaration* TemplateDeclaration::instantiate( const InstantiationInformation& _
     //Now we have the final template-parameters. Once again check whether we have already instantiated this,
     //and if not, reserve the instantiation so we cannot crash later on
     ///@todo When the same declaration is instantuated multiple times, this sucks because one is returned invalid
-    QMutexLocker l(&instantiationsMutex);
+    ///The lookup and the reservation happen within one locked section, so only one thread can win the reservation
+    InstantiationLocker l(this);
     InstantiationsHash::const_iterator it;
     it = m_instantiations.constFind( templateArguments.indexed() );
     if( it != m_instantiations.constEnd() ) {
@@ -1159,7 +1317,7 @@ IndexedInstantiationInformation TemplateDeclaration::instantiatedWith() const {
 }
 
 TemplateDeclaration::InstantiationsHash TemplateDeclaration::instantiations() const {
-    QMutexLocker l(&instantiationsMutex);
+    InstantiationLocker l(this);
     return m_instantiations;
 }
 
@@ -20,6 +20,7 @@
 #define TEMPLATEDECLARATION_H
 
 #include <QMutex>
+#include <QSet>
 
 #include <language/duchain/forwarddeclaration.h>
 #include <language/duchain/duchainbase.h>
@@ -46,6 +47,42 @@ namespace Cpp {
   using KDevelop::IndexedInstantiationInformation;
   template<class Base>
   class CppDUContext;
+
+  /**
+   * Locks the instantiations registered at a template-declaration or a template-context.
+   *
+   * The registries are guarded by a fixed set of recursive mutexes, the one to use is chosen by the
+   * address of the @p owner that holds the registry. Threads instantiating unrelated templates
+   * therefore don't contend, while all accesses to one registry are still serialized.
+   *
+   * Never lock a second owner while holding a lock, because two owners may share the same mutex.
+   * */
+  class KDEVCPPDUCHAIN_EXPORT InstantiationLocker {
+    public:
+      explicit InstantiationLocker(const void* owner);
+      ~InstantiationLocker();
+
+      void unlock();
+      void relock();
+
+      struct Statistics {
+        ///How often a lock was already held by another thread
+        uint contended;
+        ///Total time spent waiting for held locks
+        uint waitMicroseconds;
+      };
+      static Statistics statistics();
+      static void resetStatistics();
+
+      ///When disabled, all owners share one mutex. Only change this while no instantiation is running, it is meant for comparisons.
+      static void setSharded(bool sharded);
+
+    private:
+      void lock();
+
+      QMutex* m_mutex;
+      bool m_locked;
+  };
   
   struct KDEVCPPDUCHAIN_EXPORT TemplateDeclarationData {
     TemplateDeclarationData() {
@@ -110,6 +147,13 @@ namespace Cpp {
     
       //Duchain must be write-locked
       void deleteAllInstantiations();
+
+      ///Deletes all instantiations except for specializations, and those that are imported or used elsewhere.
+      ///They are re-created when needed again. Duchain must be write-locked. @return The count of deleted instantiations
+      uint evictInstantiations();
+
+      ///Value of InstantiationStore::tick() when an instantiation of this was created or looked up the last time
+      uint lastInstantiationUse() const;
       
       ///Returns the template-context that belongs to this template declaration, or zero
       DUContext* templateContext(const TopDUContext* source) const;
@@ -142,11 +186,15 @@ namespace Cpp {
 
       IndexedInstantiationInformation m_instantiatedWith;
       
-      static QMutex instantiationsMutex;
-      ///Every access to m_instantiations must be serialized through instantiationsMutex!
+      ///Every access to m_instantiations and m_defaultParameterInstantiations must be serialized through an InstantiationLocker on this!
       typedef QHash<IndexedInstantiationInformation, IndexedInstantiationInformation> DefaultParameterInstantiationHash;
       DefaultParameterInstantiationHash m_defaultParameterInstantiations;
       InstantiationsHash m_instantiations; ///Every declaration nested within a template declaration knows all its instantiations.
+      ///Instantiations that were evicted by the InstantiationStore, to recognize when they are created again
+      QSet<IndexedInstantiationInformation> m_evictedInstantiations;
+      ///Whether this was registered as owner of instantiations at the InstantiationStore
+      bool m_instantiationOwner;
+      uint m_lastInstantiationUse;
       // recursion counter
       int m_instantiationDepth;
   };
@@ -22,6 +22,10 @@
 #include <language/checks/controlflowgraph.h>
 #include <language/checks/controlflownode.h>
 #include <language/duchain/declaration.h>
+#include <parsesession.h>
+#include <usedecoratorvisitor.h>
+#include <controlflowgraphbuilder.h>
+#include <independentparts.h>
 
 QTEST_MAIN(CodeAnalysisTest)
 
@@ -317,3 +321,39 @@ void CodeAnalysisTest::testControlFlowCreation_data()
   QTest::newRow("lecture") << "int f(int x) { int i; if(x==0) i=3; else i=4; return i; }" << 5;
 }
 
+void CodeAnalysisTest::testParallelAnalysis()
+{
+  QByteArray code = "int a; namespace N { int f(int x) { a = x; return a; } struct C { int m() { while(a) return a++; return 0; } }; } "
+                    "extern \"C\" { void g() { int b = 2; a = b; } } enum E { e = 2 ? 1 : 3 }; int h() { if(a) return 1; goto end; end: return 0; }";
+  LockedTopDUContext top = parse(code, DumpNone, 0, true);
+  
+  ParseSession* session = dynamic_cast<ParseSession*>(top->ast().data());
+  QVERIFY(session);
+  QCOMPARE(Cpp::independentParts(session->topAstNode()).size(), 6);
+  
+  //The parts are read-locked from the thread-pool
+  top.m_writeLock.unlock();
+  
+  DataAccessRepository repo;
+  UseDecoratorVisitor::runParallel(session, session->topAstNode(), &repo);
+  
+  ControlFlowGraph graph;
+  ControlFlowGraphBuilder::runParallel(ReferencedTopDUContext(top), session, session->topAstNode(), &graph);
+  
+  top.m_writeLock.lock();
+  
+  //The results are the same as the ones of the sequential visitors run by parse()
+  QCOMPARE(repo.modifications().size(), m_modifications.modifications().size());
+  QVERIFY(!repo.modifications().isEmpty());
+  for(int i = 0; i < repo.modifications().size(); ++i) {
+    QCOMPARE(repo.modifications().at(i)->pos(), m_modifications.modifications().at(i)->pos());
+    QCOMPARE(repo.modifications().at(i)->flags(), m_modifications.modifications().at(i)->flags());
+  }
+  
+  QCOMPARE(graph.rootNodes().size(), m_ctlflowGraph.rootNodes().size());
+  QVERIFY(!graph.rootNodes().isEmpty());
+  for(int i = 0; i < graph.rootNodes().size(); ++i)
+    QCOMPARE(graph.rootNodes().at(i)->nodeRange(), m_ctlflowGraph.rootNodes().at(i)->nodeRange());
+  QCOMPARE(graph.deadNodes().size(), m_ctlflowGraph.deadNodes().size());
+  QCOMPARE(graph.declarations(), m_ctlflowGraph.declarations());
+}
@@ -37,6 +37,8 @@ class CodeAnalysisTest : public QObject, public Cpp::TestHelper
     
     void testControlFlowCreation();
     void testControlFlowCreation_data();
+    
+    void testParallelAnalysis();
 };
 
 #endif // DATAACCESSTEST_H
@@ -41,6 +41,8 @@
 #include "expressionvisitor.h"
 #include "expressionparser.h"
 #include "typeconversion.h"
+#include "instantiationstore.h"
+#include "builderlock.h"
 
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
@@ -48,6 +50,9 @@
 
 #include <typeinfo>
 
+#include <QThread>
+#include <QElapsedTimer>
+
 using namespace KTextEditor;
 using namespace KDevelop;
 using namespace TypeUtils;
@@ -827,6 +832,152 @@ void TestExpressionParser::testTypeConversionWithTypedefs() {
   release(c);
 }
 
+void TestExpressionParser::testTypeConversionCache() {
+  TEST_FILE_PARSE_ONLY
+
+  QByteArray test = "struct A {}; struct B : public A { operator int() {} }; B b; A a; int i; const A& r;";
+  DUContext* c = parse( test, DumpNone /*DumpDUChain | DumpAST */);
+
+  uint topContextIndex;
+  QList<IndexedType> types;
+  {
+    DUChainReadLocker lock(DUChain::lock());
+    QCOMPARE(c->localDeclarations().count(), 6);
+    topContextIndex = c->topContext()->ownIndex();
+    for(int a = 2; a < 6; ++a)
+      types << c->localDeclarations()[a]->indexedType();
+  }
+
+  QList<uint> uncached;
+  {
+    DUChainReadLocker lock(DUChain::lock());
+    TypeConversion tc(c->topContext());
+    foreach(const IndexedType& from, types)
+      foreach(const IndexedType& to, types)
+        uncached << tc.implicitConversion(from, to);
+  }
+  QVERIFY(uncached.contains(0));
+
+  //The second and third round are answered by the kept results, the last after invalidation
+  for(int round = 0; round < 4; ++round) {
+    if(round == 3)
+      TypeConversion::invalidatePersistentCaches();
+    TypeConversionCacheEnabler enableConversionCache(topContextIndex);
+    DUChainReadLocker lock(DUChain::lock());
+    QList<uint> cached;
+    for(int repeat = 0; repeat < 2; ++repeat) {
+      cached.clear();
+      TypeConversion tc(c->topContext());
+      foreach(const IndexedType& from, types)
+        foreach(const IndexedType& to, types)
+          cached << tc.implicitConversion(from, to);
+      QCOMPARE(cached, uncached);
+    }
+  }
+
+  release(c);
+}
+
+void TestExpressionParser::testBuilderLockStatistics() {
+  BuilderLock::resetStatistics();
+  BuilderLock::setCollectStatistics(true);
+
+  QByteArray test = "struct A { int m; }; void f(A a) { a.m = 1; }";
+  TopDUContext* top = parse( test, DumpNone );
+
+  {
+    //Nested lockers are not measured again
+    BuilderWriteLocker outer;
+    const uint acquisitions = BuilderLock::statistics().write.acquisitions;
+    BuilderWriteLocker inner;
+    BuilderReadLocker read;
+    QCOMPARE(BuilderLock::statistics().write.acquisitions, acquisitions);
+  }
+
+  BuilderLock::setCollectStatistics(false);
+  const BuilderLock::Statistics stats = BuilderLock::statistics();
+  QVERIFY(stats.write.acquisitions > 0);
+  QVERIFY(stats.write.maxHoldMicroseconds <= stats.write.holdMicroseconds);
+
+  {
+    //Without collecting, nothing is recorded
+    BuilderWriteLocker lock;
+  }
+  QCOMPARE(BuilderLock::statistics().write.acquisitions, stats.write.acquisitions);
+
+  DUChainWriteLocker lock;
+  release(top);
+}
+
+void TestExpressionParser::testInstantiationEviction() {
+  TEST_FILE_PARSE_ONLY
+
+  QByteArray test = "template<class T> struct Box { typedef T value_type; T value; }; "
+                    "struct A {}; struct B {}; struct C {}; struct D {}; struct E {}; "
+                    "struct Derived : Box<E> {};";
+  TopDUContext* top = parse( test, DumpNone /*DumpDUChain | DumpAST */);
+
+  QList<QByteArray> expressions;
+  expressions << "Box<A>::value_type" << "Box<B>::value_type" << "Box<C>::value_type" << "Box<D>::value_type";
+
+  Cpp::ExpressionParser parser;
+  foreach(const QByteArray& expression, expressions)
+    QVERIFY(parser.evaluateType(expression, DUContextPointer(top), top).isValid());
+
+  //Using an existing instantiation advances the clock as well
+  TemplateDeclaration* box = 0;
+  uint lastUse = 0;
+  {
+    DUChainReadLocker lock;
+    box = dynamic_cast<TemplateDeclaration*>(top->localDeclarations()[0]);
+    QVERIFY(box);
+    lastUse = box->lastInstantiationUse();
+  }
+  QVERIFY(parser.evaluateType(expressions.first(), DUContextPointer(top), top).isValid());
+  {
+    DUChainReadLocker lock;
+    QVERIFY(box->lastInstantiationUse() > lastUse);
+  }
+
+  InstantiationStore* store = InstantiationStore::self();
+  const InstantiationStore::Statistics before = store->statistics();
+  QVERIFY(before.live > uint(expressions.size()));
+
+  {
+    DUChainWriteLocker lock;
+    //Without a budget, nothing is evicted
+    QCOMPARE(store->evictIfOverBudget(), 0u);
+    store->setBudget(1);
+    QVERIFY(store->evictIfOverBudget() >= uint(expressions.size()));
+    store->setBudget(0);
+
+    //The base-class of Derived is imported by a persistent context, so it is kept
+    DUContext* derived = top->childContexts().last();
+    QCOMPARE(derived->importedParentContexts().size(), 1);
+    DUContext* base = derived->importedParentContexts().first().context(top);
+    QVERIFY(base);
+    QVERIFY(base->owner());
+    QCOMPARE(base->owner()->identifier().identifier().str(), QString("Box"));
+  }
+
+  const InstantiationStore::Statistics evicted = store->statistics();
+  QVERIFY(evicted.live >= 1);
+  QVERIFY(evicted.evicted >= before.evicted + expressions.size());
+  QVERIFY(parser.evaluateType("Derived::value_type", DUContextPointer(top), top).isValid());
+
+  //Evicted instantiations are created again when they are needed
+  foreach(const QByteArray& expression, expressions) {
+    Cpp::ExpressionEvaluationResult result = parser.evaluateType(expression, DUContextPointer(top), top);
+    QVERIFY(result.isValid());
+    DUChainReadLocker lock;
+    QVERIFY(result.type.abstractType().cast<StructureType>());
+  }
+  QVERIFY(store->statistics().recreated >= evicted.recreated + expressions.size());
+
+  DUChainWriteLocker lock;
+  release(top);
+}
+
 void TestExpressionParser::testTypeConversion() {
   TEST_FILE_PARSE_ONLY
 
@@ -1422,6 +1573,98 @@ void TestExpressionParser::benchEvaluateType_data()
   QTest::newRow("main-B") << mainCtx << QByteArray("B");
 }
 
+class InstantiatingThread : public QThread
+{
+public:
+  InstantiatingThread(const DUContextPointer& context, const QList<QByteArray>& expressions)
+    : m_context(context), m_expressions(expressions), m_resolved(0)
+  {
+  }
+
+  int resolved() const
+  {
+    return m_resolved;
+  }
+
+protected:
+  virtual void run()
+  {
+    foreach(const QByteArray& expression, m_expressions) {
+      Cpp::ExpressionParser parser;
+      if (parser.evaluateType(expression, m_context).isValid())
+        ++m_resolved;
+    }
+  }
+
+private:
+  DUContextPointer m_context;
+  QList<QByteArray> m_expressions;
+  int m_resolved;
+};
+
+void TestExpressionParser::benchConcurrentInstantiation()
+{
+  const int threadCount = qMax(QThread::idealThreadCount(), 4);
+  const int classCount = 24;
+
+  QByteArray code =
+    "template<class T> struct Box { typedef T value_type; T value; Box<T*> next() const; };\n"
+    "template<class A, class B> struct Pair { typedef A first_type; typedef B second_type; Box<A> first; Box<B> second; };\n"
+    "template<class K, class V> struct Map { typedef Pair<K, V> value_type; value_type at(const K&) const; };\n";
+  for (int a = 0; a < classCount; ++a)
+    code += QString("struct C%1 { int m%1; };\n").arg(a).toLatin1();
+
+  // Every thread instantiates its own templates and a share of templates it has in common with the others
+  QList< QList<QByteArray> > expressions;
+  for (int thread = 0; thread < threadCount; ++thread) {
+    QList<QByteArray> own;
+    for (int a = 0; a < classCount; ++a) {
+      const QString first = QString("C%1").arg(a);
+      const QString second = QString("C%1").arg((a + thread) % classCount);
+      own << QString("Map<%1, Box<%2> >::value_type::second_type::value_type").arg(first, second).toLatin1();
+      own << QString("Pair<Box<%1>, Map<%2, %1> >::first_type").arg(first, second).toLatin1();
+      own << QString("Box<Pair<%1, %2> >().next()").arg(first, second).toLatin1();
+    }
+    expressions << own;
+  }
+
+  // The templates are parsed once per run, so no run finds the instantiations of another one
+  for (int sharded = 0; sharded < 2; ++sharded) {
+    TopDUContext* top = parse(code, DumpNone);
+    QVERIFY(top);
+
+    InstantiationLocker::setSharded(sharded);
+    InstantiationLocker::resetStatistics();
+
+    QList<InstantiatingThread*> threads;
+    for (int thread = 0; thread < threadCount; ++thread)
+      threads << new InstantiatingThread(DUContextPointer(top), expressions[thread]);
+
+    QElapsedTimer timer;
+    timer.start();
+    foreach(InstantiatingThread* thread, threads)
+      thread->start();
+    int resolved = 0;
+    foreach(InstantiatingThread* thread, threads) {
+      thread->wait();
+      resolved += thread->resolved();
+    }
+    const qint64 elapsed = timer.elapsed();
+    qDeleteAll(threads);
+
+    InstantiationLocker::Statistics statistics = InstantiationLocker::statistics();
+    qDebug() << (sharded ? "sharded locks:" : "single lock:") << threadCount << "threads resolved" << resolved
+             << "expressions in" << elapsed << "ms, contended locks:" << statistics.contended
+             << "waited:" << statistics.waitMicroseconds / 1000 << "ms";
+    QVERIFY(resolved > 0);
+
+    DUChainWriteLocker lock;
+    release(top);
+  }
+
+  InstantiationLocker::setSharded(true);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -59,6 +59,9 @@ private slots:
   void testTypeConversion();
   void testTypeConversion2();
   void testTypeConversionWithTypedefs();
+  void testTypeConversionCache();
+  void testInstantiationEviction();
+  void testBuilderLockStatistics();
   void testSmartPointer();
   void testCasts();
   void testEnum();
@@ -83,6 +86,7 @@ private slots:
 
   void benchEvaluateType();
   void benchEvaluateType_data();
+  void benchConcurrentInstantiation();
 
 public:
   enum DumpArea {
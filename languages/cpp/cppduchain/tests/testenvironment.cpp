@@ -23,7 +23,13 @@
 #include "testenvironment.h"
 
 #include <environmentmanager.h>
+#include <cpppreprocessenvironment.h>
 #include <cpputils.h>
+#include <parser/rpp/pp-engine.h>
+#include <parser/rpp/preprocessor.h>
+
+#include <QElapsedTimer>
+#include <QLibraryInfo>
 
 #include <qtest_kde.h>
 
@@ -35,6 +41,215 @@ QTEST_KDEMAIN(TestEnvironment, NoGUI);
 using namespace KDevelop;
 using namespace Cpp;
 
+namespace {
+
+class CountingEnvironment : public CppPreprocessEnvironment
+{
+public:
+  CountingEnvironment(const EnvironmentFilePointer& file, qint64* lookups)
+    : CppPreprocessEnvironment(file)
+    , m_lookups(lookups)
+  {
+  }
+
+  virtual rpp::pp_macro* retrieveMacro(const IndexedString& name, bool isImportant) const
+  {
+    ++*m_lookups;
+    return CppPreprocessEnvironment::retrieveMacro(name, isImportant);
+  }
+
+private:
+  qint64* m_lookups;
+};
+
+/// Preprocesses a file and all includes that can be found in the include paths, each of them once
+class IncludingPreprocessor : public rpp::Preprocessor
+{
+public:
+  IncludingPreprocessor(const QStringList& includePaths)
+    : m_includePaths(includePaths)
+    , m_current(0)
+    , lookups(0)
+    , files(0)
+  {
+  }
+
+  void preprocess(const QString& fileName)
+  {
+    rpp::pp* parent = m_current;
+    rpp::pp pp(this);
+    EnvironmentFilePointer file(new EnvironmentFile(IndexedString(fileName), 0));
+    CountingEnvironment* environment = new CountingEnvironment(file, &lookups);
+    pp.setEnvironment(environment);
+    if(parent)
+      environment->swapMacros(parent->environment());
+
+    m_current = &pp;
+    m_directories.push(QFileInfo(fileName).absolutePath());
+    pp.processFile(fileName);
+    m_directories.pop();
+    m_current = parent;
+    ++files;
+
+    environment->finishEnvironment();
+    if(parent) {
+      environment->swapMacros(parent->environment());
+      static_cast<CppPreprocessEnvironment*>(parent->environment())->environmentFile()->merge(*file);
+    }
+  }
+
+  virtual rpp::Stream* sourceNeeded(QString& fileName, IncludeType type, int /*sourceLine*/, bool /*skipCurrentPath*/)
+  {
+    QStringList paths = m_includePaths;
+    if(type == IncludeLocal && !m_directories.isEmpty())
+      paths.prepend(m_directories.top());
+
+    foreach(const QString& path, paths) {
+      const QString candidate = QDir(path).filePath(fileName);
+      if(QFile::exists(candidate)) {
+        const QString canonical = QFileInfo(candidate).canonicalFilePath();
+        if(!m_visited.contains(canonical)) {
+          m_visited.insert(canonical);
+          preprocess(canonical);
+        }
+        break;
+      }
+    }
+    return 0;
+  }
+
+private:
+  QStringList m_includePaths;
+  QSet<QString> m_visited;
+  QStack<QString> m_directories;
+  rpp::pp* m_current;
+
+public:
+  qint64 lookups;
+  int files;
+};
+
+/// retrieveMacro(..) as it was before the identifier status was cached, for comparison
+class ReferenceEnvironment : public CppPreprocessEnvironment
+{
+public:
+  ReferenceEnvironment(const EnvironmentFilePointer& file, bool onlyImportant)
+    : CppPreprocessEnvironment(file)
+    , m_onlyImportant(onlyImportant)
+  {
+  }
+
+  virtual rpp::pp_macro* retrieveMacro(const IndexedString& name, bool isImportant) const
+  {
+    rpp::pp_macro* ret = rpp::Environment::retrieveMacro(name, isImportant);
+    EnvironmentFilePointer file = environmentFile();
+    if( !file || (m_onlyImportant && !isImportant) )
+      return ret;
+
+    if( !ret || (!file->definedMacroNames().contains(name) && !file->unDefinedMacroNames().contains(name)) )
+      strings.insert(name.index());
+
+    if( ret )
+      file->usingMacro(*ret);
+
+    return ret;
+  }
+
+  mutable std::set<Utils::BasicSetRepository::Index> strings;
+
+private:
+  bool m_onlyImportant;
+};
+
+/// Preprocesses in-memory files, includes are processed with their own environment-file like in PreprocessJob
+class MemoryPreprocessor : public rpp::Preprocessor
+{
+public:
+  MemoryPreprocessor(const QMap<QString, QByteArray>& files, const QList<rpp::pp_macro*>& predefined,
+                     bool reference, bool onlyImportant)
+    : m_files(files)
+    , m_predefined(predefined)
+    , m_reference(reference)
+    , m_onlyImportant(onlyImportant)
+    , m_current(0)
+  {
+  }
+
+  void preprocess(const QString& fileName)
+  {
+    rpp::pp* parent = m_current;
+    rpp::pp pp(this);
+    EnvironmentFilePointer file(new EnvironmentFile(IndexedString(fileName), 0));
+    CppPreprocessEnvironment* environment;
+    if(m_reference)
+      environment = new ReferenceEnvironment(file, m_onlyImportant);
+    else
+      environment = new CppPreprocessEnvironment(file);
+    pp.setEnvironment(environment);
+    if(parent) {
+      environment->swapMacros(parent->environment());
+    }else{
+      foreach(rpp::pp_macro* macro, m_predefined)
+        environment->insertMacro(macro);
+    }
+
+    m_current = &pp;
+    pp.processFile(fileName, m_files[fileName]);
+    m_current = parent;
+
+    environment->finishEnvironment();
+    if(m_reference)
+      file->addStrings(static_cast<ReferenceEnvironment*>(environment)->strings);
+    if(parent) {
+      environment->swapMacros(parent->environment());
+      static_cast<CppPreprocessEnvironment*>(parent->environment())->environmentFile()->merge(*file);
+    }
+    results[fileName] = file;
+  }
+
+  virtual rpp::Stream* sourceNeeded(QString& fileName, IncludeType /*type*/, int /*sourceLine*/, bool /*skipCurrentPath*/)
+  {
+    if(m_files.contains(fileName))
+      preprocess(fileName);
+    return 0;
+  }
+
+  QMap<QString, EnvironmentFilePointer> results;
+
+private:
+  QMap<QString, QByteArray> m_files;
+  QList<rpp::pp_macro*> m_predefined;
+  bool m_reference;
+  bool m_onlyImportant;
+  rpp::pp* m_current;
+};
+
+QStringList toStringList(const ReferenceCountedStringSet& set)
+{
+  QStringList ret;
+  ReferenceCountedStringSet::Iterator it(set.iterator());
+  while(it) {
+    ret << (*it).str();
+    ++it;
+  }
+  ret.sort();
+  return ret;
+}
+
+QStringList toStringList(const ReferenceCountedMacroSet& set)
+{
+  QStringList ret;
+  ReferenceCountedMacroSet::Iterator it(set.iterator());
+  while(it) {
+    ret << it.ref().name.str() + ' ' + it.ref().toString();
+    ++it;
+  }
+  ret.sort();
+  return ret;
+}
+
+}
+
 void TestEnvironment::initTestCase()
 {
   AutoTestShell::init(QStringList() << "kdevcppsupport");
@@ -88,4 +303,109 @@ void TestEnvironment::benchMerge_data()
   QTest::newRow("5000") << 5000;
 }
 
+void TestEnvironment::testIdentifierStatus()
+{
+  QFETCH(bool, onlyImportant);
+
+  QMap<QString, QByteArray> files;
+  files["header.h"] =
+    "#define LOCAL 1\n"
+    "#define FUNC(x) (x + EXTERNAL)\n"
+    "int h = EXTERNAL + plain;\n";
+  files["main.cpp"] =
+    "#include \"header.h\"\n"
+    "int a = EXTERNAL + FUNC(a) + LOCAL + plain + plain;\n"
+    "#undef LOCAL\n"
+    "int b = LOCAL + plain;\n"
+    "#define LOCAL 2\n"
+    "int c = LOCAL + EXTERNAL + OTHER;\n"
+    "int d = OTHER + OTHER;\n"
+    "#undef EXTERNAL\n"
+    "int e = EXTERNAL + FUNC(e);\n"
+    "#define EXTERNAL 3\n"
+    "int f = EXTERNAL + plain;\n"
+    "#ifdef NOT_DEFINED\n"
+    "#endif\n"
+    "#if defined(LOCAL) && !defined(OTHER)\n"
+    "#endif\n";
+
+  QList<rpp::pp_macro*> predefined;
+  const char* names[] = { "EXTERNAL", "OTHER" };
+  for(uint i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    rpp::pp_macro* macro = new rpp::pp_macro(IndexedString(names[i]));
+    macro->definitionList().append(IndexedString("1"));
+    predefined << macro;
+  }
+
+  CppPreprocessEnvironment::setRecordOnlyImportantString(onlyImportant);
+  MemoryPreprocessor reference(files, predefined, true, onlyImportant);
+  reference.preprocess("main.cpp");
+  MemoryPreprocessor cached(files, predefined, false, onlyImportant);
+  cached.preprocess("main.cpp");
+  CppPreprocessEnvironment::setRecordOnlyImportantString(true);
+
+  QCOMPARE(cached.results.keys(), reference.results.keys());
+  QVERIFY(!toStringList(reference.results["main.cpp"]->strings()).isEmpty());
+  QVERIFY(toStringList(reference.results["main.cpp"]->usedMacroNames()).contains("EXTERNAL"));
+  foreach(const QString& name, reference.results.keys()) {
+    EnvironmentFilePointer expected = reference.results[name];
+    EnvironmentFilePointer actual = cached.results[name];
+    QCOMPARE(toStringList(actual->strings()), toStringList(expected->strings()));
+    QCOMPARE(toStringList(actual->usedMacroNames()), toStringList(expected->usedMacroNames()));
+    QCOMPARE(toStringList(actual->usedMacros()), toStringList(expected->usedMacros()));
+  }
+
+  qDeleteAll(predefined);
+}
+
+void TestEnvironment::testIdentifierStatus_data()
+{
+  QTest::addColumn<bool>("onlyImportant");
+  QTest::newRow("all") << false;
+  QTest::newRow("important") << true;
+}
+
+void TestEnvironment::benchPreprocess()
+{
+  QFETCH(QString, file);
+  QFETCH(QStringList, includePaths);
+
+  if(!QFile::exists(file))
+    QSKIP("File not found", SkipSingle);
+
+  qint64 lookups = 0;
+  int files = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK {
+    IncludingPreprocessor preprocessor(includePaths);
+    preprocessor.preprocess(file);
+    lookups += preprocessor.lookups;
+    files = preprocessor.files;
+  }
+  const qint64 elapsed = timer.elapsed();
+  if(elapsed)
+    qDebug() << file << files << "files," << (lookups * 1000 / elapsed) << "identifiers/sec";
+}
+
+void TestEnvironment::benchPreprocess_data()
+{
+  QTest::addColumn<QString>("file");
+  QTest::addColumn<QStringList>("includePaths");
+
+  const QString qtHeaders = QLibraryInfo::location(QLibraryInfo::HeadersPath);
+  QStringList includePaths;
+  includePaths << qtHeaders << (qtHeaders + "/QtCore") << (qtHeaders + "/QtGui") << "/usr/include";
+  QDir stlRoot("/usr/include/c++");
+  foreach(const QString& version, stlRoot.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+    includePaths << stlRoot.filePath(version);
+    break;
+  }
+
+  const QByteArray fromEnv = qgetenv("KDEV_PREPROCESSOR_BENCHMARK_FILE");
+  if(!fromEnv.isEmpty())
+    QTest::newRow("custom") << QString::fromLocal8Bit(fromEnv) << includePaths;
+  QTest::newRow("QtGui") << (qtHeaders + "/QtGui/QtGui") << includePaths;
+}
+
 #include "testenvironment.moc"
@@ -35,6 +35,12 @@ private slots:
 
   void benchMerge();
   void benchMerge_data();
+
+  void testIdentifierStatus();
+  void testIdentifierStatus_data();
+
+  void benchPreprocess();
+  void benchPreprocess_data();
 };
 
 #endif // TESTENVIRONMENT_H
@@ -258,7 +258,7 @@ void TypeASTVisitor::visitSimpleTypeSpecifier(SimpleTypeSpecifierAST *node)
         if (node->isDecltype && node->expression->kind == AST::Kind_PrimaryExpression) {
           int startPosition = m_session->token_stream->position(node->expression->start_token);
           static IndexedString paren("(");
-          isDecltypeInParen = m_session->contentsVector()[startPosition] == paren.index();
+          isDecltypeInParen = m_session->contentAt(startPosition) == paren.index();
         }
 
         ExpressionParser parser(false, false, isDecltypeInParen);
@@ -25,6 +25,7 @@
 #include <language/duchain/duchainlock.h>
 #include "cppeditorintegrator.h"
 #include "name_compiler.h"
+#include "builderlock.h"
 #include <language/duchain/ducontext.h>
 #include "cpptypes.h"
 #include <language/duchain/types/alltypes.h>
@@ -49,7 +50,7 @@ using namespace Cpp;
 QString stringFromSessionTokens( ParseSession* session, int start_token, int end_token ) {
     int startPosition = session->token_stream->position(start_token);
     int endPosition = session->token_stream->position(end_token);
-    return QString::fromUtf8( stringFromContents(session->contentsVector(), startPosition, endPosition - startPosition) );
+    return QString::fromUtf8( session->contentsString(startPosition, endPosition - startPosition) );
 }
 
 bool isConstexpr(ParseSession* session, const ListNode<uint> *storageSpec)
@@ -101,7 +102,7 @@ void TypeBuilder::visitBaseSpecifier(BaseSpecifierAST *node)
   }
   
   if (node->name) {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
 
     bool openedType = openTypeFromName(node->name, AbstractType::NoModifiers, true);
 
@@ -149,7 +150,7 @@ void TypeBuilder::visitEnumerator(EnumeratorAST* node)
 
     bool delay = false;
     if(!delay) {
-      DUChainReadLocker lock(DUChain::lock());
+      BuilderReadLocker lock(DUChain::lock());
       node->expression->ducontext = currentContext();
       res = parser.evaluateType( node->expression, editor()->parseSession() );
 
@@ -253,7 +254,7 @@ void TypeBuilder::visitElaboratedTypeSpecifier(ElaboratedTypeSpecifierAST *node)
 
   if (node->name) {
 /*    {
-      DUChainReadLocker lock(DUChain::lock());
+      BuilderReadLocker lock(DUChain::lock());
 
       ///If possible, find another fitting declaration/forward-declaration and re-use it's type
 
@@ -309,7 +310,7 @@ void TypeBuilder::visitSimpleTypeSpecifier(SimpleTypeSpecifierAST *node)
         if (node->isDecltype && node->expression->kind == AST::Kind_PrimaryExpression) {
           int startPosition = editor()->parseSession()->token_stream->position(node->expression->start_token);
           static IndexedString paren("(");
-          isDecltypeInParen = editor()->parseSession()->contentsVector()[startPosition] == paren.index();
+          isDecltypeInParen = editor()->parseSession()->contentAt(startPosition) == paren.index();
         }
 
     node->expression->ducontext = currentContext();
@@ -328,7 +329,7 @@ void TypeBuilder::visitSimpleTypeSpecifier(SimpleTypeSpecifierAST *node)
 
     if(!type)
     {
-      DUChainReadLocker lock(DUChain::lock());
+      BuilderReadLocker lock(DUChain::lock());
       DelayedType::Ptr delayed( new DelayedType() );
       delayed->setIdentifier( IndexedTypeIdentifier( stringFromSessionTokens(editor()->parseSession(),
                                                      node->expression->start_token,
@@ -447,7 +448,7 @@ void TypeBuilder::createIntegralTypeForExpression(ExpressionAST* expression)
   {
     //Parse the expression, and create a CppConstantIntegralType, since we know the value
     Cpp::ExpressionParser parser;
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     expression->ducontext = currentContext();
     Cpp::ExpressionEvaluationResult res = parser.evaluateType( expression, editor()->parseSession() );
 
@@ -544,7 +545,7 @@ bool TypeBuilder::openTypeFromName(NameAST* name, uint modifiers, bool needClass
 
   if(!delay) {
     CursorInRevision pos = editor()->findPosition(name->start_token, CppEditorIntegrator::FrontEdge);
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     ifDebug( kDebug() << "searching" << id.toString(); )
     ifDebugCurrentFile( kDebug() << "searching" << id.toString(); )
 
@@ -609,11 +610,11 @@ bool TypeBuilder::openTypeFromName(NameAST* name, uint modifiers, bool needClass
    
    openDelayedType(typeId, name, templateDeclarationDepth() ? DelayedType::Delayed : DelayedType::Unresolved );
 
-   ifDebug( DUChainReadLocker lock(DUChain::lock()); if(templateDeclarationDepth() == 0) kDebug(9007) << "no declaration found for" << id.toString() << "in context \"" << searchContext()->scopeIdentifier(true).toString() << "\"" << "" << searchContext(); )
-   ifDebugCurrentFile( DUChainReadLocker lock(DUChain::lock()); if(templateDeclarationDepth() == 0) kDebug(9007) << "no declaration found for" << id.toString() << "in context \"" << searchContext()->scopeIdentifier(true).toString() << "\"" << "" << searchContext(); )
+   ifDebug( BuilderReadLocker lock(DUChain::lock()); if(templateDeclarationDepth() == 0) kDebug(9007) << "no declaration found for" << id.toString() << "in context \"" << searchContext()->scopeIdentifier(true).toString() << "\"" << "" << searchContext(); )
+   ifDebugCurrentFile( BuilderReadLocker lock(DUChain::lock()); if(templateDeclarationDepth() == 0) kDebug(9007) << "no declaration found for" << id.toString() << "in context \"" << searchContext()->scopeIdentifier(true).toString() << "\"" << "" << searchContext(); )
   }
 
-  ifDebugCurrentFile( DUChainReadLocker lock(DUChain::lock()); kDebug() << "opened type" << (currentAbstractType() ? currentAbstractType()->toString() : QString("(no type)")); )
+  ifDebugCurrentFile( BuilderReadLocker lock(DUChain::lock()); kDebug() << "opened type" << (currentAbstractType() ? currentAbstractType()->toString() : QString("(no type)")); )
 
   return openedType;
 }
@@ -624,7 +625,7 @@ void TypeBuilder::applyModifiers(KDevelop::AbstractType::Ptr type, uint modifier
 
 
 DUContext* TypeBuilder::searchContext() const {
-  DUChainReadLocker lock(DUChain::lock());
+  BuilderReadLocker lock(DUChain::lock());
   if( !m_importedParentContexts.isEmpty() ) {
     if( DUContext* ctx = m_importedParentContexts.last().context(topContext()) )
       if(ctx->type() == DUContext::Template)
@@ -804,7 +805,7 @@ void TypeBuilder::visitArrayExpression(ExpressionAST* expression)
   Cpp::ExpressionEvaluationResult res;
 
   {
-    DUChainReadLocker lock(DUChain::lock());
+    BuilderReadLocker lock(DUChain::lock());
     if(expression) {
       expression->ducontext = currentContext();
       res = parser.evaluateType( expression, editor()->parseSession() );
@@ -905,7 +906,7 @@ bool TypeBuilder::openTypeFromName(QualifiedIdentifier id, AST* typeNode, bool n
 
     if (!delay) {
         CursorInRevision pos(editorFindRange(typeNode, typeNode).start);
-        DUChainReadLocker lock(DUChain::lock());
+        BuilderReadLocker lock(DUChain::lock());
 
         QList<Declaration*> dec = searchContext()->findDeclarations(id, pos);
 
@@ -25,7 +25,8 @@
 #include <typeinfo>
 #include <language/duchain/duchainlock.h>
 #include <language/duchain/duchain.h>
-#include <qthread.h>
+#include <QThreadStorage>
+#include <QAtomicInt>
 #include <language/duchain/classfunctiondeclaration.h>
 #include <language/duchain/types/typeutils.h>
 
@@ -54,40 +55,88 @@ namespace Cpp {
 class TypeConversionCache
 {
 public:
+    TypeConversionCache() : m_active(false), m_topContextIndex(0), m_generation(0) {
+    }
 
     QHash<ImplicitConversionParams, int> m_implicitConversionResults;
 /*    QHash<QPair<IndexedType, IndexedType>, uint> m_standardConversionResults;
     QHash<QPair<IndexedType, IndexedType>, uint> m_userDefinedConversionResults;*/
 //     QHash<QPair<IndexedType, IndexedType>, bool> m_isPublicBaseCache;
+
+    ///Whether caching is currently enabled for the thread
+    bool m_active;
+    ///When non-zero, the results are kept across stopCache() for this top-context
+    uint m_topContextIndex;
+    ///The value of typeConversionGeneration the results were computed with
+    int m_generation;
 };
 }
 
-QHash<Qt::HANDLE, TypeConversionCache*> typeConversionCaches;
-QMutex typeConversionCacheMutex;
+///Each thread has its own cache, so no lock is needed while converting
+QThreadStorage<TypeConversionCache*> typeConversionCache;
+///Incremented whenever the du-chain was updated, which invalidates all persistent results
+QAtomicInt typeConversionGeneration;
+///Persistent results are dropped when there are more than this
+const int maxPersistentConversionResults = 100000;
 
 void TypeConversion::startCache() {
-  QMutexLocker lock(&typeConversionCacheMutex);
-  if(!typeConversionCaches.contains(QThread::currentThreadId()))
-    typeConversionCaches[QThread::currentThreadId()] = new TypeConversionCache;
+  TypeConversionCache* cache = typeConversionCache.localData();
+  if(!cache) {
+    cache = new TypeConversionCache;
+    typeConversionCache.setLocalData(cache);
+  }
+  if(cache->m_active)
+    return;
+
+  if(cache->m_topContextIndex) {
+    //Results kept for a persistent cache are not used for other requests
+    cache->m_implicitConversionResults.clear();
+    cache->m_topContextIndex = 0;
+  }
+  cache->m_active = true;
+}
+
+void TypeConversion::startCache(uint topContextIndex) {
+  TypeConversionCache* cache = typeConversionCache.localData();
+  if(!cache) {
+    cache = new TypeConversionCache;
+    typeConversionCache.setLocalData(cache);
+  }
+  if(cache->m_active)
+    return;
+
+  int generation = typeConversionGeneration;
+  if(cache->m_topContextIndex != topContextIndex || cache->m_generation != generation) {
+    cache->m_implicitConversionResults.clear();
+    cache->m_topContextIndex = topContextIndex;
+    cache->m_generation = generation;
+  }
+  cache->m_active = true;
 }
 
 void TypeConversion::stopCache() {
-  QMutexLocker lock(&typeConversionCacheMutex);
-  if(typeConversionCaches.contains(QThread::currentThreadId())) {
-    delete typeConversionCaches[QThread::currentThreadId()];
-    typeConversionCaches.remove(QThread::currentThreadId());
+  TypeConversionCache* cache = typeConversionCache.localData();
+  if(!cache)
+    return;
+
+  cache->m_active = false;
+  if(!cache->m_topContextIndex || cache->m_implicitConversionResults.size() > maxPersistentConversionResults) {
+    cache->m_implicitConversionResults.clear();
+    cache->m_topContextIndex = 0;
   }
 }
 
+void TypeConversion::invalidatePersistentCaches() {
+  typeConversionGeneration.ref();
+}
+
 TypeConversion::TypeConversion(const TopDUContext* topContext)
   : m_baseConversionLevels(0)
   , m_topContext(topContext)
 {
-
-  QMutexLocker lock(&typeConversionCacheMutex);
-  QHash<Qt::HANDLE, TypeConversionCache*>::iterator it = typeConversionCaches.find(QThread::currentThreadId());
-  if(it != typeConversionCaches.end())
-    m_cache = *it;
+  TypeConversionCache* cache = typeConversionCache.localData();
+  if(cache && cache->m_active)
+    m_cache = cache;
   else
     m_cache = 0;
 }
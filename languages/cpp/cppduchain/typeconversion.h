@@ -93,6 +93,19 @@ class KDEVCPPDUCHAIN_EXPORT TypeConversion {
      */
     static void startCache();
     static void stopCache();
+
+    /**
+     * Start type-conversion caching for the current thread, keeping the results after stopCache().
+     *
+     * The kept results are reused by the next call with the same @p topContextIndex, as long as
+     * the du-chain was not updated in between, see invalidatePersistentCaches().
+     */
+    static void startCache(uint topContextIndex);
+
+    /**
+     * Drop the results kept by persistent caches of all threads, call this whenever the du-chain was updated.
+     */
+    static void invalidatePersistentCaches();
     
   protected:
     /**
@@ -146,6 +159,10 @@ public:
   TypeConversionCacheEnabler() {
     TypeConversion::startCache();
   }
+  ///The results are kept across enablers for the same @p topContextIndex, see TypeConversion::startCache(uint)
+  explicit TypeConversionCacheEnabler(uint topContextIndex) {
+    TypeConversion::startCache(topContextIndex);
+  }
   ~TypeConversionCacheEnabler() {
     TypeConversion::stopCache(); 
   }
@@ -30,6 +30,9 @@
 #include <util/pushvalue.h>
 #include <language/checks/dataaccessrepository.h>
 #include <language/duchain/declaration.h>
+#include "independentparts.h"
+
+#include <QtConcurrentMap>
 
 using namespace KDevelop;
 
@@ -64,14 +67,14 @@ QString UseDecoratorVisitor::nodeToString(AST* node)
 }
 
 UseDecoratorVisitor::UseDecoratorVisitor(const ParseSession* session, DataAccessRepository* repo)
-  : m_session(session), m_defaultFlags(DataAccess::Read), m_mods(repo)
+  : m_session(session), m_defaultFlags(DataAccess::Read), m_mods(repo), m_locationTable(*session->locationTable())
 {
   Q_ASSERT(repo);
 }
 
 CursorInRevision UseDecoratorVisitor::cursorForToken(uint token)
 {
-  return m_session->positionAt(m_session->token_stream->position(token));
+  return m_session->positionAt(m_session->token_stream->position(token), m_locationTable);
 }
 
 RangeInRevision UseDecoratorVisitor::rangeForNode(AST* ast)
@@ -87,6 +90,43 @@ void UseDecoratorVisitor::run(AST* node)
   visit(node);
 }
 
+struct UseDecoratorVisitor::Part
+{
+  const ParseSession* session;
+  AST* node;
+  DataAccessRepository* repo;
+};
+
+void UseDecoratorVisitor::runParallel(const ParseSession* session, AST* node, DataAccessRepository* repo)
+{
+  QList<AST*> nodes = Cpp::independentParts(node);
+  if(nodes.size() < 2) {
+    UseDecoratorVisitor visitor(session, repo);
+    visitor.run(node);
+    return;
+  }
+  
+  QList<Part> parts;
+  foreach(AST* partNode, nodes) {
+    Part part = { session, partNode, new DataAccessRepository };
+    parts << part;
+  }
+  
+  QtConcurrent::blockingMap(parts, &UseDecoratorVisitor::buildPart);
+  
+  foreach(const Part& part, parts) {
+    foreach(DataAccess* access, part.repo->modifications())
+      repo->addModification(access->pos(), access->flags(), access->value());
+    delete part.repo;
+  }
+}
+
+void UseDecoratorVisitor::buildPart(Part& part)
+{
+  UseDecoratorVisitor visitor(part.session, part.repo);
+  visitor.run(part.node);
+}
+
 void UseDecoratorVisitor::visitUnqualifiedName(UnqualifiedNameAST* node)
 {
   //Type exctraction
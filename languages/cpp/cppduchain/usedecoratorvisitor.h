@@ -23,6 +23,7 @@
 #include <default_visitor.h>
 #include <language/duchain/types/abstracttype.h>
 #include <language/checks/dataaccessrepository.h>
+#include <rpp/pp-location.h>
 #include <QStack>
 
 namespace KDevelop {
@@ -35,6 +36,12 @@ class KDEVCPPDUCHAIN_EXPORT UseDecoratorVisitor : protected DefaultVisitor
     UseDecoratorVisitor(const ParseSession* session, KDevelop::DataAccessRepository* repo);
     
     void run(AST* node);
+    
+    /**
+     * Same as run(), but the independent parts of @p node are processed in parallel on the global thread-pool,
+     * @see Cpp::independentParts(). The accesses are added to @p repo in source order.
+     */
+    static void runParallel(const ParseSession* session, AST* node, KDevelop::DataAccessRepository* repo);
   protected:
     virtual void visitUnqualifiedName(UnqualifiedNameAST* node);
     virtual void visitFunctionCall(FunctionCallAST* node);
@@ -60,6 +67,9 @@ class KDEVCPPDUCHAIN_EXPORT UseDecoratorVisitor : protected DefaultVisitor
     virtual void visitInitializerList(InitializerListAST* );
     
   private:
+    struct Part;
+    static void buildPart(Part& part);
+    
     KDevelop::CursorInRevision cursorForToken(uint token);
     KDevelop::RangeInRevision rangeForNode(AST* ast);
     QString nodeToString(AST* node);
@@ -69,6 +79,8 @@ class KDEVCPPDUCHAIN_EXPORT UseDecoratorVisitor : protected DefaultVisitor
     QStack<int> m_argStack;
     KDevelop::DataAccess::DataAccessFlags m_defaultFlags;
     KDevelop::DataAccessRepository* m_mods;
+    ///Own copy, because the table in the session may not be used from multiple threads
+    rpp::LocationTable m_locationTable;
 };
 
 #endif // USEDECORATORVISITOR_H
@@ -44,6 +44,8 @@
 #include <ktexteditor/document.h>
 #include <ktexteditor/view.h>
 #include <KDesktopFile>
+#include <KConfigGroup>
+#include <KGlobal>
 #include <language/codecompletion/codecompletion.h>
 
 #include <interfaces/icore.h>
@@ -55,6 +57,7 @@
 #include <interfaces/ilanguagecontroller.h>
 #include <interfaces/iprojectcontroller.h>
 #include <project/interfaces/ibuildsystemmanager.h>
+#include <language/interfaces/idefinesandincludesmanager.h>
 #include <language/interfaces/iquickopen.h>
 #include <interfaces/iplugincontroller.h>
 #include <language/interfaces/editorcontext.h>
@@ -84,6 +87,7 @@
 #include "environmentmanager.h"
 #include "cppduchain/navigation/navigationwidget.h"
 #include "cppduchain/cppduchain.h"
+#include "cppduchain/instantiationstore.h"
 #include <interfaces/foregroundlock.h>
 //#include "codegen/makeimplementationprivate.h"
 #include "codegen/adaptsignatureassistant.h"
@@ -96,6 +100,7 @@
 #include "codegen/simplerefactoring.h"
 #include "codegen/cppclasshelper.h"
 #include "includepathcomputer.h"
+#include "includedirectorycache.h"
 
 //#include <valgrind/callgrind.h>
 
@@ -210,6 +215,10 @@ CppLanguageSupport::CppLanguageSupport( QObject* parent, const QVariantList& /*a
 
     CppUtils::standardMacros();
 
+    //Zero keeps all template instantiations for the whole session
+    KConfigGroup cppGroup = KGlobal::config()->group("C++ Support");
+    Cpp::InstantiationStore::self()->setBudget(cppGroup.readEntry("Maximum Template Instantiations", 0u));
+
     m_quickOpenDataProvider = new IncludeFileDataProvider();
 
     IQuickOpen* quickOpen = core()->pluginController()->extensionForPlugin<IQuickOpen>("org.kdevelop.IQuickOpen");
@@ -222,6 +231,11 @@ CppLanguageSupport::CppLanguageSupport( QObject* parent, const QVariantList& /*a
     new UIBlockTester(LOCKUP_INTERVAL, this);
 #endif
 
+    connect(core()->projectController(), SIGNAL(projectOpened(KDevelop::IProject*)),
+            this, SLOT(projectOpened(KDevelop::IProject*)));
+    connect(core()->languageController()->backgroundParser(), SIGNAL(hideProgress(KDevelop::IStatus*)),
+            this, SLOT(parsingFinished()));
+
     core()->languageController()->staticAssistantsManager()->registerAssistant(StaticAssistant::Ptr(new RenameAssistant(this)));
     core()->languageController()->staticAssistantsManager()->registerAssistant(StaticAssistant::Ptr(new Cpp::AdaptSignatureAssistant(this)));
 
@@ -230,6 +244,24 @@ CppLanguageSupport::CppLanguageSupport( QObject* parent, const QVariantList& /*a
     }
 }
 
+void CppLanguageSupport::projectOpened(IProject* project)
+{
+    //Listing the include-directories takes long on network-mounted SDKs, so do it before the first completion needs them
+    QStringList directories;
+    foreach(const Path& path, IDefinesAndIncludesManager::manager()->includes(project->projectItem()))
+        directories << path.toLocalFile();
+    Cpp::IncludeDirectoryCache::self()->populate(directories);
+}
+
+void CppLanguageSupport::parsingFinished()
+{
+    //Parse-jobs keep pointers to instantiations while they release the du-chain lock, so only evict while none exists.
+    //New jobs can not get at any du-chain object before the write-lock is released again.
+    DUChainWriteLocker lock(DUChain::lock());
+    if(CPPParseJob::liveJobs() == 0)
+        Cpp::InstantiationStore::self()->evictIfOverBudget();
+}
+
 void CppLanguageSupport::createActionsForMainWindow (Sublime::MainWindow* /*window*/, QString& _xmlFile, KActionCollection& actions)
 {
     _xmlFile = xmlFile();
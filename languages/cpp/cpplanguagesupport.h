@@ -46,6 +46,7 @@ namespace KDevelop {
   class ICodeHighlighting;
   class SimpleRange;
   class CodeCompletion;
+  class IProject;
 }
 namespace Cpp {
   class StaticCodeAssistant;
@@ -142,6 +143,11 @@ public slots:
     ///UI:
     void switchDefinitionDeclaration();
 
+private slots:
+    void projectOpened(KDevelop::IProject* project);
+    ///Called when the background-parser has finished all its jobs
+    void parsingFinished();
+
 private:
 
     //Returns the identifier and its range under the cursor as first return-value, and the tail behind it as the second
@@ -48,8 +48,11 @@
 #include "cppduchain/cppeditorintegrator.h"
 #include "cppduchain/declarationbuilder.h"
 #include "cppduchain/usebuilder.h"
+#include "cppduchain/typeconversion.h"
+#include "codecompletion/completionindex.h"
 #include "preprocessjob.h"
 #include "environmentmanager.h"
+#include "tokencache.h"
 
 #include <language/duchain/topducontext.h>
 #include <language/duchain/duchain.h>
@@ -76,6 +79,8 @@
 
 //#define DUMP_AST
 //#define DUMP_DUCHAIN
+//#define DUMP_MEMORYPOOL
+//#define DUMP_PARSER_MEMO
 
 using namespace KDevelop;
 
@@ -113,6 +118,18 @@ const QSet<const KDevelop::DUContext*>& CPPParseJob::updated() const
   return m_updated;
 }
 
+bool CPPParseJob::wasIncludedInRun(const IndexedString& file) const
+{
+  QMutexLocker lock(&m_includedInRunMutex);
+  return m_includedInRun.contains(file);
+}
+
+void CPPParseJob::setIncludedInRun(const IndexedString& file)
+{
+  QMutexLocker lock(&m_includedInRunMutex);
+  m_includedInRun.insert(file);
+}
+
 
 void CPPParseJob::setNeedUpdateEverything(bool need) {
   m_needUpdateEverything = need;
@@ -130,6 +147,8 @@ CPPParseJob::CPPParseJob( const IndexedString& url, ILanguageSupport* languageSu
         m_parsedIncludes( 0 ),
         m_needsUpdate( true )
 {
+    s_liveJobs.ref();
+
     if( !m_parentPreprocessor ) {
         addJob(m_preprocessJob = new PreprocessJob(this));
         addJob(m_parseJob = new CPPInternalParseJob(this));
@@ -273,6 +292,14 @@ const QList<IndexedString>& CPPParseJob::indexedIncludePaths() const {
 CPPParseJob::~CPPParseJob()
 {
   delete m_includePathsComputed;
+  s_liveJobs.deref();
+}
+
+QAtomicInt CPPParseJob::s_liveJobs;
+
+int CPPParseJob::liveJobs()
+{
+  return s_liveJobs;
 }
 
 KDevelop::ModificationRevisionSet CPPParseJob::includePathDependencies() const {
@@ -567,6 +594,9 @@ void CPPInternalParseJob::run()
 
       if(newFeatures != TopDUContext::Empty)
       {
+        Cpp::TokenCache::self()->tokenize( parentJob()->parseSession().data(), &control );
+        ///The contents don't change after lexing, so the parser and the builders can already read the compact form
+        parentJob()->parseSession()->compactContents();
         ast = parser.parse( parentJob()->parseSession().data() );
 
         //This will be set to true if the duchain data should be left untouched
@@ -596,6 +626,17 @@ void CPPInternalParseJob::run()
 #ifdef DUMP_AST
             DumpTree dump;
             dump.dump(ast, parentJob()->parseSession()->token_stream);
+#endif
+#ifdef DUMP_MEMORYPOOL
+            const MemoryPool::Statistics stats = parentJob()->parseSession()->mempool->statistics();
+            kDebug( 9007 ) << "memory pool of" << parentJob()->document().str() << "allocated:" << stats.allocatedBytes
+                           << "reused:" << stats.reusedBytes << "new:" << stats.newBytes << "large chunks:" << stats.largeChunkBytes
+                           << "process total:" << MemoryPool::totalBytes() << "process peak:" << MemoryPool::peakTotalBytes();
+#endif
+#ifdef DUMP_PARSER_MEMO
+            const Parser::MemoStatistics& memo = parser.memoStatistics();
+            kDebug( 9007 ) << "backtracking memo of" << parentJob()->document().str() << "lookups:" << memo.lookups
+                           << "hits:" << memo.hits << "reused tokens:" << memo.reusedTokens << "not stored:" << memo.uncacheable;
 #endif
         }
       }
@@ -637,6 +678,8 @@ void CPPInternalParseJob::run()
         }
 
         contentContext = declarationBuilder.buildDeclarations(contentEnvironmentFile, ast, &importedContentChains, contentContext, false);
+        Cpp::TypeConversion::invalidatePersistentCaches();
+        Cpp::CompletionIndex::self()->invalidate(contentContext->ownIndex());
 
         //If publically visible declarations were added/removed, all following parsed files need to be updated
         if(declarationBuilder.changeWasSignificant()) {
@@ -707,6 +750,11 @@ void CPPInternalParseJob::run()
 
         if (!parentJob()->abortRequested()) {
           if ((newFeatures & TopDUContext::AllDeclarationsContextsAndUses) == TopDUContext::AllDeclarationsContextsAndUses) {
+              ///A new document has no uses that could be stale, so show its declarations while the uses are being built.
+              ///The uses are built with read-locks, and are only write-locked shortly per context to be stored.
+              if (isOpenInEditor && !updatingContentContext && parentJob()->cpp() && parentJob()->cpp()->codeHighlighting())
+                parentJob()->cpp()->codeHighlighting()->highlightDUChain( contentContext );
+
               parentJob()->setLocalProgress(0.5, i18n("Building uses"));
 
               UseBuilder useBuilder(parentJob()->parseSession().data());
@@ -964,16 +1012,14 @@ TopDUContext::Features CPPParseJob::slaveMinimumFeatures() const
 ControlFlowGraph* CPPParseJob::controlFlowGraph()
 {
   ControlFlowGraph* ret = new ControlFlowGraph;
-  ControlFlowGraphBuilder flowvisitor(duChain(), m_session.data(), ret);
-  flowvisitor.run(m_session->topAstNode());
+  ControlFlowGraphBuilder::runParallel(duChain(), m_session.data(), m_session->topAstNode(), ret);
   return ret;
 }
 
 DataAccessRepository* CPPParseJob::dataAccessInformation()
 {
   DataAccessRepository* ret = new DataAccessRepository;
-  UseDecoratorVisitor visit(m_session.data(), ret);
-  visit.run(m_session->topAstNode());
+  UseDecoratorVisitor::runParallel(m_session.data(), m_session->topAstNode(), ret);
   return ret;
 }
 
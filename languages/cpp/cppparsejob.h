@@ -26,6 +26,8 @@
 #include <language/backgroundparser/parsejob.h>
 #include <util/path.h>
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QStringList>
 #include <QWaitCondition>
 
@@ -167,6 +169,10 @@ public:
 
     const QSet<const KDevelop::DUContext*>& updated() const;
 
+    ///Whether @p file was included anywhere during this run. Only use on the master-job.
+    bool wasIncludedInRun(const IndexedString& file) const;
+    void setIncludedInRun(const IndexedString& file);
+
     //Can be called to indicate that an included file was parsed
     void includedFileParsed();
 
@@ -183,7 +189,12 @@ public:
     
     virtual ControlFlowGraph* controlFlowGraph();
     virtual DataAccessRepository* dataAccessInformation();
+
+    ///Count of parse-jobs that currently exist, including slave-jobs and jobs that did not start yet.
+    ///While it is zero, no parse-job holds pointers to du-chain objects across releases of the du-chain lock.
+    static int liveJobs();
 private:
+    static QAtomicInt s_liveJobs;
 
     QList<LineJobPair> m_delayedImports;
     QList<LineContextPair> m_delayedImporters;
@@ -221,6 +232,9 @@ private:
     mutable KDevelop::Path::List m_includePathUrls; //Only a master-job has this set
     bool m_keepDuchain;
     QSet<const KDevelop::DUContext*> m_updated;
+    ///Written by the preprocessors of all included files, which may run on other threads (see scheduleSpeculativeIncludes)
+    QSet<IndexedString> m_includedInRun;
+    mutable QMutex m_includedInRunMutex;
     int m_parsedIncludes;
     mutable QMutex m_waitForIncludePathsMutex;
     mutable QWaitCondition m_waitForIncludePaths;
@@ -21,6 +21,7 @@
 #include "setuphelpers.h"
 #include "parser/rpp/preprocessor.h"
 #include "includepathcomputer.h"
+#include "includedirectorycache.h"
 
 #include <interfaces/icore.h>
 #include <interfaces/iprojectcontroller.h>
@@ -36,7 +37,7 @@
 
 #include <project/projectmodel.h>
 
-#include <QDirIterator>
+#include <QFileInfo>
 #include <QThread>
 #include <QCoreApplication>
 
@@ -376,20 +377,17 @@ QList<KDevelop::IncludeItem> allFilesInIncludePath(const QString& source, bool l
           searchPath += addPath;
         }
 
-        QDirIterator dirContent(searchPath);
-
-        while(dirContent.hasNext()) {
-             dirContent.next();
+        //The listing is cached and kept up to date by a directory watcher, so this does not hit the disk every time
+        foreach(const Cpp::IncludeDirectoryCache::Entry& entry, Cpp::IncludeDirectoryCache::self()->listing(searchPath))
+        {
             KDevelop::IncludeItem item;
-            item.name = dirContent.fileName();
+            item.name = entry.name;
 
-            if(item.name.startsWith('.') || item.name.endsWith("~")) //This filters out ".", "..", and hidden files, and backups
-              continue;
-            QString suffix = dirContent.fileInfo().suffix();
-            if(!dirContent.fileInfo().suffix().isEmpty() && !headerExtensions().contains(suffix) && (!allowSourceFiles || !sourceExtensions().contains(suffix)))
+            QString suffix = QFileInfo(entry.name).suffix();
+            if(!suffix.isEmpty() && !headerExtensions().contains(suffix) && (!allowSourceFiles || !sourceExtensions().contains(suffix)))
               continue;
             
-            QString fullPath = dirContent.fileInfo().canonicalFilePath();
+            QString fullPath = entry.canonicalPath;
             if (hadIncludePaths.contains(fullPath)) {
               continue;
             } else {
@@ -402,7 +400,7 @@ QList<KDevelop::IncludeItem> allFilesInIncludePath(const QString& source, bool l
               item.basePath = searchPath;
             }
             
-            item.isDirectory = dirContent.fileInfo().isDir();
+            item.isDirectory = entry.isDirectory;
             item.pathNumber = pathNumber;
 
             ret << item;
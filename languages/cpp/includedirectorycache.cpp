@@ -0,0 +1,158 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "includedirectorycache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QtConcurrentRun>
+
+#include <KGlobal>
+#include <KDirWatch>
+#include <kdebug.h>
+
+using namespace Cpp;
+
+K_GLOBAL_STATIC(IncludeDirectoryCache, globalIncludeDirectoryCache)
+
+///Listings are not cached beyond this count, so the watcher does not run out of system resources
+const int maxCachedDirectories = 4000;
+
+IncludeDirectoryCache* IncludeDirectoryCache::self()
+{
+  return globalIncludeDirectoryCache;
+}
+
+IncludeDirectoryCache::IncludeDirectoryCache()
+  : m_watch(0)
+{
+  //The watcher has to live in the main thread, while the listings are requested from the background
+  if (QCoreApplication::instance())
+    moveToThread(QCoreApplication::instance()->thread());
+}
+
+IncludeDirectoryCache::Directory IncludeDirectoryCache::read(const QString& path)
+{
+  Directory ret;
+  QDirIterator dirContent(path);
+  while (dirContent.hasNext()) {
+    dirContent.next();
+    Entry entry;
+    entry.name = dirContent.fileName();
+    if (entry.name.startsWith('.') || entry.name.endsWith('~')) //This filters out ".", "..", and hidden files, and backups
+      continue;
+    entry.canonicalPath = dirContent.fileInfo().canonicalFilePath();
+    entry.isDirectory = dirContent.fileInfo().isDir();
+    ret.names.insert(entry.name, ret.entries.size());
+    ret.entries << entry;
+  }
+  return ret;
+}
+
+IncludeDirectoryCache::Directory IncludeDirectoryCache::directory(const QString& path)
+{
+  const QString cleanPath = QDir::cleanPath(path);
+  uint generation;
+  {
+    QMutexLocker lock(&m_mutex);
+    QHash<QString, Directory>::const_iterator it = m_directories.constFind(cleanPath);
+    if (it != m_directories.constEnd())
+      return *it;
+    generation = m_generations.value(cleanPath);
+  }
+
+  //Read without holding the lock, listing a slow directory must not block the other ones
+  Directory ret = read(cleanPath);
+
+  QMutexLocker lock(&m_mutex);
+  //If the directory changed while it was read, the listing may be outdated already, so it is not cached
+  if (m_generations.value(cleanPath) == generation && m_directories.size() < maxCachedDirectories) {
+    m_directories.insert(cleanPath, ret);
+    if (!m_watched.contains(cleanPath)) {
+      m_watched.insert(cleanPath);
+      QMetaObject::invokeMethod(this, "watch", Qt::QueuedConnection, Q_ARG(QString, cleanPath));
+    }
+  }
+  return ret;
+}
+
+IncludeDirectoryCache::Listing IncludeDirectoryCache::listing(const QString& directory)
+{
+  return this->directory(directory).entries;
+}
+
+QStringList IncludeDirectoryCache::filesNamed(const QString& name, const QStringList& directories)
+{
+  QStringList ret;
+  QSet<QString> hadFiles;
+  foreach (const QString& path, directories) {
+    const Directory dir = directory(path);
+    QHash<QString, int>::const_iterator it = dir.names.constFind(name);
+    if (it == dir.names.constEnd())
+      continue;
+    const Entry& entry(dir.entries[*it]);
+    if (entry.isDirectory || hadFiles.contains(entry.canonicalPath))
+      continue;
+    hadFiles.insert(entry.canonicalPath);
+    ret << QDir::cleanPath(path) + '/' + name;
+  }
+  return ret;
+}
+
+void IncludeDirectoryCache::populate(const QStringList& directories)
+{
+  QtConcurrent::run(this, &IncludeDirectoryCache::populateNow, directories);
+}
+
+void IncludeDirectoryCache::populateNow(const QStringList& directories)
+{
+  foreach (const QString& path, directories)
+    directory(path);
+  kDebug(9007) << "cached the listings of" << directories.size() << "include-directories";
+}
+
+int IncludeDirectoryCache::size() const
+{
+  QMutexLocker lock(&m_mutex);
+  return m_directories.size();
+}
+
+void IncludeDirectoryCache::watch(const QString& directory)
+{
+  if (!m_watch) {
+    m_watch = new KDirWatch(this);
+    connect(m_watch, SIGNAL(dirty(QString)), this, SLOT(directoryChanged(QString)));
+    connect(m_watch, SIGNAL(created(QString)), this, SLOT(directoryChanged(QString)));
+    connect(m_watch, SIGNAL(deleted(QString)), this, SLOT(directoryChanged(QString)));
+  }
+  m_watch->addDir(directory);
+}
+
+void IncludeDirectoryCache::directoryChanged(const QString& path)
+{
+  const QString cleanPath = QDir::cleanPath(path);
+  const QString parentPath = QFileInfo(cleanPath).path();
+  QMutexLocker lock(&m_mutex);
+  m_directories.remove(cleanPath);
+  ++m_generations[cleanPath];
+  //When a directory is created or deleted, the listing of its parent changes as well
+  m_directories.remove(parentPath);
+  ++m_generations[parentPath];
+}
+
+#include "includedirectorycache.moc"
@@ -0,0 +1,97 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_INCLUDEDIRECTORYCACHE_H
+#define CPP_INCLUDEDIRECTORYCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+class KDirWatch;
+
+namespace Cpp {
+
+/**
+ * Shared cache of the directory listings used by include-completion and the missing-include completion.
+ *
+ * Include-paths often point into large or network-mounted SDKs, so listing them on every completion
+ * blocks for a long time. A listing is read once, and then kept until the directory watcher reports a
+ * change of the directory. Each listing also has an index by name, so looking up a file in all
+ * include-paths only costs a hash lookup per path.
+ *
+ * All functions may be called from any thread.
+ */
+class IncludeDirectoryCache : public QObject
+{
+  Q_OBJECT
+public:
+  static IncludeDirectoryCache* self();
+
+  IncludeDirectoryCache();
+
+  struct Entry {
+    Entry() : isDirectory(false) {
+    }
+    QString name;
+    ///Used to recognize files that are reachable through multiple include-paths
+    QString canonicalPath;
+    bool isDirectory;
+  };
+  typedef QVector<Entry> Listing;
+
+  ///The entries of @p directory, without hidden files and backups. Read from disk on first use.
+  Listing listing(const QString& directory);
+
+  ///The paths of the files named @p name that are directly within one of @p directories, in their order.
+  ///A file that is reachable through multiple directories is only returned once.
+  QStringList filesNamed(const QString& name, const QStringList& directories);
+
+  ///Reads the listings of @p directories in a background thread, so following completions do not hit the disk
+  void populate(const QStringList& directories);
+
+  ///Count of cached listings
+  int size() const;
+
+private slots:
+  void watch(const QString& directory);
+  void directoryChanged(const QString& path);
+
+private:
+  struct Directory {
+    Listing entries;
+    ///Maps the names to their position in entries
+    QHash<QString, int> names;
+  };
+
+  Directory directory(const QString& path);
+  static Directory read(const QString& path);
+  void populateNow(const QStringList& directories);
+
+  mutable QMutex m_mutex;
+  QHash<QString, Directory> m_directories;
+  ///Counts the changes of each directory, so a listing that was read during a change is not cached
+  QHash<QString, uint> m_generations;
+  KDirWatch* m_watch;
+  QSet<QString> m_watched;
+};
+
+}
+
+#endif // CPP_INCLUDEDIRECTORYCACHE_H
@@ -0,0 +1,144 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "includegraph.h"
+
+#include <KGlobal>
+
+#include "cpputils.h"
+
+using namespace Cpp;
+using namespace KDevelop;
+
+namespace {
+///Same as the limit of the preprocessor, protects against pathological include-chains
+const int maxIncludeDepth = 50;
+
+uint hashIncludePaths(const Path::List& includePaths)
+{
+  uint hash = 0;
+  foreach(const Path& path, includePaths)
+    hash = hash * 31 + qHash(path);
+  return hash;
+}
+}
+
+K_GLOBAL_STATIC(IncludeGraph, globalIncludeGraph)
+
+IncludeGraph* IncludeGraph::self()
+{
+  return globalIncludeGraph;
+}
+
+rpp::FileDirectives IncludeGraph::directives(const IndexedString& file)
+{
+  const ModificationRevision revision = ModificationRevision::revisionForFile(file);
+  {
+    QMutexLocker lock(&m_mutex);
+    QHash<IndexedString, Entry>::const_iterator it = m_entries.constFind(file);
+    if(it != m_entries.constEnd() && it->revision == revision)
+      return it->directives;
+  }
+
+  //Scan without holding the lock, so multiple threads can scan at the same time
+  Entry entry;
+  entry.revision = revision;
+  rpp::scanFileDirectives(file.str(), &entry.directives);
+
+  QMutexLocker lock(&m_mutex);
+  m_entries.insert(file, entry);
+  return entry.directives;
+}
+
+QList<IndexedString> IncludeGraph::includes(const IndexedString& file, const Path::List& includePaths)
+{
+  const uint includePathsHash = hashIncludePaths(includePaths);
+  const rpp::FileDirectives fileDirectives = directives(file);
+  {
+    QMutexLocker lock(&m_mutex);
+    QHash<IndexedString, Entry>::const_iterator it = m_entries.constFind(file);
+    if(it != m_entries.constEnd() && it->resolved && it->includePathsHash == includePathsHash)
+      return it->includes;
+  }
+
+  QList<IndexedString> ret;
+  const Path localPath = Path(file.str()).parent();
+  foreach(const rpp::IncludeDirective& include, fileDirectives.includes) {
+    if(include.conditional || include.includeNext)
+      continue;
+    const Path includedFile = CppUtils::findInclude(includePaths, localPath, include.name, include.type, Path(), true).first;
+    if(includedFile.isValid())
+      ret << IndexedString(includedFile.pathOrUrl());
+  }
+
+  QMutexLocker lock(&m_mutex);
+  QHash<IndexedString, Entry>::iterator it = m_entries.find(file);
+  if(it != m_entries.end()) {
+    it->resolved = true;
+    it->includePathsHash = includePathsHash;
+    it->includes = ret;
+  }
+  return ret;
+}
+
+QList<IndexedString> IncludeGraph::bottomUp(const QList<IndexedString>& roots, const Path::List& includePaths,
+                                            FileFilter skip, int maxFiles, QHash<IndexedString, int>* levels)
+{
+  QHash<IndexedString, int> visited;
+  QList<IndexedString> order;
+
+  foreach(const IndexedString& root, roots) {
+    if(order.size() >= maxFiles)
+      break;
+    if(!skip || !skip(root))
+      visit(root, includePaths, skip, maxFiles, 0, &visited, &order);
+  }
+
+  if(levels)
+    *levels = visited;
+  return order;
+}
+
+int IncludeGraph::visit(const IndexedString& file, const Path::List& includePaths, FileFilter skip, int maxFiles,
+                        int depth, QHash<IndexedString, int>* levels, QList<IndexedString>* order)
+{
+  QHash<IndexedString, int>::const_iterator it = levels->constFind(file);
+  if(it != levels->constEnd())
+    return qMax(*it, 0); //-1 while the file is being visited, which means there is a cycle
+
+  levels->insert(file, -1);
+
+  int level = 0;
+  if(depth < maxIncludeDepth) {
+    foreach(const IndexedString& included, includes(file, includePaths)) {
+      if(order->size() >= maxFiles)
+        break;
+      if(skip && skip(included))
+        continue;
+      level = qMax(level, visit(included, includePaths, skip, maxFiles, depth + 1, levels, order) + 1);
+    }
+  }
+
+  if(order->size() >= maxFiles) {
+    //The includes of the file may not all be in the result, so it is left out as well
+    levels->remove(file);
+    return level;
+  }
+
+  levels->insert(file, level);
+  order->append(file);
+  return level;
+}
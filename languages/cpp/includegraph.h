@@ -0,0 +1,89 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_INCLUDEGRAPH_H
+#define CPP_INCLUDEGRAPH_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+#include <language/duchain/indexedstring.h>
+#include <language/editor/modificationrevision.h>
+#include <util/path.h>
+
+#include "parser/rpp/pp-directivescanner.h"
+
+namespace Cpp {
+
+/**
+ * In-memory index of the include-relations between files.
+ *
+ * The files are only scanned for their directives through rpp::scanFileDirectives(..), which is
+ * much cheaper than preprocessing them, so the graph can be built before anything is parsed.
+ * It is used to find out which headers can be parsed independently, and in which order:
+ * Headers are best parsed bottom-up, so the headers they include are already in the du-chain.
+ *
+ * Only unconditional includes are part of the graph, since conditions are not evaluated.
+ * All functions are thread-safe.
+ */
+class IncludeGraph
+{
+public:
+  static IncludeGraph* self();
+
+  ///The directives of @p file. The file is scanned again when its modification-revision changed.
+  rpp::FileDirectives directives(const KDevelop::IndexedString& file);
+
+  ///The resolved unconditional includes of @p file, searched in the directory of the file and @p includePaths
+  QList<KDevelop::IndexedString> includes(const KDevelop::IndexedString& file, const KDevelop::Path::List& includePaths);
+
+  typedef bool (*FileFilter)(const KDevelop::IndexedString& file);
+
+  /**
+   * Collects the files that are reachable from @p roots, including the roots themselves.
+   *
+   * @param skip Files for which this returns true are neither returned nor descended into, may be zero
+   * @param maxFiles At most that count of files is returned. A file is only returned when all its includes
+   *                 that are not skipped are returned too, apart from cycles.
+   * @param levels If non-zero, receives the level of each returned file: The length of the longest
+   *               include-chain below the file, so leaf headers have level zero.
+   * @return The files in bottom-up order: Every file comes after all files it includes, apart from cycles.
+   */
+  QList<KDevelop::IndexedString> bottomUp(const QList<KDevelop::IndexedString>& roots, const KDevelop::Path::List& includePaths,
+                                          FileFilter skip, int maxFiles, QHash<KDevelop::IndexedString, int>* levels = 0);
+
+private:
+  struct Entry {
+    Entry() : includePathsHash(0), resolved(false) {
+    }
+    KDevelop::ModificationRevision revision;
+    rpp::FileDirectives directives;
+    uint includePathsHash;
+    bool resolved;
+    QList<KDevelop::IndexedString> includes;
+  };
+
+  int visit(const KDevelop::IndexedString& file, const KDevelop::Path::List& includePaths, FileFilter skip, int maxFiles,
+            int depth, QHash<KDevelop::IndexedString, int>* levels, QList<KDevelop::IndexedString>* order);
+
+  QHash<KDevelop::IndexedString, Entry> m_entries;
+  QMutex m_mutex;
+};
+
+}
+
+#endif // CPP_INCLUDEGRAPH_H
@@ -0,0 +1,73 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "includeguardcache.h"
+
+#include <KGlobal>
+
+using namespace Cpp;
+
+K_GLOBAL_STATIC(IncludeGuardCache, globalIncludeGuardCache)
+
+IncludeGuardCache* IncludeGuardCache::self()
+{
+  return globalIncludeGuardCache;
+}
+
+void IncludeGuardCache::setHeaderGuard(const KDevelop::IndexedString& file, const KDevelop::IndexedString& macro,
+                                       const KDevelop::ModificationRevision& revision)
+{
+  QMutexLocker lock(&m_mutex);
+  Entry& entry(m_entries[file]);
+  if (entry.revision != revision) {
+    entry.guard = Guard();
+    entry.revision = revision;
+  }
+  entry.guard.macro = macro;
+}
+
+void IncludeGuardCache::setPragmaOnce(const KDevelop::IndexedString& file, const KDevelop::ModificationRevision& revision)
+{
+  QMutexLocker lock(&m_mutex);
+  Entry& entry(m_entries[file]);
+  if (entry.revision != revision) {
+    entry.guard = Guard();
+    entry.revision = revision;
+  }
+  entry.guard.pragmaOnce = true;
+}
+
+bool IncludeGuardCache::guard(const KDevelop::IndexedString& file, Guard* guard)
+{
+  // revisionForFile has its own cache of file modification-times, so this does not hit the disk every time
+  const KDevelop::ModificationRevision revision = KDevelop::ModificationRevision::revisionForFile(file);
+
+  QMutexLocker lock(&m_mutex);
+  QHash<KDevelop::IndexedString, Entry>::iterator it = m_entries.find(file);
+  if (it == m_entries.end())
+    return false;
+
+  if (it->revision != revision) {
+    m_entries.erase(it);
+    return false;
+  }
+
+  if (it->guard.macro.isEmpty() && !it->guard.pragmaOnce)
+    return false;
+
+  *guard = it->guard;
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_INCLUDEGUARDCACHE_H
+#define CPP_INCLUDEGUARDCACHE_H
+
+#include <QHash>
+#include <QMutex>
+
+#include <language/duchain/indexedstring.h>
+#include <language/editor/modificationrevision.h>
+
+namespace Cpp {
+
+/**
+ * Remembers which files are completely wrapped into an include-guard, or marked with "#pragma once".
+ *
+ * This allows the multiple-include optimization known from compilers: When the guard of a file
+ * is active, the file does not need to be opened, read, or preprocessed again.
+ *
+ * The cache is shared by all parse-jobs. An entry is only valid as long as the modification-revision
+ * of the file stays the same, so edits in the file or an open document invalidate it.
+ */
+class IncludeGuardCache
+{
+public:
+  static IncludeGuardCache* self();
+
+  struct Guard {
+    Guard() : pragmaOnce(false) {
+    }
+    ///The guard-macro, empty for "#pragma once"
+    KDevelop::IndexedString macro;
+    bool pragmaOnce;
+  };
+
+  ///Remember that the contents of @p file in the given @p revision are guarded by @p macro
+  void setHeaderGuard(const KDevelop::IndexedString& file, const KDevelop::IndexedString& macro,
+                      const KDevelop::ModificationRevision& revision);
+
+  ///Remember that @p file in the given @p revision contains "#pragma once"
+  void setPragmaOnce(const KDevelop::IndexedString& file, const KDevelop::ModificationRevision& revision);
+
+  /**
+   * Retrieve the guard of @p file, if the file was not modified since it was recorded.
+   * @return false if no valid guard is known
+   */
+  bool guard(const KDevelop::IndexedString& file, Guard* guard);
+
+private:
+  struct Entry {
+    Guard guard;
+    KDevelop::ModificationRevision revision;
+  };
+
+  QHash<KDevelop::IndexedString, Entry> m_entries;
+  QMutex m_mutex;
+};
+
+}
+
+#endif // CPP_INCLUDEGUARDCACHE_H
@@ -41,15 +41,17 @@ CommentFormatter::CommentFormatter()
   }
 }
 
-bool CommentFormatter::containsToDo(const uint* start, const uint* end) const
+bool CommentFormatter::containsToDo(const ParseSession* session, uint start, uint end) const
 {
   const uint* markersStart = m_commentMarkerIndices.data();
   const uint* markersEnd = m_commentMarkerIndices.data() + m_commentMarkerIndices.size();
   
-  for(const uint* cursor = start; cursor < end; ++cursor)
+  for(uint cursor = start; cursor < end; ++cursor) {
+    const uint index = session->contentAt(cursor);
     for(const uint* marker = markersStart; marker < markersEnd; ++marker)
-      if(*cursor == *marker)
+      if(index == *marker)
         return true;
+  }
   
   return false;
 }
@@ -69,10 +71,10 @@ void CommentFormatter::extractToDos( uint token, const ParseSession* session, Co
   
   const Token& commentToken( (*session->token_stream)[token] );
   
-  if( !containsToDo(session->contents() + commentToken.position, session->contents() + commentToken.position + commentToken.size) )
+  if( !containsToDo(session, commentToken.position, commentToken.position + commentToken.size) )
     return; // Most common code path: No todos
   
-  QByteArray comment = stringFromContents(session->contentsVector(), commentToken.position, commentToken.size);
+  QByteArray comment = session->contentsString(commentToken.position, commentToken.size);
   QList<QByteArray> lines = comment.split( '\n' );
   if ( !lines.isEmpty() ) {
     QList<QByteArray>::iterator bit = lines.begin();
@@ -129,7 +131,7 @@ QByteArray CommentFormatter::formatComment( uint token, const ParseSession* sess
     return QByteArray();
   ///@todo Work directly on lists of IndexedString tokens, rather than QBytearray (faster), and only convert to QByteArray in the end.
   const Token& commentToken( (*session->token_stream)[token] );
-  return KDevelop::formatComment( stringFromContents(session->contentsVector(), commentToken.position, commentToken.size ) );
+  return KDevelop::formatComment( session->contentsString(commentToken.position, commentToken.size) );
 }
 
 QByteArray CommentFormatter::formatComment( const ListNode<uint>* comments, const ParseSession* session ) {
@@ -46,7 +46,7 @@ class KDEVCPPPARSER_EXPORT CommentFormatter {
     ///Processes the list of comments represented by the given token-number within the parse-session's token-stream
     QByteArray formatComment( const ListNode<uint>* node, const ParseSession* session );
   private:
-    bool containsToDo(const uint* start, const uint* end) const;
+    bool containsToDo(const ParseSession* session, uint start, uint end) const;
     bool containsToDo(const QByteArray& text) const;
     QVector<uint> m_commentMarkerIndices; // IndexedString indices
     QVector<QByteArray> m_commentMarkers;
@@ -22,6 +22,7 @@
 #include "control.h"
 #include "parsesession.h"
 #include "rpp/pp-scanner.h"
+#include "lexerscan.h"
 
 #include <cctype>
 #include <util/kdevvarlengtharray.h>
@@ -49,14 +50,14 @@ void TokenStream::splitRightShift(uint index)
 KDevelop::IndexedString TokenStream::symbol(const Token& t) const
 {
   if(t.size == 1)
-    return KDevelop::IndexedString::fromIndex(session->contents()[t.position]);
+    return KDevelop::IndexedString::fromIndex(session->contentAt(t.position));
   else
     return KDevelop::IndexedString();
 }
 
 uint TokenStream::symbolIndex(const Token& t) const
 {
-  return session->contents()[t.position];
+  return session->contentAt(t.position);
 }
 
 QByteArray TokenStream::symbolByteArray(const Token& t) const
@@ -64,7 +65,7 @@ QByteArray TokenStream::symbolByteArray(const Token& t) const
   if (t.size == 0) // esp. for EOF
     return QByteArray();
 
-  return stringFromContents(session->contentsVector(), t.position, t.size);
+  return session->contentsString(t.position, t.size);
 }
 
 QString TokenStream::symbolString(const Token& t) const
@@ -76,7 +77,7 @@ uint TokenStream::symbolLength(const Token& t) const
 {
   uint ret = 0;
   for(uint a = t.position; a < t.position+t.size; ++a) {
-    ret += KDevelop::IndexedString::lengthFromIndex(session->contents()[a]);
+    ret += KDevelop::IndexedString::lengthFromIndex(session->contentAt(a));
   }
   return ret;
 }
@@ -120,6 +121,10 @@ void Lexer::skipComment()
         break;
 
       case IN_COMMENT:
+        // jump over the comment body
+        cursor.current = const_cast<uint*>(LexerScan::findFirstOf(cursor.current, endCursor, '*', '\n', '\0', '\0'));
+        if (!(cursor < endCursor) || !*cursor)
+          return;
         if( *cursor == '\n' ) {
           scan_newline();
           continue;
@@ -129,9 +134,9 @@ void Lexer::skipComment()
         break;
 
       case IN_CXX_COMMENT:
-        if (*cursor == '\n')
-          return;
-        break;
+        // the comment ends at the next newline
+        cursor.current = const_cast<uint*>(LexerScan::findFirstOf(cursor.current, endCursor, '\n', '\0', '\0', '\0'));
+        return;
 
       case MAYBE_END:
         if (*cursor == '/')
@@ -292,6 +297,7 @@ void Lexer::tokenize(ParseSession* _session)
   m_canMergeComment = false;
   m_firstInLine = true;
   m_leaveSize = false;
+  m_contentChanges.clear();
 
   {
   Token eof;
@@ -377,6 +383,11 @@ void Lexer::tokenize(ParseSession* _session)
   stream->squeeze();
 }
 
+const QVector<QPair<uint, uint> >& Lexer::contentChanges() const
+{
+  return m_contentChanges;
+}
+
 void Lexer::initialize_scan_table()
 {
   s_initialized = true;
@@ -452,6 +463,10 @@ void Lexer::scan_char_constant()
   ++cursor;
   while (cursor < endCursor && *cursor && *cursor != '\'')
     {
+      cursor.current = const_cast<uint*>(LexerScan::findFirstOf(cursor.current, endCursor, '\'', '\\', '\n', '\0'));
+      if (!(cursor < endCursor) || !*cursor || *cursor == '\'')
+        break;
+
       if (*cursor == '\n')
         {
           KDevelop::ProblemPointer p = createProblem();
@@ -487,6 +502,10 @@ void Lexer::scan_string_constant()
   ++cursor;
   while (cursor < endCursor && *cursor && *cursor != '"')
     {
+      cursor.current = const_cast<uint*>(LexerScan::findFirstOf(cursor.current, endCursor, '"', '\\', '\n', '\0'));
+      if (!(cursor < endCursor) || !*cursor || *cursor == '"')
+        break;
+
        if (*cursor == '\n')
         {
           KDevelop::ProblemPointer p = createProblem();
@@ -583,13 +602,10 @@ void Lexer::scan_newline()
 
 void Lexer::scan_white_spaces()
 {
-  while (cursor < endCursor && isspace(*cursor))
-    {
-      if (*cursor == '\n')
-	scan_newline();
-      else
-	++cursor;
-    }
+  bool sawNewline = false;
+  cursor.current = const_cast<uint*>(LexerScan::skipWhiteSpaces(cursor.current, endCursor, &sawNewline));
+  if (sawNewline)
+    m_firstInLine = true;
 }
 
 void Lexer::scan_identifier_or_literal()
@@ -640,6 +656,8 @@ void Lexer::scan_identifier_or_keyword()
     
     (*cursor.current) = mergedSymbol.index();
     (*nextCursor.current) = 0;
+    m_contentChanges.append(qMakePair(cursor.offsetIn(session->contents()), *cursor.current));
+    m_contentChanges.append(qMakePair(nextCursor.offsetIn(session->contents()), 0u));
     ++nextCursor;
   }
   
@@ -675,8 +693,7 @@ void Lexer::scan_int_constant()
 
   //const char *begin = cursor;
 
-  while (cursor < endCursor &&  (isalnum(*cursor) || *cursor == '.'))
-    ++cursor;
+  cursor.current = const_cast<uint*>(LexerScan::skipNumberCharacters(cursor.current, endCursor));
 
   (*session->token_stream)[index++].kind = Token_number_literal;
 }
@@ -170,7 +170,7 @@ private:
 };
 
 /**C++ Lexer.*/
-class Lexer
+class KDEVCPPPARSER_EXPORT Lexer
 {
 public:
   /**
@@ -185,6 +185,13 @@ public:
   /**Finds tokens in the @p contents buffer and fills the @ref token_stream.*/
   void tokenize(ParseSession* session);
 
+  /**
+   * The lexer merges identifiers that were split by the preprocessor, which
+   * changes the session contents. This returns those changes from the last
+   * tokenize() run as pairs of offset and new value.
+   */
+  const QVector<QPair<uint, uint> >& contentChanges() const;
+
   ParseSession* session;
 
 private:
@@ -311,6 +318,8 @@ private:
   const uint* endCursor;
   uint index;
 
+  QVector<QPair<uint, uint> > m_contentChanges;
+
   bool m_leaveSize; //Marks the current token that its size should not be automatically set
   bool m_canMergeComment; //Whether we may append new comments to the last encountered one
   bool m_firstInLine;   //Whether the next token is the first one in a line
@@ -0,0 +1,219 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "lexerscan.h"
+
+#include "rpp/chartools.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LEXERSCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LEXERSCAN_SSE2
+#endif
+
+namespace {
+
+const uint charMask = 0xffff0000;
+
+#if defined(LEXERSCAN_AVX2)
+
+/// Eight indices at a time
+struct Lanes
+{
+  typedef __m256i Vec;
+  enum { Count = 8 };
+
+  static Vec load(const uint* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+  static Vec set(uint v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+  static Vec equal(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+  static Vec either(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static Vec both(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+  static Vec less(Vec a, Vec b) { return _mm256_cmpgt_epi32(b, a); }
+  static Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+  static Vec bitXor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+  static uint mask(Vec v) { return static_cast<uint>(_mm256_movemask_ps(_mm256_castsi256_ps(v))); }
+};
+
+#elif defined(LEXERSCAN_SSE2)
+
+/// Four indices at a time
+struct Lanes
+{
+  typedef __m128i Vec;
+  enum { Count = 4 };
+
+  static Vec load(const uint* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+  static Vec set(uint v) { return _mm_set1_epi32(static_cast<int>(v)); }
+  static Vec equal(Vec a, Vec b) { return _mm_cmpeq_epi32(a, b); }
+  static Vec either(Vec a, Vec b) { return _mm_or_si128(a, b); }
+  static Vec both(Vec a, Vec b) { return _mm_and_si128(a, b); }
+  static Vec less(Vec a, Vec b) { return _mm_cmplt_epi32(a, b); }
+  static Vec sub(Vec a, Vec b) { return _mm_sub_epi32(a, b); }
+  static Vec bitXor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+  static uint mask(Vec v) { return static_cast<uint>(_mm_movemask_ps(_mm_castsi128_ps(v))); }
+};
+
+#endif
+
+#if defined(LEXERSCAN_AVX2) || defined(LEXERSCAN_SSE2)
+
+/// Lanes where the index represents a character in the range [@p first, @p first + @p count)
+inline Lanes::Vec inRange(Lanes::Vec v, char first, uint count)
+{
+  // unsigned comparison of (v - first) < count, done as signed comparison on biased values
+  const uint bias = 0x80000000u;
+  const Lanes::Vec diff = Lanes::bitXor(Lanes::sub(v, Lanes::set(indexFromCharacter(first))), Lanes::set(bias));
+  return Lanes::less(diff, Lanes::set(bias + count));
+}
+
+/// Index of the lowest set bit in the non-zero @p mask
+inline int firstLane(uint mask)
+{
+  int lane = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    ++lane;
+  }
+  return lane;
+}
+
+#endif
+
+inline bool inRange(uint v, char first, uint count)
+{
+  return v - indexFromCharacter(first) < count;
+}
+
+/**
+ * Returns the first position in [begin, end) for which @p Predicate::stop is true.
+ *
+ * The predicate provides a scalar and a vectorized variant of stop().
+ */
+template<class Predicate>
+const uint* scanUntil(const uint* begin, const uint* end, const Predicate& predicate)
+{
+  const uint* p = begin;
+#if defined(LEXERSCAN_AVX2) || defined(LEXERSCAN_SSE2)
+  while (end - p >= Lanes::Count) {
+    const uint stop = Lanes::mask(predicate.stop(Lanes::load(p)));
+    if (stop) {
+      return p + firstLane(stop);
+    }
+    p += Lanes::Count;
+  }
+#endif
+  while (p < end && !predicate.stop(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+struct WhiteSpacePredicate
+{
+  // '\t', '\n', '\v', '\f' and '\r' are consecutive
+  bool stop(uint v) const
+  {
+    return !(inRange(v, '\t', 5) || v == indexFromCharacter(' '));
+  }
+#if defined(LEXERSCAN_AVX2) || defined(LEXERSCAN_SSE2)
+  Lanes::Vec stop(Lanes::Vec v) const
+  {
+    const Lanes::Vec space = Lanes::either(inRange(v, '\t', 5), Lanes::equal(v, Lanes::set(indexFromCharacter(' '))));
+    // invert
+    return Lanes::equal(space, Lanes::set(0));
+  }
+#endif
+};
+
+struct NumberPredicate
+{
+  // identifiers that were inserted by the preprocessor continue a literal, see Lexer::SpecialCursor::operator*
+  bool stop(uint v) const
+  {
+    return (v & charMask) == charMask && !(inRange(v, '0', 10) || inRange(v, 'a', 26) || inRange(v, 'A', 26)
+                                             || v == indexFromCharacter('.'));
+  }
+#if defined(LEXERSCAN_AVX2) || defined(LEXERSCAN_SSE2)
+  Lanes::Vec stop(Lanes::Vec v) const
+  {
+    const Lanes::Vec isChar = Lanes::equal(Lanes::both(v, Lanes::set(charMask)), Lanes::set(charMask));
+    const Lanes::Vec cont = Lanes::either(Lanes::either(inRange(v, '0', 10), inRange(v, 'a', 26)),
+                                          Lanes::either(inRange(v, 'A', 26), Lanes::equal(v, Lanes::set(indexFromCharacter('.')))));
+    // isChar && !cont
+    return Lanes::both(isChar, Lanes::equal(cont, Lanes::set(0)));
+  }
+#endif
+};
+
+struct AnyOfPredicate
+{
+  AnyOfPredicate(char c1, char c2, char c3, char c4)
+  : i1(indexFromCharacter(c1)), i2(indexFromCharacter(c2)), i3(indexFromCharacter(c3)), i4(indexFromCharacter(c4))
+  {
+  }
+  bool stop(uint v) const
+  {
+    return v == i1 || v == i2 || v == i3 || v == i4;
+  }
+#if defined(LEXERSCAN_AVX2) || defined(LEXERSCAN_SSE2)
+  Lanes::Vec stop(Lanes::Vec v) const
+  {
+    return Lanes::either(Lanes::either(Lanes::equal(v, Lanes::set(i1)), Lanes::equal(v, Lanes::set(i2))),
+                         Lanes::either(Lanes::equal(v, Lanes::set(i3)), Lanes::equal(v, Lanes::set(i4))));
+  }
+#endif
+  uint i1, i2, i3, i4;
+};
+
+}
+
+namespace LexerScan
+{
+
+const uint* skipWhiteSpaces(const uint* begin, const uint* end, bool* sawNewline)
+{
+  const uint* ret = scanUntil(begin, end, WhiteSpacePredicate());
+  if (findFirstOf(begin, ret, '\n', '\n', '\n', '\n') != ret) {
+    *sawNewline = true;
+  }
+  return ret;
+}
+
+const uint* skipNumberCharacters(const uint* begin, const uint* end)
+{
+  return scanUntil(begin, end, NumberPredicate());
+}
+
+const uint* findFirstOf(const uint* begin, const uint* end, char c1, char c2, char c3, char c4)
+{
+  return scanUntil(begin, end, AnyOfPredicate(c1, c2, c3, c4));
+}
+
+const char* kernelName()
+{
+#if defined(LEXERSCAN_AVX2)
+  return "avx2";
+#elif defined(LEXERSCAN_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,67 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef LEXERSCAN_H
+#define LEXERSCAN_H
+
+#include <QtCore/QtGlobal>
+
+#include "cppparserexport.h"
+
+/**
+ * Bulk scanning helpers for preprocessed contents, as used by the Lexer.
+ *
+ * All functions operate on the fake-indices produced by the preprocessor,
+ * see indexFromCharacter(). Runs of characters are compared several indices
+ * at a time using SSE2 or AVX2 when the compiler targets them, otherwise a
+ * plain scalar loop is used.
+ */
+namespace LexerScan
+{
+  /**
+   * Skip whitespace characters, including newlines.
+   *
+   * @p sawNewline is set to true when at least one newline was skipped,
+   * it is left untouched otherwise.
+   *
+   * @return pointer to the first non-whitespace index or @p end.
+   */
+  KDEVCPPPARSER_EXPORT const uint* skipWhiteSpaces(const uint* begin, const uint* end, bool* sawNewline);
+
+  /**
+   * Skip characters that may continue a number literal, i.e. letters, digits and '.'.
+   *
+   * @return pointer to the first index that does not continue the literal or @p end.
+   */
+  KDEVCPPPARSER_EXPORT const uint* skipNumberCharacters(const uint* begin, const uint* end);
+
+  /**
+   * Find the first occurrence of any of the given characters.
+   *
+   * Pass the same character multiple times if less than four are required.
+   *
+   * @return pointer to the first match or @p end.
+   */
+  KDEVCPPPARSER_EXPORT const uint* findFirstOf(const uint* begin, const uint* end, char c1, char c2, char c3, char c4);
+
+  /**
+   * @return Name of the scan kernel that was compiled in, i.e. "avx2", "sse2" or "scalar".
+   */
+  KDEVCPPPARSER_EXPORT const char* kernelName();
+}
+
+#endif // LEXERSCAN_H
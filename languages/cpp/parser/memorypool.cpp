@@ -21,6 +21,43 @@
 #include "memorypool.h"
 
 #include <QThreadStorage>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <KGlobal>
+
+/**
+ * The global reservoir takes the blocks that do not fit into a thread local
+ * cache anymore. Parse jobs are distributed over the ThreadWeaver threads, so
+ * this allows one thread to reuse the memory released by another one.
+ *
+ * It also keeps track of how much memory is held by all pools of the process.
+ */
+struct MemoryPoolReservoir
+{
+  MemoryPoolReservoir()
+  : totalBytes(0)
+  , peakTotalBytes(0)
+  {
+  }
+  ~MemoryPoolReservoir()
+  {
+    qDeleteAll(freeBlocks);
+  }
+  void addTotal(size_t bytes)
+  {
+    totalBytes += bytes;
+    if (totalBytes > peakTotalBytes) {
+      peakTotalBytes = totalBytes;
+    }
+  }
+  QMutex mutex;
+  QVector<MemoryPool::Block*> freeBlocks;
+  size_t totalBytes;
+  size_t peakTotalBytes;
+};
+
+K_GLOBAL_STATIC(MemoryPoolReservoir, globalReservoir)
 
 /**
  * This class handles the thread local caching of memory blocks.
@@ -36,6 +73,10 @@ struct MemoryPoolCache
   }
   ~MemoryPoolCache()
   {
+    if (!globalReservoir.isDestroyed()) {
+      QMutexLocker lock(&globalReservoir->mutex);
+      globalReservoir->totalBytes -= freeBlocks.size() * MemoryPool::BLOCK_SIZE;
+    }
     qDeleteAll(freeBlocks);
   }
   QVector<MemoryPool::Block*> freeBlocks;
@@ -55,6 +96,8 @@ static QThreadStorage< MemoryPoolCache* > threadLocalCache;
 MemoryPool::MemoryPool()
 : m_currentBlock(-1)
 , m_currentIndex(BLOCK_SIZE)
+, m_largeChunkBytes(0)
+, m_reusedBlocks(0)
 {
   // preallocate some space for the potentially used blocks
   m_blocks.reserve(MAX_CACHE_SIZE);
@@ -70,17 +113,51 @@ MemoryPool::~MemoryPool()
     cache = new MemoryPoolCache;
     threadLocalCache.setLocalData(cache);
   }
-  for(int i = 0; i <= m_currentBlock; ++i) {
+  int i = 0;
+  for(; i <= m_currentBlock && cache->freeBlocks.size() < MAX_CACHE_SIZE; ++i) {
+    // cache block for reuse by another thread local allocator
+    // this requires a 'prestine' state, i.e. memset to zero
     Block* block = m_blocks.at(i);
-    if (cache->freeBlocks.size() < MAX_CACHE_SIZE) {
-      // cache block for reuse by another thread local allocator
-      // this requires a 'prestine' state, i.e. memset to zero
-      memset(block->data, 0, i == m_currentBlock ? m_currentIndex : static_cast<size_t>(BLOCK_SIZE));
-      cache->freeBlocks.append(block);
-    } else {
-      // otherwise we can discard this block
-      delete block;
+    memset(block->data, 0, i == m_currentBlock ? m_currentIndex : static_cast<size_t>(BLOCK_SIZE));
+    cache->freeBlocks.append(block);
+  }
+
+  if ((i <= m_currentBlock || !m_largeChunks.isEmpty()) && !globalReservoir.isDestroyed()) {
+    MemoryPoolReservoir* reservoir = globalReservoir;
+    int room;
+    {
+      QMutexLocker lock(&reservoir->mutex);
+      room = MAX_RESERVOIR_SIZE - reservoir->freeBlocks.size();
+    }
+    // hand the blocks over to the other threads, again in a 'prestine' state.
+    // they are cleared before locking, so other threads are not blocked meanwhile
+    const int firstBlock = i;
+    const int clearedEnd = qMin(m_currentBlock + 1, firstBlock + qMax(room, 0));
+    for(int j = firstBlock; j < clearedEnd; ++j) {
+      memset(m_blocks.at(j)->data, 0, j == m_currentBlock ? m_currentIndex : static_cast<size_t>(BLOCK_SIZE));
+    }
+
+    QMutexLocker lock(&reservoir->mutex);
+    for(; i <= m_currentBlock; ++i) {
+      Block* block = m_blocks.at(i);
+      if (i < clearedEnd && reservoir->freeBlocks.size() < MAX_RESERVOIR_SIZE) {
+        reservoir->freeBlocks.append(block);
+      } else {
+        // otherwise we can discard this block
+        delete block;
+        reservoir->totalBytes -= BLOCK_SIZE;
+      }
     }
+    reservoir->totalBytes -= m_largeChunkBytes;
+  }
+
+  // only reached during static destruction if the reservoir is gone already
+  for(; i <= m_currentBlock; ++i) {
+    delete m_blocks.at(i);
+  }
+
+  foreach(char* chunk, m_largeChunks) {
+    delete[] chunk;
   }
 }
 
@@ -92,10 +169,63 @@ void MemoryPool::allocateBlock()
     // reuse cached memory block
     m_blocks.append(cache->freeBlocks.last());
     cache->freeBlocks.pop_back();
-  } else {
-    // allocate new memory block
-    Block* block = new Block;
-    memset(block->data, 0, BLOCK_SIZE);
-    m_blocks.append(block);
+    ++m_reusedBlocks;
+    return;
+  }
+
+  MemoryPoolReservoir* reservoir = globalReservoir;
+  {
+    QMutexLocker lock(&reservoir->mutex);
+    if (!reservoir->freeBlocks.isEmpty()) {
+      // reuse a block released by another thread
+      m_blocks.append(reservoir->freeBlocks.last());
+      reservoir->freeBlocks.pop_back();
+      ++m_reusedBlocks;
+      return;
+    }
+    reservoir->addTotal(BLOCK_SIZE);
   }
+
+  // allocate new memory block
+  Block* block = new Block;
+  memset(block->data, 0, BLOCK_SIZE);
+  m_blocks.append(block);
+}
+
+char* MemoryPool::allocateLargeChunk(size_t bytes)
+{
+  char* chunk = new char[bytes];
+  memset(chunk, 0, bytes);
+  m_largeChunks.append(chunk);
+  m_largeChunkBytes += bytes;
+
+  MemoryPoolReservoir* reservoir = globalReservoir;
+  QMutexLocker lock(&reservoir->mutex);
+  reservoir->addTotal(bytes);
+
+  return chunk;
+}
+
+MemoryPool::Statistics MemoryPool::statistics() const
+{
+  Statistics ret;
+  ret.allocatedBytes = size();
+  ret.reusedBytes = static_cast<size_t>(m_reusedBlocks) * BLOCK_SIZE;
+  ret.newBytes = static_cast<size_t>(m_blocks.size() - m_reusedBlocks) * BLOCK_SIZE;
+  ret.largeChunkBytes = m_largeChunkBytes;
+  return ret;
+}
+
+size_t MemoryPool::totalBytes()
+{
+  MemoryPoolReservoir* reservoir = globalReservoir;
+  QMutexLocker lock(&reservoir->mutex);
+  return reservoir->totalBytes;
+}
+
+size_t MemoryPool::peakTotalBytes()
+{
+  MemoryPoolReservoir* reservoir = globalReservoir;
+  QMutexLocker lock(&reservoir->mutex);
+  return reservoir->peakTotalBytes;
 }
@@ -36,8 +36,15 @@
  * This way it is very performant to repeatedly create this allocator
  * and use it for small numbers of allocations.
  *
+ * Blocks that do not fit into the thread-local cache are handed to a global
+ * reservoir of up to MAX_RESERVOIR_SIZE blocks, which is shared between all
+ * threads. This way the background parser threads can recycle the memory of
+ * big parse sessions instead of going back to the system allocator.
+ *
  * If the size of an element being allocated extends the amount of free
- * memory left in the block then a new block is allocated.
+ * memory left in the block then a new block is allocated. Allocations that
+ * are larger than BLOCK_SIZE get a separate, zeroed chunk of memory which is
+ * released together with the pool.
  *
  * NOTE: Neither the elements constructor or destructor is being called. The
  *       allocated memory blocks are memset to 0 though. You need to call
@@ -56,14 +63,16 @@ public:
    *
    * @return pointer to first of @p n allocated objects of type @p T.
    *
-   * @Warning Ensure you do not allocate more than the size of a block.
+   * @note Allocations larger than BLOCK_SIZE are served from a separate chunk.
    * @sa BLOCK_SIZE
    */
   template<typename T>
   T* allocate(size_t n = 1)
   {
     const size_t bytes = n * sizeof(T);
-    Q_ASSERT(bytes <= BLOCK_SIZE);
+    if (bytes > BLOCK_SIZE) {
+      return reinterpret_cast<T*>(allocateLargeChunk(bytes));
+    }
 
     if (BLOCK_SIZE < m_currentIndex + bytes) {
       // current block is full, use next one
@@ -87,9 +96,40 @@ public:
    */
   size_t size() const
   {
-    return m_currentBlock * BLOCK_SIZE + m_currentIndex;
+    return m_currentBlock * BLOCK_SIZE + m_currentIndex + m_largeChunkBytes;
   }
 
+  /**
+   * Usage counters of a single memory pool.
+   */
+  struct Statistics
+  {
+    /// Bytes handed out by allocate(), including oversized chunks.
+    size_t allocatedBytes;
+    /// Bytes of blocks that were taken from the thread-local cache or the global reservoir.
+    size_t reusedBytes;
+    /// Bytes of blocks that had to be newly allocated.
+    size_t newBytes;
+    /// Bytes of oversized chunks that were allocated outside of the blocks.
+    size_t largeChunkBytes;
+  };
+
+  /**
+   * @return usage counters for this pool.
+   */
+  Statistics statistics() const;
+
+  /**
+   * @return the number of bytes that are currently held by all memory pools
+   *         of this process, including cached and reserved free blocks.
+   */
+  static size_t totalBytes();
+
+  /**
+   * @return the maximum value totalBytes() ever reached.
+   */
+  static size_t peakTotalBytes();
+
   /**
    * Construct an object of type @p T with the values of @p value
    * at the position of @p p.
@@ -120,7 +160,12 @@ public:
      * Maximum number of free memory blocks that are cached
      * until the thread exists.
      */
-    MAX_CACHE_SIZE = 32 // * BLOCK_SIZE = approx. 2MB
+    MAX_CACHE_SIZE = 32, // * BLOCK_SIZE = approx. 2MB
+    /**
+     * Maximum number of free memory blocks that are kept in the
+     * global reservoir shared between all threads.
+     */
+    MAX_RESERVOIR_SIZE = 256 // * BLOCK_SIZE = approx. 16MB
   };
 private:
   Q_DISABLE_COPY(MemoryPool)
@@ -131,6 +176,11 @@ private:
    */
   void allocateBlock();
 
+  /**
+   * Allocate a zeroed chunk of @p bytes that is too large to fit into a block.
+   */
+  char* allocateLargeChunk(size_t bytes);
+
   /**
    * A continous block of memory.
    */
@@ -144,7 +194,12 @@ private:
   int m_currentBlock;
   size_t m_currentIndex;
 
+  QVector<char*> m_largeChunks;
+  size_t m_largeChunkBytes;
+  int m_reusedBlocks;
+
   friend struct MemoryPoolCache;
+  friend struct MemoryPoolReservoir;
 };
 
 #endif // RXX_ALLOCATOR_H
@@ -100,6 +100,8 @@ Parser::Parser(Control *c)
   , _M_last_parsed_comment(0)
   , _M_hadMismatchingCompoundTokens(false)
   , m_primaryExpressionWithTemplateParamsNeedsFunctionCall(true)
+  , m_memoize(true)
+  , m_reportedErrors(0)
 {
 }
 
@@ -205,7 +207,9 @@ TranslationUnitAST *Parser::parse(ParseSession* _session)
   if (!session->token_stream)
     session->token_stream = new TokenStream(session);
 
-  lexer.tokenize(session);
+  // the tokens may have been restored from a cache already
+  if (session->token_stream->isEmpty())
+    lexer.tokenize(session);
   advance(); // skip the first token
 
   TranslationUnitAST *ast = 0;
@@ -288,6 +292,66 @@ void Parser::clear()
   _M_problem_count = 0;
   _M_hadMismatchingCompoundTokens = false;
   m_tokenMarkers.clear();
+  m_memo.clear();
+  m_memoStatistics = MemoStatistics();
+}
+
+quint64 Parser::memoKey(MemoProduction production, uint flags) const
+{
+  // the primary-expression mode changes how template arguments are accepted
+  flags = (flags << 1) | (m_primaryExpressionWithTemplateParamsNeedsFunctionCall ? 1 : 0);
+  return (quint64(session->token_stream->cursor()) << 8) | (flags << 2) | production;
+}
+
+template<class Node>
+bool Parser::findMemo(quint64 key, Node*& node, bool& success)
+{
+  if (!m_memoize)
+    return false;
+
+  ++m_memoStatistics.lookups;
+
+  QHash<quint64, MemoEntry>::const_iterator it = m_memo.constFind(key);
+  if (it == m_memo.constEnd())
+    return false;
+
+  ++m_memoStatistics.hits;
+
+  uint start = session->token_stream->cursor();
+  if (it->endToken != start)
+    {
+      m_memoStatistics.reusedTokens += it->endToken - start;
+
+      // parsing again would pass the comments through processComment(), so do the same here
+      for (uint token = qMax(start, _M_last_parsed_comment + 1); token < it->endToken; ++token)
+        if (session->token_stream->kind(token) == Token_comment)
+          processComment(token - start);
+
+      rewind(it->endToken);
+    }
+
+  node = static_cast<Node*>(it->node);
+  success = it->success;
+  return true;
+}
+
+template<class Node>
+void Parser::storeMemo(quint64 key, Node* node, bool success, uint reportedErrors)
+{
+  if (!m_memoize)
+    return;
+
+  if (reportedErrors != m_reportedErrors)
+    {
+      ++m_memoStatistics.uncacheable;
+      return;
+    }
+
+  MemoEntry entry;
+  entry.node = const_cast<void*>(static_cast<const void*>(node));
+  entry.endToken = session->token_stream->cursor();
+  entry.success = success;
+  m_memo.insert(key, entry);
 }
 
 
@@ -295,9 +359,23 @@ void Parser::addTokenMarkers(uint tokenNumber, Parser::TokenMarkers markers)
 {
   QHash<uint, TokenMarkers>::iterator it = m_tokenMarkers.find(tokenNumber);
   if(it != m_tokenMarkers.end())
-    it.value() = (TokenMarkers)(it.value() | markers);
+    {
+      if ((it.value() | markers) == it.value())
+        return;
+      it.value() = (TokenMarkers)(it.value() | markers);
+    }
   else
     m_tokenMarkers.insert(tokenNumber, markers);
+
+  // productions that started at or before the token may have parsed it without the marker
+  QHash<quint64, MemoEntry>::iterator memo = m_memo.begin();
+  while (memo != m_memo.end())
+    {
+      if ((memo.key() >> 8) <= tokenNumber)
+        memo = m_memo.erase(memo);
+      else
+        ++memo;
+    }
 }
 
 Parser::TokenMarkers Parser::tokenMarkers(uint tokenNumber) const
@@ -405,6 +483,8 @@ void Parser::reportPendingErrors()
 
 void Parser::reportError(const QString& msg, KDevelop::ProblemData::Severity severity)
 {
+  ++m_reportedErrors;
+
   if (!_M_hold_errors && _M_problem_count < _M_max_problem_count)
     {
       ++_M_problem_count;
@@ -1057,6 +1137,24 @@ bool Parser::parseOperatorFunctionId(OperatorFunctionIdAST *&node)
 
 bool Parser::parseTemplateArgumentList(const ListNode<TemplateArgumentAST*> *&node,
                                        bool reportError)
+{
+  // the list is appended to an existing one, that can't be shared
+  if (node)
+    return parseTemplateArgumentListInternal(node, reportError);
+
+  quint64 key = memoKey(MemoTemplateArgumentList, reportError);
+  bool success;
+  if (findMemo(key, node, success))
+    return success;
+
+  uint reportedErrors = m_reportedErrors;
+  success = parseTemplateArgumentListInternal(node, reportError);
+  storeMemo(key, node, success, reportedErrors);
+  return success;
+}
+
+bool Parser::parseTemplateArgumentListInternal(const ListNode<TemplateArgumentAST*> *&node,
+                                               bool reportError)
 {
   TemplateArgumentAST *templArg = 0;
   if (!parseTemplateArgument(templArg))
@@ -1527,6 +1625,22 @@ bool Parser::parseTypeSpecifier(TypeSpecifierAST *&node)
 }
 
 bool Parser::parseDeclarator(DeclaratorAST*& node, bool allowBitfield)
+{
+  if (node)
+    return parseDeclaratorInternal(node, allowBitfield);
+
+  quint64 key = memoKey(MemoDeclarator, allowBitfield);
+  bool success;
+  if (findMemo(key, node, success))
+    return success;
+
+  uint reportedErrors = m_reportedErrors;
+  success = parseDeclaratorInternal(node, allowBitfield);
+  storeMemo(key, node, success, reportedErrors);
+  return success;
+}
+
+bool Parser::parseDeclaratorInternal(DeclaratorAST*& node, bool allowBitfield)
 {
   uint start = session->token_stream->cursor();
 
@@ -2038,6 +2152,22 @@ bool Parser::parseFunctionSpecifier(const ListNode<uint> *&node)
 }
 
 bool Parser::parseTypeId(TypeIdAST *&node)
+{
+  if (node)
+    return parseTypeIdInternal(node);
+
+  quint64 key = memoKey(MemoTypeId);
+  bool success;
+  if (findMemo(key, node, success))
+    return success;
+
+  uint reportedErrors = m_reportedErrors;
+  success = parseTypeIdInternal(node);
+  storeMemo(key, node, success, reportedErrors);
+  return success;
+}
+
+bool Parser::parseTypeIdInternal(TypeIdAST *&node)
 {
   uint start = session->token_stream->cursor();
 
@@ -3071,6 +3201,8 @@ bool Parser::parseUnqualifiedName(UnqualifiedNameAST *&node,
             }
           else if (session->token_stream->lookAhead() == Token_rightshift)
             {
+              // the inserted token moves all following tokens, so the memo refers to wrong ones
+              m_memo.clear();
               session->token_stream->splitRightShift(session->token_stream->cursor());
               advance();
             }
@@ -4836,6 +4968,22 @@ bool Parser::parseDeleteExpression(ExpressionAST *&node)
 }
 
 bool Parser::parseCastExpression(ExpressionAST *&node)
+{
+  if (node)
+    return parseCastExpressionInternal(node);
+
+  quint64 key = memoKey(MemoCastExpression);
+  bool success;
+  if (findMemo(key, node, success))
+    return success;
+
+  uint reportedErrors = m_reportedErrors;
+  success = parseCastExpressionInternal(node);
+  storeMemo(key, node, success, reportedErrors);
+  return success;
+}
+
+bool Parser::parseCastExpressionInternal(ExpressionAST *&node)
 {
   uint start = session->token_stream->cursor();
 
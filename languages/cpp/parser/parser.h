@@ -48,7 +48,8 @@ public:
   /**Parses the @p contents of the buffer of given @p size using the
   memory pool @p p to store tokens found.
 
-  Calls lexer to tokenize all contents buffer, skips the first token
+  Calls lexer to tokenize all contents buffer unless the session's
+  token stream is already filled, skips the first token
   (because the lexer provides Token_EOF as the first token,
   creates and fills the AST and returns translation unit or 0
   if nothing was parsed.
@@ -82,6 +83,33 @@ public:
   /**@return the problem count.*/
   int problemCount() const { return _M_problem_count; }
 
+  /**
+   * Counters about the memoization of the productions that are re-tried on
+   * backtracking, see parseTypeId(), parseTemplateArgumentList(),
+   * parseDeclarator() and parseCastExpression().
+   *
+   * The counters are reset whenever a new session is parsed.
+   */
+  struct MemoStatistics
+  {
+    MemoStatistics() : lookups(0), hits(0), reusedTokens(0), uncacheable(0) {}
+    ///Calls of a memoized production
+    uint lookups;
+    ///Calls that were answered from the memo table instead of being parsed again
+    uint hits;
+    ///Tokens that did not have to be parsed again thanks to the hits
+    uint reusedTokens;
+    ///Results that were not stored because the attempt reported problems
+    uint uncacheable;
+  };
+  const MemoStatistics& memoStatistics() const { return m_memoStatistics; }
+
+  /**
+   * Enable or disable the memoization of backtracking productions, it is enabled by default.
+   * Disabling it is only useful to compare the results.
+   */
+  void setMemoizationEnabled(bool enabled) { m_memoize = enabled; }
+
   /**
    * Fixup an InitDeclaratorAST @p node, which was misinterpreted to contain a
    * parameter-declaration-clause while that is actually an initializer.
@@ -114,6 +142,7 @@ public:
   bool parseBlockDeclaration(DeclarationAST *&node);
   bool parseBracedInitList(ExpressionAST *&node);
   bool parseCastExpression(ExpressionAST *&node);
+  bool parseCastExpressionInternal(ExpressionAST *&node);
   bool parseClassSpecifier(TypeSpecifierAST *&node);
   bool parseSignalSlotExpression(ExpressionAST *&node);
   bool parseQProperty(DeclarationAST *&node);
@@ -132,6 +161,7 @@ public:
                                        TypeSpecifierAST* spec);
   bool parseDeclarationStatement(StatementAST *&node);
   bool parseDeclarator(DeclaratorAST *&node, bool allowBitfield = true);
+  bool parseDeclaratorInternal(DeclaratorAST *&node, bool allowBitfield);
   bool parseDeleteExpression(ExpressionAST *&node);
   bool parseDoStatement(StatementAST *&node);
   bool parseElaboratedTypeSpecifier(TypeSpecifierAST *&node);
@@ -212,6 +242,8 @@ public:
   bool parseTemplateArgument(TemplateArgumentAST *&node);
   bool parseTemplateArgumentList(const ListNode<TemplateArgumentAST*> *&node,
 				 bool reportError = true);
+  bool parseTemplateArgumentListInternal(const ListNode<TemplateArgumentAST*> *&node,
+					 bool reportError);
   bool parseTemplateDeclaration(DeclarationAST *&node);
   bool parseTemplateParameter(TemplateParameterAST *&node);
   bool parseTemplateParameterList(const ListNode<TemplateParameterAST*> *&node);
@@ -219,6 +251,7 @@ public:
   bool parseTranslationUnit(TranslationUnitAST *&node);
   bool parseTryBlockStatement(StatementAST *&node);
   bool parseTypeId(TypeIdAST *&node);
+  bool parseTypeIdInternal(TypeIdAST *&node);
   bool parseTypeIdList(const ListNode<TypeIdAST*> *&node);
   bool parseTypeParameter(TypeParameterAST *&node);
   bool parseTypeSpecifier(TypeSpecifierAST *&node);
@@ -308,6 +341,38 @@ private:
   };
   QQueue<PendingError> m_pendingErrors;
 
+  // results of the productions that are re-tried when backtracking,
+  // keyed by the production, its flags and the start token.
+  //
+  // only attempts that did not report any problem are stored, so that
+  // held errors of a discarded attempt can not get lost on a later hit.
+  // the table is cleared when a '>>' token is split, as that renumbers
+  // the tokens behind it, and the entries that may have seen a token are
+  // dropped when the markers of that token change.
+  enum MemoProduction {
+    MemoTypeId = 0,
+    MemoTemplateArgumentList,
+    MemoDeclarator,
+    MemoCastExpression
+  };
+  struct MemoEntry
+  {
+    void* node;
+    uint endToken;
+    bool success;
+  };
+  quint64 memoKey(MemoProduction production, uint flags = 0) const;
+  template<class Node>
+  bool findMemo(quint64 key, Node*& node, bool& success);
+  template<class Node>
+  void storeMemo(quint64 key, Node* node, bool success, uint reportedErrors);
+
+  bool m_memoize;
+  // counts every call of reportError(), whether the error was held or not
+  uint m_reportedErrors;
+  QHash<quint64, MemoEntry> m_memo;
+  MemoStatistics m_memoStatistics;
+
   ///return string representation of @p node for debugging
   QString stringForNode(AST* node) const;
 
@@ -20,6 +20,7 @@
 
 #include "rpp/pp-location.h"
 #include "rpp/pp-environment.h"
+#include "rpp/chartools.h"
 
 #include "lexer.h"
 #include "memorypool.h"
@@ -141,45 +142,89 @@ rpp::Anchor ParseSession::positionAt(std::size_t offset, bool collapseIfMacroExp
 {
   Q_ASSERT(m_locationTable);
 
-  return m_locationTable->positionAt(offset, m_contents, collapseIfMacroExpansion).first;
+  return positionAt(offset, *m_locationTable, collapseIfMacroExpansion);
 }
 
 QPair<rpp::Anchor, uint> ParseSession::positionAndSpaceAt(std::size_t offset, bool collapseIfMacroExpansion) const
 {
   Q_ASSERT(m_locationTable);
 
+  if (!m_compactContents.isEmpty())
+    return m_locationTable->positionAt(offset, m_compactContents, collapseIfMacroExpansion);
   return m_locationTable->positionAt(offset, m_contents, collapseIfMacroExpansion);
 }
 
+const rpp::LocationTable* ParseSession::locationTable() const
+{
+  return m_locationTable;
+}
+
+rpp::Anchor ParseSession::positionAt(std::size_t offset, const rpp::LocationTable& table, bool collapseIfMacroExpansion) const
+{
+  if (!m_compactContents.isEmpty())
+    return table.positionAt(offset, m_compactContents, collapseIfMacroExpansion).first;
+  return table.positionAt(offset, m_contents, collapseIfMacroExpansion).first;
+}
+
 std::size_t ParseSession::size() const
 {
+  if (!m_compactContents.isEmpty())
+    return m_compactContents.size() + 1;
   return m_contents.size() + 1;
 }
 
- uint* ParseSession::contents()
- {
-   return m_contents.data();
- }
-
-const uint* ParseSession::contents() const
- {
-   return m_contents.data();
- }
+uint* ParseSession::contents()
+{
+  if (!m_compactContents.isEmpty()) {
+    m_contents = m_compactContents.toPreprocessedContents();
+    m_compactContents = rpp::CompactContents();
+  }
+  return m_contents.data();
+}
 
-const PreprocessedContents& ParseSession::contentsVector() const
+const PreprocessedContents ParseSession::contentsVector() const
 {
+  if (!m_compactContents.isEmpty())
+    return m_compactContents.toPreprocessedContents();
   return m_contents;
 }
 
+uint ParseSession::contentAt(std::size_t offset) const
+{
+  if (!m_compactContents.isEmpty())
+    return m_compactContents.at(offset);
+  return m_contents.at(offset);
+}
+
+QByteArray ParseSession::contentsString(std::size_t offset, std::size_t count) const
+{
+  if (!count)
+    return QByteArray();
+  if (!m_compactContents.isEmpty())
+    return m_compactContents.toByteArray(offset, count);
+  return stringFromContents(m_contents, offset, count);
+}
+
+void ParseSession::compactContents()
+{
+  if (m_contents.isEmpty())
+    return;
+
+  m_compactContents = rpp::CompactContents(m_contents);
+  m_contents = PreprocessedContents();
+}
+
 void ParseSession::setContents(const PreprocessedContents& contents, rpp::LocationTable* locationTable)
 {
   m_contents = contents;
+  m_compactContents = rpp::CompactContents();
   m_locationTable = locationTable;
 }
 
 void ParseSession::setContentsAndGenerateLocationTable(const PreprocessedContents& contents)
 {
   m_contents = contents;
+  m_compactContents = rpp::CompactContents();
   ///@todo We need this in the lexer, the problem is that we copy the vector when doing this
   m_contents.append(0);
   m_contents.append(0);
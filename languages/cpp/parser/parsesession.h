@@ -26,6 +26,7 @@
 #include <cppparserexport.h>
 #include <ksharedptr.h>
 #include "rpp/anchor.h"
+#include "rpp/compactcontents.h"
 
 #include <language/duchain/indexedstring.h>
 #include <language/duchain/duchainpointer.h>
@@ -112,6 +113,15 @@ public:
 
   QPair<rpp::Anchor, uint> positionAndSpaceAt(std::size_t offset, bool collapseIfMacroExpansion = false) const;
 
+  /**
+   * The table used by positionAt(). It caches the last lookup, so threads that resolve positions
+   * concurrently must each use their own copy of it. Copying the table is cheap.
+   */
+  const rpp::LocationTable* locationTable() const;
+
+  /// Same as positionAt(), but uses the given copy of locationTable()
+  rpp::Anchor positionAt(std::size_t offset, const rpp::LocationTable& table, bool collapseIfMacroExpansion = false) const;
+
   ///The contents must already be tokenized. Either by the preprocessor, or by tokenizeFromByteArray(..)
   void setContents(const PreprocessedContents& contents, rpp::LocationTable* locationTable);
 
@@ -121,10 +131,32 @@ public:
   void setUrl(const KDevelop::IndexedString& url);
   const KDevelop::IndexedString& url() const;
 
+  /**
+   * Writable access to the contents, for the lexer.
+   *
+   * If the contents were compacted, they are decoded again and the compact form is dropped,
+   * so the returned buffer is the only copy of the contents.
+   * @note Must only be called while no other thread has access to this session.
+   */
   uint *contents();
-  const uint *contents() const;
-  const PreprocessedContents& contentsVector() const;
+  /// @return a copy of the contents, which has to be decoded if they were compacted
+  const PreprocessedContents contentsVector() const;
+  /// @return the item at @p offset of the contents, without decoding the compacted contents
+  uint contentAt(std::size_t offset) const;
+  /// @return the text of @p count items starting at @p offset, @see stringFromContents()
+  QByteArray contentsString(std::size_t offset, std::size_t count) const;
   std::size_t size() const;
+
+  /**
+   * Replace the preprocessed contents with their compact encoding, @see rpp::CompactContents
+   *
+   * This is done as soon as the contents are tokenized, so the parser and the builders
+   * already work on the compact form. All the const accessors read it directly and
+   * nothing keeps a decoded copy.
+   *
+   * @note Must only be called while no other thread has access to this session.
+   */
+  void compactContents();
   MemoryPool* mempool;
   TokenStream* token_stream;
 
@@ -146,7 +178,9 @@ public:
   void dumpNode(AST* node) const;
 
 private:
+  /// Only one of these is set, m_compactContents once the contents have been compacted
   PreprocessedContents m_contents;
+  rpp::CompactContents m_compactContents;
   rpp::LocationTable* m_locationTable;
   TranslationUnitAST * m_topAstNode;
 
@@ -0,0 +1,172 @@
+/*
+  This file is part of KDevelop
+
+  Permission to use, copy, modify, distribute, and sell this software and its
+  documentation for any purpose is hereby granted without fee, provided that
+  the above copyright notice appear in all copies and that both that
+  copyright notice and this permission notice appear in supporting
+  documentation.
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+  KDEVELOP TEAM BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "compactcontents.h"
+
+#include <language/duchain/indexedstring.h>
+
+#include "chartools.h"
+
+using namespace rpp;
+
+namespace {
+/// Followed by a single character byte that collides with the escape bytes
+const uchar escapedCharacter = 0xfe;
+/// Followed by a variable-length encoded index
+const uchar escapedIndex = 0xff;
+
+inline bool isPlainCharacter(uint index)
+{
+  return isCharacter(index) && indexFromCharacter(characterFromIndex(index)) == index;
+}
+}
+
+CompactContents::CompactContents()
+  : m_size(0)
+{
+}
+
+CompactContents::CompactContents(const PreprocessedContents& contents)
+  : m_size(contents.size())
+{
+  m_data.reserve(contents.size() + contents.size() / 4);
+  m_checkpoints.reserve(contents.size() / CheckpointDistance + 1);
+
+  for (int a = 0; a < contents.size(); ++a) {
+    if (a % CheckpointDistance == 0)
+      m_checkpoints.append(m_data.size());
+
+    const uint index = contents.at(a);
+    if (isPlainCharacter(index)) {
+      const uchar character = static_cast<uchar>(characterFromIndex(index));
+      if (character >= escapedCharacter)
+        m_data.append(static_cast<char>(escapedCharacter));
+      m_data.append(static_cast<char>(character));
+    } else {
+      m_data.append(static_cast<char>(escapedIndex));
+      // seven bits per byte, the highest bit marks that more bytes follow
+      uint value = index;
+      while (value >= 0x80) {
+        m_data.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+      }
+      m_data.append(static_cast<char>(value));
+    }
+  }
+
+  m_data.squeeze();
+  m_checkpoints.squeeze();
+}
+
+CompactContents::ConstIterator::ConstIterator(const CompactContents* contents, int index, const char* data)
+  : m_contents(contents)
+  , m_index(index)
+  , m_data(data)
+  , m_value(0)
+{
+  decode();
+}
+
+void CompactContents::ConstIterator::decode()
+{
+  if (m_index >= m_contents->m_size)
+    return;
+
+  uchar byte = static_cast<uchar>(*m_data++);
+  if (byte == escapedIndex) {
+    m_value = 0;
+    int shift = 0;
+    do {
+      byte = static_cast<uchar>(*m_data++);
+      m_value |= static_cast<uint>(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+  } else {
+    if (byte == escapedCharacter)
+      byte = static_cast<uchar>(*m_data++);
+    m_value = indexFromCharacter(static_cast<char>(byte));
+  }
+}
+
+CompactContents::ConstIterator CompactContents::begin() const
+{
+  return ConstIterator(this, 0, m_data.constData());
+}
+
+CompactContents::ConstIterator CompactContents::end() const
+{
+  return ConstIterator(this, m_size, m_data.constData() + m_data.size());
+}
+
+CompactContents::ConstIterator CompactContents::iteratorAt(int offset) const
+{
+  Q_ASSERT(offset >= 0 && offset <= m_size);
+  if (offset == m_size)
+    return end();
+
+  const int checkpoint = offset / CheckpointDistance;
+  ConstIterator it(this, checkpoint * CheckpointDistance, m_data.constData() + m_checkpoints.at(checkpoint));
+  while (it.m_index < offset)
+    ++it;
+  return it;
+}
+
+uint CompactContents::at(int offset) const
+{
+  return *iteratorAt(offset);
+}
+
+int CompactContents::size() const
+{
+  return m_size;
+}
+
+bool CompactContents::isEmpty() const
+{
+  return m_size == 0;
+}
+
+QByteArray CompactContents::toByteArray(int offset, int count) const
+{
+  QByteArray ret;
+  const int endOffset = count ? offset + count : m_size;
+  for (ConstIterator it = iteratorAt(offset); it.offset() < endOffset; ++it) {
+    if (isCharacter(*it))
+      ret.append(characterFromIndex(*it));
+    else
+      ret += KDevelop::IndexedString::fromIndex(*it).byteArray();
+  }
+  return ret;
+}
+
+PreprocessedContents CompactContents::toPreprocessedContents() const
+{
+  PreprocessedContents ret;
+  ret.resize(m_size);
+  uint* target = ret.data();
+  for (ConstIterator it = begin(); it != end(); ++it)
+    *target++ = *it;
+  return ret;
+}
+
+int CompactContents::byteSize() const
+{
+  return m_data.size() + m_checkpoints.size() * sizeof(uint);
+}
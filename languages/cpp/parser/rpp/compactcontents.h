@@ -0,0 +1,120 @@
+/*
+  This file is part of KDevelop
+
+  Permission to use, copy, modify, distribute, and sell this software and its
+  documentation for any purpose is hereby granted without fee, provided that
+  the above copyright notice appear in all copies and that both that
+  copyright notice and this permission notice appear in supporting
+  documentation.
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+  KDEVELOP TEAM BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+  AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+  CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef COMPACTCONTENTS_H
+#define COMPACTCONTENTS_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <cppparserexport.h>
+
+typedef QVector<unsigned int> PreprocessedContents;
+
+namespace rpp {
+
+/**
+ * A read-only, variable-width encoding of PreprocessedContents.
+ *
+ * Plain characters take a single byte, IndexedString indices are stored
+ * behind an escape byte as variable-length integers. Compared to the four
+ * bytes per item of PreprocessedContents this usually cuts the size by
+ * a factor of three or more.
+ *
+ * Sequential access goes through ConstIterator. Random access via at() is
+ * supported through a checkpoint every CheckpointDistance items. The parser
+ * looks up single tokens that way, so the checkpoints are kept close.
+ */
+class KDEVCPPRPP_EXPORT CompactContents
+{
+  public:
+    CompactContents();
+    explicit CompactContents(const PreprocessedContents& contents);
+
+    class ConstIterator
+    {
+      public:
+        uint operator*() const
+        {
+          return m_value;
+        }
+        ConstIterator& operator++()
+        {
+          ++m_index;
+          decode();
+          return *this;
+        }
+        bool operator==(const ConstIterator& rhs) const
+        {
+          return m_index == rhs.m_index;
+        }
+        bool operator!=(const ConstIterator& rhs) const
+        {
+          return m_index != rhs.m_index;
+        }
+        /// @return the offset of the current item in the original contents
+        int offset() const
+        {
+          return m_index;
+        }
+
+      private:
+        friend class CompactContents;
+        ConstIterator(const CompactContents* contents, int index, const char* data);
+        void decode();
+
+        const CompactContents* m_contents;
+        int m_index;
+        const char* m_data;
+        uint m_value;
+    };
+
+    ConstIterator begin() const;
+    ConstIterator end() const;
+    /// @return an iterator pointing at the item with @p offset
+    ConstIterator iteratorAt(int offset) const;
+
+    uint at(int offset) const;
+    int size() const;
+    bool isEmpty() const;
+
+    /// @return the text of @p count items starting at @p offset, see stringFromContents()
+    QByteArray toByteArray(int offset = 0, int count = 0) const;
+
+    /// Decodes everything back into the uncompressed form
+    PreprocessedContents toPreprocessedContents() const;
+
+    /// @return the number of bytes used by the encoded data
+    int byteSize() const;
+
+    enum {
+      CheckpointDistance = 16
+    };
+
+  private:
+    QByteArray m_data;
+    /// Byte offset of every CheckpointDistance'th item
+    QVector<uint> m_checkpoints;
+    int m_size;
+};
+
+}
+
+#endif // COMPACTCONTENTS_H
@@ -0,0 +1,279 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License version 2 as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "pp-directivescanner.h"
+
+#include <QFile>
+
+#include <string.h>
+
+namespace {
+
+inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+}
+
+inline bool isIdentifierCharacter(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+inline bool equals(const char* begin, const char* end, const char* text)
+{
+  const int length = strlen(text);
+  return end - begin == length && strncmp(begin, text, length) == 0;
+}
+
+/// State of the include-guard detection, see pp::handle_ifdef for the rules the preprocessor uses
+enum GuardState {
+  /// No directive or code has been seen yet
+  ExpectIfndef,
+  /// "#ifndef X" was the first thing in the file
+  ExpectDefine,
+  /// Within the guarded block
+  InGuard,
+  /// The "#endif" of the guard has been seen, only comments may follow
+  AfterGuard,
+  /// The file is not guarded
+  NoGuard
+};
+
+class Scanner
+{
+public:
+  Scanner(const char* data, int size)
+    : p(data), end(data + size), line(0), depth(0), guardState(ExpectIfndef)
+  {
+  }
+
+  rpp::FileDirectives run();
+
+private:
+  void skipBlanks()
+  {
+    while (p < end && isBlank(*p))
+      ++p;
+  }
+
+  void readIdentifier(const char** begin, const char** identifierEnd)
+  {
+    *begin = p;
+    while (p < end && isIdentifierCharacter(*p))
+      ++p;
+    *identifierEnd = p;
+  }
+
+  /// Skip to the end of the line, following escaped newlines
+  void skipLine()
+  {
+    while (p < end && *p != '\n') {
+      if (*p == '\\' && p + 1 < end && p[1] == '\n') {
+        ++line;
+        ++p;
+      }
+      ++p;
+    }
+  }
+
+  void sawCode()
+  {
+    if (guardState != InGuard)
+      guardState = NoGuard;
+  }
+
+  void directive();
+
+  const char* p;
+  const char* const end;
+  int line;
+  int depth;
+  GuardState guardState;
+  QByteArray guardCandidate;
+  /// The #if nesting depth of each include, the guard is only known at the end
+  QList<int> includeDepths;
+  rpp::FileDirectives result;
+};
+
+rpp::FileDirectives Scanner::run()
+{
+  bool atLineStart = true;
+
+  while (p < end) {
+    const char c = *p;
+
+    if (c == '\n') {
+      ++line;
+      atLineStart = true;
+      ++p;
+    } else if (isBlank(c)) {
+      ++p;
+    } else if (c == '/' && p + 1 < end && p[1] == '/') {
+      while (p < end && *p != '\n')
+        ++p;
+    } else if (c == '/' && p + 1 < end && p[1] == '*') {
+      p += 2;
+      while (p < end && !(*p == '*' && p + 1 < end && p[1] == '/')) {
+        if (*p == '\n')
+          ++line;
+        ++p;
+      }
+      p += 2;
+    } else if (c == '"' || c == '\'') {
+      // Literals may contain comment-starts
+      sawCode();
+      ++p;
+      while (p < end && *p != c && *p != '\n') {
+        if (*p == '\\' && p + 1 < end)
+          ++p;
+        ++p;
+      }
+      ++p;
+      atLineStart = false;
+    } else if (c == '#' && atLineStart) {
+      ++p;
+      directive();
+      atLineStart = false;
+    } else {
+      sawCode();
+      atLineStart = false;
+      ++p;
+    }
+  }
+
+  if (guardState == AfterGuard)
+    result.headerGuard = guardCandidate;
+
+  const int guardDepth = result.headerGuard.isEmpty() ? 0 : 1;
+  for (int i = 0; i < result.includes.size(); ++i)
+    result.includes[i].conditional = includeDepths.at(i) > guardDepth;
+
+  return result;
+}
+
+void Scanner::directive()
+{
+  skipBlanks();
+  const char* name;
+  const char* nameEnd;
+  readIdentifier(&name, &nameEnd);
+  skipBlanks();
+
+  if (equals(name, nameEnd, "include") || equals(name, nameEnd, "include_next")) {
+    sawCode();
+    if (p < end && (*p == '<' || *p == '"')) {
+      const char close = *p == '<' ? '>' : '"';
+      const char* included = ++p;
+      while (p < end && *p != close && *p != '\n')
+        ++p;
+      if (p < end && *p == close) {
+        rpp::IncludeDirective include;
+        include.name = QString::fromUtf8(included, p - included);
+        include.type = close == '"' ? rpp::Preprocessor::IncludeLocal : rpp::Preprocessor::IncludeGlobal;
+        include.line = line;
+        include.includeNext = nameEnd - name == 12;
+        result.includes << include;
+        includeDepths << depth;
+      }
+    }
+  } else if (equals(name, nameEnd, "ifndef")) {
+    const char* macro;
+    const char* macroEnd;
+    readIdentifier(&macro, &macroEnd);
+    if (guardState == ExpectIfndef && macro != macroEnd) {
+      guardCandidate = QByteArray(macro, macroEnd - macro);
+      guardState = ExpectDefine;
+    } else {
+      sawCode();
+    }
+    ++depth;
+  } else if (equals(name, nameEnd, "define")) {
+    const char* macro;
+    const char* macroEnd;
+    readIdentifier(&macro, &macroEnd);
+    if (guardState == ExpectDefine) {
+      guardState = QByteArray::fromRawData(macro, macroEnd - macro) == guardCandidate ? InGuard : NoGuard;
+    } else {
+      sawCode();
+    }
+  } else if (equals(name, nameEnd, "if") || equals(name, nameEnd, "ifdef")) {
+    sawCode();
+    ++depth;
+  } else if (equals(name, nameEnd, "endif")) {
+    if (depth > 0)
+      --depth;
+    if (guardState == InGuard && depth == 0)
+      guardState = AfterGuard;
+    else
+      sawCode();
+  } else if (equals(name, nameEnd, "pragma")) {
+    const char* argument;
+    const char* argumentEnd;
+    readIdentifier(&argument, &argumentEnd);
+    if (equals(argument, argumentEnd, "once"))
+      result.pragmaOnce = true;
+    sawCode();
+  } else if (equals(name, nameEnd, "else") || equals(name, nameEnd, "elif")) {
+    // An alternative to the guarded block means that the file is not guarded completely
+    if (guardState == InGuard && depth == 1)
+      guardState = NoGuard;
+    sawCode();
+  } else {
+    // #undef, #error, ...
+    sawCode();
+  }
+
+  skipLine();
+}
+
+}
+
+namespace rpp {
+
+FileDirectives scanDirectives(const char* data, int size)
+{
+  return Scanner(data, size).run();
+}
+
+FileDirectives scanDirectives(const QByteArray& contents)
+{
+  return scanDirectives(contents.constData(), contents.size());
+}
+
+bool scanFileDirectives(const QString& fileName, FileDirectives* result)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  const qint64 size = file.size();
+  if (size == 0) {
+    *result = FileDirectives();
+    return true;
+  }
+
+  if (uchar* data = file.map(0, size)) {
+    *result = scanDirectives(reinterpret_cast<const char*>(data), size);
+    file.unmap(data);
+    return true;
+  }
+
+  // Mapping is not supported for all files, for example on some network file-systems
+  *result = scanDirectives(file.readAll());
+  return true;
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License version 2 as published by the Free Software Foundation.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifndef PP_DIRECTIVESCANNER_H
+#define PP_DIRECTIVESCANNER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include <cppparserexport.h>
+
+#include "preprocessor.h"
+
+namespace rpp {
+
+struct IncludeDirective
+{
+  IncludeDirective() : type(Preprocessor::IncludeGlobal), line(0), includeNext(false), conditional(false) {
+  }
+
+  ///The included name as written, without the quotes or angle brackets
+  QString name;
+  Preprocessor::IncludeType type;
+  int line;
+  bool includeNext;
+  ///Whether the directive is within an #if/#ifdef/#ifndef block, not counting the include-guard
+  bool conditional;
+};
+
+struct FileDirectives
+{
+  FileDirectives() : pragmaOnce(false) {
+  }
+
+  QList<IncludeDirective> includes;
+  ///The macro of an #ifndef/#define/#endif guard that wraps the whole file, empty if there is none
+  QByteArray headerGuard;
+  bool pragmaOnce;
+};
+
+/**
+ * Extracts the directives that are relevant for the include-graph from a file, without preprocessing it:
+ * #include and #include_next, the #if nesting they are in, the include-guard, and "#pragma once".
+ *
+ * Only comments and literals are recognized in the body. Conditions are not evaluated and macros are
+ * not expanded, so the result is an approximation of what the preprocessor will include.
+ * Includes through macros like "#include MY_HEADER" are not reported.
+ */
+KDEVCPPRPP_EXPORT FileDirectives scanDirectives(const char* data, int size);
+
+KDEVCPPRPP_EXPORT FileDirectives scanDirectives(const QByteArray& contents);
+
+/**
+ * Memory-maps @p fileName and scans it through scanDirectives(..).
+ * @return false if the file could not be read
+ */
+KDEVCPPRPP_EXPORT bool scanFileDirectives(const QString& fileName, FileDirectives* result);
+
+}
+
+#endif // PP_DIRECTIVESCANNER_H
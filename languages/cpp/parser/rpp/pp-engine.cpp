@@ -112,6 +112,7 @@ void pp::handle_directive(uint directive, Stream& input, Stream& output)
   static const uint defineDirective = KDevelop::IndexedString("define").index();
   static const uint includeDirective = KDevelop::IndexedString("include").index();
   static const uint includeNextDirective = KDevelop::IndexedString("include_next").index();
+  static const uint pragmaDirective = KDevelop::IndexedString("pragma").index();
 
   skip_blanks (input, output);
   while (!input.atEnd() && input != '\n' && input == '/' && input.peekNextCharacter() == '*')
@@ -157,6 +158,18 @@ void pp::handle_directive(uint directive, Stream& input, Stream& output)
 
   if(directive == ifndefDirective)
       return handle_ifdef(true, input);
+
+  if(directive == pragmaDirective)
+      if (! skipping ())
+        return handle_pragma(input);
+}
+
+void pp::handle_pragma(Stream& input)
+{
+  static const uint onceText = KDevelop::IndexedString("once").index();
+
+  if (skip_identifier(input) == onceText)
+    m_preprocessor->foundPragmaOnce(input);
 }
 
 void pp::handle_include(bool skip_current_path, Stream& input, Stream& output)
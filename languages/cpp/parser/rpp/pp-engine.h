@@ -256,6 +256,8 @@ private:
 
   void handle_undef(Stream& input);
 
+  void handle_pragma(Stream& input);
+
   int next_token (Stream& input);
   int next_token_accept (Stream& input);
   void accept_token();
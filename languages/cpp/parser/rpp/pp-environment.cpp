@@ -58,6 +58,7 @@ LocationTable* Environment::takeLocationTable()
 
 void Environment::swapMacros( Environment* parentEnvironment ) {
   qSwap(m_environment, parentEnvironment->m_environment);
+  qSwap(m_macroFilter, parentEnvironment->m_macroFilter);
 
   qSwap(m_ownedMacros, parentEnvironment->m_ownedMacros);
 }
@@ -72,20 +73,33 @@ void Environment::setMacro(pp_macro* macro)
   if(!macro->isRepositoryMacro())
     m_ownedMacros.append(macro);
 
+  addToMacroFilter(macro->name.index());
   m_environment.insert(macro->name, macro);
 }
 
 void Environment::insertMacro(pp_macro* macro)
 {
+  addToMacroFilter(macro->name.index());
   m_environment.insert(macro->name, macro);
 }
 
+void Environment::addToMacroFilter(uint nameIndex)
+{
+  if(m_macroFilter.isEmpty())
+    m_macroFilter.fill(0, (1 << MacroFilterBits) / 32);
+
+  const uint bit = macroFilterBit(nameIndex);
+  m_macroFilter[bit >> 5] |= 1u << (bit & 31);
+}
+
 const Environment::EnvironmentMap& Environment::environment() const {
   return m_environment;
 }
 
 pp_macro* Environment::retrieveStoredMacro(const KDevelop::IndexedString& name) const
 {
+  if(!mayHaveMacro(name.index()))
+    return nullptr;
   return m_environment.value(name, nullptr);
 }
 
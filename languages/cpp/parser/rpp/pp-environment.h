@@ -26,6 +26,7 @@
 #include <QMap>
 
 #include <QStack>
+#include <QVector>
 #include <cppparserexport.h>
 // #include "pp-macro.h"
 
@@ -73,8 +74,32 @@ public:
   LocationTable* locationTable() const;
   LocationTable* takeLocationTable();
 
+  /**
+   * Quick negative check for macro lookups, without touching the macro hash.
+   * @return false if no macro with the given IndexedString index was ever stored in this environment,
+   *         true if there may be one.
+   */
+  inline bool mayHaveMacro(uint nameIndex) const {
+    if(m_macroFilter.isEmpty())
+      return false;
+    const uint bit = macroFilterBit(nameIndex);
+    return m_macroFilter.at(bit >> 5) & (1u << (bit & 31));
+  }
+
 private:
+  enum {
+    MacroFilterBits = 17
+  };
+
+  static inline uint macroFilterBit(uint nameIndex) {
+    return (nameIndex * 2654435761u) >> (32 - MacroFilterBits);
+  }
+
+  void addToMacroFilter(uint nameIndex);
+
   EnvironmentMap m_environment;
+  //Bitmap over the names in m_environment, bits are never cleared so removed macros may give false positives
+  QVector<uint> m_macroFilter;
 
   QVector<pp_macro*> m_ownedMacros;
   LocationTable* m_locationTable;
@@ -21,9 +21,11 @@
 
 #include <pp-location.h>
 #include <QStringList>
+#include <algorithm>
 #include <kdebug.h>
 #include <language/duchain/indexedstring.h>
 #include "chartools.h"
+#include "compactcontents.h"
 
 using namespace rpp;
 
@@ -33,7 +35,8 @@ bool LocationTable::AnchorInTable::operator==(const LocationTable::AnchorInTable
 }
 
 LocationTable::LocationTable()
-  : m_positionAtLastOffset(-1)
+  : m_currentIndex(0)
+  , m_positionAtLastOffset(-1)
 {
   anchor(0, Anchor(0,0), 0);
 }
@@ -43,7 +46,8 @@ static const std::size_t EMPTY_CACHE = -1;
 }
 
 LocationTable::LocationTable(const PreprocessedContents& contents)
-  : m_positionAtLastOffset(EMPTY_CACHE)
+  : m_currentIndex(0)
+  , m_positionAtLastOffset(EMPTY_CACHE)
 {
   anchor(0, Anchor(0,0), 0);
 
@@ -55,17 +59,37 @@ LocationTable::LocationTable(const PreprocessedContents& contents)
       anchor(i + 1, Anchor(++line, 0), 0);
 }
 
-QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const PreprocessedContents& contents, bool collapseIfMacroExpansion) const
+namespace {
+/// @return the length in the original source of the items from @p begin up to @p end
+inline int columnLength(const PreprocessedContents& contents, std::size_t begin, std::size_t end)
+{
+  int ret = 0;
+  for(std::size_t a = begin; a < end; ++a)
+    ret += KDevelop::IndexedString::lengthFromIndex(contents[a]);
+  return ret;
+}
+
+inline int columnLength(const CompactContents& contents, std::size_t begin, std::size_t end)
+{
+  int ret = 0;
+  end = qMin(end, static_cast<std::size_t>(contents.size()));
+  if(begin >= end)
+    return ret;
+  for(CompactContents::ConstIterator it = contents.iteratorAt(begin); static_cast<std::size_t>(it.offset()) < end; ++it)
+    ret += KDevelop::IndexedString::lengthFromIndex(*it);
+  return ret;
+}
+}
+
+template<class Contents>
+QPair<rpp::Anchor, uint> LocationTable::positionAtInContents(std::size_t offset, const Contents& contents, bool collapseIfMacroExpansion) const
 {
   AnchorInTable ret = anchorForOffset(offset, collapseIfMacroExpansion);
 
   // NOTE: when the cache is empty all the members of m_lastAnchorInTable will be uninitialized.
   if (m_positionAtLastOffset != EMPTY_CACHE && m_lastAnchorInTable == ret && offset >= m_positionAtLastOffset) {
     // use cached position
-    ret.anchor.column = m_positionAtColumnCache;
-
-    for(std::size_t a = m_positionAtLastOffset; a < offset; ++a)
-      ret.anchor.column += KDevelop::IndexedString::lengthFromIndex(contents[a]);
+    ret.anchor.column = m_positionAtColumnCache + columnLength(contents, m_positionAtLastOffset, offset);
 
     m_positionAtColumnCache = ret.anchor.column;
     m_positionAtLastOffset = offset;
@@ -73,8 +97,7 @@ QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const Pre
     // save anchor _before_ changing it's members
     m_lastAnchorInTable = ret;
 
-    for(std::size_t a = ret.position; a < offset; ++a)
-      ret.anchor.column += KDevelop::IndexedString::lengthFromIndex(contents[a]);
+    ret.anchor.column += columnLength(contents, ret.position, offset);
 
     m_positionAtColumnCache = ret.anchor.column;
     m_positionAtLastOffset = offset;
@@ -89,6 +112,16 @@ QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const Pre
   return qMakePair(ret.anchor, room);
 }
 
+QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const PreprocessedContents& contents, bool collapseIfMacroExpansion) const
+{
+  return positionAtInContents(offset, contents, collapseIfMacroExpansion);
+}
+
+QPair<rpp::Anchor, uint> LocationTable::positionAt(std::size_t offset, const CompactContents& contents, bool collapseIfMacroExpansion) const
+{
+  return positionAtInContents(offset, contents, collapseIfMacroExpansion);
+}
+
 void LocationTable::anchor(std::size_t offset, Anchor anchor, const PreprocessedContents* contents)
 {
   Q_ASSERT(!offset || !anchor.column || contents);
@@ -99,91 +132,121 @@ void LocationTable::anchor(std::size_t offset, Anchor anchor, const Preprocessed
     if (known.first == anchor && known.first.macroExpansion == anchor.macroExpansion)
       return;
   }
-  m_currentOffset = OffsetTable::ConstIterator(m_offsetTable.insert(offset, anchor));
+
+  const PackedAnchor packed = pack(anchor);
+
+  if (m_offsets.isEmpty() || m_offsets.last() < offset) {
+    // common case, the preprocessor moves forward
+    m_offsets.append(offset);
+    m_anchors.append(packed);
+    m_currentIndex = m_offsets.size() - 1;
+    return;
+  }
+
+  const uint* begin = m_offsets.constData();
+  const int index = std::lower_bound(begin, begin + m_offsets.size(), static_cast<uint>(offset)) - begin;
+  if (m_offsets.at(index) == offset) {
+    m_anchors[index] = packed;
+  } else {
+    m_offsets.insert(index, offset);
+    m_anchors.insert(index, packed);
+  }
+  m_currentIndex = index;
 }
 
-LocationTable::AnchorInTable LocationTable::anchorForOffset(std::size_t offset, bool collapseIfMacroExpansion) const
+LocationTable::PackedAnchor LocationTable::pack(const Anchor& anchor)
+{
+  PackedAnchor ret;
+  ret.line = anchor.line;
+  ret.column = anchor.column;
+  ret.flags = anchor.collapsed ? CollapsedFlag : 0;
+  if (anchor.macroExpansion.isValid()) {
+    // consecutive anchors usually come from the same expansion, so check the last one before hashing
+    uint index;
+    if (!m_macroExpansions.isEmpty() && m_macroExpansions.last() == anchor.macroExpansion) {
+      index = m_macroExpansions.size();
+    } else {
+      const quint64 key = (static_cast<quint64>(static_cast<uint>(anchor.macroExpansion.line)) << 32)
+                          | static_cast<uint>(anchor.macroExpansion.column);
+      index = m_macroExpansionIndices.value(key);
+      if (!index) {
+        m_macroExpansions.append(anchor.macroExpansion);
+        index = m_macroExpansions.size();
+        m_macroExpansionIndices.insert(key, index);
+      }
+    }
+    Q_ASSERT(index <= MacroExpansionMask);
+    ret.flags |= index;
+  }
+  return ret;
+}
+
+Anchor LocationTable::unpack(const PackedAnchor& packed) const
+{
+  const uint macroExpansion = packed.flags & MacroExpansionMask;
+  return Anchor(packed.line, packed.column, packed.flags & CollapsedFlag,
+                macroExpansion ? m_macroExpansions.at(macroExpansion - 1) : KDevelop::CursorInRevision::invalid());
+}
+
+int LocationTable::indexForOffset(uint offset) const
 {
-  // Look nearby for a match first
-  QMap<std::size_t, Anchor>::ConstIterator constEnd = m_offsetTable.constEnd();
+  const uint* offsets = m_offsets.constData();
+  const int count = m_offsets.size();
+  Q_ASSERT(count && offsets[0] <= offset);
 
-  if (m_currentOffset != constEnd) {
-    std::size_t current = m_currentOffset.key();
-    bool checkForwards = (current < offset);
+  // Look nearby for a match first, the parser mostly asks for increasing offsets
+  int index = m_currentIndex;
+  if (index < count && offsets[index] <= offset) {
     // TODO check for optimal number of iterations
     for (int i = 0; i < 5; ++i) {
-      if (checkForwards) {
-        if (m_currentOffset + 1 == constEnd)
-          // Special case
-          goto done;
-
-        ++m_currentOffset;
-        if (m_currentOffset != constEnd) {
-          if (m_currentOffset.key() > offset) {
-            // Gone forwards too much, but one back is correct
-            --m_currentOffset;
-            goto done;
-          }
-
-        } else {
-          break;
-        }
-
-      } else {
-        if (m_currentOffset == m_offsetTable.constBegin())
-          // Special case
-          goto done;
-
-        ++m_currentOffset;
-        if (m_currentOffset != constEnd) {
-          if (m_currentOffset.key() < offset) {
-            // Correct position :)
-            goto done;
-          }
-        } else {
-          break;
-        }
-      }
+      if (index + 1 == count || offsets[index + 1] > offset)
+        return index;
+      ++index;
     }
   }
 
-  m_currentOffset = m_offsetTable.lowerBound(offset);
-  //kDebug() << k_funcinfo << offset << "found" << m_currentOffset.key();
-  if (m_currentOffset == constEnd)
-    --m_currentOffset;
-
-  if (m_currentOffset.key() > offset)
-    --m_currentOffset;
+  // Binary search for the last offset that is not bigger, without branching on the comparison
+  const uint* base = offsets;
+  int n = count;
+  while (n > 1) {
+    const int half = n / 2;
+    base = (base[half] <= offset) ? base + half : base;
+    n -= half;
+  }
+  return base - offsets;
+}
 
-  done:
-  Q_ASSERT(m_currentOffset != constEnd);
-  Anchor ret = m_currentOffset.value();
-  if(ret.macroExpansion.isValid() && collapseIfMacroExpansion)
-    ret.collapsed = true;
+LocationTable::AnchorInTable LocationTable::anchorForOffset(std::size_t offset, bool collapseIfMacroExpansion) const
+{
+  const int index = indexForOffset(offset);
+  m_currentIndex = index;
 
   AnchorInTable retItem;
-  retItem.position = m_currentOffset.key();
-  retItem.anchor = ret;
-
-  ++m_currentOffset;
+  retItem.position = m_offsets.at(index);
+  retItem.anchor = unpack(m_anchors.at(index));
+  if(retItem.anchor.macroExpansion.isValid() && collapseIfMacroExpansion)
+    retItem.anchor.collapsed = true;
 
-  if(m_currentOffset == constEnd) {
+  if(index + 1 == m_offsets.size()) {
     retItem.nextPosition = 0;
   }else{
-    retItem.nextPosition = m_currentOffset.key();
-    retItem.nextAnchor = m_currentOffset.value();
+    retItem.nextPosition = m_offsets.at(index + 1);
+    retItem.nextAnchor = unpack(m_anchors.at(index + 1));
   }
 
   return retItem;
 }
 
+int LocationTable::size() const
+{
+  return m_offsets.size();
+}
+
 void LocationTable::dump() const
 {
-  QMapIterator<std::size_t, Anchor> it = m_offsetTable;
   qDebug() << "Location Table:";
-  while (it.hasNext()) {
-    it.next();
-    qDebug() << it.key() << " => " << it.value().castToSimpleCursor().textCursor();
+  for (int i = 0; i < m_offsets.size(); ++i) {
+    qDebug() << m_offsets.at(i) << " => " << unpack(m_anchors.at(i)).castToSimpleCursor().textCursor();
   }
 }
 
@@ -192,17 +255,17 @@ void LocationTable::splitByAnchors(const PreprocessedContents& text, const Ancho
   Anchor currentAnchor = Anchor(textStartPosition);
   size_t currentOffset = 0;
 
-  QMapIterator<std::size_t, Anchor> it = m_offsetTable;
+  int it = 0;
 
   while (currentOffset < (size_t)text.size())
   {
     Anchor nextAnchor(KDevelop::CursorInRevision::invalid());
     size_t nextOffset;
 
-    if(it.hasNext()) {
-      it.next();
-      nextOffset = it.key();
-      nextAnchor = it.value();
+    if(it < m_offsets.size()) {
+      nextOffset = m_offsets.at(it);
+      nextAnchor = unpack(m_anchors.at(it));
+      ++it;
     }else{
       nextOffset = text.size();
       nextAnchor = Anchor(KDevelop::CursorInRevision::invalid());
@@ -22,7 +22,8 @@
 #ifndef PP_LOCATION_H
 #define PP_LOCATION_H
 
-#include <QMap>
+#include <QHash>
+#include <QVector>
 
 #include <cppparserexport.h>
 #include "anchor.h"
@@ -31,6 +32,16 @@ typedef QVector<unsigned int> PreprocessedContents;
 
 namespace rpp {
 
+class CompactContents;
+
+/**
+ * Maps offsets in the preprocessed contents to positions in the original source.
+ *
+ * The anchors are stored in a flat array sorted by offset. Since the preprocessor
+ * emits them in increasing order, adding an anchor is an append in the common case.
+ * Lookups first try to move a cursor forward from the last lookup, which matches
+ * the access pattern of the parser, and fall back to a binary search.
+ */
 class KDEVCPPRPP_EXPORT LocationTable
 {
   public:
@@ -50,6 +61,8 @@ class KDEVCPPRPP_EXPORT LocationTable
     * Returns the found position stored in the anchor, and the possible maximum length until the next anchored position, or zero.
     */
     QPair<rpp::Anchor, uint> positionAt(std::size_t offset, const PreprocessedContents& contents, bool collapseIfMacroExpansion = false) const;
+    /// Same as above, but reads the compacted contents without decoding all of them
+    QPair<rpp::Anchor, uint> positionAt(std::size_t offset, const CompactContents& contents, bool collapseIfMacroExpansion = false) const;
 
     struct AnchorInTable {
       uint position; //Position of this anchor
@@ -76,10 +89,41 @@ class KDEVCPPRPP_EXPORT LocationTable
     * */
     void splitByAnchors(const PreprocessedContents& text, const Anchor& textStartPosition, QList<PreprocessedContents>& strings, QList<Anchor>& anchors) const;
 
+    /// @return the number of anchors in this table
+    int size() const;
+
   private:
-    typedef QMap<std::size_t, Anchor> OffsetTable;
-    OffsetTable m_offsetTable;
-    mutable OffsetTable::ConstIterator m_currentOffset;
+    /**
+     * Anchor without the macro-expansion cursor, which is instead stored once
+     * per expansion in m_macroExpansions.
+     */
+    struct PackedAnchor {
+      int line;
+      int column;
+      /// Lowest 31 bits: index + 1 into m_macroExpansions, or zero. Highest bit: collapsed.
+      uint flags;
+    };
+
+    enum {
+      CollapsedFlag = 0x80000000u,
+      MacroExpansionMask = 0x7fffffffu
+    };
+
+    PackedAnchor pack(const Anchor& anchor);
+    Anchor unpack(const PackedAnchor& packed) const;
+    /// @return the index of the last anchor with an offset smaller than or equal to @p offset
+    int indexForOffset(uint offset) const;
+    template<class Contents>
+    QPair<rpp::Anchor, uint> positionAtInContents(std::size_t offset, const Contents& contents, bool collapseIfMacroExpansion) const;
+
+    /// Offsets of the anchors, sorted. Kept separate from the anchors so the search touches less memory.
+    QVector<uint> m_offsets;
+    QVector<PackedAnchor> m_anchors;
+    QVector<KDevelop::CursorInRevision> m_macroExpansions;
+    /// Index + 1 into m_macroExpansions by line and column, so each expansion cursor is stored once
+    QHash<quint64, uint> m_macroExpansionIndices;
+    /// Index of the anchor found by the last lookup
+    mutable int m_currentIndex;
     //cache for positionAt
     mutable AnchorInTable m_lastAnchorInTable;
     mutable int m_positionAtColumnCache;
@@ -66,3 +66,7 @@ void Preprocessor::headerSectionEnded(rpp::Stream& stream)
 void Preprocessor::foundHeaderGuard(rpp::Stream& /*stream*/, KDevelop::IndexedString /*guardName*/)
 {
 }
+
+void Preprocessor::foundPragmaOnce(rpp::Stream& /*stream*/)
+{
+}
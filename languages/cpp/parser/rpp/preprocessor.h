@@ -76,6 +76,11 @@ public:
      * Is called when a header-guard protection has been detected for the currently processed file
      * */
     virtual void foundHeaderGuard(rpp::Stream& stream, KDevelop::IndexedString guardName);
+
+    /**
+     * Is called when a "#pragma once" directive has been found in the currently processed file
+     * */
+    virtual void foundPragmaOnce(rpp::Stream& stream);
 };
 
 }
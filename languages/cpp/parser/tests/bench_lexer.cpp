@@ -0,0 +1,132 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "bench_lexer.h"
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "control.h"
+#include "lexer.h"
+#include "lexerscan.h"
+#include "parsesession.h"
+#include "rpp/preprocessor.h"
+#include "rpp/pp-engine.h"
+
+#include "testconfig.h"
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+QTEST_MAIN(BenchLexer)
+
+Q_DECLARE_METATYPE(ParseSession*)
+
+namespace {
+
+QStringList corpusFiles()
+{
+  const QByteArray fromEnv = qgetenv("KDEV_LEXER_BENCHMARK_FILES");
+  if (!fromEnv.isEmpty()) {
+    return QString::fromLocal8Bit(fromEnv).split(':', QString::SkipEmptyParts);
+  }
+
+  QStringList candidates;
+  candidates << QString(QT_INCLUDE_DIR "/QtCore/qobject.h")
+             << QString(QT_INCLUDE_DIR "/QtCore/qglobal.h")
+             << QString(QT_INCLUDE_DIR "/QtGui/qwidget.h")
+             << "/usr/include/boost/spirit/home/qi/nonterminal/rule.hpp"
+             << "/usr/include/boost/variant/variant.hpp";
+  QDir stlRoot("/usr/include/c++");
+  foreach(const QString& version, stlRoot.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+    candidates << stlRoot.filePath(version + "/bits/stl_algo.h")
+               << stlRoot.filePath(version + "/bits/basic_string.h");
+    break;
+  }
+
+  QStringList ret;
+  foreach(const QString& file, candidates) {
+    if (QFile::exists(file)) {
+      ret << file;
+    }
+  }
+  return ret;
+}
+
+}
+
+void BenchLexer::initTestCase()
+{
+  KDevelop::AutoTestShell::init(QStringList() << "kdevcppsupport");
+  KDevelop::TestCore* core = new KDevelop::TestCore();
+  core->initialize(KDevelop::Core::NoUi);
+
+  qDebug() << "scan kernel:" << LexerScan::kernelName();
+
+  foreach(const QString& fileName, corpusFiles()) {
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly)) {
+      continue;
+    }
+    rpp::Preprocessor preprocessor;
+    rpp::pp pp(&preprocessor);
+    ParseSession* session = new ParseSession;
+    session->setUrl(KDevelop::IndexedString(fileName));
+    session->setContentsAndGenerateLocationTable(pp.processFile(fileName, file.readAll()));
+    m_sessions << session;
+  }
+}
+
+void BenchLexer::cleanupTestCase()
+{
+  qDeleteAll(m_sessions);
+  m_sessions.clear();
+  KDevelop::TestCore::shutdown();
+}
+
+void BenchLexer::benchTokenize_data()
+{
+  QTest::addColumn<ParseSession*>("session");
+
+  foreach(ParseSession* session, m_sessions) {
+    QTest::newRow(qPrintable(session->url().str())) << session;
+  }
+}
+
+void BenchLexer::benchTokenize()
+{
+  QFETCH(ParseSession*, session);
+
+  Control control;
+  Lexer lexer(&control);
+  qint64 tokens = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QBENCHMARK {
+    delete session->token_stream;
+    session->token_stream = new TokenStream(session);
+    lexer.tokenize(session);
+    tokens += session->token_stream->size();
+  }
+  const qint64 elapsed = timer.elapsed();
+  if (elapsed) {
+    qDebug() << session->url().str() << session->size() << "indices," << session->token_stream->size()
+             << "tokens," << (tokens * 1000 / elapsed) << "tokens/sec";
+  }
+}
+
+#include "bench_lexer.moc"
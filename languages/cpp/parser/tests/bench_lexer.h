@@ -0,0 +1,48 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef BENCH_LEXER_H
+#define BENCH_LEXER_H
+
+#include <QObject>
+#include <QStringList>
+
+class ParseSession;
+
+/**
+ * Measures the throughput of Lexer::tokenize over a corpus of large headers.
+ *
+ * The corpus is taken from the colon separated list of files in the
+ * KDEV_LEXER_BENCHMARK_FILES environment variable. If that is not set,
+ * a few big Qt, Boost and STL headers are searched in the usual locations.
+ */
+class BenchLexer : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void benchTokenize_data();
+  void benchTokenize();
+
+private:
+  QList<ParseSession*> m_sessions;
+};
+
+#endif // BENCH_LEXER_H
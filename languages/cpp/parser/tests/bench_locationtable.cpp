@@ -0,0 +1,344 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "bench_locationtable.h"
+
+#include <QtTest/QtTest>
+#include <QMap>
+
+#include "rpp/chartools.h"
+#include "rpp/pp-location.h"
+
+#include <language/duchain/indexedstring.h>
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+QTEST_MAIN(BenchLocationTable)
+
+using rpp::Anchor;
+using KDevelop::CursorInRevision;
+
+namespace {
+
+/// The QMap based table that rpp::LocationTable replaced, as it was
+class OldLocationTable
+{
+public:
+  OldLocationTable()
+    : m_positionAtLastOffset(EmptyCache)
+  {
+    anchor(0, Anchor(0,0), 0);
+  }
+
+  QPair<Anchor, uint> positionAt(std::size_t offset, const PreprocessedContents& contents) const
+  {
+    rpp::LocationTable::AnchorInTable ret = anchorForOffset(offset);
+
+    if (m_positionAtLastOffset != EmptyCache && m_lastAnchorInTable == ret && offset >= m_positionAtLastOffset) {
+      ret.anchor.column = m_positionAtColumnCache;
+      for(std::size_t a = m_positionAtLastOffset; a < offset; ++a)
+        ret.anchor.column += KDevelop::IndexedString::lengthFromIndex(contents[a]);
+      m_positionAtColumnCache = ret.anchor.column;
+      m_positionAtLastOffset = offset;
+    } else if(!ret.anchor.collapsed) {
+      m_lastAnchorInTable = ret;
+      for(std::size_t a = ret.position; a < offset; ++a)
+        ret.anchor.column += KDevelop::IndexedString::lengthFromIndex(contents[a]);
+      m_positionAtColumnCache = ret.anchor.column;
+      m_positionAtLastOffset = offset;
+    }
+
+    uint room = 0;
+    if(ret.nextPosition)
+      if(ret.nextAnchor.line == ret.anchor.line && ret.nextAnchor.column > ret.anchor.column)
+        room = ret.nextAnchor.column - ret.anchor.column;
+
+    return qMakePair(ret.anchor, room);
+  }
+
+  void anchor(std::size_t offset, Anchor anchor, const PreprocessedContents* contents)
+  {
+    if (offset && anchor.column && !anchor.collapsed) {
+      QPair<Anchor, uint> known = positionAt(offset, *contents);
+      if (known.first == anchor && known.first.macroExpansion == anchor.macroExpansion)
+        return;
+    }
+    m_currentOffset = OffsetTable::ConstIterator(m_offsetTable.insert(offset, anchor));
+  }
+
+  rpp::LocationTable::AnchorInTable anchorForOffset(std::size_t offset, bool collapseIfMacroExpansion = false) const
+  {
+    OffsetTable::ConstIterator constEnd = m_offsetTable.constEnd();
+
+    if (m_currentOffset != constEnd) {
+      std::size_t current = m_currentOffset.key();
+      bool checkForwards = (current < offset);
+      for (int i = 0; i < 5; ++i) {
+        if (checkForwards) {
+          if (m_currentOffset + 1 == constEnd)
+            goto done;
+
+          ++m_currentOffset;
+          if (m_currentOffset != constEnd) {
+            if (m_currentOffset.key() > offset) {
+              --m_currentOffset;
+              goto done;
+            }
+          } else {
+            break;
+          }
+        } else {
+          if (m_currentOffset == m_offsetTable.constBegin())
+            goto done;
+
+          ++m_currentOffset;
+          if (m_currentOffset != constEnd) {
+            if (m_currentOffset.key() < offset) {
+              goto done;
+            }
+          } else {
+            break;
+          }
+        }
+      }
+    }
+
+    m_currentOffset = m_offsetTable.lowerBound(offset);
+    if (m_currentOffset == constEnd)
+      --m_currentOffset;
+
+    if (m_currentOffset.key() > offset)
+      --m_currentOffset;
+
+    done:
+    Anchor ret = m_currentOffset.value();
+    if(ret.macroExpansion.isValid() && collapseIfMacroExpansion)
+      ret.collapsed = true;
+
+    rpp::LocationTable::AnchorInTable retItem;
+    retItem.position = m_currentOffset.key();
+    retItem.anchor = ret;
+
+    ++m_currentOffset;
+
+    if(m_currentOffset == constEnd) {
+      retItem.nextPosition = 0;
+    }else{
+      retItem.nextPosition = m_currentOffset.key();
+      retItem.nextAnchor = m_currentOffset.value();
+    }
+
+    return retItem;
+  }
+
+private:
+  typedef QMap<std::size_t, Anchor> OffsetTable;
+  static const std::size_t EmptyCache = std::size_t(-1);
+
+  OffsetTable m_offsetTable;
+  mutable OffsetTable::ConstIterator m_currentOffset;
+  mutable rpp::LocationTable::AnchorInTable m_lastAnchorInTable;
+  mutable int m_positionAtColumnCache;
+  mutable std::size_t m_positionAtLastOffset;
+};
+
+}
+
+/**
+ * Generates the anchor() calls the preprocessor makes for macro heavy code:
+ * an anchor for every line, many small macro expansions with their expansion
+ * cursor, collapsed ranges, anchors that repeat the known position, and some
+ * anchors that go back to an earlier offset.
+ */
+QVector<BenchLocationTable::AnchorCall> BenchLocationTable::generateCalls(PreprocessedContents* contents)
+{
+  QVector<AnchorCall> calls;
+  qsrand(42);
+  std::size_t offset = 0;
+  for (int line = 0; line < 20000; ++line) {
+    AnchorCall call = { offset, Anchor(line, 0) };
+    calls += call;
+    int column = 0;
+    const int tokens = qrand() % 6;
+    for (int t = 0; t < tokens; ++t) {
+      const int length = 1 + qrand() % 8;
+      offset += length;
+      column += length;
+      AnchorCall next = { offset, Anchor(line, column) };
+      switch (qrand() % 5) {
+        case 0:
+          // an expansion of a macro used somewhere else on the line, or one used before
+          next.anchor.macroExpansion = CursorInRevision(qrand() % 2 ? line : qrand() % (line + 1), qrand() % 3);
+          break;
+        case 1:
+          next.anchor.collapsed = true;
+          break;
+        case 2:
+          // re-anchoring an earlier offset, like the macro-expander does
+          next.offset -= 1 + qrand() % length;
+          break;
+        default:
+          // the position that is known already, which is not stored
+          break;
+      }
+      calls += next;
+    }
+    offset += 1 + qrand() % 10;
+  }
+  contents->fill(indexFromCharacter('a'), offset + 1);
+  return calls;
+}
+
+void BenchLocationTable::initTestCase()
+{
+  KDevelop::AutoTestShell::init();
+  KDevelop::TestCore* core = new KDevelop::TestCore();
+  core->initialize(KDevelop::Core::NoUi);
+
+  m_calls = generateCalls(&m_contents);
+}
+
+void BenchLocationTable::cleanupTestCase()
+{
+  KDevelop::TestCore::shutdown();
+}
+
+void BenchLocationTable::testSameAnchors()
+{
+  rpp::LocationTable table;
+  OldLocationTable reference;
+  foreach (const AnchorCall& call, m_calls) {
+    table.anchor(call.offset, call.anchor, &m_contents);
+    reference.anchor(call.offset, call.anchor, &m_contents);
+  }
+  QVERIFY(table.size() > 20000);
+
+  // backwards and with gaps, so the lookups don't only move the cursor forward
+  for (int offset = m_contents.size() - 1; offset >= 0; offset -= 7) {
+    for (int collapse = 0; collapse < 2; ++collapse) {
+      const rpp::LocationTable::AnchorInTable expected = reference.anchorForOffset(offset, collapse);
+      const rpp::LocationTable::AnchorInTable actual = table.anchorForOffset(offset, collapse);
+      QCOMPARE(actual.position, expected.position);
+      QCOMPARE(actual.anchor.line, expected.anchor.line);
+      QCOMPARE(actual.anchor.column, expected.anchor.column);
+      QCOMPARE(actual.anchor.collapsed, expected.anchor.collapsed);
+      QVERIFY(actual.anchor.macroExpansion == expected.anchor.macroExpansion);
+      QCOMPARE(actual.nextPosition, expected.nextPosition);
+      if (expected.nextPosition) {
+        QVERIFY(actual.nextAnchor == expected.nextAnchor);
+        QVERIFY(actual.nextAnchor.macroExpansion == expected.nextAnchor.macroExpansion);
+      }
+    }
+  }
+
+  for (int offset = 0; offset < m_contents.size(); ++offset) {
+    const QPair<Anchor, uint> expected = reference.positionAt(offset, m_contents);
+    const QPair<Anchor, uint> actual = table.positionAt(offset, m_contents);
+    QVERIFY(actual.first == expected.first);
+    QCOMPARE(actual.second, expected.second);
+  }
+}
+
+void BenchLocationTable::benchSequential_data()
+{
+  QTest::addColumn<bool>("useMap");
+  QTest::newRow("flat") << false;
+  QTest::newRow("qmap") << true;
+}
+
+void BenchLocationTable::benchSequential()
+{
+  QFETCH(bool, useMap);
+  rpp::LocationTable table;
+  OldLocationTable reference;
+  foreach (const AnchorCall& call, m_calls) {
+    table.anchor(call.offset, call.anchor, &m_contents);
+    reference.anchor(call.offset, call.anchor, &m_contents);
+  }
+  const int size = m_contents.size();
+  int sum = 0;
+  if (useMap) {
+    QBENCHMARK {
+      for (int offset = 0; offset < size; ++offset)
+        sum += reference.anchorForOffset(offset).anchor.line;
+    }
+  } else {
+    QBENCHMARK {
+      for (int offset = 0; offset < size; ++offset)
+        sum += table.anchorForOffset(offset).anchor.line;
+    }
+  }
+  QVERIFY(sum);
+}
+
+void BenchLocationTable::benchRandom_data()
+{
+  benchSequential_data();
+}
+
+void BenchLocationTable::benchRandom()
+{
+  QFETCH(bool, useMap);
+  rpp::LocationTable table;
+  OldLocationTable reference;
+  foreach (const AnchorCall& call, m_calls) {
+    table.anchor(call.offset, call.anchor, &m_contents);
+    reference.anchor(call.offset, call.anchor, &m_contents);
+  }
+  QVector<int> offsets(m_contents.size());
+  qsrand(42);
+  for (int i = 0; i < offsets.size(); ++i)
+    offsets[i] = qrand() % offsets.size();
+  int sum = 0;
+  if (useMap) {
+    QBENCHMARK {
+      foreach(int offset, offsets)
+        sum += reference.anchorForOffset(offset).anchor.line;
+    }
+  } else {
+    QBENCHMARK {
+      foreach(int offset, offsets)
+        sum += table.anchorForOffset(offset).anchor.line;
+    }
+  }
+  QVERIFY(sum);
+}
+
+void BenchLocationTable::benchAnchor_data()
+{
+  benchSequential_data();
+}
+
+void BenchLocationTable::benchAnchor()
+{
+  QFETCH(bool, useMap);
+  if (useMap) {
+    QBENCHMARK {
+      OldLocationTable reference;
+      foreach (const AnchorCall& call, m_calls)
+        reference.anchor(call.offset, call.anchor, &m_contents);
+    }
+  } else {
+    QBENCHMARK {
+      rpp::LocationTable table;
+      foreach (const AnchorCall& call, m_calls)
+        table.anchor(call.offset, call.anchor, &m_contents);
+    }
+  }
+}
+
+#include "bench_locationtable.moc"
@@ -0,0 +1,60 @@
+/* This file is part of KDevelop
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef BENCH_LOCATIONTABLE_H
+#define BENCH_LOCATIONTABLE_H
+
+#include <QObject>
+#include <QVector>
+
+#include "rpp/pp-location.h"
+
+/**
+ * Compares rpp::LocationTable against the QMap based table it replaced,
+ * both filled by the same anchor() calls as for macro heavy code.
+ */
+class BenchLocationTable : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void testSameAnchors();
+
+  void benchSequential_data();
+  void benchSequential();
+  void benchRandom_data();
+  void benchRandom();
+  void benchAnchor_data();
+  void benchAnchor();
+
+private:
+  /// One call of LocationTable::anchor()
+  struct AnchorCall
+  {
+    std::size_t offset;
+    rpp::Anchor anchor;
+  };
+  static QVector<AnchorCall> generateCalls(PreprocessedContents* contents);
+
+  QVector<AnchorCall> m_calls;
+  PreprocessedContents m_contents;
+};
+
+#endif // BENCH_LOCATIONTABLE_H
@@ -41,6 +41,8 @@
 #include <iostream>
 #include <rpp/chartools.h>
 #include <rpp/pp-engine.h>
+#include <rpp/compactcontents.h>
+#include <rpp/pp-directivescanner.h>
 
 #include <tests/autotestshell.h>
 #include <tests/testcore.h>
@@ -944,6 +946,86 @@ void TestParser::testMultiByteComments()
   QVERIFY(pos == KDevelop::CursorInRevision(0, 17));
 }
 
+void TestParser::testCompactContents()
+{
+  QByteArray code = "struct Foo { int bar; };\nconst char* a = \"\xc3\xa4\xff\";\nint Foo::* b = &Foo::bar;";
+  TranslationUnitAST* ast = parse(code);
+  QVERIFY(control.problems().isEmpty());
+  const PreprocessedContents contents = lastSession->contentsVector();
+  AST* str = getAST(ast, AST::Kind_StringLiteral);
+  QVERIFY(str);
+  const QString strText = lastSession->stringForNode(str);
+  Token token = lastSession->token_stream->token(ast->declarations->toBack()->element->start_token);
+  const rpp::Anchor pos = lastSession->positionAt(token.position);
+
+  rpp::CompactContents compact(contents);
+  QCOMPARE(compact.size(), contents.size());
+  QVERIFY(compact.byteSize() < contents.size() * int(sizeof(uint)));
+  QCOMPARE(compact.toPreprocessedContents(), contents);
+  for (int i = 0; i < contents.size(); ++i) {
+    QCOMPARE(compact.at(i), contents.at(i));
+  }
+
+  lastSession->compactContents();
+  QCOMPARE(lastSession->stringForNode(str), strText);
+  QVERIFY(lastSession->positionAt(token.position) == pos);
+  QCOMPARE(lastSession->contentsVector(), contents);
+  for (int i = 0; i < contents.size(); ++i) {
+    QCOMPARE(lastSession->contentAt(i), contents.at(i));
+  }
+  QCOMPARE(lastSession->contentsString(0, contents.size()), stringFromContents(contents));
+
+  // writing through contents() drops the compact form, so both can't diverge
+  uint* writable = lastSession->contents();
+  writable[0] = indexFromCharacter('c');
+  QCOMPARE(lastSession->contentAt(0), indexFromCharacter('c'));
+  QCOMPARE(lastSession->contentsVector().at(0), indexFromCharacter('c'));
+}
+
+void TestParser::testDirectiveScanner()
+{
+  rpp::FileDirectives directives = rpp::scanDirectives(QByteArray(
+    "// comment\n"
+    "#ifndef FOO_H\n"
+    "#define FOO_H\n"
+    "#include <vector>\n"
+    "  #  include \"bar.h\" // trailing\n"
+    "/* #include <commented.h> */\n"
+    "const char* s = \"/*\";\n"
+    "#ifdef WIN32\n"
+    "#include_next <windows.h>\n"
+    "#endif\n"
+    "#define MACRO \\\n"
+    "#include <continued.h>\n"
+    "#endif\n"));
+  QCOMPARE(directives.headerGuard, QByteArray("FOO_H"));
+  QVERIFY(!directives.pragmaOnce);
+  QCOMPARE(directives.includes.size(), 3);
+  QCOMPARE(directives.includes[0].name, QString("vector"));
+  QCOMPARE(directives.includes[0].type, rpp::Preprocessor::IncludeGlobal);
+  QCOMPARE(directives.includes[0].line, 3);
+  QVERIFY(!directives.includes[0].conditional);
+  QCOMPARE(directives.includes[1].name, QString("bar.h"));
+  QCOMPARE(directives.includes[1].type, rpp::Preprocessor::IncludeLocal);
+  QVERIFY(!directives.includes[1].conditional);
+  QCOMPARE(directives.includes[2].name, QString("windows.h"));
+  QVERIFY(directives.includes[2].includeNext);
+  QVERIFY(directives.includes[2].conditional);
+
+  // code after the guard
+  QVERIFY(rpp::scanDirectives(QByteArray("#ifndef A\n#define A\n#endif\nint a;\n")).headerGuard.isEmpty());
+  // an alternative to the guarded block
+  QVERIFY(rpp::scanDirectives(QByteArray("#ifndef A\n#define A\n#else\n#endif\n")).headerGuard.isEmpty());
+  // guard and define don't match
+  QVERIFY(rpp::scanDirectives(QByteArray("#ifndef A\n#define B\n#endif\n")).headerGuard.isEmpty());
+
+  directives = rpp::scanDirectives(QByteArray("#pragma once\n#ifdef A\n#include <a.h>\n#endif\n"));
+  QVERIFY(directives.pragmaOnce);
+  QVERIFY(directives.headerGuard.isEmpty());
+  QCOMPARE(directives.includes.size(), 1);
+  QVERIFY(directives.includes[0].conditional);
+}
+
 void TestParser::testTernaryEmptyExpression()
 {
   // see also: https://bugs.kde.org/show_bug.cgi?id=292357
@@ -958,6 +1040,138 @@ void TestParser::testTernaryEmptyExpression()
   QVERIFY(ast);
 }
 
+struct NodeSpanVisitor : protected DefaultVisitor
+{
+  // kind, start and end token of every visited node
+  QVector<uint> spans;
+
+  void visit(AST* node)
+  {
+    if (node) {
+      spans << node->kind << node->start_token << node->end_token;
+      DefaultVisitor::visit(node);
+    }
+  }
+};
+
+void TestParser::testBacktrackingMemo()
+{
+  QFETCH(QByteArray, code);
+
+  // the memoized parse has to produce exactly the same tree
+  QVector<uint> spans[2];
+  QVector<quint16> kinds[2];
+  int problems[2];
+  for (int memoize = 0; memoize < 2; ++memoize) {
+    control = Control();
+    Parser parser(&control);
+    parser.setMemoizationEnabled(memoize);
+    QScopedPointer<ParseSession> session(new ParseSession());
+
+    rpp::Preprocessor preprocessor;
+    rpp::pp pp(&preprocessor);
+    session->setContentsAndGenerateLocationTable(pp.processFile("anonymous", code));
+    TranslationUnitAST* ast = parser.parse(session.data());
+    QVERIFY(ast);
+
+    NodeSpanVisitor visitor;
+    visitor.visit(ast);
+    spans[memoize] = visitor.spans;
+    // TODO comments are reported as problems, so this also covers the comments
+    problems[memoize] = control.problems().count();
+    for (int i = 0; i < session->token_stream->size(); ++i)
+      kinds[memoize] << session->token_stream->kind(i);
+
+    const Parser::MemoStatistics& statistics = parser.memoStatistics();
+    if (memoize) {
+      QVERIFY(statistics.hits > 0);
+      QVERIFY(statistics.hits <= statistics.lookups);
+    } else {
+      QCOMPARE(statistics.lookups, 0u);
+    }
+  }
+
+  QCOMPARE(kinds[1], kinds[0]);
+  QCOMPARE(spans[1], spans[0]);
+  QCOMPARE(problems[1], problems[0]);
+}
+
+void TestParser::testBacktrackingMemo_data()
+{
+  QTest::addColumn<QByteArray>("code");
+
+  QTest::newRow("spaced") << QByteArray(
+    "void f() {\n"
+    "  std::map<std::pair<int, std::vector<int> >, std::map<int, std::pair<A<B>, C> > > m;\n"
+    "  std::pair<std::map<int, int>, std::vector<std::pair<int, int> > > p(x, y);\n"
+    "  a < b > (c);\n"
+    "  int i = (A<B>::value) + (int)(long)x;\n"
+    "}\n");
+
+  // the productions around a '>>' are re-parsed after the token was split
+  QTest::newRow("rightshift") << QByteArray(
+    "void f() {\n"
+    "  std::map<std::pair<int, std::vector<int>>, std::map<int, std::pair<A<B>, C>>> m;\n"
+    "  std::pair<std::map<int, int>, std::vector<std::pair<int, int>>> p(x, y);\n"
+    "  a < b >> (c);\n"
+    "  int i = (A<B<C>>::value) + (int)(long)x >> 2;\n"
+    "  std::vector<std::vector<int>> (v);\n"
+    "}\n");
+
+  // a '<' that does not start a template-argument-list is marked, which changes how the productions around it are parsed again
+  QTest::newRow("markers") << QByteArray(
+    "void f() {\n"
+    "  int i = a < b > c;\n"
+    "  int j = (a < b > c) + (x < y > z);\n"
+    "  int k = (a < b) + (c < d);\n"
+    "}\n");
+
+  QTest::newRow("comments") << QByteArray(
+    "void f() {\n"
+    "  std::pair<int /* TODO: first */, std::vector<int>> p(x /* TODO: second */, y);\n"
+    "  int i = (A<B<C /* TODO: third */>>::value) + (int)(long)x;\n"
+    "}\n");
+}
+
+struct TemplateArgumentsVisitor : protected DefaultVisitor
+{
+  TemplateArgumentsVisitor() : withArguments(0) {}
+  // count of unqualified names that were given template-arguments
+  int withArguments;
+
+  void visit(AST* node)
+  {
+    DefaultVisitor::visit(node);
+  }
+
+protected:
+  virtual void visitUnqualifiedName(UnqualifiedNameAST* node)
+  {
+    if (node->template_arguments)
+      ++withArguments;
+    DefaultVisitor::visitUnqualifiedName(node);
+  }
+};
+
+void TestParser::testNoTemplateArgumentListMemo()
+{
+  // "a < b > c" can not be a template-id followed by an identifier in an expression, and
+  // the memoized attempts must not hand out a template-id that was parsed before the '<' was marked
+  QByteArray code = "void f() {\n"
+                    "  int i = a < b > c;\n"
+                    "  int j = (a < b > c) + (x < y > z);\n"
+                    "  int k = (a < b) + (c < d);\n"
+    "  int k = (a < b) + (c < d);\n"
+                    "}\n";
+  TranslationUnitAST* ast = parse(code);
+  QVERIFY(ast);
+  QCOMPARE(control.problems().count(), 0);
+
+  TemplateArgumentsVisitor visitor;
+  visitor.visit(ast);
+  QCOMPARE(visitor.withArguments, 0);
+}
+
 TranslationUnitAST* TestParser::parse(const QByteArray& unit)
 {
   control = Control(); // Clear the problems
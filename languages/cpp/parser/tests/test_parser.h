@@ -98,6 +98,12 @@ private slots:
 
   void testTernaryEmptyExpression();
 
+  void testCompactContents();
+  void testDirectiveScanner();
+  void testBacktrackingMemo();
+  void testBacktrackingMemo_data();
+  void testNoTemplateArgumentListMemo();
+
   //BEGIN C++2011 support
   void testRangeBasedFor();
   void testRValueReference();
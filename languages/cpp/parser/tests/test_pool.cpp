@@ -89,6 +89,43 @@ void TestPool::testWastedMemoryDueToBlockAllocation()
     QCOMPARE(p2[0], 11);
 }
 
+void TestPool::testLargeAllocation()
+{
+    MemoryPool pool;
+    int *small = pool.allocate<int>();
+    *small = 1;
+    //this does not fit into a single block
+    const size_t count = 2 * MemoryPool::BLOCK_SIZE / sizeof(int);
+    int *p = pool.allocate<int>(count);
+    //chunk is zeroed like a block
+    QCOMPARE(p[0], 0);
+    QCOMPARE(p[count-1], 0);
+    p[count-1] = 10;
+    QCOMPARE(p[count-1], 10);
+    QCOMPARE(*small, 1);
+    QCOMPARE(pool.statistics().largeChunkBytes, count * sizeof(int));
+    QCOMPARE(pool.size(), sizeof(int) + count * sizeof(int));
+    //following small allocations still go into the current block
+    int *p2 = pool.allocate<int>();
+    QCOMPARE(p2, small + 1);
+}
+
+void TestPool::testBlockReuse()
+{
+    {
+        MemoryPool pool;
+        pool.allocate<char>(64);
+    }
+    MemoryPool pool;
+    char *p = pool.allocate<char>(64);
+    //the block of the first pool got cleaned up and recycled
+    QCOMPARE(p[0], char(0));
+    QCOMPARE(pool.statistics().reusedBytes, size_t(MemoryPool::BLOCK_SIZE));
+    QCOMPARE(pool.statistics().newBytes, size_t(0));
+    QVERIFY(MemoryPool::peakTotalBytes() >= MemoryPool::totalBytes());
+    QVERIFY(MemoryPool::totalBytes() >= size_t(MemoryPool::BLOCK_SIZE));
+}
+
 void TestPool::benchManyAllocations()
 {
   MemoryPool pool;
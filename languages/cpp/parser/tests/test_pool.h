@@ -27,6 +27,9 @@ private slots:
 
     void testWastedMemoryDueToBlockAllocation();
 
+    void testLargeAllocation();
+    void testBlockReuse();
+
     void benchManyPools();
     void benchManyAllocations();
 };
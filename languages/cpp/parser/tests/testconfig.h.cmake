@@ -2,3 +2,6 @@
 
 /* The location for a test cpp file used as an input for the c++ parser. */
 #define TEST_FILE "${CMAKE_CURRENT_SOURCE_DIR}/test_parser.cpp"
+
+/* The Qt include directory, used to find a corpus for the lexer benchmark. */
+#define QT_INCLUDE_DIR "${QT_INCLUDE_DIR}"
@@ -27,8 +27,10 @@
 #include <QByteArray>
 #include <QMutexLocker>
 #include <QReadWriteLock>
+#include <QSet>
 
 #include <kdebug.h>
+#include <kglobal.h>
 #include <klocale.h>
 
 #include <language/backgroundparser/backgroundparser.h>
@@ -52,10 +54,13 @@
 #include "parser/rpp/pp-engine.h"
 #include "parser/rpp/pp-macro.h"
 #include "parser/rpp/preprocessor.h"
+#include "parser/rpp/pp-directivescanner.h"
 #include "environmentmanager.h"
 #include "cpppreprocessenvironment.h"
 
 #include "cppdebughelper.h"
+#include "includeguardcache.h"
+#include "includegraph.h"
 #include "codegen/unresolvedincludeassistant.h"
 
 // #define ifDebug(x) x
@@ -106,12 +111,37 @@ void PreprocessJob::foundHeaderGuard(rpp::Stream& stream, KDevelop::IndexedStrin
   KDevelop::DUChainWriteLocker lock(KDevelop::DUChain::lock());
   
   m_currentEnvironment->environmentFile()->setHeaderGuard(guardName);
+  Cpp::IncludeGuardCache::self()->setHeaderGuard(parentJob()->document(), guardName, m_firstEnvironmentFile->modificationRevision());
   
   //In naive matching mode, we ignore the dependence on header-guards
   if(Cpp::EnvironmentManager::self()->matchingLevel() <= Cpp::EnvironmentManager::Naive)
     m_currentEnvironment->removeString(guardName);
 }
 
+void PreprocessJob::foundPragmaOnce(rpp::Stream& stream)
+{
+  Q_UNUSED(stream);
+
+  Cpp::IncludeGuardCache::self()->setPragmaOnce(parentJob()->document(), m_firstEnvironmentFile->modificationRevision());
+}
+
+bool PreprocessJob::includeGuardActive(const IndexedString& file)
+{
+  Cpp::IncludeGuardCache::Guard guard;
+  if(!Cpp::IncludeGuardCache::self()->guard(file, &guard))
+    return false;
+
+  if(guard.pragmaOnce && parentJob()->masterJob()->wasIncludedInRun(file))
+    return true;
+
+  if(guard.macro.isEmpty())
+    return false;
+
+  //Through retrieveMacro the dependency on the guard is noted in the environment-file
+  rpp::pp_macro* macro = m_currentEnvironment->retrieveMacro(guard.macro, true);
+  return macro && !macro->isUndef();
+}
+
 void PreprocessJob::run()
 {
     if(!ICore::self()->languageController()->language("C++")->languageSupport())
@@ -131,6 +161,9 @@ void PreprocessJob::run()
     if( parentJob()->parentPreprocessor() )
       kDebug(9007) << "PARENT:" << parentJob()->parentPreprocessor()->parentJob()->document().toUrl();
 
+    //Jobs that were scheduled speculatively by another master-job don't schedule their includes themselves
+    const bool speculativeJob = !parentJob()->parentPreprocessor() && takeSpeculativeDocument(parentJob()->document());
+
     if (checkAbort())
         return;
 
@@ -212,6 +245,13 @@ void PreprocessJob::run()
     if (checkAbort() || !readContents())
         return;
 
+    if(!parentJob()->parentPreprocessor()) {
+      if(speculativeJob)
+        markSpeculativeResult(parentJob()->document());
+      else
+        scheduleSpeculativeIncludes();
+    }
+
     {
         ///Find a context that can be updated
         KDevelop::DUChainReadLocker readLock(KDevelop::DUChain::lock());
@@ -314,6 +354,104 @@ void PreprocessJob::run()
     m_currentEnvironment = 0; //Was given to the pp-engine, and will be destroyed by that
 }
 
+namespace {
+///Limits the count of files scheduled by one job, the remaining includes are parsed by the job itself
+const int maxSpeculativeFiles = 24;
+
+bool isInDUChain(const IndexedString& file)
+{
+  KDevelop::DUChainReadLocker readLock(KDevelop::DUChain::lock());
+  return !KDevelop::DUChain::self()->allEnvironmentFiles(file).isEmpty();
+}
+
+struct SpeculativeDocuments
+{
+  QMutex mutex;
+  ///The documents that were added to the background-parser by scheduleSpeculativeIncludes(), and did not start yet
+  QSet<IndexedString> documents;
+  ///The documents that were preprocessed by a speculative job, and were not checked against the macros of an includer yet
+  QSet<IndexedString> results;
+};
+
+K_GLOBAL_STATIC(SpeculativeDocuments, speculativeDocuments)
+}
+
+bool PreprocessJob::takeSpeculativeDocument(const IndexedString& document)
+{
+    QMutexLocker lock(&speculativeDocuments->mutex);
+    return speculativeDocuments->documents.remove(document);
+}
+
+void PreprocessJob::markSpeculativeResult(const IndexedString& document)
+{
+    QMutexLocker lock(&speculativeDocuments->mutex);
+    speculativeDocuments->results.insert(document);
+}
+
+bool PreprocessJob::takeSpeculativeResult(const IndexedString& document)
+{
+    QMutexLocker lock(&speculativeDocuments->mutex);
+    return speculativeDocuments->results.remove(document);
+}
+
+void PreprocessJob::scheduleSpeculativeIncludes()
+{
+    //Speculative jobs preprocess the headers with the standard macros and project defines, but without the ones defined up to the #include.
+    //sourceNeeded(..) checks the result against the actual macros of the includer, and parses the header again if they differ.
+    if(!m_speculativeIncludeParsing)
+      return;
+
+    KDevelop::BackgroundParser* backgroundParser = ICore::self()->languageController()->backgroundParser();
+    if(backgroundParser->threadCount() < 2)
+      return;
+
+    const TopDUContext::Features features = (TopDUContext::Features)(parentJob()->slaveMinimumFeatures() & (~TopDUContext::ForceUpdateRecursive));
+    const Path::List& includePaths = parentJob()->includePathUrls();
+    QList<IndexedString> roots;
+
+    //Our own contents may come from an open document, so they are scanned here instead of through the include-graph
+    foreach(const rpp::IncludeDirective& include, rpp::scanDirectives(m_contents).includes) {
+      if(include.includeNext || include.conditional)
+        continue;
+
+      const Path includedFile = CppUtils::findInclude(includePaths, parentJob()->localPath(), include.name, include.type, Path(), true).first;
+      if(!includedFile.isValid())
+        continue;
+
+      const IndexedString indexedFile(includedFile.pathOrUrl());
+      if(indexedFile != parentJob()->document() && !roots.contains(indexedFile))
+        roots << indexedFile;
+    }
+
+    if(roots.isEmpty())
+      return;
+
+    //The first include and the files it includes are reached by this job right away, so they would only be parsed twice
+    const QList<IndexedString> reachedFirst = Cpp::IncludeGraph::self()->bottomUp(QList<IndexedString>() << roots.takeFirst(), includePaths, &isInDUChain, maxSpeculativeFiles);
+    QSet<IndexedString> skip = reachedFirst.toSet();
+    skip.insert(parentJob()->document());
+
+    //Schedule bottom-up, so the included headers are already in the du-chain when their includers are parsed
+    QHash<IndexedString, int> levels;
+    const QList<IndexedString> files = Cpp::IncludeGraph::self()->bottomUp(roots, includePaths, &isInDUChain, maxSpeculativeFiles, &levels);
+
+    foreach(const IndexedString& file, files) {
+      if(skip.contains(file) || backgroundParser->isQueued(file))
+        continue;
+      ifDebug( kDebug(9007) << "PreprocessJob" << parentJob()->document().str() << ": speculatively scheduling" << file.str() << "level" << levels.value(file); )
+      {
+        QMutexLocker lock(&speculativeDocuments->mutex);
+        speculativeDocuments->documents.insert(file);
+      }
+      backgroundParser->addDocument(file, features, parentJob()->parsePriority() + levels.value(file));
+    }
+}
+
+void PreprocessJob::setSpeculativeIncludeParsing(bool enabled)
+{
+    m_speculativeIncludeParsing = enabled;
+}
+
 void PreprocessJob::headerSectionEnded(rpp::Stream& stream)
 {
   headerSectionEndedInternal(&stream);
@@ -475,6 +613,9 @@ rpp::Stream* PreprocessJob::sourceNeeded(QString& _fileName, IncludeType type, i
         KDevelop::ReferencedTopDUContext includedContext;
         bool updateNeeded = false;
         bool updateForbidden = false;
+        bool skipGuarded = false;
+        //Multiple-include optimization: When the guard is active, the file would be empty anyway
+        const bool guardActive = includeGuardActive(indexedFile);
 
         {
             KDevelop::DUChainReadLocker readLock(KDevelop::DUChain::lock());
@@ -509,14 +650,29 @@ rpp::Stream* PreprocessJob::sourceNeeded(QString& _fileName, IncludeType type, i
 //               }
             }
             
-            if(includedContext) {
+            if(!includedContext && guardActive) {
+              skipGuarded = true;
+            } else if(includedContext && guardActive) {
+              //Don't even check the file for modifications, it would not be updated anyway
+              updateForbidden = true;
+            } else if(includedContext) {
               Cpp::EnvironmentFilePointer includedEnvironment(dynamic_cast<Cpp::EnvironmentFile*>(includedContext->parsingEnvironmentFile().data()));
               if( includedEnvironment ) {
+                if(!includedEnvironment->headerGuard().isEmpty())
+                  Cpp::IncludeGuardCache::self()->setHeaderGuard(indexedFile, includedEnvironment->headerGuard(), includedEnvironment->modificationRevision());
+
                 updateNeeded = CppUtils::needsUpdate(includedEnvironment, parentJob()->localPath(), parentJob()->includePathUrls());
                 //The ForceUpdateRecursive flag is removed before checking for satisfied features, so we can prevent double-updating through "wasUpdated()" below (see *1)
                 updateNeeded |= !includedEnvironment->featuresSatisfied((TopDUContext::Features)(slaveMinimumFeatures & (~TopDUContext::ForceUpdateRecursive)));
                 //(*1) Do not update again if ForceUpdate is given and the context was already updated during this run
                 updateNeeded |= (slaveMinimumFeatures & TopDUContext::ForceUpdate) && !parentJob()->masterJob()->wasUpdated(includedContext.data());
+
+                //A speculatively parsed header did not see the macros we have defined up to here. The matching-level may be
+                //disabled, so check the macros explicitly, and throw the result away through an update if they make a difference.
+                if(takeSpeculativeResult(indexedFile) && !updateNeeded && !includedEnvironment->matchMacros(m_currentEnvironment)) {
+                  kDebug(9007) << "PreprocessJob" << parentJob()->document().str() << ": speculatively parsed" << includedFile << "does not match the environment";
+                  updateNeeded = true;
+                }
                 
                 #if 0
                 //If header-guards should be ignored, unguard the file
@@ -536,11 +692,21 @@ rpp::Stream* PreprocessJob::sourceNeeded(QString& _fileName, IncludeType type, i
             }
         }
 
+        if(skipGuarded) {
+            ifDebug( kDebug(9007) << "PreprocessJob" << parentJob()->document().str() << ": skipping guarded include-file" << fileName; )
+            //Nothing is imported, so depend on the revision of the file directly. When it loses or
+            //changes its guard, this file is updated like for a change in any other included file.
+            KDevelop::DUChainWriteLocker writeLock(KDevelop::DUChain::lock());
+            m_firstEnvironmentFile->addIncludeFile(indexedFile, KDevelop::ModificationRevision::revisionForFile(indexedFile));
+            return 0;
+        }
+
         if( includedContext && (updateForbidden || (!updateNeeded && (!parentJob()->masterJob()->needUpdateEverything() || parentJob()->masterJob()->wasUpdated(includedContext)))) ) {
             ifDebug( kDebug(9007) << "PreprocessJob" << parentJob()->document().str() << ": took included file from the du-chain" << fileName; )
 
             KDevelop::DUChainReadLocker readLock(KDevelop::DUChain::lock());
             parentJob()->addIncludedFile(includedContext, sourceLine);
+            parentJob()->masterJob()->setIncludedInRun(indexedFile);
             KDevelop::ParsingEnvironmentFilePointer file = includedContext->parsingEnvironmentFile();
             Cpp::EnvironmentFile* environmentFile = dynamic_cast<Cpp::EnvironmentFile*> (file.data());
             if( environmentFile ) {
@@ -580,6 +746,8 @@ rpp::Stream* PreprocessJob::sourceNeeded(QString& _fileName, IncludeType type, i
 
             slaveJob->parseForeground();
 
+            parentJob()->masterJob()->setIncludedInRun(indexedFile);
+
             // Add the included file.
             if(slaveJob->duChain())
               parentJob()->addIncludedFile(slaveJob->duChain(), sourceLine);
@@ -672,6 +840,7 @@ bool PreprocessJob::success() const
 }
 
 KDevelop::ParsingEnvironment * PreprocessJob::m_standardEnvironment = 0;
+bool PreprocessJob::m_speculativeIncludeParsing = true;
 
 const KDevelop::ParsingEnvironment * PreprocessJob::standardEnvironment()
 {
@@ -72,6 +72,8 @@ public:
     virtual void headerSectionEnded(rpp::Stream& stream);
     
     virtual void foundHeaderGuard(rpp::Stream& stream, KDevelop::IndexedString guardName);
+
+    virtual void foundPragmaOnce(rpp::Stream& stream);
     
     /**
      * Returns the standard-environment used for parsing c++ files(all other environments are based on that one)
@@ -84,10 +86,29 @@ public:
     static KDevelop::ParsingEnvironment* createStandardEnvironment();
 
     static const KDevelop::ParsingEnvironment* standardEnvironment();
+
+    /**
+     * When enabled, the includes of a master-job that are not in the du-chain yet are found through
+     * the include-graph, and are scheduled bottom-up in the background-parser, so they are parsed on other threads
+     * before the preprocessor reaches them. The headers are parsed with the standard macros and the defines of their project,
+     * so when the includer reaches them, the macros it uses are checked against the includer's
+     * environment at any matching-level, and the header is parsed again on mismatch.
+     * Enabled by default.
+     * */
+    static void setSpeculativeIncludeParsing(bool enabled);
 private:
+    void scheduleSpeculativeIncludes();
+    ///Returns whether @p document was scheduled by scheduleSpeculativeIncludes(), and forgets about it
+    static bool takeSpeculativeDocument(const KDevelop::IndexedString& document);
+    ///Notes that @p document was preprocessed by a speculative job, without the macros of its includer
+    static void markSpeculativeResult(const KDevelop::IndexedString& document);
+    ///Returns whether the context of @p document was produced by a speculative job and was not checked yet, and forgets about it
+    static bool takeSpeculativeResult(const KDevelop::IndexedString& document);
     void headerSectionEndedInternal(rpp::Stream* stream);
     bool checkAbort();
     bool readContents();
+    ///Whether the include-guard or "#pragma once" of @p file is known, and currently active
+    bool includeGuardActive(const KDevelop::IndexedString& file);
 
     CppPreprocessEnvironment* m_currentEnvironment;
     KSharedPtr<Cpp::EnvironmentFile> m_firstEnvironmentFile; //First environment-file. If simplified matching is used, this is the proxy.
@@ -101,6 +122,7 @@ private:
     QByteArray m_contents;
 
     static KDevelop::ParsingEnvironment* m_standardEnvironment;
+    static bool m_speculativeIncludeParsing;
 };
 
 KDevelop::ParsingEnvironment* CreateStandardEnvironment();
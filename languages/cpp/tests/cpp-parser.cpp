@@ -34,13 +34,27 @@
 #include "rpp/pp-engine.h"
 
 #include "contextbuilder.h"
+#include "declarationbuilder.h"
+#include "usebuilder.h"
+#include "builderlock.h"
+#include "environmentmanager.h"
 #include "cpputils.h"
 #include "control.h"
 #include <memorypool.h>
 
+#include <QThread>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+
 using namespace Cpp;
 using namespace KDevelopUtils;
 
+/// Set by --duchain, builds the duchain and reports the chain lock statistics after parsing
+static bool buildChain = false;
+
 class MemSizeVisitor : public DefaultVisitor
 {
 public:
@@ -147,6 +161,46 @@ private:
   quint64 m_size;
 };
 
+/// Read-locks the chain over and over, as the UI does for completion and highlighting
+class ChainReader : public QThread
+{
+public:
+  ChainReader()
+  : m_acquisitions(0), m_waitMicroseconds(0), m_maxWaitMicroseconds(0), m_stop(0)
+  {
+  }
+
+  void stop()
+  {
+    m_stop = 1;
+    wait();
+  }
+
+  uint m_acquisitions;
+  quint64 m_waitMicroseconds;
+  quint64 m_maxWaitMicroseconds;
+
+protected:
+  virtual void run()
+  {
+    while (!m_stop) {
+      QElapsedTimer timer;
+      timer.start();
+      {
+        KDevelop::DUChainReadLocker lock(KDevelop::DUChain::lock());
+        const quint64 wait = timer.nsecsElapsed() / 1000;
+        ++m_acquisitions;
+        m_waitMicroseconds += wait;
+        m_maxWaitMicroseconds = qMax(m_maxWaitMicroseconds, wait);
+      }
+      usleep(100);
+    }
+  }
+
+private:
+  QAtomicInt m_stop;
+};
+
 class CppParser {
 public:
     CppParser(const bool printAst, const bool printTokens)
@@ -221,6 +275,10 @@ private:
 
       qout << "contents vector size: " << m_session.contentsVector().size() << endl;
       qout << "mempool size: " << m_session.mempool->size() << endl;
+      const Parser::MemoStatistics& memo = parser.memoStatistics();
+      qout << "backtracking memo: " << memo.hits << " of " << memo.lookups << " lookups reused, "
+           << memo.reusedTokens << " tokens not parsed again, "
+           << memo.uncacheable << " results not stored" << endl;
       MemSizeVisitor visitor;
       if (ast) {
         visitor.visit(ast);
@@ -230,6 +288,54 @@ private:
       if (!ast) {
         exit(255);
       }
+
+      if (buildChain)
+        buildDUChain(ast);
+    }
+
+    /**
+     * build the duchain for the AST while another thread reads the chain,
+     * and report how long both waited for and held the chain lock
+     */
+    void buildDUChain(TranslationUnitAST* ast)
+    {
+      if (!Cpp::EnvironmentManager::self())
+        Cpp::EnvironmentManager::init();
+      BuilderLock::resetStatistics();
+      BuilderLock::setCollectStatistics(true);
+
+      ChainReader reader;
+      reader.start();
+
+      QElapsedTimer timer;
+      timer.start();
+      Cpp::EnvironmentFilePointer file(new Cpp::EnvironmentFile(m_session.url(), 0));
+      DeclarationBuilder declarationBuilder(&m_session);
+      KDevelop::ReferencedTopDUContext top = declarationBuilder.buildDeclarations(file, ast);
+      UseBuilder useBuilder(&m_session);
+      useBuilder.buildUses(ast);
+      const qint64 elapsed = timer.elapsed();
+
+      reader.stop();
+      BuilderLock::setCollectStatistics(false);
+
+      const BuilderLock::Statistics stats = BuilderLock::statistics();
+      qout << endl << "duchain built in " << elapsed << "ms, chain lock of the builders:" << endl;
+      printLockCounters("write", stats.write);
+      printLockCounters("read", stats.read);
+      qout << "concurrent reader: " << reader.m_acquisitions << " acquisitions, waited "
+           << reader.m_waitMicroseconds << "us, longest wait " << reader.m_maxWaitMicroseconds << "us" << endl;
+
+      KDevelop::DUChainWriteLocker lock(KDevelop::DUChain::lock());
+      if (top)
+        KDevelop::DUChain::self()->removeDocumentChain(top.data());
+    }
+
+    void printLockCounters(const char* kind, const BuilderLock::Statistics::Counters& counters)
+    {
+      qout << "  " << kind << ": " << counters.acquisitions << " acquisitions, " << counters.contended << " contended, "
+           << "waited " << counters.waitMicroseconds << "us (longest " << counters.maxWaitMicroseconds << "us), "
+           << "held " << counters.holdMicroseconds << "us (longest " << counters.maxHoldMicroseconds << "us)" << endl;
     }
 
     ParseSession m_session;
@@ -243,5 +349,16 @@ int main(int argc, char* argv[])
                           "1", ki18n("KDevelop CPP parser debugging utility"), KAboutData::License_GPL,
                           ki18n( "2011 Milian Wolff" ), KLocalizedString(), "http://www.kdevelop.org" );
 
+    // --duchain is not known to the shared parser helper, so take it out of the arguments before they get there
+    int argCount = 0;
+    for (int i = 0; i < argc; ++i) {
+      if (qstrcmp(argv[i], "--duchain") == 0)
+        buildChain = true;
+      else
+        argv[argCount++] = argv[i];
+    }
+    argv[argCount] = 0;
+    argc = argCount;
+
     return KDevelopUtils::initAndRunParser<CppParser>(aboutData, argc, argv);
 }
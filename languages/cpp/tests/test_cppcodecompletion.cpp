@@ -48,6 +48,10 @@
 #include "codecompletion/context.h"
 #include "codecompletion/helpers.h"
 #include "codecompletion/item.h"
+#include "codecompletion/completionindex.h"
+#include "codecompletion/model.h"
+#include "codecompletion/worker.h"
+#include "includedirectorycache.h"
 #include "codecompletion/implementationhelperitem.h"
 #include "cpppreprocessenvironment.h"
 #include <language/duchain/classdeclaration.h>
@@ -3684,6 +3688,37 @@ void TestCppCodeCompletion::testMultipleIncludeCompletionItems()
   QCOMPARE(includeItems[0].basePath, KUrl(innerDir1.absolutePath()));
 }
 
+void TestCppCodeCompletion::testIncludeDirectoryCache()
+{
+  KTempDir tempDir;
+  QDir dir(tempDir.name());
+  dir.mkdir("sub");
+  QFile header(dir.absoluteFilePath("QState"));
+  QVERIFY(header.open(QIODevice::ReadWrite));
+  QFile hidden(dir.absoluteFilePath(".hidden.h"));
+  QVERIFY(hidden.open(QIODevice::ReadWrite));
+  QVERIFY(QFile::link(dir.absolutePath(), dir.absoluteFilePath("sub/link")));
+
+  Cpp::IncludeDirectoryCache* cache = Cpp::IncludeDirectoryCache::self();
+  const int size = cache->size();
+  Cpp::IncludeDirectoryCache::Listing listing = cache->listing(dir.absolutePath());
+  QCOMPARE(listing.size(), 2);
+  QCOMPARE(cache->size(), size + 1);
+
+  //The same file reached through a link is only found once
+  const QStringList directories = QStringList() << dir.absolutePath() << dir.absoluteFilePath("sub/link");
+  QCOMPARE(cache->filesNamed("QState", directories), QStringList() << dir.absoluteFilePath("QState"));
+  QVERIFY(cache->filesNamed("sub", directories).isEmpty());
+
+  //The listing is updated when the directory changes, the watcher is started from the event-loop
+  QTest::qWait(100);
+  QFile added(dir.absoluteFilePath("added.h"));
+  QVERIFY(added.open(QIODevice::ReadWrite));
+  for (int a = 0; a < 50 && cache->listing(dir.absolutePath()).size() != 3; ++a)
+    QTest::qWait(100);
+  QCOMPARE(cache->listing(dir.absolutePath()).size(), 3);
+}
+
 void TestCppCodeCompletion::testAfterVisibility_data()
 {
   QTest:: addColumn<QString>("vis");
@@ -3778,6 +3813,230 @@ void TestCppCodeCompletion::testLookaheadMatches_data()
     << (QStringList() << "One::NoLookahead NoLookahead =" << "NO" << "CAN" << "SEE" << all );
 }
 
+class RecordingItemStream : public Cpp::CodeCompletionContext::ItemStream
+{
+public:
+  RecordingItemStream() : abortAfterBatch(0), abort(0) {
+  }
+  virtual void itemsFound(const QList<CompletionTreeItemPointer>& items, Cpp::CodeCompletionContext*) {
+    QStringList names;
+    foreach(const CompletionTreeItemPointer& item, items)
+      if(item->declaration())
+        names << item->declaration()->identifier().toString();
+    batches << names;
+    if(abort && batches.size() == abortAfterBatch)
+      *abort = true;
+  }
+  QList<QStringList> batches;
+  int abortAfterBatch;
+  bool* abort;
+};
+
+///Records the item-lists the worker publishes, instead of showing them
+class RecordingCompletionModel : public Cpp::CodeCompletionModel
+{
+public:
+  RecordingCompletionModel() : Cpp::CodeCompletionModel(0) {
+  }
+  QList<QStringList> batches;
+protected:
+  virtual void foundDeclarations(QList<CompletionTreeElementPointer> tree, KDevelop::CodeCompletionContext::Ptr) {
+    QStringList names;
+    foreach(const CompletionTreeElementPointer& element, tree)
+      addNames(element.data(), names);
+    batches << names;
+  }
+private:
+  void addNames(CompletionTreeElement* element, QStringList& names) {
+    if(CompletionTreeNode* node = element->asNode()) {
+      foreach(const CompletionTreeElementPointer& child, node->children)
+        addNames(child.data(), names);
+    }else if(CompletionTreeItem* item = element->asItem()) {
+      if(item->declaration())
+        names << item->declaration()->identifier().toString();
+    }
+  }
+};
+
+///Makes the streaming part of the worker accessible, without running it in a thread
+class StreamingCompletionWorker : public Cpp::CodeCompletionWorker
+{
+public:
+  StreamingCompletionWorker(RecordingCompletionModel* model) : Cpp::CodeCompletionWorker(model) {
+    connect(this, SIGNAL(foundDeclarations(QList<KSharedPtr<CompletionTreeElement> >,KSharedPtr<CodeCompletionContext>)),
+            model, SLOT(foundDeclarations(QList<KSharedPtr<CompletionTreeElement> >,KSharedPtr<CodeCompletionContext>)), Qt::DirectConnection);
+  }
+  QList<CompletionTreeItemPointer> complete(DUContext* ctx, const CursorInRevision& position) {
+    resetItemStream();
+    KDevelop::CodeCompletionContext::Ptr context(createCompletionContext(DUContextPointer(ctx), "; ", QString(), position));
+    bool abort = false;
+    return context->completionItems(abort);
+  }
+  using Cpp::CodeCompletionWorker::setStreamInterval;
+  using Cpp::CodeCompletionWorker::flushPendingItems;
+};
+
+void TestCppCodeCompletion::testStreamedCompletionItems()
+{
+  QByteArray method("int globalVar; struct C { int member; void f(int param) { int local; ; } };");
+  TopDUContext* top = parse(method, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+
+  CursorInRevision position(0, method.indexOf("; }"));
+  DUContext* ctx = top->findContextAt(position);
+  QVERIFY(ctx);
+
+  {
+    //Without throttling, every batch is shown, the local and class-scope items first
+    RecordingCompletionModel model;
+    StreamingCompletionWorker worker(&model);
+    worker.setStreamInterval(0);
+    QList<CompletionTreeItemPointer> items = worker.complete(ctx, position);
+    QStringList names;
+    foreach(const CompletionTreeItemPointer& item, items)
+      if(item->declaration())
+        names << item->declaration()->identifier().toString();
+    QVERIFY(names.contains("globalVar"));
+
+    QVERIFY(model.batches.size() >= 2);
+    QVERIFY(model.batches.first().contains("local"));
+    QVERIFY(model.batches.first().contains("param"));
+    QVERIFY(model.batches.first().contains("member"));
+    QVERIFY(!model.batches.first().contains("globalVar"));
+    foreach(const QString& name, model.batches.first())
+      QVERIFY(names.contains(name));
+  }
+  {
+    //Batches that arrive too early are held back, and shown once the interval has expired
+    RecordingCompletionModel model;
+    StreamingCompletionWorker worker(&model);
+    worker.setStreamInterval(1000);
+    worker.complete(ctx, position);
+    QVERIFY(model.batches.isEmpty());
+    worker.flushPendingItems();
+    QVERIFY(model.batches.isEmpty());
+
+    worker.setStreamInterval(0);
+    worker.flushPendingItems();
+    QCOMPARE(model.batches.size(), 1);
+    QVERIFY(model.batches.first().contains("local"));
+    QVERIFY(model.batches.first().contains("globalVar"));
+    worker.flushPendingItems();
+    QCOMPARE(model.batches.size(), 1);
+  }
+  {
+    //Aborting while streaming stops the computation of the global items
+    RecordingItemStream stream;
+    Cpp::CodeCompletionContext::Ptr cptr( new Cpp::CodeCompletionContext(DUContextPointer(ctx), "; ", QString(), position) );
+    cptr->setItemStream(&stream);
+    bool abort = false;
+    stream.abort = &abort;
+    stream.abortAfterBatch = 1;
+    cptr->completionItems(abort);
+    QCOMPARE(stream.batches.size(), 1);
+  }
+
+  release(top);
+}
+
+void TestCppCodeCompletion::testCompletionIndex()
+{
+  QCOMPARE(Cpp::CompletionIndex::humps("QStringList"), QString("qsl"));
+  QCOMPARE(Cpp::CompletionIndex::humps("q_string_list"), QString("qsl"));
+  QCOMPARE(Cpp::CompletionIndex::humps("XMLReader"), QString("xr"));
+
+  addInclude("indexed.h", "struct QString {}; class QStringList {}; int qsort; int other;");
+  QByteArray method("#include \"indexed.h\"\nint quality; int f(int param) { ; } int queueLater;");
+  TopDUContext* top = parse(method, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+
+  CursorInRevision position(1, method.indexOf("; }") - method.indexOf('\n') - 1);
+  DUContext* ctx = top->findContextAt(position);
+  QVERIFY(ctx);
+
+  Cpp::CompletionIndex* index = Cpp::CompletionIndex::self();
+  QStringList names;
+  foreach(Declaration* decl, index->globalDeclarations(top, "Q", position))
+    names << decl->identifier().toString();
+  //Declarations of the own file behind the cursor are not visible
+  QCOMPARE(names.toSet(), QSet<QString>() << "QString" << "QStringList" << "qsort" << "quality");
+
+  names.clear();
+  foreach(Declaration* decl, index->globalDeclarations(top, "qsl", position))
+    names << decl->identifier().toString();
+  QCOMPARE(names, QStringList() << "QStringList");
+  QVERIFY(index->globalDeclarations(top, "qsl", position, Cpp::CompletionIndex::MatchPrefix).isEmpty());
+
+  //The global items are restricted to the first typed character, the local ones are all shown
+  CompletionItemTester tester(ctx, "; ", "qu", position);
+  QVERIFY(tester.names.contains("QString"));
+  QVERIFY(tester.names.contains("qsort"));
+  QVERIFY(tester.names.contains("quality"));
+  QVERIFY(tester.names.contains("param"));
+  QVERIFY(!tester.names.contains("other"));
+  QVERIFY(!tester.names.contains("queueLater"));
+
+  const int size = index->size();
+  QVERIFY(size >= 2);
+  index->invalidate(top->ownIndex());
+  QCOMPARE(index->size(), size - 1);
+
+  release(top);
+}
+
+void TestCppCodeCompletion::testCompletionIndexNestedScopes()
+{
+  QByteArray method("enum Color { ColorRed, ColorGreen }; enum class Scoped { ColorScoped };"
+                    "union { int colorBits; float colorValue; }; struct Holder { enum { ColorInner }; int colorMember; };");
+  TopDUContext* top = parse(method, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+
+  //Unscoped enumerators and anonymous union members are global, the members of scoped enums and classes are not
+  QStringList names;
+  foreach(Declaration* decl, Cpp::CompletionIndex::self()->globalDeclarations(top, "color", CursorInRevision::invalid()))
+    names << decl->identifier().toString();
+  QCOMPARE(names.toSet(), QSet<QString>() << "Color" << "ColorRed" << "ColorGreen" << "colorBits" << "colorValue");
+
+  release(top);
+}
+
+void TestCppCodeCompletion::testLookaheadIndex()
+{
+  QByteArray test = "struct Value {}; struct Other {}; struct Inner { Value a; Value b; Other c; };"
+                    "struct Outer { Inner inner; void x() { } };";
+  TopDUContext* top = parse(test, DumpNone);
+  DUChainWriteLocker lock(DUChain::lock());
+  DUContext* testContext = top->childContexts()[3]->childContexts()[1];
+  Declaration* inner = top->localDeclarations()[2];
+  QCOMPARE(inner->identifier().toString(), QString("Inner"));
+
+  Cpp::CompletionIndex* index = Cpp::CompletionIndex::self();
+  index->invalidate(top->ownIndex());
+  Cpp::CompletionIndex::LookaheadMembers members;
+  QVERIFY(!index->lookaheadMembers(inner, false, members));
+
+  CompletionItemTester tester(testContext, "Value v = ");
+  QVERIFY(tester.names.contains("inner.a"));
+  QVERIFY(tester.names.contains("inner.b"));
+  QVERIFY(!tester.names.contains("inner.c"));
+
+  //The members of the container are kept grouped by their type
+  QVERIFY(index->lookaheadMembers(inner, false, members));
+  QCOMPARE(members.size(), 2);
+  QCOMPARE(members[0].members.size(), 2);
+  QCOMPARE(members[1].members.size(), 1);
+
+  //The cached members are used by the following completions
+  CompletionItemTester tester2(testContext, "Other o = ");
+  QVERIFY(tester2.names.contains("inner.c"));
+  QVERIFY(!tester2.names.contains("inner.a"));
+
+  index->invalidate(top->ownIndex());
+  QVERIFY(!index->lookaheadMembers(inner, false, members));
+
+  release(top);
+}
+
 void TestCppCodeCompletion::testLookaheadMatches()
 {
   QByteArray test = "struct One { enum NoLookahead { NO, CAN, SEE, }; int alsoRan; typedef int myInt; };"
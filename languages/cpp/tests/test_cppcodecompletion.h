@@ -145,6 +145,7 @@ private slots:
   void testFilterVoid();
   void testCompletedIncludeFilePath();
   void testMultipleIncludeCompletionItems();
+  void testIncludeDirectoryCache();
   void testParentConstructor_data();
   void testParentConstructor();
   void testOverride_data();
@@ -155,6 +156,10 @@ private slots:
   void testAfterVisibility_data();
   void testAfterVisibility();
   void testNoQuadrupleColon();
+  void testStreamedCompletionItems();
+  void testCompletionIndex();
+  void testCompletionIndexNestedScopes();
+  void testLookaheadIndex();
   void testLookaheadMatches_data();
   void testLookaheadMatches();
   void testMemberAccessInstance();
@@ -0,0 +1,155 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "test_includegraph.h"
+
+#include <QTest>
+#include <qtest_kde.h>
+#include <KTempDir>
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+#include "includegraph.h"
+
+using namespace KDevelop;
+using namespace Cpp;
+
+QTEST_KDEMAIN(TestIncludeGraph, NoGUI)
+
+namespace {
+
+KTempDir* s_dir = 0;
+
+IndexedString file(const QString& name)
+{
+  return IndexedString(s_dir->name() + name);
+}
+
+bool skipHidden(const IndexedString& path)
+{
+  return path.str().endsWith("skipped.h");
+}
+
+void writeFile(const QString& name, const QByteArray& contents)
+{
+  QFile f(s_dir->name() + name);
+  QVERIFY(f.open(QIODevice::WriteOnly));
+  f.write(contents);
+}
+
+}
+
+void TestIncludeGraph::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+
+  m_dir = new KTempDir;
+  s_dir = m_dir;
+
+  writeFile("leaf.h", "class Leaf {};\n");
+  writeFile("mid.h", "#include \"leaf.h\"\n");
+  writeFile("top.h",
+            "#include \"mid.h\"\n"
+            "#include \"leaf.h\"\n"
+            "#include \"skipped.h\"\n"
+            "#ifdef CONDITION\n"
+            "#include \"conditional.h\"\n"
+            "#endif\n"
+            "#include \"missing.h\"\n");
+  writeFile("skipped.h", "#include \"hidden.h\"\n");
+  writeFile("hidden.h", "");
+  writeFile("conditional.h", "");
+  writeFile("cycleA.h", "#include \"cycleB.h\"\n");
+  writeFile("cycleB.h",
+            "#include \"cycleA.h\"\n"
+            "#include \"leaf.h\"\n");
+}
+
+void TestIncludeGraph::cleanupTestCase()
+{
+  s_dir = 0;
+  delete m_dir;
+  TestCore::shutdown();
+}
+
+void TestIncludeGraph::testOrder()
+{
+  QHash<IndexedString, int> levels;
+  const QList<IndexedString> order = IncludeGraph::self()->bottomUp(QList<IndexedString>() << file("top.h"), Path::List(),
+                                                                    &skipHidden, 100, &levels);
+
+  QCOMPARE(order, QList<IndexedString>() << file("leaf.h") << file("mid.h") << file("top.h"));
+  QCOMPARE(levels.size(), 3);
+  QCOMPARE(levels.value(file("leaf.h")), 0);
+  QCOMPARE(levels.value(file("mid.h")), 1);
+  QCOMPARE(levels.value(file("top.h")), 2);
+
+  // without a filter, the skipped file and its include are part of the result
+  const QList<IndexedString> all = IncludeGraph::self()->bottomUp(QList<IndexedString>() << file("top.h"), Path::List(), 0, 100);
+  QCOMPARE(all.size(), 5);
+  QVERIFY(all.indexOf(file("hidden.h")) < all.indexOf(file("skipped.h")));
+  QCOMPARE(all.last(), file("top.h"));
+}
+
+void TestIncludeGraph::testCycle()
+{
+  QHash<IndexedString, int> levels;
+  const QList<IndexedString> order = IncludeGraph::self()->bottomUp(QList<IndexedString>() << file("cycleA.h") << file("cycleB.h"),
+                                                                    Path::List(), 0, 100, &levels);
+
+  QCOMPARE(order, QList<IndexedString>() << file("leaf.h") << file("cycleB.h") << file("cycleA.h"));
+  QCOMPARE(levels.value(file("leaf.h")), 0);
+  QCOMPARE(levels.value(file("cycleB.h")), 1);
+  QCOMPARE(levels.value(file("cycleA.h")), 2);
+  foreach(int level, levels)
+    QVERIFY(level >= 0);
+}
+
+void TestIncludeGraph::testMaxFiles()
+{
+  QFETCH(int, maxFiles);
+
+  const QList<IndexedString> roots = QList<IndexedString>() << file("top.h") << file("cycleA.h");
+  QHash<IndexedString, int> levels;
+  const QList<IndexedString> order = IncludeGraph::self()->bottomUp(roots, Path::List(), 0, maxFiles, &levels);
+
+  QVERIFY(order.size() <= maxFiles);
+  QCOMPARE(levels.size(), order.size());
+  QCOMPARE(order.toSet().size(), order.size());
+
+  // every returned file comes after its includes, apart from the cycle
+  for(int i = 0; i < order.size(); ++i) {
+    foreach(const IndexedString& included, IncludeGraph::self()->includes(order[i], Path::List())) {
+      if(order[i] == file("cycleB.h") && included == file("cycleA.h"))
+        continue;
+      const int position = order.indexOf(included);
+      QVERIFY(position != -1);
+      QVERIFY(position < i);
+    }
+  }
+}
+
+void TestIncludeGraph::testMaxFiles_data()
+{
+  QTest::addColumn<int>("maxFiles");
+
+  for(int maxFiles = 0; maxFiles <= 8; ++maxFiles)
+    QTest::newRow(qPrintable(QString::number(maxFiles))) << maxFiles;
+}
+
+#include "test_includegraph.moc"
@@ -0,0 +1,208 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "test_includeguards.h"
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+#include <tests/testfile.h>
+#include <tests/testproject.h>
+
+#include <language/duchain/duchain.h>
+#include <language/duchain/duchainlock.h>
+#include <language/duchain/duchainutils.h>
+#include <language/duchain/declaration.h>
+#include <language/duchain/parsingenvironment.h>
+#include <language/duchain/problem.h>
+#include <language/editor/modificationrevision.h>
+
+#include "cppduchain/environmentmanager.h"
+#include <language/codegen/coderepresentation.h>
+
+#include <QTest>
+#include <qtest_kde.h>
+#include <KTempDir>
+
+using namespace KDevelop;
+
+QTEST_KDEMAIN(TestIncludeGuards, NoGUI)
+
+namespace {
+
+/// Every parsed version of @p file has to contain the declaration @p name exactly once
+void verifyAllVersionsDeclare(const TestFile& file, const QString& name)
+{
+  QList<ParsingEnvironmentFilePointer> versions = DUChain::self()->allEnvironmentFiles(file.url());
+  QVERIFY(!versions.isEmpty());
+  foreach(const ParsingEnvironmentFilePointer& version, versions) {
+    TopDUContext* top = DUChainUtils::contentContextFromProxyContext(version->topContext());
+    QVERIFY(top);
+    QCOMPARE(top->findLocalDeclarations(Identifier(name)).size(), 1);
+  }
+}
+
+}
+
+void TestIncludeGuards::initTestCase()
+{
+    AutoTestShell::init(QStringList() << "kdevcppsupport");
+    TestCore::initialize(Core::NoUi);
+    TestCore* core = dynamic_cast<TestCore*>(TestCore::self());
+    QVERIFY(core);
+
+    DUChain::self()->disablePersistentStorage();
+    CodeRepresentation::setDiskChangesForbidden(true);
+
+    m_projects = new TestProjectController(core);
+    core->setProjectController(m_projects);
+}
+
+void TestIncludeGuards::cleanupTestCase()
+{
+    TestCore::shutdown();
+}
+
+void TestIncludeGuards::cleanup()
+{
+    m_projects->clearProjects();
+}
+
+void TestIncludeGuards::testGuardedIncludes()
+{
+    TestProject* project = new TestProject;
+    m_projects->addProject(project);
+
+    KTempDir dir;
+    QVERIFY(dir.exists());
+    const QString dirName = QFileInfo(dir.name()).dir().dirName() + "/";
+
+    TestFile pragmaOnce("#pragma once\n"
+                        "class P {};\n",
+                        "h", project, dirName);
+    const QString guardName = "TEST_INCLUDEGUARDS_GUARDED_H";
+    TestFile guarded("#ifndef " + guardName + "\n"
+                     "#define " + guardName + "\n"
+                     "class G {};\n"
+                     "#endif\n",
+                     "h", project, dirName);
+    const QString pragmaOnceName = pragmaOnce.url().toUrl().fileName();
+    const QString guardedName = guarded.url().toUrl().fileName();
+
+    // includes the headers again, relative to its own directory
+    TestFile wrapper("#include \"" + pragmaOnceName + "\"\n"
+                     "#include \"" + guardedName + "\"\n"
+                     "class W {};\n",
+                     "h", project, dirName);
+
+    TestFile active("#include \"" + dirName + pragmaOnceName + "\"\n"
+                    "#include \"" + dirName + guardedName + "\"\n"
+                    "#include \"" + dirName + wrapper.url().toUrl().fileName() + "\"\n"
+                    "#include \"./" + dirName + pragmaOnceName + "\"\n"
+                    "#include \"./" + dirName + guardedName + "\"\n"
+                    "int main() { P p; G g; W w; }\n",
+                    "cpp", project);
+
+    // parse twice, the second run can use the guards recorded in the first one
+    for(int run = 0; run < 2; ++run) {
+        active.parse(TopDUContext::Features(TopDUContext::AllDeclarationsContextsAndUses | TopDUContext::ForceUpdateRecursive));
+        QVERIFY(active.waitForParsed());
+
+        DUChainReadLocker lock;
+
+        QVERIFY(active.topContext());
+        TopDUContext* top = DUChainUtils::contentContextFromProxyContext(active.topContext());
+        QVERIFY(top);
+        QVERIFY(top->problems().isEmpty());
+
+        QCOMPARE(top->findDeclarations(QualifiedIdentifier("P")).size(), 1);
+        QCOMPARE(top->findDeclarations(QualifiedIdentifier("G")).size(), 1);
+        QCOMPARE(top->findDeclarations(QualifiedIdentifier("W")).size(), 1);
+
+        // a guard that is active while a header is included again must not produce an empty version of it
+        verifyAllVersionsDeclare(pragmaOnce, "P");
+        verifyAllVersionsDeclare(guarded, "G");
+
+        TopDUContext* wrapperTop = 0;
+        foreach(const DUContext::Import& import, top->importedParentContexts()) {
+            TopDUContext* imported = dynamic_cast<TopDUContext*>(import.context(top));
+            if(imported && imported->url() == wrapper.url())
+                wrapperTop = imported;
+        }
+        QVERIFY(wrapperTop);
+        QCOMPARE(wrapperTop->findDeclarations(QualifiedIdentifier("P")).size(), 1);
+        QCOMPARE(wrapperTop->findDeclarations(QualifiedIdentifier("G")).size(), 1);
+    }
+}
+
+void TestIncludeGuards::testSkippedIncludeDependency()
+{
+    TestProject* project = new TestProject;
+    m_projects->addProject(project);
+
+    KTempDir dir;
+    QVERIFY(dir.exists());
+    const QString dirName = QFileInfo(dir.name()).dir().dirName() + "/";
+
+    // with full matching the version of the header parsed without the guard does not match the includer,
+    // with the other levels any version would be imported instead of skipping the include
+    const Cpp::EnvironmentManager::MatchingLevel matchingLevel = Cpp::EnvironmentManager::self()->matchingLevel();
+    Cpp::EnvironmentManager::self()->setMatchingLevel(Cpp::EnvironmentManager::Full);
+
+    const QString guardName = "TEST_INCLUDEGUARDS_SKIPPED_H";
+    TestFile header("#ifndef " + guardName + "\n"
+                    "#define " + guardName + "\n"
+                    "class S {};\n"
+                    "#endif\n",
+                    "h", project, dirName);
+
+    // records the guard of the header
+    header.parse(TopDUContext::AllDeclarationsContextsAndUses);
+    QVERIFY(header.waitForParsed());
+
+    // the guard is active, and no version of the header matches, so it is skipped without being opened
+    TestFile includer("#define " + guardName + "\n"
+                      "#include \"" + dirName + header.url().toUrl().fileName() + "\"\n"
+                      "int main() {}\n",
+                      "cpp", project);
+    includer.parse(TopDUContext::AllDeclarationsContextsAndUses);
+    QVERIFY(includer.waitForParsed());
+    {
+        DUChainReadLocker lock;
+        QVERIFY(includer.topContext());
+        QVERIFY(includer.topContext()->findDeclarations(QualifiedIdentifier("S")).isEmpty());
+        QVERIFY(!includer.topContext()->parsingEnvironmentFile()->needsUpdate());
+    }
+
+    // once the header loses its guard, the includer has to be updated
+    QTest::qSleep(1100);
+    header.setFileContents("class S {};\n");
+    ModificationRevision::clearModificationCache(header.url());
+    {
+        DUChainReadLocker lock;
+        QVERIFY(includer.topContext()->parsingEnvironmentFile()->needsUpdate());
+    }
+
+    includer.parse(TopDUContext::AllDeclarationsContextsAndUses);
+    QVERIFY(includer.waitForParsed());
+    {
+        DUChainReadLocker lock;
+        QCOMPARE(includer.topContext()->findDeclarations(QualifiedIdentifier("S")).size(), 1);
+    }
+
+    Cpp::EnvironmentManager::self()->setMatchingLevel(matchingLevel);
+}
+
+#include "test_includeguards.moc"
@@ -0,0 +1,129 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "test_tokencache.h"
+
+#include <QtTest/QTest>
+#include <KTempDir>
+#include <qtest_kde.h>
+
+#include <tests/autotestshell.h>
+#include <tests/testcore.h>
+
+#include "parser/control.h"
+#include "parser/lexer.h"
+#include "parser/parsesession.h"
+#include "parser/rpp/preprocessor.h"
+#include "parser/rpp/pp-engine.h"
+
+#include "tokencache.h"
+
+QTEST_KDEMAIN(TestTokenCache, NoGUI)
+
+using namespace KDevelop;
+
+namespace {
+
+/// Source with identifiers merged by ##, which makes the lexer change the contents
+QByteArray mergingSource(int lines)
+{
+  QByteArray code("#define CAT(a, b) a ## b\n");
+  for (int i = 0; i < lines; ++i) {
+    const QByteArray number = QByteArray::number(i);
+    code += "int CAT(var, " + number + ") = " + number + ";\n";
+  }
+  return code;
+}
+
+ParseSession* preprocessedSession(const QByteArray& code)
+{
+  rpp::Preprocessor preprocessor;
+  rpp::pp pp(&preprocessor);
+  ParseSession* session = new ParseSession;
+  session->setContentsAndGenerateLocationTable(pp.processFile("anonymous", code));
+  return session;
+}
+
+}
+
+void TestTokenCache::initTestCase()
+{
+  AutoTestShell::init();
+  TestCore::initialize(Core::NoUi);
+}
+
+void TestTokenCache::cleanupTestCase()
+{
+  TestCore::shutdown();
+}
+
+void TestTokenCache::testCacheHit()
+{
+  const QByteArray code = mergingSource(1000);
+
+  // reference result, straight from the lexer
+  QScopedPointer<ParseSession> expected(preprocessedSession(code));
+  QVERIFY(expected->size() >= Cpp::TokenCache::MinimumContentsSize);
+  expected->token_stream = new TokenStream(expected.data());
+  Control control;
+  Lexer lexer(&control);
+  lexer.tokenize(expected.data());
+  QVERIFY(!lexer.contentChanges().isEmpty());
+
+  KTempDir dir;
+  Cpp::TokenCache cache(dir.name() + "tokens");
+
+  QScopedPointer<ParseSession> first(preprocessedSession(code));
+  Control firstControl;
+  QVERIFY(!cache.tokenize(first.data(), &firstControl));
+
+  QScopedPointer<ParseSession> second(preprocessedSession(code));
+  Control secondControl;
+  QVERIFY(cache.tokenize(second.data(), &secondControl));
+
+  ParseSession* sessions[] = { first.data(), second.data() };
+  for (int s = 0; s < 2; ++s) {
+    const TokenStream* tokens = sessions[s]->token_stream;
+    QCOMPARE(tokens->size(), expected->token_stream->size());
+    for (int i = 0; i < tokens->size(); ++i)
+      QVERIFY((*tokens)[i] == (*expected->token_stream)[i]);
+
+    // the identifier merges of the lexer have to be replayed on a cache hit
+    QCOMPARE(sessions[s]->contentsVector(), expected->contentsVector());
+  }
+
+  // different contents of the same size must not hit the entry
+  QScopedPointer<ParseSession> other(preprocessedSession(QByteArray(code).replace("int CAT", "long CAT")));
+  QCOMPARE(other->size(), expected->size());
+  Control otherControl;
+  QVERIFY(!cache.tokenize(other.data(), &otherControl));
+}
+
+void TestTokenCache::testSmallContents()
+{
+  KTempDir dir;
+  Cpp::TokenCache cache(dir.name() + "tokens");
+
+  const QByteArray code = mergingSource(5);
+  for (int i = 0; i < 2; ++i) {
+    QScopedPointer<ParseSession> session(preprocessedSession(code));
+    Control control;
+    QVERIFY(!cache.tokenize(session.data(), &control));
+    QVERIFY(!session->token_stream->isEmpty());
+  }
+}
+
+#include "test_tokencache.moc"
@@ -0,0 +1,196 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "tokencache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <KDebug>
+#include <KGlobal>
+
+#include <language/duchain/repositories/itemrepositoryregistry.h>
+
+#include "parser/control.h"
+#include "parser/lexer.h"
+#include "parser/parsesession.h"
+
+using namespace Cpp;
+
+namespace {
+const quint32 cacheMagic = 0x4b544f4b; // KTOK
+/// Increase whenever the lexer output or the file format changes
+const quint32 cacheVersion = 1;
+}
+
+K_GLOBAL_STATIC(TokenCache, globalTokenCache)
+
+TokenCache* TokenCache::self()
+{
+  return globalTokenCache;
+}
+
+TokenCache::TokenCache()
+  : m_directory(KDevelop::globalItemRepositoryRegistry().path() + "/cpp_token_cache")
+  , m_disabled(0)
+  , m_entries(-1)
+{
+}
+
+TokenCache::TokenCache(const QString& directory)
+  : m_directory(directory)
+  , m_disabled(directory.isEmpty())
+  , m_entries(-1)
+{
+}
+
+QString TokenCache::fileForKey(const QByteArray& key) const
+{
+  return m_directory + '/' + QString::fromLatin1(key);
+}
+
+bool TokenCache::tokenize(ParseSession* session, Control* control)
+{
+  if (!session->token_stream)
+    session->token_stream = new TokenStream(session);
+  Q_ASSERT(session->token_stream->isEmpty());
+
+  const PreprocessedContents& contents = session->contentsVector();
+  if (contents.size() < MinimumContentsSize || m_disabled) {
+    Lexer lexer(control);
+    lexer.tokenize(session);
+    return false;
+  }
+
+  // hash the contents before lexing, the lexer changes them
+  const QByteArray key = QCryptographicHash::hash(
+      QByteArray::fromRawData(reinterpret_cast<const char*>(contents.constData()), contents.size() * sizeof(uint)),
+      QCryptographicHash::Md5).toHex();
+  const QString fileName = fileForKey(key);
+
+  if (load(fileName, session))
+    return true;
+
+  Lexer lexer(control);
+  lexer.tokenize(session);
+  if (!control->hasProblem(KDevelop::ProblemData::Lexer))
+    store(fileName, session, lexer.contentChanges());
+  return false;
+}
+
+bool TokenCache::load(const QString& fileName, ParseSession* session) const
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream stream(&file);
+  quint32 magic, version, contentsSize, tokenCount, changeCount;
+  stream >> magic >> version >> contentsSize >> tokenCount;
+  if (stream.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion
+      || contentsSize != static_cast<quint32>(session->contentsVector().size()))
+  {
+    return false;
+  }
+
+  TokenStream* tokens = session->token_stream;
+  tokens->resize(tokenCount);
+  const int tokenBytes = tokenCount * sizeof(Token);
+  if (stream.readRawData(reinterpret_cast<char*>(tokens->data()), tokenBytes) != tokenBytes) {
+    tokens->clear();
+    return false;
+  }
+
+  stream >> changeCount;
+  QVector<QPair<quint32, quint32> > changes;
+  changes.reserve(changeCount);
+  for (quint32 i = 0; i < changeCount && stream.status() == QDataStream::Ok; ++i) {
+    quint32 offset, value;
+    stream >> offset >> value;
+    if (offset >= contentsSize)
+      break;
+    changes.append(qMakePair(offset, value));
+  }
+  if (stream.status() != QDataStream::Ok || static_cast<quint32>(changes.size()) != changeCount) {
+    kWarning() << "dropping broken token cache file" << fileName;
+    tokens->clear();
+    return false;
+  }
+
+  uint* contents = session->contents();
+  for (int i = 0; i < changes.size(); ++i)
+    contents[changes[i].first] = changes[i].second;
+
+  return true;
+}
+
+void TokenCache::store(const QString& fileName, ParseSession* session, const QVector<QPair<uint, uint> >& contentChanges)
+{
+  {
+    QMutexLocker lock(&m_mutex);
+    if (m_entries == -1) {
+      if (!QDir().mkpath(m_directory)) {
+        kWarning() << "cannot create token cache directory" << m_directory;
+        m_disabled = 1;
+        return;
+      }
+      m_entries = QDir(m_directory).entryList(QDir::Files).size();
+    }
+    if (++m_entries > MaximumEntries)
+      removeOldEntries();
+  }
+
+  // write to a temporary file first, so other threads never see a half-written entry
+  const QString tempName = fileName + '.' + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+  QFile file(tempName);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  const TokenStream* tokens = session->token_stream;
+  QDataStream stream(&file);
+  stream << cacheMagic << cacheVersion << static_cast<quint32>(session->contentsVector().size())
+         << static_cast<quint32>(tokens->size());
+  stream.writeRawData(reinterpret_cast<const char*>(tokens->constData()), tokens->size() * sizeof(Token));
+  stream << static_cast<quint32>(contentChanges.size());
+  for (int i = 0; i < contentChanges.size(); ++i)
+    stream << static_cast<quint32>(contentChanges[i].first) << static_cast<quint32>(contentChanges[i].second);
+  file.close();
+
+  if (stream.status() != QDataStream::Ok) {
+    QFile::remove(tempName);
+    return;
+  }
+
+  QFile::remove(fileName);
+  if (!QFile::rename(tempName, fileName))
+    QFile::remove(tempName);
+}
+
+void TokenCache::removeOldEntries()
+{
+  QDir dir(m_directory);
+  const QFileInfoList entries = dir.entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+  const int remove = entries.size() / 2;
+  for (int i = 0; i < remove; ++i)
+    QFile::remove(entries[i].absoluteFilePath());
+  m_entries = entries.size() - remove;
+  kDebug() << "removed" << remove << "token cache entries";
+}
@@ -0,0 +1,80 @@
+/*
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License version 2 as published by the Free Software Foundation.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CPP_TOKENCACHE_H
+#define CPP_TOKENCACHE_H
+
+#include <QString>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include "parser/rpp/chartools.h"
+
+class ParseSession;
+class Control;
+
+namespace Cpp {
+
+/**
+ * Content-addressed on-disk cache of lexer results.
+ *
+ * The key is a hash of the preprocessed contents, so re-parsing a file whose
+ * preprocessed contents did not change (e.g. after touching it, or after a change
+ * in an unrelated header) restores the token stream instead of running the lexer.
+ *
+ * The preprocessed contents contain IndexedString indices, which are only valid
+ * together with the DUChain repository, so the cache lives in the repository directory.
+ */
+class TokenCache
+{
+public:
+  static TokenCache* self();
+
+  /**
+   * Fill the token stream of @p session, either from the cache or by running the lexer.
+   * Lexer problems are reported to @p control, results with problems are not cached.
+   *
+   * @return true if the tokens were restored from the cache.
+   */
+  bool tokenize(ParseSession* session, Control* control);
+
+  enum {
+    /// Smaller contents are lexed faster than the cache file can be read
+    MinimumContentsSize = 4096,
+    /// When there are more cache files, the older half is removed
+    MaximumEntries = 4096
+  };
+
+  TokenCache();
+  /// Creates a cache in @p directory instead of the DUChain repository directory, for tests
+  explicit TokenCache(const QString& directory);
+
+private:
+  QString fileForKey(const QByteArray& key) const;
+  bool load(const QString& fileName, ParseSession* session) const;
+  void store(const QString& fileName, ParseSession* session, const QVector<QPair<uint, uint> >& contentChanges);
+  void removeOldEntries();
+
+  const QString m_directory;
+  /// Set when the directory cannot be created, read without holding m_mutex
+  QAtomicInt m_disabled;
+  QMutex m_mutex;
+  int m_entries;
+};
+
+}
+
+#endif // CPP_TOKENCACHE_H
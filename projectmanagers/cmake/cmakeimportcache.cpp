@@ -0,0 +1,478 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "cmakeimportcache.h"
+#include "cmakeprojectdata.h"
+#include "cmakeprojectvisitor.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <KDebug>
+#include <KSaveFile>
+
+/// Increase when the stored data changes
+static const quint32 cacheVersion = 2;
+
+/// The changes that interpreting the CMakeLists.txt of a directory made to the project data
+struct CMakeImportResult
+{
+    QByteArray key;
+    /// The included and read files, and the digests of their contents
+    QHash<QString, QByteArray> files;
+    /// The paths that were looked at, and their FileSystemDependencies::PathState
+    QHash<QString, int> paths;
+    QVector<GlobDependency> globs;
+    /// The variables taken from the process environment, and their values
+    QHash<QString, QString> environment;
+
+    QString projectName;
+    QVector<Subdirectory> subdirectories;
+    QVector<Target> targets;
+    QVector<Test> testSuites;
+    CMakeDefinitions definitions;
+    QHash<QString, QString> targetAlias;
+    /// Variables set in the scope of the directory
+    QHash<QString, QStringList> scopeVariables;
+    /// Variables that were changed outside of the scope, like the cached ones
+    QHash<QString, QStringList> globalVariables;
+    QStringList removedVariables;
+    /// New or redefined macros and functions
+    MacroMap macros;
+    /// Changed property entries
+    CMakeProperties properties;
+};
+
+static QDataStream& operator<<(QDataStream& stream, const CMakeFunctionArgument& arg)
+{
+    return stream << arg.value << arg.quoted << arg.line << arg.column;
+}
+
+static QDataStream& operator>>(QDataStream& stream, CMakeFunctionArgument& arg)
+{
+    stream >> arg.value >> arg.quoted >> arg.line >> arg.column;
+    arg.segments = CMakeFunctionArgument::parseReferences(arg.value);
+    return stream;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const CMakeFunctionDesc& desc)
+{
+    return stream << desc.name << desc.arguments << desc.filePath << desc.line << desc.column
+                  << desc.endLine << desc.endColumn;
+}
+
+static QDataStream& operator>>(QDataStream& stream, CMakeFunctionDesc& desc)
+{
+    return stream >> desc.name >> desc.arguments >> desc.filePath >> desc.line >> desc.column
+                  >> desc.endLine >> desc.endColumn;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const Subdirectory& subdirectory)
+{
+    return stream << subdirectory.name << subdirectory.desc << subdirectory.build_dir;
+}
+
+static QDataStream& operator>>(QDataStream& stream, Subdirectory& subdirectory)
+{
+    return stream >> subdirectory.name >> subdirectory.desc >> subdirectory.build_dir;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const Target& target)
+{
+    //the du-chain is persistent as well, so the declaration stays valid while its file is unchanged
+    return stream << target.declaration.topContextIndex() << target.declaration.localIndex()
+                  << target.files << qint32(target.type) << target.desc << target.name;
+}
+
+static QDataStream& operator>>(QDataStream& stream, Target& target)
+{
+    quint32 topContext, declaration;
+    qint32 type;
+    stream >> topContext >> declaration >> target.files >> type >> target.desc >> target.name;
+    target.declaration = KDevelop::IndexedDeclaration(topContext, declaration);
+    target.type = Target::Type(type);
+    return stream;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const Test& test)
+{
+    return stream << test.name << test.executable << test.arguments << test.properties;
+}
+
+static QDataStream& operator>>(QDataStream& stream, Test& test)
+{
+    return stream >> test.name >> test.executable >> test.arguments >> test.properties;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const Macro& macro)
+{
+    return stream << macro.name << macro.knownArgs << macro.code << macro.isFunction;
+}
+
+static QDataStream& operator>>(QDataStream& stream, Macro& macro)
+{
+    return stream >> macro.name >> macro.knownArgs >> macro.code >> macro.isFunction;
+}
+
+static QDataStream& operator<<(QDataStream& stream, const GlobDependency& glob)
+{
+    return stream << glob.startPath << glob.expression << glob.recursive << glob.followSymlinks << glob.matches;
+}
+
+static QDataStream& operator>>(QDataStream& stream, GlobDependency& glob)
+{
+    return stream >> glob.startPath >> glob.expression >> glob.recursive >> glob.followSymlinks >> glob.matches;
+}
+
+static void writeProperties(QDataStream& stream, const CMakeProperties& properties)
+{
+    stream << qint32(properties.size());
+    for (CMakeProperties::const_iterator it = properties.constBegin(), itEnd = properties.constEnd(); it != itEnd; ++it)
+        stream << qint32(it.key()) << *it;
+}
+
+static void readProperties(QDataStream& stream, CMakeProperties& properties)
+{
+    qint32 count;
+    stream >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        qint32 type;
+        CategoryType category;
+        stream >> type >> category;
+        properties.insert(PropertyType(type), category);
+    }
+}
+
+static QDataStream& operator<<(QDataStream& stream, const CMakeImportResult& result)
+{
+    stream << result.key << result.files << result.paths << result.globs << result.environment << result.projectName << result.subdirectories << result.targets
+           << result.testSuites << result.definitions << result.targetAlias << result.scopeVariables
+           << result.globalVariables << result.removedVariables << result.macros;
+    writeProperties(stream, result.properties);
+    return stream;
+}
+
+static QDataStream& operator>>(QDataStream& stream, CMakeImportResult& result)
+{
+    stream >> result.key >> result.files >> result.paths >> result.globs >> result.environment >> result.projectName >> result.subdirectories >> result.targets
+           >> result.testSuites >> result.definitions >> result.targetAlias >> result.scopeVariables
+           >> result.globalVariables >> result.removedVariables >> result.macros;
+    readProperties(stream, result.properties);
+    return stream;
+}
+
+/// Writes @p hash ordered by the keys, so equal contents always give the same digest
+template<class T>
+static void writeSorted(QDataStream& stream, const QHash<QString, T>& hash)
+{
+    QStringList keys = hash.keys();
+    qSort(keys);
+    stream << qint32(keys.size());
+    foreach (const QString& key, keys)
+        stream << key << hash.value(key);
+}
+
+CMakeImportCache::CMakeImportCache(const QString& file, const CacheValues& cache, const QMap<QString, QString>& environment)
+    : m_file(file)
+    , m_changed(false)
+{
+    QStringList keys = cache.keys();
+    qSort(keys);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    foreach (const QString& key, keys) {
+        hash.addData(key.toUtf8());
+        hash.addData("=", 1);
+        hash.addData(cache.value(key).value.toUtf8());
+        hash.addData("\n", 1);
+    }
+    //$ENV{} and the find_*() search paths are resolved with the environment profile first
+    hash.addData("\n", 1);
+    for (QMap<QString, QString>::const_iterator it = environment.constBegin(), itEnd = environment.constEnd(); it != itEnd; ++it) {
+        hash.addData(it.key().toUtf8());
+        hash.addData("=", 1);
+        hash.addData(it->toUtf8());
+        hash.addData("\n", 1);
+    }
+    m_cacheDigest = hash.result();
+}
+
+CMakeImportCache::~CMakeImportCache()
+{
+}
+
+bool CMakeImportCache::load()
+{
+    QFile f(m_file);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+    quint32 version;
+    stream >> version;
+    if (version != cacheVersion) {
+        kDebug(9042) << "discarding the import cache" << m_file << "of version" << version;
+        return false;
+    }
+
+    QHash<QString, CMakeImportResult> results;
+    stream >> results;
+    if (stream.status() != QDataStream::Ok) {
+        kWarning(9042) << "could not read the import cache" << m_file;
+        return false;
+    }
+
+    //Drop the results of the directories that were removed, they would be kept forever otherwise
+    bool pruned = false;
+    for (QHash<QString, CMakeImportResult>::iterator it = results.begin(); it != results.end(); ) {
+        if (QFileInfo(it.key()).isDir()) {
+            ++it;
+        } else {
+            it = results.erase(it);
+            pruned = true;
+        }
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_results = results;
+    m_changed = pruned;
+    kDebug(9042) << "loaded" << m_results.size() << "directories from the import cache" << m_file;
+    return true;
+}
+
+bool CMakeImportCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_changed)
+        return true;
+
+    QDir().mkpath(QFileInfo(m_file).absolutePath());
+    KSaveFile f(m_file);
+    if (!f.open(QIODevice::WriteOnly)) {
+        kWarning(9042) << "could not write the import cache" << m_file;
+        return false;
+    }
+    QDataStream stream(&f);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << cacheVersion << m_results;
+    if (!f.finalize())
+        return false;
+    m_changed = false;
+    return true;
+}
+
+QByteArray CMakeImportCache::fileDigest(const QString& file)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<QString, QByteArray>::const_iterator it = m_fileDigests.constFind(file);
+        if (it != m_fileDigests.constEnd())
+            return *it;
+    }
+
+    QByteArray digest;
+    QFile f(file);
+    if (f.open(QIODevice::ReadOnly))
+        digest = QCryptographicHash::hash(f.readAll(), QCryptographicHash::Sha1);
+
+    QMutexLocker lock(&m_mutex);
+    m_fileDigests.insert(file, digest);
+    return digest;
+}
+
+QByteArray CMakeImportCache::macroDigest(const Macro& macro)
+{
+    //The same macro is in the data of every directory, so it is only serialized once
+    QString id = macro.name;
+    if (!macro.code.isEmpty())
+        id += '@' + macro.code.first().filePath + ':' + QString::number(macro.code.first().line);
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<QString, QByteArray>::const_iterator it = m_macroDigests.constFind(id);
+        if (it != m_macroDigests.constEnd())
+            return *it;
+    }
+
+    QByteArray buffer;
+    QDataStream stream(&buffer, QIODevice::WriteOnly);
+    stream << macro;
+    const QByteArray digest = QCryptographicHash::hash(buffer, QCryptographicHash::Sha1);
+
+    QMutexLocker lock(&m_mutex);
+    m_macroDigests.insert(id, digest);
+    return digest;
+}
+
+QByteArray CMakeImportCache::key(const QString& cmakeLists, const CMakeProjectData& data)
+{
+    QByteArray buffer;
+    QDataStream stream(&buffer, QIODevice::WriteOnly);
+    stream << fileDigest(cmakeLists) << m_cacheDigest << data.modulePath;
+
+    QStringList names = data.vm.uniqueKeys();
+    qSort(names);
+    foreach (const QString& name, names)
+        stream << name << data.vm.values(name);
+
+    writeSorted(stream, data.definitions);
+    writeSorted(stream, data.targetAlias);
+    for (CMakeProperties::const_iterator it = data.properties.constBegin(), itEnd = data.properties.constEnd(); it != itEnd; ++it) {
+        stream << qint32(it.key());
+        writeSorted(stream, *it);
+    }
+
+    QStringList macros = data.mm.keys();
+    qSort(macros);
+    foreach (const QString& name, macros)
+        stream << name << macroDigest(data.mm.value(name));
+
+    return QCryptographicHash::hash(buffer, QCryptographicHash::Sha1);
+}
+
+bool CMakeImportCache::isValid(const QString& directory, const CMakeImportResult& result)
+{
+    for (QHash<QString, QByteArray>::const_iterator it = result.files.constBegin(); it != result.files.constEnd(); ++it) {
+        if (fileDigest(it.key()) != *it) {
+            kDebug(9042) << "not using the import cache for" << directory << "because" << it.key() << "changed";
+            return false;
+        }
+    }
+
+    for (QHash<QString, int>::const_iterator it = result.paths.constBegin(); it != result.paths.constEnd(); ++it) {
+        if (FileSystemDependencies::pathState(QFileInfo(it.key())) != *it) {
+            kDebug(9042) << "not using the import cache for" << directory << "because" << it.key() << "was added or removed";
+            return false;
+        }
+    }
+
+    for (QHash<QString, QString>::const_iterator it = result.environment.constBegin(); it != result.environment.constEnd(); ++it) {
+        if (QString::fromLatin1(qgetenv(it.key().toLatin1())) != *it) {
+            kDebug(9042) << "not using the import cache for" << directory << "because the environment variable" << it.key() << "changed";
+            return false;
+        }
+    }
+
+    foreach (const GlobDependency& glob, result.globs) {
+        if (CMakeProjectVisitor::traverseGlob(glob.startPath, glob.expression, glob.recursive, glob.followSymlinks) != glob.matches) {
+            kDebug(9042) << "not using the import cache for" << directory << "because the matches of" << glob.expression << "changed";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CMakeImportCache::restore(const QString& directory, const QByteArray& key, CMakeProjectData* data)
+{
+    CMakeImportResult result;
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<QString, CMakeImportResult>::const_iterator it = m_results.constFind(directory);
+        if (it == m_results.constEnd() || it->key != key)
+            return false;
+        result = *it;
+    }
+
+    if (!isValid(directory, result))
+        return false;
+
+    data->projectName = result.projectName;
+    data->subdirectories = result.subdirectories;
+    data->targets = result.targets;
+    data->testSuites = result.testSuites;
+    data->definitions = result.definitions;
+    data->targetAlias = result.targetAlias;
+
+    foreach (const QString& name, result.removedVariables)
+        data->vm.remove(name);
+    for (QHash<QString, QStringList>::const_iterator it = result.globalVariables.constBegin(); it != result.globalVariables.constEnd(); ++it)
+        data->vm.insertGlobal(it.key(), *it);
+    for (QHash<QString, QStringList>::const_iterator it = result.scopeVariables.constBegin(); it != result.scopeVariables.constEnd(); ++it)
+        data->vm.insert(it.key(), *it);
+
+    for (MacroMap::const_iterator it = result.macros.constBegin(); it != result.macros.constEnd(); ++it)
+        data->mm.insert(it.key(), *it);
+
+    for (CMakeProperties::const_iterator it = result.properties.constBegin(); it != result.properties.constEnd(); ++it) {
+        CategoryType& category = data->properties[it.key()];
+        for (CategoryType::const_iterator cit = it->constBegin(); cit != it->constEnd(); ++cit)
+            category.insert(cit.key(), *cit);
+    }
+    return true;
+}
+
+void CMakeImportCache::store(const QString& directory, const QByteArray& key, const CMakeProjectData& before,
+                             const CMakeProjectData& after, const FileSystemDependencies& dependencies)
+{
+    CMakeImportResult result;
+    result.key = key;
+    foreach (const QString& file, dependencies.readFiles)
+        result.files.insert(file, fileDigest(file));
+    result.paths = dependencies.paths;
+    result.globs = dependencies.globs;
+    result.environment = dependencies.environment;
+
+    result.projectName = after.projectName;
+    result.subdirectories = after.subdirectories;
+    result.targets = after.targets;
+    result.testSuites = after.testSuites;
+    result.definitions = after.definitions;
+    result.targetAlias = after.targetAlias;
+
+    const QSet<QString> scope = after.vm.currentScope();
+    foreach (const QString& name, scope)
+        result.scopeVariables.insert(name, after.vm.value(name));
+    foreach (const QString& name, after.vm.uniqueKeys()) {
+        if (scope.contains(name))
+            continue;
+        const QStringList value = after.vm.value(name);
+        if (!before.vm.contains(name) || before.vm.value(name) != value)
+            result.globalVariables.insert(name, value);
+    }
+    foreach (const QString& name, before.vm.uniqueKeys()) {
+        if (!after.vm.contains(name))
+            result.removedVariables += name;
+    }
+
+    for (MacroMap::const_iterator it = after.mm.constBegin(); it != after.mm.constEnd(); ++it) {
+        MacroMap::const_iterator old = before.mm.constFind(it.key());
+        if (old == before.mm.constEnd() || macroDigest(*old) != macroDigest(*it))
+            result.macros.insert(it.key(), *it);
+    }
+
+    for (CMakeProperties::const_iterator it = after.properties.constBegin(); it != after.properties.constEnd(); ++it) {
+        const CategoryType previous = before.properties.value(it.key());
+        for (CategoryType::const_iterator cit = it->constBegin(); cit != it->constEnd(); ++cit) {
+            CategoryType::const_iterator pit = previous.constFind(cit.key());
+            if (pit == previous.constEnd() || *pit != *cit)
+                result.properties[it.key()].insert(cit.key(), *cit);
+        }
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_results.insert(directory, result);
+    m_changed = true;
+}
+
+int CMakeImportCache::size() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_results.size();
+}
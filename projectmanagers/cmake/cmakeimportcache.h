@@ -0,0 +1,99 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef CMAKEIMPORTCACHE_H
+#define CMAKEIMPORTCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QStringList>
+
+#include "cmakeexport.h"
+#include "cmaketypes.h"
+
+struct CMakeProjectData;
+struct CMakeImportResult;
+
+/**
+ * Keeps the results of interpreting the CMakeLists.txt of each directory between sessions.
+ *
+ * A result is stored as the changes the interpretation made to the project data. It is identified
+ * by a key that covers the contents of the CMakeLists.txt, the CMakeCache.txt, the environment profile
+ * and the project data the interpretation starts from. Additionally, what the interpretation took from
+ * the file system and the process environment is checked before a result is reused: the contents of
+ * the included and read files, the paths that find_*() and if(EXISTS) looked at, the matches of
+ * file(GLOB) and the environment variables.
+ *
+ * All functions may be called from multiple threads.
+ */
+class KDEVCMAKECOMMON_EXPORT CMakeImportCache
+{
+public:
+    /**
+     * @param file where the results are stored
+     * @param cache the values of the CMakeCache.txt, which all results depend on
+     * @param environment the environment profile of the project, which all results depend on
+     */
+    CMakeImportCache(const QString& file, const CacheValues& cache,
+                     const QMap<QString, QString>& environment = QMap<QString, QString>());
+    ~CMakeImportCache();
+
+    /**
+     * Reads the stored results, and drops those of directories that do not exist anymore.
+     * @returns false if there are none or they are of another format
+     */
+    bool load();
+
+    /** Writes the results, if there are new ones */
+    bool save();
+
+    /** Identifies interpreting @p cmakeLists with @p data as the initial state */
+    QByteArray key(const QString& cmakeLists, const CMakeProjectData& data);
+
+    /**
+     * Applies the result stored for @p directory to @p data, if it was stored with @p key
+     * and none of its dependencies changed since.
+     *
+     * @returns false if there is no valid result, @p data is unchanged then
+     */
+    bool restore(const QString& directory, const QByteArray& key, CMakeProjectData* data);
+
+    /** Stores how interpreting @p directory changed @p before into @p after */
+    void store(const QString& directory, const QByteArray& key, const CMakeProjectData& before,
+               const CMakeProjectData& after, const FileSystemDependencies& dependencies);
+
+    /** Count of stored results */
+    int size() const;
+
+private:
+    bool isValid(const QString& directory, const CMakeImportResult& result);
+    QByteArray fileDigest(const QString& file);
+    QByteArray macroDigest(const Macro& macro);
+
+    const QString m_file;
+    QByteArray m_cacheDigest;
+    mutable QMutex m_mutex;
+    QHash<QString, CMakeImportResult> m_results;
+    QHash<QString, QByteArray> m_fileDigests;
+    QHash<QString, QByteArray> m_macroDigests;
+    bool m_changed;
+};
+
+#endif
@@ -25,6 +25,7 @@
 #include "cmakemanager.h"
 #include "cmakeprojectdata.h"
 #include "cmakemodelitems.h"
+#include "cmakeimportcache.h"
 #include <project/projectmodel.h>
 #include <project/projectfiltermanager.h>
 #include <language/duchain/duchain.h>
@@ -33,8 +34,15 @@
 #include <interfaces/iproject.h>
 #include <util/environmentgrouplist.h>
 #include <KCompositeJob>
+#include <KStandardDirs>
 #include <QtConcurrentRun>
 #include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 using namespace KDevelop;
 
@@ -77,6 +85,91 @@ private:
     bool m_started;
 };
 
+/// A directory that is interpreted in parallel to its siblings
+struct ImportedDirectory
+{
+    ImportedDirectory() : parent(-1), hasCMakeLists(false), elapsed(0), criticalPath(0) {}
+
+    Path path;
+    int parent;
+    QList<int> children;
+    ReferencedTopDUContext parentTop;
+    ReferencedTopDUContext top;
+    /// The data of the parent directory at first, then the data after interpreting this directory
+    CMakeProjectData data;
+    bool hasCMakeLists;
+    Path::List subdirectories;
+    qint64 elapsed;
+    /// Time from the start of the import until this directory is done, with enough threads
+    qint64 criticalPath;
+};
+
+/// The indexes of the directories that were interpreted, in the order they finished
+class FinishedDirectories
+{
+public:
+    void push(int index)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_finished.enqueue(index);
+        m_condition.wakeOne();
+    }
+
+    int pop()
+    {
+        QMutexLocker lock(&m_mutex);
+        while (m_finished.isEmpty())
+            m_condition.wait(&m_mutex);
+        return m_finished.dequeue();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<int> m_finished;
+};
+
+class DirectoryImportRunnable : public QRunnable
+{
+public:
+    DirectoryImportRunnable(CMakeImportJob* job, ImportedDirectory* dir, int index, FinishedDirectories* finished)
+        : m_job(job)
+        , m_dir(dir)
+        , m_index(index)
+        , m_finished(finished)
+    {}
+
+    virtual void run()
+    {
+        m_job->interpretDirectory(m_dir);
+        m_finished->push(m_index);
+    }
+
+private:
+    CMakeImportJob* m_job;
+    ImportedDirectory* m_dir;
+    int m_index;
+    FinishedDirectories* m_finished;
+};
+
+/// Adds to @p merged what was changed in @p properties compared to the @p parent directory
+static void mergeProperties(CMakeProperties& merged, const CMakeProperties& properties, const CMakeProperties& parent)
+{
+    for (CMakeProperties::const_iterator it = properties.constBegin(), itEnd = properties.constEnd(); it != itEnd; ++it) {
+        const CategoryType parentCategory = parent.value(it.key());
+        //most categories are inherited unchanged, then comparing them is cheap because they are shared
+        if (*it == parentCategory)
+            continue;
+
+        CategoryType& category = merged[it.key()];
+        for (CategoryType::const_iterator cit = it->constBegin(), citEnd = it->constEnd(); cit != citEnd; ++cit) {
+            CategoryType::const_iterator pit = parentCategory.constFind(cit.key());
+            if (pit == parentCategory.constEnd() || *pit != *cit)
+                category.insert(cit.key(), *cit);
+        }
+    }
+}
+
 CMakeImportJob::CMakeImportJob(ProjectFolderItem* dom, CMakeManager* parent)
     : KJob(parent)
     , m_project(dom->project())
@@ -84,8 +177,14 @@ CMakeImportJob::CMakeImportJob(ProjectFolderItem* dom, CMakeManager* parent)
     , m_data(parent->projectData(dom->project()))
     , m_manager(parent)
     , m_futureWatcher(new QFutureWatcher<void>)
+    , m_importCache(0)
+    , m_useImportCache(true)
 {
     connect(m_futureWatcher, SIGNAL(finished()), SLOT(importFinished()));
+
+    //The configuration is read here, so the import threads don't access it concurrently
+    const KDevelop::EnvironmentGroupList env( KGlobal::config() );
+    m_environment = env.variables(CMake::currentEnvironment(m_project));
 }
 
 void CMakeImportJob::start()
@@ -108,6 +207,20 @@ void CMakeImportJob::importFinished()
 
 void CMakeImportJob::initialize()
 {
+    if (readCompilationDatabase() && CMake::importFromCompilationDatabase(m_project)) {
+        //CMake already resolved the flags of the compiled files, so only the files need to be listed.
+        //There are no targets then, they are only known by interpreting the CMakeLists.txt files.
+        const Path cachefile(Path(CMake::currentBuildDir(m_project)), "CMakeCache.txt");
+        m_data.cache = CMakeParserUtils::readCache(cachefile);
+        CMakeCommitChangesJob* commitJob = new CMakeCommitChangesJob(m_project->path(), m_manager, m_project);
+        commitJob->moveToThread(thread());
+        m_jobs += commitJob;
+        return;
+    }
+
+    //Otherwise the database only has the flags of the compiled files, the targets and the flags
+    //of the other files come from interpreting the CMakeLists.txt files
+
     ReferencedTopDUContext ctx;
     ProjectBaseItem* parent = m_dom->parent();
     while (parent && !ctx) {
@@ -118,7 +231,49 @@ void CMakeImportJob::initialize()
     if (!ctx) {
         ctx = initializeProject(dynamic_cast<CMakeFolderItem*>(m_dom));
     }
-    importDirectory(m_project, m_dom->path(), ctx);
+
+    const KUrl buildDir = CMake::currentBuildDir(m_project);
+    if (!buildDir.isEmpty()) {
+        const QString cacheName = QString::number(qHash(buildDir.toLocalFile(KUrl::RemoveTrailingSlash)), 16);
+        m_importCache = new CMakeImportCache(KStandardDirs::locateLocal("cache", "kdevcmakemanager/" + cacheName), m_data.cache, m_environment);
+        m_importCache->load();
+    }
+
+    if (CMake::parallelImport(m_project))
+        importDirectoriesInParallel(m_dom->path(), ctx);
+    else
+        importDirectory(m_project, m_dom->path(), ctx);
+
+    if (m_importCache) {
+        m_importCache->save();
+        delete m_importCache;
+        m_importCache = 0;
+    }
+}
+
+bool CMakeImportJob::readCompilationDatabase()
+{
+    const KUrl buildDir = CMake::currentBuildDir(m_project);
+    if (!CMake::useCompilationDatabase(m_project) || buildDir.isEmpty()) {
+        m_data.compilationDatabase = CompilationDatabase();
+        return false;
+    }
+
+    const Path file(Path(buildDir), "compile_commands.json");
+    if (!m_data.compilationDatabase.isUpToDate(file) && !m_data.compilationDatabase.read(file)) {
+        kDebug(9042) << "taking all flags from the CMakeLists.txt files, there is no compilation database at" << file;
+        return false;
+    }
+
+    //Watched even when it is stale, so the project is imported again once CMake has written it
+    m_manager->addWatcher(m_project, file.toLocalFile());
+
+    if (m_data.compilationDatabase.isStale(m_project->path(), Path(Path(buildDir), "CMakeCache.txt"))) {
+        kDebug(9042) << "taking all flags from the CMakeLists.txt files, the compilation database at" << file << "is stale";
+        m_data.compilationDatabase = CompilationDatabase();
+        return false;
+    }
+    return true;
 }
 
 KDevelop::ReferencedTopDUContext CMakeImportJob::initializeProject(CMakeFolderItem* rootFolder)
@@ -176,7 +331,7 @@ KDevelop::ReferencedTopDUContext CMakeImportJob::initializeProject(CMakeFolderIt
             Q_ASSERT(ref);
             includes << m_data.properties[DirectoryProperty][dir]["INCLUDE_DIRECTORIES"];
             CMakeParserUtils::addDefinitions(m_data.properties[DirectoryProperty][dir]["COMPILE_DEFINITIONS"], &m_data.definitions);
-            CMakeParserUtils::addDefinitions(m_data.vm["CMAKE_CXX_FLAGS"], &m_data.definitions, true);
+            CMakeParserUtils::addDefinitions(m_data.vm.value("CMAKE_CXX_FLAGS"), &m_data.definitions, true);
             rootFolder->setDefinitions(m_data.definitions);
             
             foreach(const Subdirectory& s, m_data.subdirectories) {
@@ -198,11 +353,41 @@ void CMakeImportJob::waitFinished(KJob*)
 }
 
 KDevelop::ReferencedTopDUContext CMakeImportJob::includeScript(const QString& file, const QString& dir, ReferencedTopDUContext parent)
+{
+    return includeScript(file, dir, parent, &m_data);
+}
+
+KDevelop::ReferencedTopDUContext CMakeImportJob::includeScript(const QString& file, const QString& dir, ReferencedTopDUContext parent, CMakeProjectData* data, FileSystemDependencies* dependencies)
 {
     m_manager->addWatcher(m_project, file);
-    QString profile = CMake::currentEnvironment(m_project);
-    const KDevelop::EnvironmentGroupList env( KGlobal::config() );
-    return CMakeParserUtils::includeScript( file, parent, &m_data, dir, env.variables(profile));
+    return CMakeParserUtils::includeScript( file, parent, data, dir, m_environment, dependencies);
+}
+
+KDevelop::ReferencedTopDUContext CMakeImportJob::interpretCMakeLists(const Path& dir, const ReferencedTopDUContext& parentTop, CMakeProjectData* data)
+{
+    const Path cmakeListsPath(dir, "CMakeLists.txt");
+    if (!m_importCache)
+        return includeScript(cmakeListsPath.toLocalFile(), dir.toLocalFile(), parentTop, data);
+
+    const QByteArray key = m_importCache->key(cmakeListsPath.toLocalFile(), *data);
+    ReferencedTopDUContext ctx;
+    if (m_useImportCache) {
+        {
+            DUChainReadLocker lock;
+            ctx = DUChain::self()->chainForDocument(IndexedString(cmakeListsPath.pathOrUrl()));
+        }
+        //The stored targets refer to the declarations in the context of the last interpretation
+        if (ctx && m_importCache->restore(dir.toLocalFile(), key, data)) {
+            m_manager->addWatcher(m_project, cmakeListsPath.toLocalFile());
+            return ctx;
+        }
+    }
+
+    const CMakeProjectData before = *data;
+    FileSystemDependencies dependencies;
+    ctx = includeScript(cmakeListsPath.toLocalFile(), dir.toLocalFile(), parentTop, data, &dependencies);
+    m_importCache->store(dir.toLocalFile(), key, before, *data, dependencies);
+    return ctx;
 }
 
 CMakeCommitChangesJob* CMakeImportJob::importDirectory(IProject* project, const Path& path, const KDevelop::ReferencedTopDUContext& parentTop)
@@ -216,9 +401,11 @@ CMakeCommitChangesJob* CMakeImportJob::importDirectory(IProject* project, const
     {
         kDebug(9042) << "Adding cmake: " << cmakeListsPath << " to the model";
 
+        QElapsedTimer timer;
+        timer.start();
         m_data.vm.pushScope();
-        ReferencedTopDUContext ctx = includeScript(cmakeListsPath.toLocalFile(),
-                                                   path.toLocalFile(), parentTop);
+        ReferencedTopDUContext ctx = interpretCMakeLists(path, parentTop, &m_data);
+        kDebug(9042) << "Interpreted" << cmakeListsPath << "in" << timer.elapsed() << "ms";
         Path::List folderList = commitJob->addProjectData(m_data);
         foreach(const Path& folder, folderList) {
             if (!m_manager->filterManager()->isValid(folder, true, project)) {
@@ -240,6 +427,150 @@ CMakeCommitChangesJob* CMakeImportJob::importDirectory(IProject* project, const
     return commitJob;
 }
 
+void CMakeImportJob::importDirectoriesInParallel(const Path& path, const ReferencedTopDUContext& parentTop)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    FinishedDirectories finished;
+    QList<ImportedDirectory*> dirs;
+
+    ImportedDirectory* root = new ImportedDirectory;
+    root->path = path;
+    root->parentTop = parentTop;
+    root->data = m_data;
+    dirs += root;
+    pool.start(new DirectoryImportRunnable(this, root, 0, &finished));
+
+    //The subdirectories are scheduled as soon as their parent is done, so the pool never waits for a whole level
+    for (int running = 1; running > 0; --running) {
+        const int index = finished.pop();
+        ImportedDirectory* dir = dirs[index];
+        dir->criticalPath = dir->elapsed + (dir->parent >= 0 ? dirs[dir->parent]->criticalPath : 0);
+
+        foreach (const Path& folder, dir->subdirectories) {
+            ImportedDirectory* child = new ImportedDirectory;
+            child->path = folder;
+            child->parent = index;
+            child->parentTop = dir->top;
+            child->data = dir->data;
+            dir->children += dirs.size();
+            pool.start(new DirectoryImportRunnable(this, child, dirs.size(), &finished));
+            dirs += child;
+            ++running;
+        }
+    }
+
+    commitDirectories(dirs);
+
+    qint64 total = 0;
+    int slowest = 0;
+    for (int i = 0; i < dirs.size(); ++i) {
+        total += dirs[i]->elapsed;
+        if (dirs[i]->criticalPath > dirs[slowest]->criticalPath)
+            slowest = i;
+    }
+    QStringList criticalPath;
+    for (int i = slowest; i >= 0; i = dirs[i]->parent)
+        criticalPath.prepend(QString("%1 (%2 ms)").arg(dirs[i]->path.toLocalFile()).arg(dirs[i]->elapsed));
+    kDebug(9042) << "Imported" << dirs.size() << "directories in" << timer.elapsed() << "ms on" << pool.maxThreadCount()
+                 << "threads, interpreting took" << total << "ms in total";
+    kDebug(9042) << "Critical path of" << dirs[slowest]->criticalPath << "ms:" << criticalPath.join(" -> ");
+
+    qDeleteAll(dirs);
+}
+
+void CMakeImportJob::interpretDirectory(ImportedDirectory* dir)
+{
+    const Path cmakeListsPath(dir->path, "CMakeLists.txt");
+    if (!QFile::exists(cmakeListsPath.toLocalFile()))
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+    dir->hasCMakeLists = true;
+    dir->data.vm.pushScope();
+    dir->top = interpretCMakeLists(dir->path, dir->parentTop, &dir->data);
+
+    QSet<QString> alreadyAdded;
+    foreach (const Subdirectory& subf, dir->data.subdirectories) {
+        if (subf.name.isEmpty() || alreadyAdded.contains(subf.name))
+            continue;
+        alreadyAdded.insert(subf.name);
+
+        const Path folder(dir->path, subf.name);
+        if (!m_manager->filterManager()->isValid(folder, true, m_project)) {
+            continue;
+        }
+        if (!QFile::exists(Path(folder, "CMakeLists.txt").toLocalFile())) {
+            kWarning() << "Unable to open " << Path(folder, "CMakeLists.txt").toLocalFile();
+            continue;
+        }
+        dir->subdirectories += folder;
+    }
+
+    dir->elapsed = timer.elapsed();
+    kDebug(9042) << "Interpreted" << cmakeListsPath << "in" << dir->elapsed << "ms";
+}
+
+void CMakeImportJob::commitDirectories(const QList<ImportedDirectory*>& dirs)
+{
+    //Pre-order, like the sequential import
+    QList<int> order;
+    QList<int> pending;
+    pending += 0;
+    while (!pending.isEmpty()) {
+        const int index = pending.takeLast();
+        order += index;
+        const QList<int>& children = dirs[index]->children;
+        for (int i = children.size() - 1; i >= 0; --i)
+            pending += children[i];
+    }
+
+    //A target may depend on the targets of any other directory, so all of them get the merged properties
+    CMakeProjectData merged = dirs.first()->data;
+    foreach (int index, order) {
+        const ImportedDirectory* dir = dirs[index];
+        if (dir->parent < 0)
+            continue;
+        const CMakeProjectData& parent = dirs[dir->parent]->data;
+        mergeProperties(merged.properties, dir->data.properties, parent.properties);
+        for (QHash<QString, QString>::const_iterator it = dir->data.targetAlias.constBegin(); it != dir->data.targetAlias.constEnd(); ++it) {
+            if (parent.targetAlias.value(it.key()) != *it)
+                merged.targetAlias.insert(it.key(), *it);
+        }
+        for (MacroMap::const_iterator it = dir->data.mm.constBegin(); it != dir->data.mm.constEnd(); ++it) {
+            if (!parent.mm.contains(it.key()))
+                merged.mm.insert(it.key(), *it);
+        }
+    }
+
+    QVector<CMakeCommitChangesJob*> jobs(dirs.size());
+    foreach (int index, order) {
+        ImportedDirectory* dir = dirs[index];
+        CMakeCommitChangesJob* commitJob = new CMakeCommitChangesJob(dir->path, m_manager, m_project);
+        commitJob->moveToThread(thread());
+        m_jobs += commitJob;
+        jobs[index] = commitJob;
+
+        if (dir->hasCMakeLists) {
+            dir->data.properties = merged.properties;
+            dir->data.targetAlias = merged.targetAlias;
+            commitJob->addProjectData(dir->data);
+        }
+        if (dir->parent >= 0) {
+            commitJob->setFindParentItem(false);
+            connect(jobs[dir->parent], SIGNAL(folderCreated(KDevelop::ProjectFolderItem*)),
+                    commitJob, SLOT(folderAvailable(KDevelop::ProjectFolderItem*)));
+        }
+    }
+
+    m_data = merged;
+    if (dirs.first()->hasCMakeLists)
+        m_data.vm.popScope();
+}
+
 IProject* CMakeImportJob::project() const
 {
     Q_ASSERT(!m_futureWatcher->isRunning());
@@ -252,5 +583,10 @@ CMakeProjectData CMakeImportJob::projectData() const
     return m_data;
 }
 
+void CMakeImportJob::setUseImportCache(bool use)
+{
+    m_useImportCache = use;
+}
+
 #include "moc_cmakeimportjob.cpp"
 #include "cmakeimportjob.moc"
@@ -22,12 +22,15 @@
 #define CMAKEIMPORTJOB_H
 
 #include <KJob>
+#include <QMap>
 #include "cmakeprojectdata.h"
 
 template<class T>class QFutureWatcher;
 class CMakeManager;
 class CMakeFolderItem;
 class CMakeCommitChangesJob;
+class CMakeImportCache;
+struct ImportedDirectory;
 namespace KDevelop
 {
     class Path;
@@ -45,16 +48,34 @@ class CMakeImportJob : public KJob
         virtual void start();
         KDevelop::IProject* project() const;
         CMakeProjectData projectData() const;
+        /// With @p use false, all the directories are interpreted, the results are still stored
+        void setUseImportCache(bool use);
 
     private slots:
         void waitFinished(KJob* job);
         void importFinished();
 
     private:
+        friend class DirectoryImportRunnable;
+
         void initialize();
+        /// @returns whether there is a compilation database, and it is not stale
+        bool readCompilationDatabase();
         CMakeCommitChangesJob* importDirectory(KDevelop::IProject* project, const KDevelop::Path& path, const KDevelop::ReferencedTopDUContext& parentTop);
         KDevelop::ReferencedTopDUContext initializeProject(CMakeFolderItem*);
         KDevelop::ReferencedTopDUContext includeScript(const QString& file, const QString& currentDir, KDevelop::ReferencedTopDUContext parent);
+        KDevelop::ReferencedTopDUContext includeScript(const QString& file, const QString& currentDir, KDevelop::ReferencedTopDUContext parent, CMakeProjectData* data, FileSystemDependencies* dependencies = 0);
+        /// Interprets the CMakeLists.txt in @p dir, or takes its result from the import cache when nothing changed
+        KDevelop::ReferencedTopDUContext interpretCMakeLists(const KDevelop::Path& dir, const KDevelop::ReferencedTopDUContext& parentTop, CMakeProjectData* data);
+
+        /**
+         * Interprets the directories below @p path on a thread pool. Each subdirectory works on a copy
+         * of its parent's data, so siblings are independent. Their results are merged in the order
+         * of the subdirectories, so the outcome does not depend on the scheduling.
+         */
+        void importDirectoriesInParallel(const KDevelop::Path& path, const KDevelop::ReferencedTopDUContext& parentTop);
+        void interpretDirectory(ImportedDirectory* dir);
+        void commitDirectories(const QList<ImportedDirectory*>& dirs);
 
         KDevelop::IProject* m_project;
         KDevelop::ProjectFolderItem* m_dom;
@@ -62,6 +83,9 @@ class CMakeImportJob : public KJob
         CMakeManager* m_manager;
         QFutureWatcher<void>* m_futureWatcher;
         QVector<CMakeCommitChangesJob*> m_jobs;
+        QMap<QString, QString> m_environment;
+        CMakeImportCache* m_importCache;
+        bool m_useImportCache;
 };
 
 #endif // CMAKEIMPORTJOB_H
@@ -25,6 +25,7 @@
 #include <QDir>
 #include <QThread>
 #include <QFileSystemWatcher>
+#include <QMutexLocker>
 #include <QTimer>
 
 #include <KPluginFactory>
@@ -235,8 +236,18 @@ QList<KDevelop::ProjectTargetItem*> CMakeManager::targets() const
     return ret;
 }
 
+bool CMakeManager::compilationDatabaseFlags(KDevelop::ProjectBaseItem* item, CompilationDatabase::CompileFlags* flags) const
+{
+    const CMakeProjectData* data = m_projectsData.value(item->project());
+    return data && !data->compilationDatabase.isEmpty() && data->compilationDatabase.flags(item->path(), flags);
+}
+
 Path::List CMakeManager::includeDirectories(KDevelop::ProjectBaseItem *item) const
 {
+    CompilationDatabase::CompileFlags flags;
+    if(compilationDatabaseFlags(item, &flags))
+        return flags.includes;
+
     IProject* project = item->project();
 //     kDebug(9042) << "Querying inc dirs for " << item;
     while(item)
@@ -256,6 +267,10 @@ Path::List CMakeManager::includeDirectories(KDevelop::ProjectBaseItem *item) con
 
 QHash< QString, QString > CMakeManager::defines(KDevelop::ProjectBaseItem *item ) const
 {
+    CompilationDatabase::CompileFlags flags;
+    if(compilationDatabaseFlags(item, &flags))
+        return flags.defines;
+
     CompilationDataAttached* att=0;
     ProjectBaseItem* it=item;
 //     kDebug(9042) << "Querying defines for " << item << dynamic_cast<ProjectTargetItem*>(item);
@@ -287,6 +302,12 @@ KDevelop::IProjectBuilder * CMakeManager::builder() const
 }
 
 bool CMakeManager::reload(KDevelop::ProjectFolderItem* folder)
+{
+    //Reloading is how the user gets rid of an outdated state, so nothing is taken from the import cache
+    return reloadFolder(folder, false);
+}
+
+bool CMakeManager::reloadFolder(KDevelop::ProjectFolderItem* folder, bool useImportCache)
 {
     kDebug(9032) << "reloading" << folder->path();
     IProject* p = folder->project();
@@ -301,6 +322,7 @@ bool CMakeManager::reload(KDevelop::ProjectFolderItem* folder)
     Q_ASSERT(fi && "at least the root item should be a CMakeFolderItem");
 
     KJob *job=createImportJob(fi);
+    static_cast<CMakeImportJob*>(job)->setUseImportCache(useImportCache);
     connect(job, SIGNAL(result(KJob*)), SLOT(importFinished(KJob*)));
     p->setReloadJob(job);
     ICore::self()->runController()->registerJob( job );
@@ -322,7 +344,7 @@ void CMakeManager::deletedWatchedDirectory(IProject* p, const KUrl& dir)
         if(dir.fileName()=="CMakeLists.txt") {
             QList<ProjectFolderItem*> folders = p->foldersForUrl(dir.upUrl());
             foreach(ProjectFolderItem* folder, folders)
-                reload(folder);
+                reloadFolder(folder, true);
         } else {
             qDeleteAll(p->itemsForUrl(dir));
         }
@@ -386,7 +408,7 @@ void CMakeManager::dirtyFile(const QString & dirty)
                     parseOnly(proj, current);
                 }
 #endif
-            reload(folderItem);
+            reloadFolder(folderItem, true);
         }
         else if(QFileInfo(dirty).isDir() && p->isReady())
         {
@@ -399,13 +421,13 @@ void CMakeManager::dirtyFile(const QString & dirty)
             }
         }
     }
-    else if(dirtyFile.fileName()=="CMakeCache.txt")
+    else if(dirtyFile.fileName()=="CMakeCache.txt" || dirtyFile.fileName()=="compile_commands.json")
     {
         //we first have to check from which project is this builddir
         foreach(KDevelop::IProject* pp, m_watchers.uniqueKeys()) {
             KUrl buildDir = CMake::currentBuildDir(pp);
             if(dirtyFile.upUrl().equals(buildDir, KUrl::CompareWithoutTrailingSlash)) {
-                reload(pp->projectItem());
+                reloadFolder(pp->projectItem(), true);
             }
         }
     }
@@ -414,7 +436,7 @@ void CMakeManager::dirtyFile(const QString & dirty)
         foreach(KDevelop::IProject* project, m_watchers.uniqueKeys())
         {
             if(m_watchers[project]->files().contains(dirty))
-                reload(project->projectItem());
+                reloadFolder(project->projectItem(), true);
         }
     }
 }
@@ -870,6 +892,7 @@ CMakeFolderItem* CMakeManager::takePending(const Path& path)
 
 void CMakeManager::addWatcher(IProject* p, const QString& path)
 {
+    QMutexLocker lock(&m_watchersMutex); //called from the import threads
     if (QFileSystemWatcher* watcher = m_watchers.value(p)) {
         watcher->addPath(path);
     } else {
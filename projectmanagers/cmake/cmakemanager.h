@@ -24,6 +24,7 @@
 
 #include <QList>
 #include <QString>
+#include <QMutex>
 #include <QtCore/QVariant>
 
 #include <project/interfaces/iprojectfilemanager.h>
@@ -36,6 +37,7 @@
 #include "cmakelistsparser.h"
 #include "icmakemanager.h"
 #include "cmakeprojectvisitor.h"
+#include "compilationdatabase.h"
 
 class WaitAllJobs;
 class CMakeCommitChangesJob;
@@ -149,14 +151,18 @@ private slots:
     void importFinished(KJob* job);
 
 private:
+    bool compilationDatabaseFlags(KDevelop::ProjectBaseItem* item, CompilationDatabase::CompileFlags* flags) const;
     QStringList processGeneratorExpression(const QStringList& expr, KDevelop::IProject* project, KDevelop::ProjectTargetItem* target) const;
 
     bool renameFileOrFolder(KDevelop::ProjectBaseItem *item, const KDevelop::Path &newUrl);
     void realDirectoryChanged(const QString& dir);
     void deletedWatchedDirectory(KDevelop::IProject* p, const KUrl& dir);
+    /// Reimports @p folder, with @p useImportCache false everything is interpreted again
+    bool reloadFolder(KDevelop::ProjectFolderItem* folder, bool useImportCache);
     
     QHash<KDevelop::IProject*, CMakeProjectData*> m_projectsData;
     QHash<KDevelop::IProject*, QFileSystemWatcher*> m_watchers;
+    QMutex m_watchersMutex;
     QHash<KDevelop::Path, CMakeFolderItem*> m_pending;
     
     KDevelop::ICodeHighlighting *m_highlight;
@@ -3,6 +3,7 @@
 
 #include <QStringList>
 #include "cmaketypes.h"
+#include "compilationdatabase.h"
 
 struct CMakeProjectData
 {
@@ -18,6 +19,7 @@ struct CMakeProjectData
     CMakeDefinitions definitions;
     QStringList modulePath;
     QHash<QString,QString> targetAlias;
+    CompilationDatabase compilationDatabase;
     
     void clear() { vm.clear(); mm.clear(); properties.clear(); cache.clear(); targetAlias.clear(); }
 };
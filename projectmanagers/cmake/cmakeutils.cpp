@@ -59,6 +59,9 @@ static const QString projectBuildDirs = "BuildDirs";
 static const QString buildDirIndexKey = "Current Build Directory Index";
 static const QString buildDirOverrideIndexKey = "Temporary Build Directory Index";
 static const QString buildDirCountKey = "Build Directory Count";
+static const QString useCompilationDatabaseKey = "Use Compilation Database";
+static const QString importFromCompilationDatabaseKey = "Import From Compilation Database";
+static const QString parallelImportKey = "Parallel Import";
 
 namespace Specific
 {
@@ -286,6 +289,21 @@ bool hasProjectRootRelative(KDevelop::IProject* project)
     return baseGroup(project).hasKey( Config::Old::projectRootRelativeKey );
 }
 
+bool useCompilationDatabase( KDevelop::IProject* project )
+{
+    return baseGroup(project).readEntry( Config::useCompilationDatabaseKey, true );
+}
+
+bool importFromCompilationDatabase( KDevelop::IProject* project )
+{
+    return baseGroup(project).readEntry( Config::importFromCompilationDatabaseKey, false );
+}
+
+bool parallelImport( KDevelop::IProject* project )
+{
+    return baseGroup(project).readEntry( Config::parallelImportKey, false );
+}
+
 QString currentExtraArguments( KDevelop::IProject* project )
 {
     return readProjectParameter( project, Config::Specific::cmakeArgumentsKey, QString() );
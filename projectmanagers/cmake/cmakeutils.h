@@ -85,6 +85,26 @@ namespace CMake
      */
     KDEVCMAKECOMMON_EXPORT bool hasProjectRootRelative( KDevelop::IProject* project );
     
+    /**
+     * @returns whether the flags of the compiled files are read from compile_commands.json in the
+     * build dir when there is one, and it is not older than the CMakeLists.txt files. Enabled by default.
+     */
+    KDEVCMAKECOMMON_EXPORT bool useCompilationDatabase( KDevelop::IProject* project );
+
+    /**
+     * @returns whether the CMakeLists.txt files are not interpreted at all while the compilation database
+     * is used. The folders are then only listed from disk, and there are no targets, because only the
+     * interpreter knows them. Files outside of the directories of the compiled files get no flags.
+     * Disabled by default.
+     */
+    KDEVCMAKECOMMON_EXPORT bool importFromCompilationDatabase( KDevelop::IProject* project );
+
+    /**
+     * @returns whether sibling subdirectories are interpreted on a thread pool. Disabled by default,
+     * because macros and PARENT_SCOPE variables of a subdirectory are then not visible to its siblings.
+     */
+    KDEVCMAKECOMMON_EXPORT bool parallelImport( KDevelop::IProject* project );
+
     /**
      * Convenience function to get the project root.
      */
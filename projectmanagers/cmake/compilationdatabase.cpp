@@ -0,0 +1,447 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "compilationdatabase.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+
+#include <KDebug>
+
+using namespace KDevelop;
+
+namespace
+{
+
+/**
+ * Reads the JSON of a compilation database from a stream, without keeping the whole
+ * document in memory. Only what compile_commands.json uses is supported: strings,
+ * arrays and objects. Other values are skipped.
+ */
+class JsonReader
+{
+public:
+    JsonReader(QIODevice* device)
+        : m_stream(device)
+        , m_pos(0)
+        , m_error(false)
+    {
+        m_stream.setCodec("UTF-8");
+    }
+
+    bool hasError() const { return m_error; }
+
+    /** @returns the next character that is not white space, without consuming it */
+    QChar peek()
+    {
+        while (!m_error) {
+            if (m_pos == m_buffer.size() && !fill())
+                return QChar();
+            if (!m_buffer[m_pos].isSpace())
+                return m_buffer[m_pos];
+            ++m_pos;
+        }
+        return QChar();
+    }
+
+    /** Consumes @p c if it is the next character */
+    bool accept(QChar c)
+    {
+        if (peek() != c)
+            return false;
+        ++m_pos;
+        return true;
+    }
+
+    bool expect(QChar c)
+    {
+        if (!accept(c)) {
+            m_error = true;
+            return false;
+        }
+        return true;
+    }
+
+    bool readString(QString* out)
+    {
+        if (!expect('"'))
+            return false;
+        out->clear();
+        for (;;) {
+            if (m_pos == m_buffer.size() && !fill()) {
+                m_error = true;
+                return false;
+            }
+            const QChar c = m_buffer[m_pos++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                *out += c;
+                continue;
+            }
+            const QChar escaped = next();
+            switch (escaped.unicode()) {
+                case 'n': *out += '\n'; break;
+                case 't': *out += '\t'; break;
+                case 'r': *out += '\r'; break;
+                case 'b': *out += '\b'; break;
+                case 'f': *out += '\f'; break;
+                case 'u': {
+                    QString hex;
+                    for (int i = 0; i < 4; ++i)
+                        hex += next();
+                    bool ok;
+                    *out += QChar(hex.toUShort(&ok, 16));
+                    if (!ok)
+                        m_error = true;
+                    break;
+                }
+                default: *out += escaped; break;
+            }
+            if (m_error)
+                return false;
+        }
+    }
+
+    bool readStringArray(QStringList* out)
+    {
+        if (!expect('['))
+            return false;
+        if (accept(']'))
+            return true;
+        do {
+            QString value;
+            if (!readString(&value))
+                return false;
+            *out += value;
+        } while (accept(','));
+        return expect(']');
+    }
+
+    bool skipValue()
+    {
+        const QChar c = peek();
+        if (c == '"') {
+            QString ignored;
+            return readString(&ignored);
+        } else if (c == '[' || c == '{') {
+            const QChar close = c == '[' ? ']' : '}';
+            ++m_pos;
+            if (accept(close))
+                return true;
+            do {
+                if (close == '}') {
+                    QString key;
+                    if (!readString(&key) || !expect(':'))
+                        return false;
+                }
+                if (!skipValue())
+                    return false;
+            } while (accept(','));
+            return expect(close);
+        }
+        //numbers, true, false and null
+        bool any = false;
+        for (QChar n = peek(); !m_error && (n.isLetterOrNumber() || n == '-' || n == '+' || n == '.'); n = m_buffer[m_pos]) {
+            any = true;
+            ++m_pos;
+            if (m_pos == m_buffer.size() && !fill())
+                break;
+        }
+        m_error |= !any;
+        return !m_error;
+    }
+
+private:
+    QChar next()
+    {
+        if (m_pos == m_buffer.size() && !fill()) {
+            m_error = true;
+            return QChar();
+        }
+        return m_buffer[m_pos++];
+    }
+
+    bool fill()
+    {
+        m_buffer = m_stream.read(64 * 1024);
+        m_pos = 0;
+        return !m_buffer.isEmpty();
+    }
+
+    QTextStream m_stream;
+    QString m_buffer;
+    int m_pos;
+    bool m_error;
+};
+
+/// Relative paths are relative to the working directory of the compiler
+Path resolve(const Path& directory, const QString& path)
+{
+    if (QFileInfo(path).isAbsolute() || !directory.isValid())
+        return Path(path);
+    return Path(directory, path);
+}
+
+const char* const includeOptions[] = { "-isystem", "-iquote", "-idirafter", "-I" };
+
+}
+
+bool CompilationDatabase::read(const Path& file)
+{
+    *this = CompilationDatabase();
+
+    QFile f(file.toLocalFile());
+    if (!f.open(QIODevice::ReadOnly)) {
+        kDebug(9042) << "no compilation database at" << file;
+        return false;
+    }
+
+    const QDateTime lastModified = QFileInfo(f).lastModified();
+    if (!read(&f)) {
+        kWarning(9042) << "could not read the compilation database" << file;
+        return false;
+    }
+    m_file = file;
+    m_lastModified = lastModified;
+    kDebug(9042) << "read the flags of" << m_files.size() << "files from" << file;
+    return true;
+}
+
+bool CompilationDatabase::read(QIODevice* device)
+{
+    m_files.clear();
+    m_directories.clear();
+    m_lastFlags = CompileFlags();
+
+    JsonReader reader(device);
+    if (!reader.expect('['))
+        return false;
+
+    if (!reader.accept(']')) {
+        do {
+            if (!reader.expect('{'))
+                break;
+
+            QString directory, file, command;
+            QStringList arguments;
+            if (!reader.accept('}')) {
+                do {
+                    QString key;
+                    if (!reader.readString(&key) || !reader.expect(':'))
+                        break;
+                    if (key == "directory")
+                        reader.readString(&directory);
+                    else if (key == "file")
+                        reader.readString(&file);
+                    else if (key == "command")
+                        reader.readString(&command);
+                    else if (key == "arguments")
+                        reader.readStringArray(&arguments);
+                    else
+                        reader.skipValue();
+                } while (!reader.hasError() && reader.accept(','));
+                reader.expect('}');
+            }
+            if (reader.hasError())
+                break;
+
+            if (arguments.isEmpty())
+                arguments = splitCommand(command);
+            addEntry(directory, file, arguments);
+        } while (reader.accept(','));
+        reader.expect(']');
+    }
+
+    if (reader.hasError()) {
+        m_files.clear();
+        m_directories.clear();
+        return false;
+    }
+    return true;
+}
+
+void CompilationDatabase::addEntry(const QString& directory, const QString& file, const QStringList& arguments)
+{
+    if (file.isEmpty())
+        return;
+
+    const Path dir(directory);
+    const Path path = resolve(dir, file);
+    CompileFlags flags = parseArguments(arguments, dir);
+    if (flags == m_lastFlags)
+        flags = m_lastFlags;
+    else
+        m_lastFlags = flags;
+
+    m_files.insert(path, flags);
+    const Path parent = path.parent();
+    if (!m_directories.contains(parent))
+        m_directories.insert(parent, flags);
+}
+
+bool CompilationDatabase::isUpToDate(const Path& file) const
+{
+    return m_lastModified.isValid() && m_file == file
+        && QFileInfo(file.toLocalFile()).lastModified() == m_lastModified;
+}
+
+bool CompilationDatabase::isStale(const Path& sourceRoot, const Path& cacheFile) const
+{
+    if (!m_lastModified.isValid())
+        return true;
+
+    const QFileInfo cache(cacheFile.toLocalFile());
+    if (cache.exists() && cache.lastModified() > m_lastModified) {
+        kDebug(9042) << "the compilation database is older than" << cacheFile;
+        return true;
+    }
+
+    QSet<Path> checked;
+    QList<Path> directories = m_directories.keys();
+    directories << sourceRoot;
+    foreach (Path dir, directories) {
+        while ((dir == sourceRoot || sourceRoot.isParentOf(dir)) && !checked.contains(dir)) {
+            checked.insert(dir);
+            const Path lists(dir, "CMakeLists.txt");
+            const QFileInfo info(lists.toLocalFile());
+            if (info.exists() && info.lastModified() > m_lastModified) {
+                kDebug(9042) << "the compilation database is older than" << lists;
+                return true;
+            }
+            dir = dir.parent();
+        }
+    }
+    return false;
+}
+
+bool CompilationDatabase::flags(const Path& path, CompileFlags* flags) const
+{
+    QHash<Path, CompileFlags>::const_iterator it = m_files.constFind(path);
+    if (it != m_files.constEnd()) {
+        *flags = *it;
+        return true;
+    }
+
+    for (Path dir = path;; dir = dir.parent()) {
+        it = m_directories.constFind(dir);
+        if (it != m_directories.constEnd()) {
+            *flags = *it;
+            return true;
+        }
+        if (!dir.hasParent())
+            break;
+    }
+    return false;
+}
+
+QStringList CompilationDatabase::splitCommand(const QString& command)
+{
+    QStringList ret;
+    QString current;
+    bool inArgument = false;
+    QChar quote;
+    for (int i = 0; i < command.size(); ++i) {
+        const QChar c = command[i];
+        if (quote == '\'') {
+            if (c == '\'')
+                quote = QChar();
+            else
+                current += c;
+        } else if (c == '\\' && i + 1 < command.size()) {
+            //inside double quotes, the backslash only escapes the characters that are special there
+            const QChar escaped = command[i + 1];
+            if (quote.isNull() || escaped == '"' || escaped == '\\' || escaped == '$' || escaped == '`') {
+                current += escaped;
+                ++i;
+            } else {
+                current += c;
+            }
+            inArgument = true;
+        } else if (quote == '"') {
+            if (c == '"')
+                quote = QChar();
+            else
+                current += c;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            inArgument = true;
+        } else if (c.isSpace()) {
+            if (inArgument)
+                ret += current;
+            current.clear();
+            inArgument = false;
+        } else {
+            current += c;
+            inArgument = true;
+        }
+    }
+    if (inArgument)
+        ret += current;
+    return ret;
+}
+
+CompilationDatabase::CompileFlags CompilationDatabase::parseArguments(const QStringList& arguments, const Path& directory)
+{
+    CompileFlags ret;
+    for (int i = 0; i < arguments.size(); ++i) {
+        const QString& arg = arguments[i];
+        if (!arg.startsWith('-'))
+            continue;
+
+        //the flags with a value accept it both attached and as next argument
+        QString value;
+        bool isInclude = false;
+        bool isDefine = false;
+        bool isUndefine = false;
+        for (uint o = 0; o < sizeof(includeOptions) / sizeof(*includeOptions); ++o) {
+            if (arg.startsWith(QLatin1String(includeOptions[o]))) {
+                isInclude = true;
+                value = arg.mid(qstrlen(includeOptions[o]));
+                break;
+            }
+        }
+        if (!isInclude) {
+            isDefine = arg.startsWith("-D");
+            isUndefine = arg.startsWith("-U");
+            if (!isDefine && !isUndefine)
+                continue;
+            value = arg.mid(2);
+        }
+        if (value.isEmpty()) {
+            if (++i == arguments.size())
+                break;
+            value = arguments[i];
+        }
+
+        if (isInclude) {
+            ret.includes += resolve(directory, value);
+        } else if (isDefine) {
+            const int eq = value.indexOf('=');
+            if (eq == -1)
+                ret.defines.insert(value, QString());
+            else
+                ret.defines.insert(value.left(eq), value.mid(eq + 1));
+        } else {
+            ret.defines.remove(value);
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,109 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef COMPILATIONDATABASE_H
+#define COMPILATIONDATABASE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+
+#include <util/path.h>
+
+#include "cmakeexport.h"
+#include "cmaketypes.h"
+
+class QIODevice;
+
+/**
+ * The compile flags CMake wrote to compile_commands.json (CMAKE_EXPORT_COMPILE_COMMANDS).
+ *
+ * When the build directory has this file, the include directories and definitions
+ * of each source file are taken from it rather than from the interpreted CMakeLists.txt
+ * files, which is exact, since CMake itself resolved them.
+ *
+ * Files that are not compiled, like headers, get the flags of a compiled file in the
+ * same directory, or else in the closest parent directory. Files outside of all those
+ * directories are not covered, they get the flags of the interpreted CMakeLists.txt files,
+ * unless the import is done from the database alone (see CMake::importFromCompilationDatabase).
+ */
+class KDEVCMAKECOMMON_EXPORT CompilationDatabase
+{
+public:
+    struct CompileFlags
+    {
+        bool operator==(const CompileFlags& other) const
+        {
+            return includes == other.includes && defines == other.defines;
+        }
+
+        KDevelop::Path::List includes;
+        CMakeDefinitions defines;
+    };
+
+    /**
+     * Reads @p file, replacing the current contents.
+     *
+     * @returns false if the file does not exist or is malformed, the database is empty then.
+     */
+    bool read(const KDevelop::Path& file);
+
+    /** Reads the database from @p device, which is read incrementally. */
+    bool read(QIODevice* device);
+
+    /** @returns whether @p file is what was read last, and was not modified since then */
+    bool isUpToDate(const KDevelop::Path& file) const;
+
+    /**
+     * @returns whether CMake did not write the database again since the project was changed, which is
+     * when the CMakeCache.txt @p cacheFile, or the CMakeLists.txt of a directory with compiled files
+     * or of one of its parents up to @p sourceRoot is newer than the database.
+     */
+    bool isStale(const KDevelop::Path& sourceRoot, const KDevelop::Path& cacheFile) const;
+
+    bool isEmpty() const { return m_files.isEmpty(); }
+
+    /** Count of compiled files */
+    int size() const { return m_files.size(); }
+
+    /**
+     * Looks up the flags for @p path, which may be a file or a directory.
+     *
+     * @returns false if neither @p path nor one of its parent directories has a compiled file.
+     */
+    bool flags(const KDevelop::Path& path, CompileFlags* flags) const;
+
+    /** Splits @p command into its arguments the way a POSIX shell would. */
+    static QStringList splitCommand(const QString& command);
+
+    /** Extracts the include directories and definitions out of the compiler @p arguments. */
+    static CompileFlags parseArguments(const QStringList& arguments, const KDevelop::Path& directory);
+
+private:
+    void addEntry(const QString& directory, const QString& file, const QStringList& arguments);
+
+    KDevelop::Path m_file;
+    QDateTime m_lastModified;
+    QHash<KDevelop::Path, CompileFlags> m_files;
+    /// The flags of the first compiled file of each directory
+    QHash<KDevelop::Path, CompileFlags> m_directories;
+    /// Consecutive files usually belong to the same target, so they share the lists of this one
+    CompileFlags m_lastFlags;
+};
+
+#endif
@@ -488,17 +488,21 @@ bool AddExecutableAst::parseFunctionInfo( const CMakeFunctionDesc& func )
 
 }
 
-QMap<QString, AddLibraryAst::LibraryType> AddLibraryAst::s_typeForName;
+//Initialized statically, since the asts are created from multiple threads when importing in parallel
+static QMap<QString, AddLibraryAst::LibraryType> libraryTypeNames()
+{
+    QMap<QString, AddLibraryAst::LibraryType> ret;
+    ret.insert("STATIC", AddLibraryAst::Static);
+    ret.insert("SHARED", AddLibraryAst::Shared);
+    ret.insert("MODULE", AddLibraryAst::Module);
+    ret.insert("OBJECT", AddLibraryAst::Object);
+    ret.insert("UNKNOWN", AddLibraryAst::Unknown);
+    return ret;
+}
+
+QMap<QString, AddLibraryAst::LibraryType> AddLibraryAst::s_typeForName = libraryTypeNames();
 AddLibraryAst::AddLibraryAst()
 {
-    if(s_typeForName.isEmpty()) {
-        s_typeForName.insert("STATIC", Static);
-        s_typeForName.insert("SHARED", Shared);
-        s_typeForName.insert("MODULE", Module);
-        s_typeForName.insert("OBJECT", Object);
-        s_typeForName.insert("UNKNOWN", Unknown);
-    }
-    
     m_type = Static;
     m_isImported = false;
     m_excludeFromAll = false;
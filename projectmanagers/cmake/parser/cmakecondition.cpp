@@ -67,6 +67,7 @@ static int compareVersions(const QList<int>& v1, const QList<int>& v2)
 
 QMap<QString, CMakeCondition::conditionToken> CMakeCondition::nameToToken=initNameToToken();
 QSet<QString> CMakeCondition::s_falseDefinitions=QSet<QString>() << "" << "0" << "N" << "NO" << "OFF" << "FALSE" << "NOTFOUND" ;
+const int CMakeCondition::s_currentSourceDirId=VariableMap::variableId("CMAKE_CURRENT_SOURCE_DIR");
 QSet<QString> CMakeCondition::s_trueDefinitions=QSet<QString>() << "1" << "ON" << "YES" << "TRUE" << "Y";
 
 CMakeCondition::CMakeCondition(const CMakeProjectVisitor* v)
@@ -119,11 +120,11 @@ bool CMakeCondition::isTrue(const QStringList::const_iterator& it)
     else 
     {
         QString value;
-        if(m_vars->contains(val))
+        if(const QStringList* var = m_vars->find(val))
         {
             //         A variable is expanded (dereferenced) and then checked if it equals one of the above
             //         FALSE constants.
-            value = m_vars->value(*it).join(";").toUpper();
+            value = var->join(";").toUpper();
     //         kDebug(9042) << "Checking" << varName << "is true ? >>>" << m_vars->value(varName) << "<<<";
         }
         else if(m_cache->contains(val))
@@ -196,9 +197,11 @@ bool CMakeCondition::evaluateCondition(QStringList::const_iterator itBegin, QStr
                     last=false;
                 else
                 {
-                    Q_ASSERT(m_vars->contains("CMAKE_CURRENT_SOURCE_DIR"));
-                    QString dir=m_vars->value("CMAKE_CURRENT_SOURCE_DIR").first();
+                    const QStringList* sourceDir = m_vars->find(s_currentSourceDirId);
+                    Q_ASSERT(sourceDir);
+                    QString dir=sourceDir->first();
                     QFileInfo f(dir, v);
+                    m_visitor->addPathDependency(f);
                     last=f.exists();
                 }
                 itEnd=it2;
@@ -206,6 +209,7 @@ bool CMakeCondition::evaluateCondition(QStringList::const_iterator itBegin, QStr
             case IS_DIRECTORY: {
                 CHECK_NEXT(it2);
                 QFileInfo f(value(it2+1));
+                m_visitor->addPathDependency(f);
                 last = f.isDir();
                 itEnd=it2;
             }   break;
@@ -393,10 +397,9 @@ int CMakeCondition::compareVersion(QStringList::const_iterator left,
 
 QString CMakeCondition::value(QList< QString >::const_iterator it)
 {
-    QString value = *it;
-    if (m_vars->contains(value)) {
-        value = m_vars->value(value).join(";");
+    if (const QStringList* var = m_vars->find(*it)) {
         m_varUses.append(it);
+        return var->join(";");
     }
-    return value;
+    return *it;
 }
@@ -50,6 +50,7 @@ class KDEVCMAKECOMMON_EXPORT CMakeCondition
         static QMap<QString, conditionToken> nameToToken;
         static QSet<QString> s_falseDefinitions;
         static QSet<QString> s_trueDefinitions;
+        static const int s_currentSourceDirId;
         
         QList<QStringList::const_iterator> m_varUses;
         QList<int> m_argUses;
@@ -23,8 +23,10 @@
 #include "cmakeast.h"
 // #include "cmakeprojectvisitor.h"
 #include "astfactory.h"
+#include "variablemap.h"
 
 #include <QStack>
+#include <QVector>
 #include <KDebug>
 
 QMap<QChar, QChar> whatToScape()
@@ -69,6 +71,105 @@ QString CMakeFunctionArgument::unescapeValue(const QString& value)
     return newValue;
 }
 
+typedef QPair<int, int> Braces;
+
+static void addLiteral(QList<CMakeArgumentSegment>& segments, const QString& text)
+{
+    if(text.isEmpty())
+        return;
+    CMakeArgumentSegment segment;
+    segment.text = text;
+    segments += segment;
+}
+
+/// Splits the range [begin, end) of @p value, @p next is the first reference in @p braces that wasn't used yet
+static QList<CMakeArgumentSegment> splitReferences(const QString& value, int begin, int end, const QVector<Braces>& braces, int& next)
+{
+    QList<CMakeArgumentSegment> ret;
+    int pos = begin;
+    while(next<braces.size() && braces[next].first<end)
+    {
+        const Braces reference = braces[next++];
+        //the nested references are only needed to know the name
+        QList<CMakeArgumentSegment> name = splitReferences(value, reference.first+1, reference.second, braces, next);
+
+        CMakeArgumentSegment segment;
+        int dollar = value.lastIndexOf('$', reference.first);
+        const QString kind = value.mid(dollar+1, reference.first-dollar-1);
+        if(dollar<pos) {
+            //the dollar belongs to an earlier reference, like in ${a$}{b}
+            segment.type = CMakeArgumentSegment::Unknown;
+            dollar = pos;
+        } else if(kind.isEmpty())
+            segment.type = CMakeArgumentSegment::Variable;
+        else if(kind=="ENV")
+            segment.type = CMakeArgumentSegment::Environment;
+        else
+            segment.type = CMakeArgumentSegment::Unknown;
+
+        addLiteral(ret, value.mid(pos, dollar-pos));
+        if(segment.type==CMakeArgumentSegment::Unknown)
+            segment.text = value.mid(dollar, reference.second-dollar+1);
+        else if(name.size()==1 && name.first().type==CMakeArgumentSegment::Literal)
+            segment.text = name.first().text;
+        else
+            segment.name = name;
+
+        if(segment.type==CMakeArgumentSegment::Variable && segment.name.isEmpty())
+            segment.id = VariableMap::variableId(segment.text);
+        ret += segment;
+        pos = reference.second+1;
+    }
+    addLiteral(ret, value.mid(pos, end-pos));
+    return ret;
+}
+
+QList<CMakeArgumentSegment> CMakeFunctionArgument::parseReferences(const QString& value)
+{
+    const int firstDollar = value.indexOf('$');
+    if(firstDollar<0)
+        return QList<CMakeArgumentSegment>();
+
+    //a brace opens a reference if there was a dollar since the last one
+    QVector<Braces> braces;
+    QStack<int> opened;
+    bool gotDollar=false;
+    for(int i=firstDollar; i<value.size(); i++)
+    {
+        switch(value[i].unicode())
+        {
+            case '$':
+                gotDollar=true;
+                break;
+            case '{':
+                if(gotDollar)
+                {
+                    opened.push(braces.size());
+                    braces += Braces(i, -1);
+                }
+                gotDollar=false;
+                break;
+            case '}':
+                if(!opened.isEmpty())
+                    braces[opened.pop()].second = i;
+                break;
+        }
+    }
+
+    //braces that are never closed are literal text
+    if(!opened.isEmpty())
+    {
+        for(int i=braces.size()-1; i>=0; i--)
+        {
+            if(braces[i].second<0)
+                braces.remove(i);
+        }
+    }
+
+    int next = 0;
+    return splitReferences(value, 0, value.size(), braces, next);
+}
+
 void CMakeFunctionDesc::addArguments( const QStringList& args, bool addEvenIfEmpty )
 {
     if(addEvenIfEmpty && args.isEmpty())
@@ -239,7 +340,7 @@ bool CMakeFunctionDesc::operator==(const CMakeFunctionDesc & other) const
 }*/
 
 CMakeFunctionArgument::CMakeFunctionArgument(const QString& v, bool q, quint32 l, quint32 c)
-    : value(unescapeValue(v)), quoted(q), line(l), column(c)
+    : value(unescapeValue(v)), quoted(q), line(l), column(c), segments(parseReferences(value))
 {
 }
 
@@ -36,6 +36,27 @@
 #include <cmakeexport.h>
 #include <language/editor/rangeinrevision.h>
 
+/**
+ * A part of an argument: either literal text or a variable reference like ${VAR} or $ENV{VAR}.
+ *
+ * The arguments are split into segments once when they are read, so that resolving them
+ * again, like in every run of a loop or macro, doesn't need to look for the references.
+ */
+struct CMakeArgumentSegment
+{
+    enum Type { Literal, Variable, Environment, Unknown };
+
+    CMakeArgumentSegment() : type(Literal), id(-1) {}
+
+    Type type;
+    /// The literal text, the name of the referenced variable, or the whole reference if its kind is Unknown
+    QString text;
+    /// The id of the variable called @c text, see VariableMap::variableId(), or -1
+    int id;
+    /// The parts of the name of the referenced variable, if it contains other references
+    QList<CMakeArgumentSegment> name;
+};
+
 struct CMakeFunctionArgument
 {
     CMakeFunctionArgument(): value(), quoted(false), line(0), column(0) {}
@@ -59,6 +80,9 @@ struct CMakeFunctionArgument
     bool isCorrect() const { return column>0; }
 
     static QString unescapeValue(const QString& value);
+
+    /** Splits @p value at its variable references, @returns an empty list if it has none */
+    static QList<CMakeArgumentSegment> parseReferences(const QString& value);
     
     KDevelop::RangeInRevision range() const
     { return KDevelop::RangeInRevision(line-1, column-1, line-1, column+value.length()-1); }
@@ -69,6 +93,8 @@ struct CMakeFunctionArgument
     bool quoted;
     quint32 line;
     quint32 column;
+    /// The segments of @c value, if it was read from a file
+    QList<CMakeArgumentSegment> segments;
     static const QMap<QChar, QChar> scapings;
 };
 Q_DECLARE_METATYPE( CMakeFunctionArgument )
@@ -32,6 +32,9 @@
 #include "cmakecachereader.h"
 #include <util/path.h>
 #include <ktempdir.h>
+#include <kconfig.h>
+#include <kconfiggroup.h>
+#include <QDateTime>
 
 namespace CMakeParserUtils
 {
@@ -70,6 +73,40 @@ namespace CMakeParserUtils
     }
 
 
+    /**
+     * The values of @p variables in the --system-information output of @p cmakeCmd.
+     *
+     * Running cmake takes a while, so they are stored until the cmake binary changes.
+     */
+    static QMap<QString, QString> systemInformation(const QString& cmakeCmd, const QStringList& variables)
+    {
+        KConfig config(KStandardDirs::locateLocal("cache", "kdevcmakemanager/systeminformation"), KConfig::SimpleConfig);
+        KConfigGroup group = config.group(cmakeCmd);
+        const QDateTime modified = QFileInfo(cmakeCmd).lastModified();
+
+        QMap<QString, QString> ret;
+        if (group.readEntry("Modified", QDateTime()) == modified) {
+            foreach(const QString& variable, variables) {
+                if (!group.hasKey(variable))
+                    break;
+                ret[variable] = group.readEntry(variable, QString());
+            }
+            if (ret.size() == variables.size())
+                return ret;
+        }
+
+        const QString systeminfo=executeProcess(cmakeCmd, QStringList("--system-information"));
+        group.deleteGroup();
+        group = config.group(cmakeCmd);
+        foreach(const QString& variable, variables) {
+            ret[variable] = valueFromSystemInfo(variable, systeminfo);
+            group.writeEntry(variable, ret[variable]);
+        }
+        group.writeEntry("Modified", modified);
+        config.sync();
+        return ret;
+    }
+
     QPair<VariableMap,QStringList> initialVariables()
     {
         static QPair<VariableMap, QStringList> ret;
@@ -78,18 +115,19 @@ namespace CMakeParserUtils
         }
         QString cmakeCmd=KStandardDirs::findExe("cmake");
         
-        QString systeminfo=executeProcess(cmakeCmd, QStringList("--system-information"));
+        const QMap<QString, QString> systeminfo = systemInformation(cmakeCmd, QStringList() << "CMAKE_ROOT"
+                << "CMAKE_MAJOR_VERSION" << "CMAKE_MINOR_VERSION" << "CMAKE_PATCH_VERSION" << "CMAKE_VERSION");
         
         VariableMap varsDef;
-        QStringList modulePathDef=QStringList(CMakeParserUtils::valueFromSystemInfo( "CMAKE_ROOT", systeminfo ) + "/Modules");
+        QStringList modulePathDef=QStringList(systeminfo["CMAKE_ROOT"] + "/Modules");
         kDebug(9042) << "found module path is" << modulePathDef;
         varsDef.insertGlobal("CMAKE_BINARY_DIR", QStringList("#[bin_dir]"));
         varsDef.insertGlobal("CMAKE_INSTALL_PREFIX", QStringList("#[install_dir]"));
         varsDef.insertGlobal("CMAKE_COMMAND", QStringList(cmakeCmd));
-        varsDef.insertGlobal("CMAKE_MAJOR_VERSION", QStringList(CMakeParserUtils::valueFromSystemInfo("CMAKE_MAJOR_VERSION", systeminfo)));
-        varsDef.insertGlobal("CMAKE_MINOR_VERSION", QStringList(CMakeParserUtils::valueFromSystemInfo("CMAKE_MINOR_VERSION", systeminfo)));
-        varsDef.insertGlobal("CMAKE_PATCH_VERSION", QStringList(CMakeParserUtils::valueFromSystemInfo("CMAKE_PATCH_VERSION", systeminfo)));
-        varsDef.insertGlobal("CMAKE_VERSION", QStringList(CMakeParserUtils::valueFromSystemInfo("CMAKE_VERSION", systeminfo)));
+        varsDef.insertGlobal("CMAKE_MAJOR_VERSION", QStringList(systeminfo["CMAKE_MAJOR_VERSION"]));
+        varsDef.insertGlobal("CMAKE_MINOR_VERSION", QStringList(systeminfo["CMAKE_MINOR_VERSION"]));
+        varsDef.insertGlobal("CMAKE_PATCH_VERSION", QStringList(systeminfo["CMAKE_PATCH_VERSION"]));
+        varsDef.insertGlobal("CMAKE_VERSION", QStringList(systeminfo["CMAKE_VERSION"]));
         varsDef.insertGlobal("CMAKE_INCLUDE_CURRENT_DIR", QStringList("OFF"));
         
         QStringList cmakeInitScripts;
@@ -107,7 +145,7 @@ namespace CMakeParserUtils
         cmakeInitScripts << "CMakeDetermineCXXCompiler.cmake";
         
         varsDef.insertGlobal("CMAKE_MODULE_PATH", modulePathDef);
-        varsDef.insertGlobal("CMAKE_ROOT", QStringList(CMakeParserUtils::valueFromSystemInfo("CMAKE_ROOT", systeminfo)));
+        varsDef.insertGlobal("CMAKE_ROOT", QStringList(systeminfo["CMAKE_ROOT"]));
         
         //Defines the behaviour that can't be identified on initialization scripts
         #ifdef Q_OS_WIN32
@@ -168,7 +206,7 @@ namespace CMakeParserUtils
         return binDir;
     }
     
-    KDevelop::ReferencedTopDUContext includeScript(const QString& file, const KDevelop::ReferencedTopDUContext& parent, CMakeProjectData* data, const QString& sourcedir, const QMap<QString, QString>& env)
+    KDevelop::ReferencedTopDUContext includeScript(const QString& file, const KDevelop::ReferencedTopDUContext& parent, CMakeProjectData* data, const QString& sourcedir, const QMap<QString, QString>& env, FileSystemDependencies* dependencies)
     {
         kDebug(9042) << "Running cmake script: " << file;
 
@@ -199,6 +237,8 @@ namespace CMakeParserUtils
         data->testSuites=v.testSuites();
         data->targetAlias=v.targetAlias();
         data->definitions=v.definitions();
+        if(dependencies)
+            *dependencies=v.dependencies();
         
         //printSubdirectories(data->subdirectories);
         
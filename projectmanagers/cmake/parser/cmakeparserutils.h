@@ -59,7 +59,12 @@ namespace CMakeParserUtils
     /** Runs the process specified by @p execName with @p args */
     KDEVCMAKECOMMON_EXPORT QString executeProcess(const QString& execName, const QStringList& args=QStringList());
     
-    KDEVCMAKECOMMON_EXPORT KDevelop::ReferencedTopDUContext includeScript( const QString& file, const KDevelop::ReferencedTopDUContext& parent, CMakeProjectData* data, const QString& sourcedir, const QMap< QString, QString >& env);
+    /**
+     * Interprets @p file into @p data.
+     *
+     * @param dependencies if set, receives what the interpretation took from the file system and the environment
+     */
+    KDEVCMAKECOMMON_EXPORT KDevelop::ReferencedTopDUContext includeScript( const QString& file, const KDevelop::ReferencedTopDUContext& parent, CMakeProjectData* data, const QString& sourcedir, const QMap< QString, QString >& env, FileSystemDependencies* dependencies = 0);
     
     KDEVCMAKECOMMON_EXPORT CacheValues readCache(const KDevelop::Path& path);
 
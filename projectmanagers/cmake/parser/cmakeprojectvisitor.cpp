@@ -72,8 +72,10 @@ QStringList CMakeProjectVisitor::envVarDirectories(const QString &varName) const
     QMap<QString, QString>::const_iterator it=m_environmentProfile.constFind(varName);
     if(it!=m_environmentProfile.constEnd())
         env = *it;
-    else
+    else {
         env = QString::fromLatin1(qgetenv(varName.toLatin1()));
+        m_dependencies.environment.insert(varName, env);
+    }
     
 //     kDebug(9042) << ".......resolving env:" << varName << "=" << QProcess::systemEnvironment() << env;
     if(!env.isEmpty())
@@ -134,11 +136,11 @@ QList< CMakeProjectVisitor::IntPair > CMakeProjectVisitor::parseArgument(const Q
     return pos;
 }
 
-QStringList CMakeProjectVisitor::variableValue(const QString& var) const
+QStringList CMakeProjectVisitor::variableValue(const QString& var, int id) const
 {
-    VariableMap::const_iterator it=m_vars->constFind(var);
-    if(it!=m_vars->constEnd())
-        return *it;
+    const QStringList* value= id>=0 ? m_vars->find(id) : m_vars->find(var);
+    if(value)
+        return *value;
     else {
         CacheValues::const_iterator it=m_cache->constFind(var);
         if(it!=m_cache->constEnd())
@@ -147,106 +149,54 @@ QStringList CMakeProjectVisitor::variableValue(const QString& var) const
     return QStringList();
 }
 
-QStringList CMakeProjectVisitor::theValue(const QString& exp, const IntPair& thecase) const
+QStringList CMakeProjectVisitor::resolveReference(const CMakeArgumentSegment& reference) const
 {
-    int dollar=exp.lastIndexOf('$', thecase.first);
-    QString type=exp.mid(dollar+1, thecase.first-dollar-1);
-    QString var=exp.mid(thecase.first+1, thecase.second-thecase.first-1);
-    QStringList value;
-//     kDebug() << "lalalallalala" << exp << thecase.print();
-    if(type.isEmpty())
-    {
-        value=variableValue(var);
-    }
-    else if(type=="ENV")
+    QString name=reference.text;
+    if(!reference.name.isEmpty())
     {
-        value=envVarDirectories(var);
-    }
-    else
-        kDebug() << "error: I do not understand the key: " << type;
-
-//     kDebug() << "solving: " << var << vars << exp;
-    return value;
-}
-
-static QString replaceOne(const QString& var, const QString& id, const QString& value, int dollar)
-{
-//     kDebug() << "ooo" << var << value << id << var[dollar+id.size()-1] << (dollar+id.size());
-//     kDebug() << "kkkk" << var.mid(0, dollar) << value << var.mid(dollar+id.size(), var.size()-(dollar+id.size()));
-    return var.mid(0, dollar)+value+var.mid(dollar+id.size(), var.size()-(dollar+id.size()));
-}
-
-QStringList CMakeProjectVisitor::value(const QString& exp, const QList<IntPair>& poss, int& desired) const
-{
-    QString var=exp;
-    QList<IntPair> invars;
-    invars += poss[desired];
-    //kDebug() << ">>>>>" << exp << desired << poss.count();
-    for(; desired+1<poss.size() && poss[desired].level>1; desired++)
-    {
-        invars+=poss[desired+1];
-        //kDebug() << "poss@"<< desired+1 << "="<< poss[desired+1].print();
+        foreach(const CMakeArgumentSegment& segment, reference.name)
+        {
+            if(segment.type==CMakeArgumentSegment::Literal)
+                name+=segment.text;
+            else
+                name+=resolveReference(segment).join(QChar(';'));
+        }
     }
 
-    //kDebug() << ";;;;;" << invars.count();
-    if(invars.count()>1)
+    switch(reference.type)
     {
-        QList<IntPair>::const_iterator itConstEnd=invars.constEnd();
-        QList<IntPair>::iterator itEnd=invars.end();
-        QList<IntPair>::iterator itBegin=invars.begin();
-        for(QList<IntPair>::const_iterator it=invars.constBegin(); (it+1)!=itConstEnd; ++it)
-        {
-            const IntPair& subvar=*it;
-            int dollar=var.lastIndexOf('$', subvar.first);
-            QString id=var.mid(dollar, subvar.second-dollar+1), value=theValue(var, subvar).join(QChar(';'));
-
-            int diff=value.size()-id.size();
-            for(QList<IntPair>::iterator it=itBegin; it!=itEnd; ++it)
-            {
-                if(it->first > subvar.first) it->first += diff;
-                if(it->second> subvar.second) it->second+= diff;
-            }
-
-            var=replaceOne(var, id, value, dollar);
-        }
+        case CMakeArgumentSegment::Variable:
+            return variableValue(name, reference.id);
+        case CMakeArgumentSegment::Environment:
+            return envVarDirectories(name);
+        default:
+            kDebug() << "error: I do not understand the reference: " << reference.text;
+            return QStringList();
     }
-    return theValue(var, invars.last());
 }
 
 QStringList CMakeProjectVisitor::resolveVariable(const CMakeFunctionArgument &exp)
 {
+    //arguments that were not read from a file are not split yet
+    const QList<CMakeArgumentSegment> segments = exp.segments.isEmpty() ? CMakeFunctionArgument::parseReferences(exp.value) : exp.segments;
+
     QStringList ret;
     ret += QString();
-    QList< IntPair > var = parseArgument(exp.value);
-
-    int i=0;
-    IntPair last(-1,-1, 0);
-
-    for(QList<IntPair>::const_iterator it=var.constBegin(); it!=var.constEnd(); ++it, ++i)
+    foreach(const CMakeArgumentSegment& segment, segments)
     {
-        while(it!=var.constEnd() && it->level>1)
-            ++it;
-
-        const IntPair& p=*it;
-//         kDebug () << "reeeeeet" << ret << exp.value << p.print();
-        int dollar=exp.value.lastIndexOf('$', p.first);
-        QString pre=exp.value.mid(last.second+1, dollar-last.second-1);
-
-        QStringList vars = value(exp.value, var, i);
-//         kDebug() << "aaaaaaaaaA" << pre << vars;
+        if(segment.type==CMakeArgumentSegment::Literal)
+        {
+            ret.last()+=segment.text;
+            continue;
+        }
 
+        QStringList vars = resolveReference(segment);
         if(!vars.isEmpty())
         {
-            pre+=vars.takeFirst();
+            ret.last()+=vars.takeFirst();
         }
-        ret.last()+=pre;
         ret += vars;
-        last=p;
-        
-//         kDebug() << "yaaaaaaa" << ret;
-//         i++;
     }
-    ret.last().append(exp.value.mid(last.second+1, exp.value.count()-last.second));
 
     if(exp.quoted) {
         ret=QStringList(ret.join(QChar(';')));
@@ -560,8 +510,13 @@ int CMakeProjectVisitor::visit(const IncludeDirectoriesAst * dirs)
     return 1;
 }
 
+void CMakeProjectVisitor::addPathDependency(const QFileInfo& info) const
+{
+    m_dependencies.paths.insert(info.absoluteFilePath(), FileSystemDependencies::pathState(info));
+}
+
 QString CMakeProjectVisitor::findFile(const QString &file, const QStringList &folders,
-        const QStringList& suffixes, bool location)
+        const QStringList& suffixes, bool location, FileSystemDependencies* dependencies)
 {
     if( file.isEmpty() || QFileInfo(file).isAbsolute() )
          return file;
@@ -587,6 +542,8 @@ QString CMakeProjectVisitor::findFile(const QString &file, const QStringList &fo
         afile.addPath(file);
         kDebug(9042) << "Trying:" << mpath << '.' << file;
         QFileInfo f(afile.toLocalFile());
+        if(dependencies)
+            dependencies->paths.insert(f.absoluteFilePath(), FileSystemDependencies::pathState(f));
         if(f.exists() && f.isFile())
         {
             if(location)
@@ -608,13 +565,15 @@ int CMakeProjectVisitor::visit(const IncludeAst *inc)
 
     QString possib=inc->includeFile();
     QString path;
+    if(!KUrl(possib).isRelative())
+        addPathDependency(QFileInfo(possib));
     if(!KUrl(possib).isRelative() && QFile::exists(possib))
         path=possib;
     else
     {
         if(!possib.contains('.'))
             possib += ".cmake";
-        path=findFile(possib, modulePath);
+        path=findFile(possib, modulePath, QStringList(), false, &m_dependencies);
     }
 
     if(!path.isEmpty())
@@ -622,6 +581,7 @@ int CMakeProjectVisitor::visit(const IncludeAst *inc)
         m_vars->insertMulti("CMAKE_CURRENT_LIST_FILE", QStringList(path));
         m_vars->insertMulti("CMAKE_CURRENT_LIST_DIR", QStringList(KUrl(path).directory()));
         CMakeFileContent include = CMakeListsParser::readCMakeFile(path);
+        m_dependencies.readFiles += path;
         if ( !include.isEmpty() )
         {
             kDebug(9042) << "including:" << path;
@@ -699,6 +659,7 @@ int CMakeProjectVisitor::visit(const FindPackageAst *pack)
     QSet<QString> handled;
     foreach(const QString& lookup, lookupPaths)
     {
+        addPathDependency(QFileInfo(lookup));
         if(!QFile::exists(lookup) || handled.contains(lookup)) {
             continue;
         }
@@ -733,7 +694,7 @@ int CMakeProjectVisitor::visit(const FindPackageAst *pack)
     bool isConfig=false;
     QString path;
     foreach(const QString& possib, possibleConfigNames) {
-        path = findFile(possib, configPath);
+        path = findFile(possib, configPath, QStringList(), false, &m_dependencies);
         if (!path.isEmpty()) {
             m_vars->insertGlobal(pack->name()+"_DIR", QStringList(KUrl(path).directory()));
             isConfig=true;
@@ -744,7 +705,7 @@ int CMakeProjectVisitor::visit(const FindPackageAst *pack)
     if (path.isEmpty()) {
         foreach(const QString& possib, possibleModuleNames)
         {
-            path=findFile(possib, modulePath);
+            path=findFile(possib, modulePath, QStringList(), false, &m_dependencies);
             if(!path.isEmpty()) {
                 break;
             }
@@ -769,6 +730,7 @@ int CMakeProjectVisitor::visit(const FindPackageAst *pack)
         m_vars->insert(pack->name()+"_FIND_VERSION_COUNT", QStringList(QString::number(version.size())));
         
         CMakeFileContent package=CMakeListsParser::readCMakeFile( path );
+        m_dependencies.readFiles += path;
         if ( !package.isEmpty() )
         {
             path=KUrl(path).pathOrUrl();
@@ -905,7 +867,7 @@ QString CMakeProjectVisitor::findExecutable(const QString& file,
 
     foreach(const QString& suffix, suffixes)
     {
-        path=findFile(file+suffix, directories, pathSuffixes);
+        path=findFile(file+suffix, directories, pathSuffixes, false, &m_dependencies);
         if(!path.isEmpty())
             break;
     }
@@ -947,7 +909,7 @@ int CMakeProjectVisitor::visit(const FindPathAst *fpath)
     kDebug(9042) << "Find:" << /*locationOptions << "@" <<*/ fpath->variableName() << /*"=" << files <<*/ " path.";
     foreach(const QString& p, files)
     {
-        QString p1=findFile(p, locationOptions, suffixes, true);
+        QString p1=findFile(p, locationOptions, suffixes, true, &m_dependencies);
         if(p1.isEmpty())
         {
             kDebug(9042) << p << "not found";
@@ -1009,7 +971,7 @@ int CMakeProjectVisitor::visit(const FindLibraryAst *flib)
         {
             foreach(const QString& suffix, m_vars->value("CMAKE_FIND_LIBRARY_SUFFIXES"))
             {
-                QString p1=findFile(prefix+p+suffix, locationOptions, flib->pathSuffixes());
+                QString p1=findFile(prefix+p+suffix, locationOptions, flib->pathSuffixes(), false, &m_dependencies);
                 if(p1.isEmpty())
                 {
                     kDebug(9042) << p << "not found";
@@ -1072,7 +1034,7 @@ int CMakeProjectVisitor::visit(const FindFileAst *ffile)
     kDebug(9042) << "Find File:" << ffile->filenames();
     foreach(const QString& p, files)
     {
-        QString p1=findFile(p, locationOptions, ffile->pathSuffixes());
+        QString p1=findFile(p, locationOptions, ffile->pathSuffixes(), false, &m_dependencies);
         if(p1.isEmpty())
         {
             kDebug(9042) << p << "not found";
@@ -1589,11 +1551,13 @@ int CMakeProjectVisitor::visit(const FileAst *file)
             KUrl filename=file->path();
             QFileInfo ifile(filename.toLocalFile());
             kDebug(9042) << "FileAst: reading " << file->path() << ifile.isFile();
+            addPathDependency(ifile);
             if(!ifile.isFile())
                 return 1;
             QFile f(filename.toLocalFile());
             if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
                 return 1;
+            m_dependencies.readFiles += ifile.absoluteFilePath();
             QString output=f.readAll();
             m_vars->insert(file->variable(), QStringList(output));
             kDebug(9042) << "FileAst: read ";
@@ -1610,7 +1574,14 @@ int CMakeProjectVisitor::visit(const FileAst *file)
                 if (QDir::isRelativePath(expr) && pathPrefix.isEmpty())
                     pathPrefix = m_vars->value("CMAKE_CURRENT_SOURCE_DIR").first();
                 
-                matches.append(traverseGlob(pathPrefix, expr, file->type() == FileAst::GlobRecurse, file->isFollowingSymlinks()));
+                GlobDependency glob;
+                glob.startPath = pathPrefix;
+                glob.expression = expr;
+                glob.recursive = file->type() == FileAst::GlobRecurse;
+                glob.followSymlinks = file->isFollowingSymlinks();
+                glob.matches = traverseGlob(glob.startPath, glob.expression, glob.recursive, glob.followSymlinks);
+                m_dependencies.globs += glob;
+                matches.append(glob.matches);
             }
             
             if (!file->path().isEmpty())
@@ -1660,11 +1631,13 @@ int CMakeProjectVisitor::visit(const FileAst *file)
             KUrl filename=file->path();
             QFileInfo ifile(filename.toLocalFile());
             kDebug(9042) << "FileAst: reading " << file->path() << ifile.isFile();
+            addPathDependency(ifile);
             if(!ifile.isFile())
                 return 1;
             QFile f(filename.toLocalFile());
             if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
                 return 1;
+            m_dependencies.readFiles += ifile.absoluteFilePath();
             QStringList output=QString(f.readAll()).split('\n');
             
             if(!file->regex().isEmpty()) {
@@ -2074,8 +2047,8 @@ int CMakeProjectVisitor::visit(const GetCMakePropertyAst *past)
     switch(past->type())
     {
         case GetCMakePropertyAst::Variables:
-            kDebug(9042) << "get cmake prop: variables:" << m_vars->size();
-            output = m_vars->keys();
+            output = m_vars->uniqueKeys();
+            kDebug(9042) << "get cmake prop: variables:" << output.size();
             break;
         case GetCMakePropertyAst::CacheVariables:
             output = m_cache->keys();
@@ -116,12 +116,21 @@ class KDEVCMAKECOMMON_EXPORT CMakeProjectVisitor : CMakeAstVisitor
         QVector<Target> targets() const { return m_targetForId.values().toVector(); }
         QStringList resolveDependencies(const QStringList& target) const;
         QVector<Test> testSuites() const { return m_testSuites; }
+        /** What the interpretation took from the file system and the environment */
+        FileSystemDependencies dependencies() const { return m_dependencies; }
+        /** Notes that the result depends on the state of the path of @p info */
+        void addPathDependency(const QFileInfo& info) const;
             
         int walk(const CMakeFileContent& fc, int line, bool isClean=false);
         
 //         enum FileType { Location, File, Executable, Library };
+        /** @param dependencies if set, receives the state of every path that was tried */
         static QString findFile(const QString& files, const QStringList &folders,
-                                    const QStringList& suffixes=QStringList(), bool location=false);
+                                    const QStringList& suffixes=QStringList(), bool location=false,
+                                    FileSystemDependencies* dependencies=0);
+
+        static QStringList traverseGlob(const QString& startPath, const QString& expression,
+            bool recursive = false, bool followSymlinks = false);
         
         QString findExecutable(const QString& filenames, const QStringList& dirs,
                                     const QStringList& pathSuffixes=QStringList()) const;
@@ -141,7 +150,8 @@ class KDEVCMAKECOMMON_EXPORT CMakeProjectVisitor : CMakeAstVisitor
         
         static void setMessageCallback(message_callback f) { s_msgcallback=f; }
         
-        QStringList variableValue(const QString& var) const;
+        /** @p id is the id of @p var in the VariableMap, if it is known already */
+        QStringList variableValue(const QString& var, int id = -1) const;
         void setProperties(const CMakeProperties& properties) { m_props = properties; }
         QHash<QString, QString> targetAlias() { return m_targetAlias; }
         
@@ -171,8 +181,7 @@ class KDEVCMAKECOMMON_EXPORT CMakeProjectVisitor : CMakeAstVisitor
         
         void macroDeclaration(const CMakeFunctionDesc& def, const CMakeFunctionDesc& end, const QStringList& args);
         CMakeFunctionDesc resolveVariables(const CMakeFunctionDesc &exp);
-        QStringList value(const QString& exp, const QList<IntPair>& poss, int& desired) const;
-        QStringList theValue(const QString& exp, const IntPair& p) const;
+        QStringList resolveReference(const CMakeArgumentSegment& reference) const;
         
         void defineTarget(const QString& id, const QStringList& sources, Target::Type t);
         bool haveToFind(const QString &varName);
@@ -182,9 +191,6 @@ class KDEVCMAKECOMMON_EXPORT CMakeProjectVisitor : CMakeAstVisitor
         VisitorState stackTop() const;
         QStringList dependees(const QString& s) const;
         int declareFunction(Macro m, const CMakeFileContent& content, int initial, const QString& end);
-
-        QStringList traverseGlob(const QString& startPath, const QString& expression,
-            bool recursive = false, bool followSymlinks = false);
         
         CMakeProperties m_props;
         QStringList m_modulePath;
@@ -207,6 +213,8 @@ class KDEVCMAKECOMMON_EXPORT CMakeProjectVisitor : CMakeAstVisitor
         QHash<QString, QString> m_targetAlias;
 
         QVector<Test> m_testSuites;
+        /// Recorded by the const lookups as well, so it is mutable
+        mutable FileSystemDependencies m_dependencies;
 };
 
 #endif
@@ -24,6 +24,8 @@
 
 #include <language/duchain/indexeddeclaration.h>
 
+#include <QFileInfo>
+
 struct Macro
 {
     QString name;
@@ -67,11 +69,41 @@ struct Test
     QHash<QString, QString> properties;
 };
 
+/// A file(GLOB) or file(GLOB_RECURSE) expression and what it matched
+struct GlobDependency
+{
+    GlobDependency() : recursive(false), followSymlinks(false) {}
+    QString startPath;
+    QString expression;
+    bool recursive;
+    bool followSymlinks;
+    QStringList matches;
+};
+
+/**
+ * What interpreting a script took from the file system and the environment, besides the
+ * contents of the script. Its result only stays valid while all of these are unchanged.
+ */
+struct FileSystemDependencies
+{
+    enum PathState { Missing, File, Directory };
+    static int pathState(const QFileInfo& info) { return info.isDir() ? Directory : info.exists() ? File : Missing; }
+
+    /// The files whose contents were read, by include(), find_package() and file(READ) or file(STRINGS)
+    QStringList readFiles;
+    /// The state of the paths that were looked at, by find_*(), include(), find_package() and if(EXISTS) or if(IS_DIRECTORY)
+    QHash<QString, int> paths;
+    QVector<GlobDependency> globs;
+    /// The variables that were taken from the process environment, with their values
+    QHash<QString, QString> environment;
+};
+
 Q_DECLARE_TYPEINFO(Test, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(Subdirectory, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(Target, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(CacheEntry, Q_MOVABLE_TYPE);
 Q_DECLARE_TYPEINFO(Macro, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(GlobDependency, Q_MOVABLE_TYPE);
 
 enum PropertyType { GlobalProperty, DirectoryProperty, TargetProperty, SourceProperty, TestProperty, CacheProperty, VariableProperty };
 typedef QHash<QString, QMap<QString, QStringList> > CategoryType;
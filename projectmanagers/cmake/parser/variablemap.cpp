@@ -19,11 +19,147 @@
  */
 
 #include "variablemap.h"
-#include <QDebug>
+#include <QHash>
+#include <QAtomicInt>
+#include <QReadWriteLock>
+#include <QThreadStorage>
+#include <QVector>
+#include <kglobal.h>
+
+namespace
+{
+
+/// The ids a thread already looked up, so it does not take the lock of the VariableNames again
+struct VariableNamesCache
+{
+    VariableNamesCache() : size(0) {}
+    QHash<QString, int> ids;
+    /// The names that were not known while the table had @c size entries
+    QSet<QString> missing;
+    int size;
+};
+
+/**
+ * Maps the variable names to the ids, for all maps and threads.
+ *
+ * The ids never change and the names are never removed, so every thread keeps the ids it found
+ * and only takes the lock for the names it has not seen. A name that was not found stays unknown
+ * until another one is added, which is noticed through the size of the table.
+ */
+class VariableNames
+{
+public:
+    int id(const QString& name)
+    {
+        VariableNamesCache* cache = localCache();
+        QHash<QString, int>::const_iterator it = cache->ids.constFind(name);
+        if(it != cache->ids.constEnd())
+            return *it;
+
+        int id;
+        {
+            QReadLocker lock(&m_lock);
+            id = m_ids.value(name, -1);
+        }
+        if(id<0) {
+            QWriteLocker lock(&m_lock);
+            id = m_ids.value(name, -1);
+            if(id<0) {
+                id = m_names.size();
+                m_names += name;
+                m_ids.insert(name, id);
+                m_size.fetchAndStoreRelease(m_names.size());
+            }
+        }
+        cache->ids.insert(name, id);
+        return id;
+    }
+
+    /// @returns -1 if no variable was ever called @p name
+    int find(const QString& name)
+    {
+        VariableNamesCache* cache = localCache();
+        QHash<QString, int>::const_iterator it = cache->ids.constFind(name);
+        if(it != cache->ids.constEnd())
+            return *it;
+
+        const int size = m_size.fetchAndAddAcquire(0);
+        if(cache->size != size) {
+            cache->missing.clear();
+            cache->size = size;
+        } else if(cache->missing.contains(name))
+            return -1;
+
+        int id;
+        {
+            QReadLocker lock(&m_lock);
+            id = m_ids.value(name, -1);
+        }
+        if(id>=0)
+            cache->ids.insert(name, id);
+        else if(cache->missing.size() < maxMissing)
+            //conditions look up every argument, most of which are not variables
+            cache->missing.insert(name);
+        return id;
+    }
+
+    QString name(int id)
+    {
+        QReadLocker lock(&m_lock);
+        return m_names.at(id);
+    }
+
+private:
+    enum { maxMissing = 4096 };
+
+    VariableNamesCache* localCache()
+    {
+        VariableNamesCache* cache = m_caches.localData();
+        if(!cache) {
+            cache = new VariableNamesCache;
+            m_caches.setLocalData(cache);
+        }
+        return cache;
+    }
+
+    QReadWriteLock m_lock;
+    QHash<QString, int> m_ids;
+    QVector<QString> m_names;
+    /// The size of m_names, readable without the lock
+    QAtomicInt m_size;
+    QThreadStorage<VariableNamesCache*> m_caches;
+};
+
+K_GLOBAL_STATIC(VariableNames, s_names)
+
+}
+
+class VariableScope : public QSharedData
+{
+public:
+    /// The values by variable id. The values added by insertMulti hide the previous ones.
+    QHash<int, QStringList> variables;
+    QSharedDataPointer<VariableScope> parent;
+};
 
 VariableMap::VariableMap()
+    : m_top(new VariableScope)
+{
+}
+
+VariableMap::VariableMap(const VariableMap& other)
+    : m_top(other.m_top)
+{
+}
+
+VariableMap::~VariableMap()
+{
+}
+
+VariableMap& VariableMap::operator=(const VariableMap& other)
 {
-    m_scopes.push(QSet<QString>());
+    m_top = other.m_top;
+    return *this;
 }
 
 QStringList splitVariable(const QStringList& input)
@@ -39,60 +175,187 @@ QStringList splitVariable(const QStringList& input)
     return ret;
 }
 
-void VariableMap::insert(const QString& varName, const QStringList& value, bool parentScope)
+int VariableMap::variableId(const QString& varName)
+{
+    return s_names->id(varName);
+}
+
+QString VariableMap::variableName(int id)
+{
+    return s_names->name(id);
+}
+
+VariableScope* VariableMap::writableScope(int depth)
+{
+    VariableScope* scope = m_top.data();
+    for(; depth>0; --depth)
+        scope = scope->parent.data();
+    return scope;
+}
+
+int VariableMap::scopeDepth(int id) const
 {
-    QSet< QString >* current;
-//     qDebug() << "leeeeeeeeeeeeE" << varName << value << parentScope;
-    if(parentScope && m_scopes.size()>1) { //TODO: provide error?
-        current = &m_scopes[m_scopes.size()-2];
-        m_scopes.top().remove(varName);
-    } else
-        current = &m_scopes.top();
-    
-    QStringList ret = splitVariable(value);
-    
-    if(current->contains(varName))
-        (*this)[varName]=ret;
-    else {
-        current->insert(varName);
-        QHash<QString, QStringList>::insertMulti(varName, ret);
+    int depth = 0;
+    for(const VariableScope* scope = m_top.constData(); scope; scope = scope->parent.constData(), ++depth) {
+        if(scope->variables.contains(id))
+            return depth;
     }
-    
-//     QHash<QString, QStringList>::insert(varName, ret);
-//     qDebug() << "++++++++" << varName << QHash<QString, QStringList>::value(varName);
+    return -1;
 }
 
-QHash<QString, QStringList>::iterator VariableMap::insertMulti(const QString & varName, const QStringList & value)
+void VariableMap::insert(const QString& varName, const QStringList& value, bool parentScope)
 {
-    return QHash<QString, QStringList>::insertMulti(varName, splitVariable(value));
+    //TODO: provide error if there is no parent scope?
+    const bool hasParent = m_top.constData()->parent.constData();
+    writableScope(parentScope && hasParent ? 1 : 0)->variables.insert(variableId(varName), splitVariable(value));
+}
+
+void VariableMap::insertMulti(const QString & varName, const QStringList & value)
+{
+    writableScope(0)->variables.insertMulti(variableId(varName), splitVariable(value));
 }
 
 void VariableMap::insertGlobal(const QString& varName, const QStringList& value)
 {
-    QHash<QString, QStringList>::insert(varName, value);
+    const int id = variableId(varName);
+    int depth = scopeDepth(id);
+    if(depth<0) {
+        //the outermost scope is never popped
+        depth = 0;
+        for(const VariableScope* scope = m_top.constData()->parent.constData(); scope; scope = scope->parent.constData())
+            ++depth;
+    }
+    writableScope(depth)->variables.insert(id, value);
 }
 
 void VariableMap::pushScope()
 {
-    m_scopes.push(QSet<QString>());
+    VariableScope* scope = new VariableScope;
+    scope->parent = m_top;
+    m_top = scope;
 }
 
 void VariableMap::popScope()
 {
-    QSet<QString> t=m_scopes.pop();
-    foreach(const QString& var, t) {
-//         qDebug() << "removing........" << var << QHash<QString, QStringList>::value(var);
-        take(var);
+    const QSharedDataPointer<VariableScope> parent = m_top.constData()->parent;
+    Q_ASSERT(parent.constData());
+    if(parent.constData())
+        m_top = parent;
+}
+
+int VariableMap::remove(const QString& varName)
+{
+    const int id = s_names->find(varName);
+    int last = -1, depth = 0;
+    for(const VariableScope* scope = m_top.constData(); scope; scope = scope->parent.constData(), ++depth) {
+        if(scope->variables.contains(id))
+            last = depth;
     }
+
+    int removed = 0;
+    if(last>=0) {
+        VariableScope* scope = m_top.data();
+        for(depth = 0; ; scope = scope->parent.data(), ++depth) {
+            removed += scope->variables.remove(id);
+            if(depth==last)
+                break;
+        }
+    }
+    return removed;
 }
 
 int VariableMap::removeMulti(const QString& varName)
 {
-    iterator it = find(varName);
-    if(it==end())
+    const int id = s_names->find(varName);
+    const int depth = scopeDepth(id);
+    if(depth<0)
         return 0;
-    else {
-        erase(it);
-        return 1;
+
+    QHash<int, QStringList>& variables = writableScope(depth)->variables;
+    variables.erase(variables.find(id));
+    return 1;
+}
+
+const QStringList* VariableMap::find(int id) const
+{
+    for(const VariableScope* scope = m_top.constData(); scope; scope = scope->parent.constData()) {
+        QHash<int, QStringList>::const_iterator it = scope->variables.constFind(id);
+        if(it != scope->variables.constEnd())
+            return &*it;
     }
+    return 0;
+}
+
+const QStringList* VariableMap::find(const QString& varName) const
+{
+    const int id = s_names->find(varName);
+    return id<0 ? 0 : find(id);
+}
+
+bool VariableMap::contains(int id) const
+{
+    return find(id) != 0;
+}
+
+bool VariableMap::contains(const QString& varName) const
+{
+    return find(varName) != 0;
+}
+
+QStringList VariableMap::value(int id) const
+{
+    const QStringList* value = find(id);
+    return value ? *value : QStringList();
+}
+
+QStringList VariableMap::value(const QString& varName) const
+{
+    const QStringList* value = find(varName);
+    return value ? *value : QStringList();
+}
+
+QList<QStringList> VariableMap::values(const QString& varName) const
+{
+    const int id = s_names->find(varName);
+    QList<QStringList> ret;
+    for(const VariableScope* scope = m_top.constData(); id>=0 && scope; scope = scope->parent.constData())
+        ret += scope->variables.values(id);
+    return ret;
+}
+
+QStringList VariableMap::uniqueKeys() const
+{
+    QSet<int> ids;
+    for(const VariableScope* scope = m_top.constData(); scope; scope = scope->parent.constData()) {
+        for(QHash<int, QStringList>::const_iterator it = scope->variables.constBegin(); it != scope->variables.constEnd(); ++it)
+            ids.insert(it.key());
+    }
+
+    QStringList ret;
+    foreach(int id, ids)
+        ret += variableName(id);
+    return ret;
+}
+
+bool VariableMap::isEmpty() const
+{
+    for(const VariableScope* scope = m_top.constData(); scope; scope = scope->parent.constData()) {
+        if(!scope->variables.isEmpty())
+            return false;
+    }
+    return true;
+}
+
+QSet<QString> VariableMap::currentScope() const
+{
+    QSet<QString> ret;
+    const QHash<int, QStringList>& variables = m_top.constData()->variables;
+    for(QHash<int, QStringList>::const_iterator it = variables.constBegin(); it != variables.constEnd(); ++it)
+        ret.insert(variableName(it.key()));
+    return ret;
+}
+
+void VariableMap::clear()
+{
+    m_top = new VariableScope;
 }
@@ -21,29 +21,54 @@
 #ifndef CMAKE_VARIABLEMAP_H
 #define CMAKE_VARIABLEMAP_H
 
-#include <QHash>
+#include <QSharedDataPointer>
 #include <QStringList>
 #include "cmakeexport.h"
 #include <QSet>
-#include <QStack>
 
-class KDEVCMAKECOMMON_EXPORT VariableMap : public QHash<QString, QStringList>
+class VariableScope;
+
+/**
+ * The variables visible while interpreting CMake code.
+ *
+ * Every scope only stores the variables that were set in it, and points to its parent scope.
+ * The scopes are shared between copies of the map, so copying the map and pushing a scope are
+ * cheap, and a scope is only copied when it is changed while shared.
+ *
+ * Variable names are interned to integer ids, which can be used for the lookups instead of the names.
+ */
+class KDEVCMAKECOMMON_EXPORT VariableMap
 {
     public:
         VariableMap();
-//         bool contains(const QString& varName) const;
+        VariableMap(const VariableMap& other);
+        ~VariableMap();
+        VariableMap& operator=(const VariableMap& other);
+
         void insert(const QString& varName, const QStringList& value, bool parentScope = false);
         
         ///only for very special cases, usually should use insert. bypasses scopes
-        iterator insertMulti(const QString& varName, const QStringList& value);
+        void insertMulti(const QString& varName, const QStringList& value);
         
-//         QStringList value(const QString& varName) const;
-//         QStringList take(const QString& varName);
-//         int remove(const QString& varName);
+        /** removes the variable from all scopes */
+        int remove(const QString& varName);
+        /** removes the value added last by insertMulti */
         int removeMulti(const QString& varName);
-// 
-//         int size() const { return QHash<QString, QStringList>::size(); }
-//         QStringList keys() const { return QHash<QString, QStringList>::keys(); }
+
+        bool contains(const QString& varName) const;
+        bool contains(int id) const;
+        QStringList value(const QString& varName) const;
+        QStringList value(int id) const;
+        /** @returns the value of the variable, or 0 if it is not set. Only valid until the map changes */
+        const QStringList* find(const QString& varName) const;
+        const QStringList* find(int id) const;
+        /** @returns all the values of the variable, the visible one first */
+        QList<QStringList> values(const QString& varName) const;
+        /** @returns the names of all variables that are set */
+        QStringList uniqueKeys() const;
+        bool isEmpty() const;
+        void clear();
+
         static QString regexVar() { return "\\$\\{[A-z0-9\\-._:]+\\}"; }
 #ifdef Q_OS_WIN
         static QString regexEnvVar() { return "\\$ENV\\{[A-z0-9\\-._:]+\\}"; }
@@ -55,8 +80,20 @@ class KDEVCMAKECOMMON_EXPORT VariableMap : public QHash<QString, QStringList>
         
         /** will create a variable without adding a scope on it */
         void insertGlobal(const QString& key, const QStringList& value);
+
+        /** @returns the names of the variables that were set in the innermost scope */
+        QSet<QString> currentScope() const;
+
+        /** @returns the id of the variable called @p varName, the same name always gets the same id */
+        static int variableId(const QString& varName);
+        static QString variableName(int id);
     private:
-        QStack<QSet<QString> > m_scopes;
+        /** @returns the scope @p depth levels below the innermost one, copying the shared scopes on the way */
+        VariableScope* writableScope(int depth);
+        /** @returns how many levels below the innermost scope @p id is set, or -1 */
+        int scopeDepth(int id) const;
+
+        QSharedDataPointer<VariableScope> m_top;
 };
 
 #endif
@@ -106,7 +106,7 @@ CMakeProjectVisitor CMakeCompliance::parseFile( const QString& sourcefile )
     KDevelop::ReferencedTopDUContext buildstrapContext=new TopDUContext(IndexedString("buildstrap"), RangeInRevision(0,0, 0,0));
     DUChain::self()->addDocumentChain(buildstrapContext);
     ReferencedTopDUContext ref=buildstrapContext;
-    QStringList modulesPath = data.vm["CMAKE_MODULE_PATH"];
+    QStringList modulesPath = data.vm.value("CMAKE_MODULE_PATH");
     
     foreach(const QString& script, initials.second)
     {
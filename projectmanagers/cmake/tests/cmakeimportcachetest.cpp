@@ -0,0 +1,294 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "cmakeimportcachetest.h"
+#include "cmakeimportcache.h"
+#include "cmakeprojectdata.h"
+#include "cmakeprojectvisitor.h"
+
+#include <KTempDir>
+
+QTEST_MAIN( CMakeImportCacheTest )
+
+static void writeFile(const QString& path, const QByteArray& contents)
+{
+    QFile f(path);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.write(contents);
+}
+
+/// The data the interpretation of a directory starts from
+static CMakeProjectData initialData()
+{
+    CMakeProjectData data;
+    data.vm.insertGlobal("CMAKE_SOURCE_DIR", QStringList("/src"));
+    data.vm.insertGlobal("GLOBAL", QStringList("old"));
+    data.vm.insertGlobal("REMOVED", QStringList("x"));
+    data.properties[DirectoryProperty]["/src"]["INCLUDE_DIRECTORIES"] = QStringList("/src/include");
+    data.vm.pushScope();
+    return data;
+}
+
+/// What the interpretation of the directory would make of initialData()
+static CMakeProjectData interpretedData()
+{
+    CMakeProjectData data = initialData();
+    data.projectName = "test";
+    data.vm.insert("LOCAL", QStringList() << "a" << "b");
+    data.vm.insertGlobal("GLOBAL", QStringList("new"));
+    data.vm.remove("REMOVED");
+
+    Target target;
+    target.name = "lib";
+    target.type = Target::Library;
+    target.files = QStringList() << "a.cpp" << "b.cpp";
+    target.desc = CMakeFunctionDesc("add_library", QStringList() << "lib" << "a.cpp" << "b.cpp");
+    data.targets += target;
+    data.properties[TargetProperty]["lib"]["COMPILE_DEFINITIONS"] = QStringList("LIB");
+    data.definitions.insert("DIR", "1");
+
+    Macro macro;
+    macro.name = "my_macro";
+    macro.isFunction = false;
+    macro.knownArgs = QStringList("ARG");
+    data.mm.insert(macro.name, macro);
+    return data;
+}
+
+void CMakeImportCacheTest::testKey()
+{
+    KTempDir dir;
+    const QString cmakeLists = dir.name() + "CMakeLists.txt";
+    writeFile(cmakeLists, "project(test)\n");
+
+    const CMakeProjectData data = initialData();
+    QByteArray key = CMakeImportCache(dir.name() + "cache", CacheValues()).key(cmakeLists, data);
+    QCOMPARE(CMakeImportCache(dir.name() + "cache", CacheValues()).key(cmakeLists, data), key);
+
+    CMakeProjectData other = data;
+    other.vm.insertGlobal("GLOBAL", QStringList("changed"));
+    QVERIFY(CMakeImportCache(dir.name() + "cache", CacheValues()).key(cmakeLists, other) != key);
+
+    CacheValues cache;
+    cache.insert("CMAKE_BUILD_TYPE", CacheEntry("Debug"));
+    QVERIFY(CMakeImportCache(dir.name() + "cache", cache).key(cmakeLists, data) != key);
+
+    writeFile(cmakeLists, "project(other)\n");
+    QVERIFY(CMakeImportCache(dir.name() + "cache", CacheValues()).key(cmakeLists, data) != key);
+}
+
+void CMakeImportCacheTest::testRestore()
+{
+    KTempDir dir;
+    const QString cacheFile = dir.name() + "cache";
+    const QString cmakeLists = dir.name() + "CMakeLists.txt";
+    writeFile(cmakeLists, "project(test)\n");
+
+    QByteArray key;
+    {
+        CMakeImportCache cache(cacheFile, CacheValues());
+        QVERIFY(!cache.load());
+        key = cache.key(cmakeLists, initialData());
+        cache.store(dir.name(), key, initialData(), interpretedData(), FileSystemDependencies());
+        QVERIFY(cache.save());
+    }
+
+    CMakeImportCache cache(cacheFile, CacheValues());
+    QVERIFY(cache.load());
+    QCOMPARE(cache.size(), 1);
+
+    CMakeProjectData data = initialData();
+    QVERIFY(!cache.restore(dir.name(), "other key", &data));
+    QVERIFY(!cache.restore("/other", key, &data));
+    QVERIFY(cache.restore(dir.name(), key, &data));
+
+    const CMakeProjectData expected = interpretedData();
+    QCOMPARE(data.projectName, expected.projectName);
+    QCOMPARE(data.vm.value("LOCAL"), QStringList() << "a" << "b");
+    QCOMPARE(data.vm.value("GLOBAL"), QStringList("new"));
+    QVERIFY(!data.vm.contains("REMOVED"));
+    QCOMPARE(data.targets.size(), 1);
+    QCOMPARE(data.targets.first().name, QString("lib"));
+    QCOMPARE(data.targets.first().files, expected.targets.first().files);
+    QVERIFY(data.targets.first().desc == expected.targets.first().desc);
+    QCOMPARE(data.properties, expected.properties);
+    QCOMPARE(data.definitions, expected.definitions);
+    QVERIFY(data.mm.contains("my_macro"));
+    QCOMPARE(data.mm["my_macro"].knownArgs, QStringList("ARG"));
+
+    //the variables of the directory are still removed with its scope
+    data.vm.popScope();
+    QVERIFY(!data.vm.contains("LOCAL"));
+}
+
+void CMakeImportCacheTest::testIncludedFileChanged()
+{
+    KTempDir dir;
+    const QString cmakeLists = dir.name() + "CMakeLists.txt";
+    const QString module = dir.name() + "Module.cmake";
+    writeFile(cmakeLists, "include(Module)\n");
+    writeFile(module, "set(A 1)\n");
+
+    QByteArray key;
+    {
+        CMakeImportCache cache(dir.name() + "cache", CacheValues());
+        key = cache.key(cmakeLists, initialData());
+        FileSystemDependencies dependencies;
+        dependencies.readFiles += module;
+        cache.store(dir.name(), key, initialData(), interpretedData(), dependencies);
+        QVERIFY(cache.save());
+    }
+
+    {
+        CMakeImportCache cache(dir.name() + "cache", CacheValues());
+        QVERIFY(cache.load());
+        CMakeProjectData data = initialData();
+        QVERIFY(cache.restore(dir.name(), key, &data));
+    }
+
+    writeFile(module, "set(A 2)\n");
+    CMakeImportCache cache(dir.name() + "cache", CacheValues());
+    QVERIFY(cache.load());
+    CMakeProjectData data = initialData();
+    QVERIFY(!cache.restore(dir.name(), key, &data));
+    QVERIFY(!data.vm.contains("LOCAL"));
+}
+
+/// Stores interpretedData() for @p directory with @p dependencies, @returns whether it is restored after @p change
+static bool restoredAfter(const QString& directory, const FileSystemDependencies& dependencies, void (*change)(const QString&))
+{
+    const QString cacheFile = directory + "cache";
+    const QString cmakeLists = directory + "CMakeLists.txt";
+    QByteArray key;
+    {
+        CMakeImportCache cache(cacheFile, CacheValues());
+        key = cache.key(cmakeLists, initialData());
+        cache.store(directory, key, initialData(), interpretedData(), dependencies);
+        cache.save();
+    }
+
+    if (change)
+        change(directory);
+
+    CMakeImportCache cache(cacheFile, CacheValues());
+    cache.load();
+    CMakeProjectData data = initialData();
+    return cache.restore(directory, key, &data);
+}
+
+static void createSource(const QString& directory)
+{
+    writeFile(directory + "new.cpp", "int main() {}\n");
+}
+
+static void createModule(const QString& directory)
+{
+    writeFile(directory + "FindFoo.cmake", "set(FOO_FOUND TRUE)\n");
+}
+
+static void changeEnvironment(const QString&)
+{
+    qputenv("KDEV_CMAKE_IMPORT_CACHE_TEST", "changed");
+}
+
+void CMakeImportCacheTest::testGlobChanged()
+{
+    KTempDir dir;
+    writeFile(dir.name() + "CMakeLists.txt", "file(GLOB srcs *.cpp)\n");
+    writeFile(dir.name() + "main.cpp", "int main() {}\n");
+
+    FileSystemDependencies dependencies;
+    GlobDependency glob;
+    glob.startPath = dir.name();
+    glob.expression = "*.cpp";
+    glob.matches = CMakeProjectVisitor::traverseGlob(glob.startPath, glob.expression);
+    QCOMPARE(glob.matches.size(), 1);
+    dependencies.globs += glob;
+
+    QVERIFY(restoredAfter(dir.name(), dependencies, 0));
+    QVERIFY(!restoredAfter(dir.name(), dependencies, createSource));
+}
+
+void CMakeImportCacheTest::testPathStateChanged()
+{
+    KTempDir dir;
+    writeFile(dir.name() + "CMakeLists.txt", "find_package(Foo)\n");
+
+    FileSystemDependencies dependencies;
+    const QString module = dir.name() + "FindFoo.cmake";
+    dependencies.paths.insert(module, FileSystemDependencies::pathState(QFileInfo(module)));
+    QCOMPARE(dependencies.paths.value(module), int(FileSystemDependencies::Missing));
+
+    QVERIFY(restoredAfter(dir.name(), dependencies, 0));
+    QVERIFY(!restoredAfter(dir.name(), dependencies, createModule));
+}
+
+void CMakeImportCacheTest::testEnvironmentChanged()
+{
+    KTempDir dir;
+    const QString cmakeLists = dir.name() + "CMakeLists.txt";
+    writeFile(cmakeLists, "set(A $ENV{KDEV_CMAKE_IMPORT_CACHE_TEST})\n");
+
+    //the environment profile is part of the key
+    QMap<QString, QString> environment;
+    environment.insert("PATH", "/usr/bin");
+    const QByteArray key = CMakeImportCache(dir.name() + "cache", CacheValues(), environment).key(cmakeLists, initialData());
+    QCOMPARE(CMakeImportCache(dir.name() + "cache", CacheValues(), environment).key(cmakeLists, initialData()), key);
+    environment.insert("PATH", "/opt/bin");
+    QVERIFY(CMakeImportCache(dir.name() + "cache", CacheValues(), environment).key(cmakeLists, initialData()) != key);
+
+    //the process environment is checked on restore
+    qputenv("KDEV_CMAKE_IMPORT_CACHE_TEST", "value");
+    FileSystemDependencies dependencies;
+    dependencies.environment.insert("KDEV_CMAKE_IMPORT_CACHE_TEST", "value");
+    QVERIFY(restoredAfter(dir.name(), dependencies, 0));
+    QVERIFY(!restoredAfter(dir.name(), dependencies, changeEnvironment));
+}
+
+void CMakeImportCacheTest::testRemovedDirectoryPruned()
+{
+    KTempDir dir;
+    const QString cacheFile = dir.name() + "cache";
+    const QString removed = dir.name() + "removed/";
+    QVERIFY(QDir().mkpath(removed));
+    writeFile(dir.name() + "CMakeLists.txt", "add_subdirectory(removed)\n");
+    writeFile(removed + "CMakeLists.txt", "project(removed)\n");
+
+    {
+        CMakeImportCache cache(cacheFile, CacheValues());
+        cache.store(dir.name(), cache.key(dir.name() + "CMakeLists.txt", initialData()), initialData(), interpretedData(), FileSystemDependencies());
+        cache.store(removed, cache.key(removed + "CMakeLists.txt", initialData()), initialData(), interpretedData(), FileSystemDependencies());
+        QVERIFY(cache.save());
+    }
+
+    QVERIFY(QFile::remove(removed + "CMakeLists.txt"));
+    QVERIFY(QDir().rmdir(removed));
+
+    {
+        CMakeImportCache cache(cacheFile, CacheValues());
+        QVERIFY(cache.load());
+        QCOMPARE(cache.size(), 1);
+        QVERIFY(cache.save());
+    }
+
+    CMakeImportCache cache(cacheFile, CacheValues());
+    QVERIFY(cache.load());
+    QCOMPARE(cache.size(), 1);
+}
+
+#include "cmakeimportcachetest.moc"
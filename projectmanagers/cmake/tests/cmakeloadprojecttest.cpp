@@ -165,7 +165,7 @@ CMakeProjectData CMakeLoadProjectTest::parseProject( const QString& sourcedir )
     KDevelop::ReferencedTopDUContext buildstrapContext=new TopDUContext(IndexedString("buildstrap"), RangeInRevision(0,0, 0,0));
     DUChain::self()->addDocumentChain(buildstrapContext);
     ReferencedTopDUContext ref=buildstrapContext;
-    QStringList modulesPath = data.vm["CMAKE_MODULE_PATH"];
+    QStringList modulesPath = data.vm.value("CMAKE_MODULE_PATH");
     foreach(const QString& script, initials.second)
     {
         ref = CMakeParserUtils::includeScript(CMakeProjectVisitor::findFile(script, modulesPath, QStringList()), ref, &data, sourcedir, QMap<QString,QString>());
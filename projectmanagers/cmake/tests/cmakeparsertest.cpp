@@ -24,6 +24,7 @@
 #include "cmListFileLexer.h"
 #include "cmakelistsparser.h"
 #include "cmakeast.h"
+#include "variablemap.h"
 
 QTEST_MAIN( CMakeParserTest )
 
@@ -123,6 +124,59 @@ void CMakeParserTest::testParserWithBadData_data()
     QTest::newRow( "bad data 4" ) << "project(foo) set(mysrcs_SRCS foo.c)";
 }
 
+static QString printSegments(const QList<CMakeArgumentSegment>& segments)
+{
+    QStringList ret;
+    foreach(const CMakeArgumentSegment& segment, segments)
+    {
+        const QString name = segment.name.isEmpty() ? segment.text : '[' + printSegments(segment.name) + ']';
+        switch(segment.type)
+        {
+            case CMakeArgumentSegment::Literal:
+                ret += segment.text;
+                break;
+            case CMakeArgumentSegment::Variable:
+                ret += "${" + name + '}';
+                if(segment.name.isEmpty() && segment.id!=VariableMap::variableId(segment.text))
+                    ret += "wrong id";
+                break;
+            case CMakeArgumentSegment::Environment:
+                ret += "$ENV{" + name + '}';
+                break;
+            case CMakeArgumentSegment::Unknown:
+                ret += '?' + segment.text;
+                break;
+        }
+    }
+    return ret.join("|");
+}
+
+void CMakeParserTest::testReferences()
+{
+    QFETCH(QString, value);
+    QFETCH(QString, segments);
+
+    QCOMPARE(printSegments(CMakeFunctionArgument::parseReferences(value)), segments);
+}
+
+void CMakeParserTest::testReferences_data()
+{
+    QTest::addColumn<QString>( "value" );
+    QTest::addColumn<QString>( "segments" );
+
+    QTest::newRow( "none" ) << "abc" << "";
+    QTest::newRow( "simple" ) << "${a}" << "${a}";
+    QTest::newRow( "literals" ) << "x;${a}/y" << "x;|${a}|/y";
+    QTest::newRow( "two" ) << "${a}${b}" << "${a}|${b}";
+    QTest::newRow( "env" ) << "$ENV{HOME}/bin" << "$ENV{HOME}|/bin";
+    QTest::newRow( "nested" ) << "${a${b}c}" << "${[a|${b}|c]}";
+    QTest::newRow( "nested twice" ) << "${${${a}}}" << "${[${[${a}]}]}";
+    QTest::newRow( "unclosed" ) << "${a" << "${a";
+    QTest::newRow( "unclosed outer" ) << "${${a}" << "${|${a}";
+    QTest::newRow( "dollar" ) << "a$b" << "a$b";
+    QTest::newRow( "unknown" ) << "x$FOO{y}" << "x|?$FOO{y}";
+}
+
 // void CMakeParserTest::testAstCreation()
 // {
 
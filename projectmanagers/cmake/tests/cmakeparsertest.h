@@ -46,6 +46,9 @@ private slots:
     void testParserWithBadData();
     void testParserWithBadData_data();
 
+    void testReferences();
+    void testReferences_data();
+
     //void testAstCreation();
 
     // void testWhitespaceHandling();
@@ -865,9 +865,9 @@ void CMakeProjectVisitorTest::testGlobs()
     v.setCacheValues( &val );
     v.walk(code, 0);
 
-    VariableMap::const_iterator it = v.variables()->constFind("RESULT");
-    QVERIFY2(it != v.variables()->constEnd(), "RESULT variable doesn't exist");
-    QStringList filesFound = it.value();
+    const QStringList* result = v.variables()->find("RESULT");
+    QVERIFY2(result, "RESULT variable doesn't exist");
+    QStringList filesFound = *result;
     QDir baseDir(dir.name());
     for (int i = 0; i < filesFound.size(); i++)
     {
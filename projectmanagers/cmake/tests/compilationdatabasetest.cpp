@@ -0,0 +1,188 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "compilationdatabasetest.h"
+#include "compilationdatabase.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <KTempDir>
+
+using namespace KDevelop;
+
+QTEST_MAIN( CompilationDatabaseTest )
+
+static const char* const database =
+    "[\n"
+    "{\n"
+    "  \"directory\": \"/build/src\",\n"
+    "  \"command\": \"/usr/bin/c++ -DQT_NO_CAST=1 -DNAME=\\\\\\\"kdev\\\\\\\" -I/src/include -I../generated -isystem /usr/include/qt4"
+                   " -o main.o -c /src/main.cpp\",\n"
+    "  \"file\": \"/src/main.cpp\"\n"
+    "},\n"
+    "{\n"
+    "  \"directory\": \"/build/src/lib\",\n"
+    "  \"arguments\": [\"c++\", \"-DLIB\", \"-D\", \"SHARED\", \"-UNDEBUG\", \"-I\", \"/src/lib\", \"-c\", \"util.cpp\"],\n"
+    "  \"file\": \"/src/lib/util.cpp\",\n"
+    "  \"output\": [1, 2.5e3, true, null, {\"a\": []}]\n"
+    "}\n"
+    "]\n";
+
+void CompilationDatabaseTest::testSplitCommand()
+{
+    QFETCH(QString, command);
+    QFETCH(QStringList, arguments);
+    QCOMPARE(CompilationDatabase::splitCommand(command), arguments);
+}
+
+void CompilationDatabaseTest::testSplitCommand_data()
+{
+    QTest::addColumn<QString>("command");
+    QTest::addColumn<QStringList>("arguments");
+
+    QTest::newRow("plain") << QString("c++  -c   main.cpp ") << (QStringList() << "c++" << "-c" << "main.cpp");
+    QTest::newRow("double quotes") << QString("c++ \"-DA=a b\" x") << (QStringList() << "c++" << "-DA=a b" << "x");
+    QTest::newRow("single quotes") << QString("c++ '-DA=\\\"' x") << (QStringList() << "c++" << "-DA=\\\"" << "x");
+    QTest::newRow("escaped quote") << QString("c++ -DA=\\\"a\\\"") << (QStringList() << "c++" << "-DA=\"a\"");
+    QTest::newRow("empty argument") << QString("c++ \"\" x") << (QStringList() << "c++" << QString() << "x");
+    QTest::newRow("escaped space") << QString("c++ -I/a\\ b") << (QStringList() << "c++" << "-I/a b");
+}
+
+void CompilationDatabaseTest::testRead()
+{
+    QBuffer buffer;
+    buffer.setData(database);
+    buffer.open(QIODevice::ReadOnly);
+
+    CompilationDatabase db;
+    QVERIFY(db.read(&buffer));
+    QCOMPARE(db.size(), 2);
+
+    CompilationDatabase::CompileFlags flags;
+    QVERIFY(db.flags(Path("/src/main.cpp"), &flags));
+    QCOMPARE(flags.includes.size(), 3);
+    QCOMPARE(flags.includes[0].toLocalFile(), QString("/src/include"));
+    QCOMPARE(flags.includes[1].toLocalFile(), QString("/build/generated"));
+    QCOMPARE(flags.includes[2].toLocalFile(), QString("/usr/include/qt4"));
+    QCOMPARE(flags.defines.size(), 2);
+    QCOMPARE(flags.defines.value("QT_NO_CAST"), QString("1"));
+    QCOMPARE(flags.defines.value("NAME"), QString("\"kdev\""));
+
+    QVERIFY(db.flags(Path("/src/lib/util.cpp"), &flags));
+    QCOMPARE(flags.includes.size(), 1);
+    QCOMPARE(flags.includes[0].toLocalFile(), QString("/src/lib"));
+    QCOMPARE(flags.defines.size(), 2);
+    QVERIFY(flags.defines.contains("LIB"));
+    QVERIFY(flags.defines.contains("SHARED"));
+
+    //files that are not compiled use the flags of their directory, or else the closest parent
+    QVERIFY(db.flags(Path("/src/lib/util.h"), &flags));
+    QVERIFY(flags.defines.contains("LIB"));
+    QVERIFY(db.flags(Path("/src/other/other.h"), &flags));
+    QVERIFY(flags.defines.contains("QT_NO_CAST"));
+    QVERIFY(!db.flags(Path("/elsewhere/file.h"), &flags));
+}
+
+void CompilationDatabaseTest::testMalformed()
+{
+    QBuffer buffer;
+    buffer.setData("[{\"directory\": \"/build\", \"file\": \"/src/a.cpp\", \"command\": \"c++ -DA\"}, {\"file\": ");
+    buffer.open(QIODevice::ReadOnly);
+
+    CompilationDatabase db;
+    QVERIFY(!db.read(&buffer));
+    QVERIFY(db.isEmpty());
+}
+
+void CompilationDatabaseTest::testUpToDate()
+{
+    KTempDir dir;
+    const Path file(Path(dir.name()), "compile_commands.json");
+    QFile f(file.toLocalFile());
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.write(database);
+    f.close();
+
+    CompilationDatabase db;
+    QVERIFY(!db.isUpToDate(file));
+    QVERIFY(db.read(file));
+    QVERIFY(db.isUpToDate(file));
+    QVERIFY(!db.isUpToDate(Path(Path(dir.name()), "other.json")));
+
+    //the modification time only has a resolution of seconds
+    QTest::qSleep(1100);
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.write("[]");
+    f.close();
+    QVERIFY(!db.isUpToDate(file));
+    QVERIFY(db.read(file));
+    QVERIFY(db.isEmpty());
+
+    QVERIFY(QFile::remove(file.toLocalFile()));
+    QVERIFY(!db.isUpToDate(file));
+    QVERIFY(!db.read(file));
+}
+
+static void writeFile(const Path& path, const QByteArray& contents)
+{
+    QFile f(path.toLocalFile());
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    f.write(contents);
+}
+
+void CompilationDatabaseTest::testStale()
+{
+    KTempDir dir;
+    const Path root(dir.name());
+    QVERIFY(QDir(root.toLocalFile()).mkpath("src/lib"));
+    QVERIFY(QDir(root.toLocalFile()).mkpath("build"));
+    writeFile(Path(root, "CMakeLists.txt"), "add_subdirectory(src)\n");
+    writeFile(Path(root, "src/CMakeLists.txt"), "add_subdirectory(lib)\n");
+    writeFile(Path(root, "src/lib/CMakeLists.txt"), "add_library(lib util.cpp)\n");
+    const Path cache(root, "build/CMakeCache.txt");
+    writeFile(cache, "CMAKE_BUILD_TYPE:STRING=Debug\n");
+
+    const Path file(root, "build/compile_commands.json");
+    const QByteArray contents = "[{\"directory\": \"" + Path(root, "build").toLocalFile().toUtf8()
+        + "\", \"command\": \"c++ -c util.cpp\", \"file\": \"" + Path(root, "src/lib/util.cpp").toLocalFile().toUtf8() + "\"}]";
+
+    //the modification time only has a resolution of seconds
+    QTest::qSleep(1100);
+    writeFile(file, contents);
+
+    CompilationDatabase db;
+    QVERIFY(db.isStale(root, cache));
+    QVERIFY(db.read(file));
+    QVERIFY(!db.isStale(root, cache));
+
+    //a parent of the directory with the compiled file
+    QTest::qSleep(1100);
+    writeFile(Path(root, "src/CMakeLists.txt"), "add_subdirectory(lib)\nadd_definitions(-DA)\n");
+    QVERIFY(db.isStale(root, cache));
+
+    QTest::qSleep(1100);
+    writeFile(file, contents);
+    QVERIFY(db.read(file));
+    QVERIFY(!db.isStale(root, cache));
+
+    QTest::qSleep(1100);
+    writeFile(cache, "CMAKE_BUILD_TYPE:STRING=Release\n");
+    QVERIFY(db.isStale(root, cache));
+}
+
+#include "compilationdatabasetest.moc"
@@ -0,0 +1,135 @@
+/* KDevelop CMake Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "variablemaptest.h"
+#include "variablemap.h"
+
+QTEST_MAIN( VariableMapTest )
+
+void VariableMapTest::testScopes()
+{
+    VariableMap vm;
+    vm.insert("A", QStringList("outer"));
+    vm.pushScope();
+    QCOMPARE(vm.value("A"), QStringList("outer"));
+
+    vm.insert("A", QStringList("inner"));
+    vm.insert("B", QStringList() << "x;y" << "z");
+    QCOMPARE(vm.value("A"), QStringList("inner"));
+    QCOMPARE(vm.value("B"), QStringList() << "x" << "y" << "z");
+    QCOMPARE(vm.currentScope(), QSet<QString>() << "A" << "B");
+    QCOMPARE(vm.values("A"), QList<QStringList>() << QStringList("inner") << QStringList("outer"));
+
+    vm.popScope();
+    QCOMPARE(vm.value("A"), QStringList("outer"));
+    QVERIFY(!vm.contains("B"));
+    QCOMPARE(vm.uniqueKeys(), QStringList("A"));
+}
+
+void VariableMapTest::testParentScope()
+{
+    VariableMap vm;
+    vm.insert("A", QStringList("outer"));
+    vm.pushScope();
+    vm.insert("A", QStringList("inner"));
+    vm.insert("A", QStringList("parent"), true);
+    QCOMPARE(vm.value("A"), QStringList("inner"));
+    vm.popScope();
+    QCOMPARE(vm.value("A"), QStringList("parent"));
+
+    //without a parent scope, the current one is used
+    vm.insert("B", QStringList("b"), true);
+    QCOMPARE(vm.value("B"), QStringList("b"));
+}
+
+void VariableMapTest::testMulti()
+{
+    VariableMap vm;
+    vm.insert("ARG", QStringList("outer"));
+    vm.insertMulti("ARG", QStringList("arg"));
+    QCOMPARE(vm.value("ARG"), QStringList("arg"));
+
+    vm.insert("ARG", QStringList("changed"));
+    QCOMPARE(vm.value("ARG"), QStringList("changed"));
+
+    QCOMPARE(vm.removeMulti("ARG"), 1);
+    QCOMPARE(vm.value("ARG"), QStringList("outer"));
+    QCOMPARE(vm.removeMulti("ARG"), 1);
+    QVERIFY(!vm.contains("ARG"));
+    QCOMPARE(vm.removeMulti("ARG"), 0);
+}
+
+void VariableMapTest::testGlobal()
+{
+    VariableMap vm;
+    vm.pushScope();
+    vm.insertGlobal("G", QStringList("global"));
+    vm.insert("A", QStringList("a"));
+    vm.pushScope();
+    vm.insertGlobal("A", QStringList("changed"));
+    vm.popScope();
+    QCOMPARE(vm.value("A"), QStringList("changed"));
+
+    //variables without a scope stay after all scopes are popped
+    vm.popScope();
+    QCOMPARE(vm.value("G"), QStringList("global"));
+    QVERIFY(!vm.contains("A"));
+}
+
+void VariableMapTest::testRemove()
+{
+    VariableMap vm;
+    vm.insert("A", QStringList("outer"));
+    vm.pushScope();
+    vm.insert("A", QStringList("inner"));
+    QCOMPARE(vm.remove("A"), 2);
+    QVERIFY(!vm.contains("A"));
+    vm.popScope();
+    QVERIFY(!vm.contains("A"));
+    QCOMPARE(vm.remove("A"), 0);
+    QCOMPARE(vm.remove("never set"), 0);
+    QVERIFY(vm.isEmpty());
+}
+
+void VariableMapTest::testCopies()
+{
+    VariableMap parent;
+    parent.insert("A", QStringList("a"));
+    parent.pushScope();
+    parent.insert("B", QStringList("b"));
+
+    VariableMap child = parent;
+    child.insert("B", QStringList("child"));
+    child.insertGlobal("A", QStringList("child"));
+    child.remove("B");
+    child.pushScope();
+    child.insert("C", QStringList("c"));
+
+    QCOMPARE(parent.value("A"), QStringList("a"));
+    QCOMPARE(parent.value("B"), QStringList("b"));
+    QVERIFY(!parent.contains("C"));
+    QCOMPARE(child.value("A"), QStringList("child"));
+    QVERIFY(!child.contains("B"));
+
+    parent.popScope();
+    QCOMPARE(parent.value("A"), QStringList("a"));
+    QCOMPARE(VariableMap::variableName(VariableMap::variableId("A")), QString("A"));
+    QCOMPARE(parent.value(VariableMap::variableId("A")), QStringList("a"));
+}
+
+#include "variablemaptest.moc"